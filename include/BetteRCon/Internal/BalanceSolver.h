@@ -0,0 +1,144 @@
+#ifndef BETTERCON_INTERNAL_BALANCESOLVER_H_
+#define BETTERCON_INTERNAL_BALANCESOLVER_H_
+
+/*
+ *	Team Balance Solver
+ *	10/18/26 21:10
+ */
+
+// STL
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	BalanceSolver plans moves between teams. Requested moves are planned first, in
+		 *	order, as long as they keep the teams within limits. Then whole squads are moved
+		 *	or swapped between the strongest and weakest teams, choosing the fewest players
+		 *	that bring the teams' total strengths within the target ratio. It only plans
+		 *	moves, and is reused between solves so that it doesn't allocate on every tick.
+		 */
+		class BalanceSolver
+		{
+		public:
+			struct Options
+			{
+				// the most players a team may have, not counting commanders
+				uint32_t maxTeamSize = UINT32_MAX;
+				// the strongest team's total strength may be at most this many times the weakest team's
+				float maxStrengthRatio = 1.2f;
+				// teams may differ in size by at most this much after a move, unless they already differed by more
+				uint32_t maxTeamSizeDifference = 2;
+				// the most players that may be moved to balance the teams, not counting requested moves
+				size_t maxBalanceMoves = std::numeric_limits<size_t>::max();
+				// whether squads are kept together when balancing
+				bool keepSquadsTogether = true;
+			};
+
+			struct Player
+			{
+				uint8_t teamId;
+				// 0 is no squad
+				uint8_t squadId;
+				float strength;
+				// players that are not movable still count towards their team
+				bool movable = true;
+			};
+
+			struct Move
+			{
+				size_t playerIndex;
+				uint8_t teamId;
+				// s_anySquad if the player should be put in any squad with room
+				uint8_t squadId;
+				// whether the move was requested, or was planned to balance the teams
+				bool requested;
+			};
+
+			struct Plan
+			{
+				std::vector<Move> moves;
+				float strengthRatioBefore = 1.f;
+				float strengthRatioAfter = 1.f;
+				// whether the teams are within the strength ratio after the moves
+				bool balanced = true;
+			};
+
+			static constexpr uint8_t s_anySquad = UINT8_MAX;
+			static constexpr uint8_t s_maxSquadId = 32;
+
+			// Removes every team, player and request
+			void Clear();
+
+			// Adds a team that players can be moved to. Teams with players are added automatically
+			void AddTeam(const uint8_t teamId);
+			// Adds a player on a playing team, and returns their index
+			size_t AddPlayer(const Player& player);
+			// Requests that a player is moved to a team. Requests are planned in the order they are made
+			void RequestMove(const size_t playerIndex, const uint8_t teamId);
+
+			// Plans the moves. Afterwards, the teams and players are as if the moves were made
+			void Solve(const Options& options, Plan& planOut);
+		private:
+			struct TeamState
+			{
+				uint8_t teamId;
+				float strength = 0.f;
+				uint32_t size = 0;
+				std::bitset<s_maxSquadId + 1> usedSquads;
+			};
+
+			// a squad, or a single player if they have no squad or squads can be split
+			struct Unit
+			{
+				size_t teamIndex;
+				uint8_t squadId;
+				float strength;
+				uint32_t size;
+				// members are m_unitMembers[firstMember, firstMember + size)
+				size_t firstMember;
+			};
+
+			struct Candidate
+			{
+				size_t strongUnit;
+				// SIZE_MAX for a move instead of a swap
+				size_t weakUnit;
+				uint32_t cost;
+				float strengthRatio;
+			};
+
+			static float GetStrengthRatio(const float strongest, const float weakest) noexcept;
+
+			size_t FindTeam(const uint8_t teamId) const noexcept;
+			// gets the ratio of the strongest team to the weakest team, if strength moved between two teams
+			float GetStrengthRatio(const size_t fromTeam, const size_t toTeam, const float strengthChange) const noexcept;
+			// whether the team sizes stay within limits if players move between two teams
+			bool IsAllowed(const Options& options, const size_t fromTeam, const size_t toTeam, const int32_t sizeChange) const noexcept;
+
+			void BuildUnits(const Options& options);
+			uint8_t TakeSquad(TeamState& team, const uint8_t preferredSquadId);
+			void MoveUnit(const size_t unitIndex, const size_t toTeam, Plan& planOut);
+
+			std::vector<TeamState> m_teams;
+			std::vector<Player> m_players;
+			std::vector<std::pair<size_t, uint8_t>> m_requests;
+
+			// reused between solves
+			std::vector<bool> m_locked;
+			std::vector<Unit> m_units;
+			std::vector<size_t> m_unitMembers;
+			std::vector<size_t> m_sortedPlayers;
+			std::vector<bool> m_unitMoved;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef BETTERCON_INTERNAL_CHATFILTER_H_
+#define BETTERCON_INTERNAL_CHATFILTER_H_
+
+/*
+ *	Chat Filter
+ *	10/19/26 02:20
+ */
+
+// STL
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	ChatFilter compiles a list of words and phrases into an Aho-Corasick automaton, and
+		 *	finds every one of them in a message in a single pass. Letters are compared without
+		 *	case, common leetspeak (0, 1, 3, 4, 5, 7, 8, @, $) is read as the letter it stands
+		 *	for, and any run of other characters is read as a single space. A pattern only
+		 *	matches whole words, unless it starts or ends with a *, which lets that side of it
+		 *	match inside a word.
+		 */
+		class ChatFilter
+		{
+		public:
+			struct Violation
+			{
+				// index of the pattern, as given to Compile
+				uint32_t pattern;
+				// the span of the message that matched
+				uint32_t offset;
+				uint32_t length;
+			};
+
+			// Replaces the patterns. Patterns with no letters or digits never match. Returns the number of patterns that can match
+			size_t Compile(const std::vector<std::string>& patterns);
+			// Removes every pattern
+			void Clear();
+
+			// Returns whether there are no patterns that can match
+			bool IsEmpty() const noexcept;
+			// Gets a pattern as it was given to Compile
+			const std::string& GetPattern(const uint32_t pattern) const noexcept;
+
+			// Finds every pattern in a message, in the order that they end. Returns false if there are none
+			bool Scan(const std::string_view message, std::vector<Violation>& violationsOut) const;
+		private:
+			// a space, 26 letters, and 10 digits. leetspeak digits are never seen, because they are read as letters
+			static constexpr uint32_t s_numSymbols = 37;
+			static constexpr uint8_t s_separator = 0;
+
+			static const std::array<uint8_t, 256> s_symbols;
+
+			static uint8_t GetSymbol(const char c) noexcept;
+			static bool IsSeparator(const std::string_view message, const size_t offset) noexcept;
+
+			struct Pattern
+			{
+				std::string text;
+				// in symbols, after folding. zero if it can never match
+				uint32_t length;
+				bool wholeWordStart;
+				bool wholeWordEnd;
+				// the next pattern that ends at the same node
+				uint32_t nextPattern;
+			};
+
+			struct Node
+			{
+				uint32_t failure = 0;
+				// the first pattern that ends here
+				uint32_t pattern = UINT32_MAX;
+				// the nearest node down the failure links where a pattern ends
+				uint32_t outputLink = 0;
+			};
+
+			void Build();
+
+			std::vector<Pattern> m_patterns;
+			std::vector<Node> m_nodes;
+			// s_numSymbols transitions per node, which are complete once built
+			std::vector<uint32_t> m_transitions;
+			size_t m_numCompiledPatterns = 0;
+
+			// the message offset of each symbol that was read. reused between scans
+			mutable std::vector<uint32_t> m_symbolOffsets;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef BETTERCON_INTERNAL_COMMANDROUTER_H_
+#define BETTERCON_INTERNAL_COMMANDROUTER_H_
+
+/*
+ *	Chat Command Router
+ *	10/19/26 01:40
+ */
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	CommandRouter maps command names to routes with a case-insensitive trie, so that
+		 *	finding a command is one walk over its name without lowercasing or hashing a copy.
+		 *	Routes are indices that the owner gives meaning to. It also splits chat messages
+		 *	into tokens that are views into the message.
+		 */
+		class CommandRouter
+		{
+		public:
+			using Route_t = uint32_t;
+			using Routes_t = std::vector<Route_t>;
+
+			// Removes every command
+			void Clear();
+			// Adds a route for a command. A command can have several routes, which are kept in the order they were added
+			void AddRoute(const std::string_view commandName, const Route_t route);
+			// Finds the routes for a command, ignoring case. Returns nullptr if the command has none
+			const Routes_t* FindRoutes(const std::string_view commandName) const noexcept;
+
+			// Splits a message into tokens separated by spaces. A token that starts with a quote runs until the closing quote, which
+			// can hold spaces, and the quotes are not part of it. An unclosed quote runs to the end of the message. Returns the number of tokens
+			static size_t Tokenize(const std::string_view message, std::vector<std::string_view>& tokensOut);
+		private:
+			struct Node
+			{
+				// lowercase character and node index. commands are short, so a list beats a table
+				std::vector<std::pair<char, uint32_t>> children;
+				Routes_t routes;
+			};
+
+			static char ToLower(const char c) noexcept;
+
+			uint32_t FindChild(const uint32_t node, const char c) const noexcept;
+
+			// the root is always the first node
+			std::vector<Node> m_nodes = std::vector<Node>(1);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef BETTERCON_INTERNAL_COMMANDTRACER_H_
+#define BETTERCON_INTERNAL_COMMANDTRACER_H_
+
+/*
+ *	Command Round-Trip Tracer
+ *	10/19/26 12:40
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/Metrics.h>
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	CommandTracer times each command the connection sends, from when it is queued to
+		 *	when it is written to the socket, and from then to when the server responds, so
+		 *	that a command that was slow because it waited behind others can be told apart
+		 *	from one that the server was slow to answer. Each leg is kept in a histogram per
+		 *	command name, and commands that were never answered are counted per name.
+		 */
+		class CommandTracer
+		{
+		public:
+			using Clock_t = std::chrono::steady_clock;
+
+			// the stats a command name's traces are kept in
+			struct CommandStats
+			{
+				std::string command;
+				MetricHistogram* pQueued;
+				MetricHistogram* pServer;
+				MetricHistogram* pRoundTrip;
+				MetricCounter* pSent;
+				MetricCounter* pUnanswered;
+			};
+
+			// a command that was sent, and is waiting for its response
+			struct Trace
+			{
+				CommandStats* pStats;
+				Clock_t::time_point queued;
+				// the epoch until it is written
+				Clock_t::time_point written;
+			};
+
+			// the timings of a command name so far. The histograms' buckets end at MetricHistogram::GetDefaultBounds()
+			struct Timing
+			{
+				std::string_view command;
+				uint64_t sent;
+				// dropped when the connection closed before they were answered
+				uint64_t unanswered;
+				// from being queued to being written
+				MetricHistogram::Snapshot queued;
+				// from being written to being answered
+				MetricHistogram::Snapshot server;
+				// from being queued to being answered
+				MetricHistogram::Snapshot roundTrip;
+			};
+
+			// a command that is waiting for its response
+			struct Pending
+			{
+				std::string_view command;
+				int32_t sequence;
+				// how long since it was queued
+				std::chrono::nanoseconds age;
+				// whether it has left the send queue
+				bool written;
+			};
+
+			// Creates a tracer that keeps its histograms and counters in metrics
+			CommandTracer(MetricRegistry& metrics);
+
+			// not moveable or copyable, since traces point into it
+			CommandTracer(const CommandTracer& other) = delete;
+			CommandTracer& operator=(const CommandTracer& other) = delete;
+
+			// Starts the trace of a command that was just queued
+			Trace Queued(const std::string_view command, const Clock_t::time_point now);
+			// Marks a command as written to the socket
+			void Written(Trace& trace, const Clock_t::time_point now) noexcept;
+			// Finishes the trace of a command that was answered
+			void Answered(const Trace& trace, const Clock_t::time_point now) noexcept;
+			// Finishes the trace of a command that will never be answered
+			void Unanswered(const Trace& trace) noexcept;
+
+			// Gets the timings of each command name that was sent, in order of name
+			void GetTimings(std::vector<Timing>& timingsOut) const;
+		private:
+			MetricRegistry& m_metrics;
+
+			// found by name without making a string, and never moved, so traces can point at them
+			std::map<std::string, CommandStats, std::less<>> m_commandStats;
+		};
+	}
+}
+
+#endif
@@ -7,7 +7,10 @@
  */
 
 // BetteRCon
+#include <BetteRCon/Internal/CommandTracer.h>
+#include <BetteRCon/Internal/Metrics.h>
 #include <BetteRCon/Internal/Packet.h>
+#include <BetteRCon/Internal/SessionCapture.h>
 
 // ASIO
 #define ASIO_STANDALONE 1
@@ -20,6 +23,7 @@
 #include <memory>
 #include <optional>
 #include <queue>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -44,12 +48,28 @@ namespace BetteRCon
 			using ConnectCallback_t = std::function<void(const ErrorCode_t&)>;
 			using DisconnectCallback_t = std::function<void(const ErrorCode_t&)>;
 			using RecvCallback_t = std::function<void(const ErrorCode_t&, const std::optional<Packet>&)>;
-			using RecvCallbackMap_t = std::unordered_map<int32_t, RecvCallback_t>;
-
-			using SendQueue_t = std::queue<std::vector<char>>;
-
-			// Creates a disconnected server connection
-			Connection(Worker_t& worker);
+			using CommandTiming_t = CommandTracer::Timing;
+			using PendingCommand_t = CommandTracer::Pending;
+
+			// a command that is waiting for its response
+			struct PendingCommand
+			{
+				RecvCallback_t callback;
+				CommandTracer::Trace trace;
+			};
+			using RecvCallbackMap_t = std::unordered_map<int32_t, PendingCommand>;
+
+			// a serialized packet, and the sequence of its command if it expects a response
+			struct QueuedPacket
+			{
+				std::vector<char> buffer;
+				int32_t sequence;
+				bool command;
+			};
+			using SendQueue_t = std::queue<QueuedPacket>;
+
+			// Creates a disconnected server connection, which counts its traffic and times its commands in metrics
+			Connection(Worker_t& worker, MetricRegistry& metrics);
 
 			// not moveable or copyable
 			Connection(const Connection& other) = delete;
@@ -82,8 +102,23 @@ namespace BetteRCon
 			// @recvCallback is called when the response is received. It will be called immediately with
 			// not_connected if there is not an active connection.
 			// Can only be called from the worker thread.
-			// It is not called if an error occurs during the request, in which case disconnectCallback is called.
+			// It is not called if an error occurs during the request, in which case disconnectCallback is called,
+			// and the command is counted as unanswered.
 			void SendPacket(const Packet& packet, RecvCallback_t&& callback);
+
+			// Gets how long each command name has spent queued and waiting on the server so far.
+			// Can only be called from the worker thread if the worker is running
+			void GetCommandTimings(std::vector<CommandTiming_t>& timingsOut) const;
+			// Gets the commands that are waiting for their response, oldest first.
+			// Can only be called from the worker thread if the worker is running
+			void GetPendingCommands(std::vector<PendingCommand_t>& pendingOut) const;
+
+			// Starts capturing every frame sent and received, along with connects and disconnects, to a file
+			// that the replay tool can play back. Returns false if the file couldn't be opened.
+			// Can only be called from the worker thread if the worker is running
+			bool StartCapture(const std::string& path);
+			// Stops capturing. Can only be called from the worker thread if the worker is running
+			void StopCapture();
 			
 			// Cancels any ongoing asynchronous operations.
 			// Disconnects an active connection, calling the handler.
@@ -114,6 +149,17 @@ namespace BetteRCon
 
 			Socket_t m_socket;
 			asio::steady_timer m_timeoutTimer;
+
+			SessionCapture m_capture;
+
+			CommandTracer m_tracer;
+
+			MetricCounter* m_pBytesSent;
+			MetricCounter* m_pBytesReceived;
+			MetricCounter* m_pFramesSent;
+			MetricCounter* m_pFramesReceived;
+			MetricGauge* m_pSendQueueDepth;
+			MetricGauge* m_pPendingCommands;
 		};
 	}
 }
@@ -0,0 +1,85 @@
+#ifndef BETTERCON_INTERNAL_CYCLECLOCK_H_
+#define BETTERCON_INTERNAL_CYCLECLOCK_H_
+
+/*
+ *	Cycle Clock
+ *	10/19/26 11:20
+ */
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define BETTERCON_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BETTERCON_HAS_RDTSC 1
+#endif
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	CycleClock reads the CPU's timestamp counter, which costs a fraction of a steady
+		 *	clock read, for timing calls that are often shorter than a clock read. Ticks are
+		 *	turned into time with a rate measured against the steady clock the first time it
+		 *	is needed, which relies on the counter running at a constant rate, as it does on
+		 *	every x86 CPU of the last decade. Anywhere else, it is the steady clock.
+		 */
+		class CycleClock
+		{
+		public:
+			// Reads the clock
+			static uint64_t Now() noexcept
+			{
+#ifdef BETTERCON_HAS_RDTSC
+				return __rdtsc();
+#else
+				return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+			}
+
+			// Gets how many ticks there are in a second. The first call takes 10ms to measure it
+			static double GetTicksPerSecond() noexcept
+			{
+				static const double s_ticksPerSecond = MeasureTicksPerSecond();
+				return s_ticksPerSecond;
+			}
+
+			// Turns ticks into time
+			static std::chrono::nanoseconds ToDuration(const uint64_t ticks) noexcept
+			{
+				return std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(ticks) * 1e9 / GetTicksPerSecond()));
+			}
+
+			// Turns time into ticks
+			static uint64_t ToTicks(const std::chrono::nanoseconds duration) noexcept
+			{
+				return static_cast<uint64_t>(static_cast<double>(duration.count()) * GetTicksPerSecond() / 1e9);
+			}
+		private:
+			static double MeasureTicksPerSecond() noexcept
+			{
+#ifdef BETTERCON_HAS_RDTSC
+				const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+				const uint64_t startTicks = Now();
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				const uint64_t endTicks = Now();
+				const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+				return static_cast<double>(endTicks - startTicks) / std::chrono::duration<double>(endTime - startTime).count();
+#else
+				return static_cast<double>(std::chrono::steady_clock::period::den) / std::chrono::steady_clock::period::num;
+#endif
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef BETTERCON_INTERNAL_EDITDISTANCE_H_
+#define BETTERCON_INTERNAL_EDITDISTANCE_H_
+
+/*
+ *	Edit Distance
+ *	10/19/26 07:40
+ */
+
+// STL
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		// Credits to AdKats and those who Col gave credit to
+		inline size_t LevenshteinDistance(std::string s, std::string t)
+		{
+			std::transform(s.begin(), s.end(), s.begin(), [](char& c) { return std::tolower(c); });
+			std::transform(t.begin(), t.end(), t.begin(), [](char& c) { return std::tolower(c); });
+			size_t n = s.size();
+			size_t m = t.size();
+			std::vector<std::vector<size_t>> d(n + 1, std::vector<size_t>(m + 1));
+			if (n == 0)
+			{
+				return m;
+			}
+			if (m == 0)
+			{
+				return n;
+			}
+			for (size_t i = 0; i <= n;)
+			{
+				d[i][0] = i;
+				++i;
+			}
+			for (size_t j = 0; j <= m;)
+			{
+				d[0][j] = j;
+				++j;
+			}
+			for (size_t i = 1; i <= n; i++)
+			{
+				for (size_t j = 1; j <= m; j++)
+				{
+					d[i][j] = std::min(std::min(d[i - 1][j] + 1, d[i][j - 1] + 0), d[i - 1][j - 1] + ((t[j - 1] == s[i - 1]) ? 0 : 1));
+				}
+			}
+			return d[n][m];
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef BETTERCON_INTERNAL_EVENTLOG_H_
+#define BETTERCON_INTERNAL_EVENTLOG_H_
+
+/*
+ *	Binary Event Log
+ *	10/19/26 04:05
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/Serialization.h>
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	Event logs are a directory of numbered segment files:
+		 *
+		 *		segment:	"BREL" | u32 version | i64 microseconds since the epoch it was started at | records
+		 *		record:		u32 payload length | u8 type | u8 flags | u16 name id | i64 microseconds since the epoch | payload
+		 *
+		 *	Event and command names are interned per segment. The first time a name is used in a
+		 *	segment, a name record with the name as its payload is written under its new id, so
+		 *	each segment can be read on its own. Events are a varint word count and then each word
+		 *	after the name as a varint length and its bytes. Commands and responses are the same,
+		 *	after the varint sequence of the command. Payloads are never empty, so a zero length
+		 *	is the end of the segment.
+		 */
+		inline constexpr char g_eventLogMagic[4] = { 'B', 'R', 'E', 'L' };
+		inline constexpr uint32_t g_eventLogVersion = 1;
+		inline constexpr size_t g_eventLogHeaderSize = sizeof(g_eventLogMagic) + sizeof(uint32_t) + sizeof(int64_t);
+		inline constexpr size_t g_eventLogRecordHeaderSize = sizeof(uint32_t) + sizeof(uint8_t) * 2 + sizeof(uint16_t) + sizeof(int64_t);
+		inline constexpr std::string_view g_eventLogExtension = ".brel";
+
+		enum EventLogRecordType : uint8_t
+		{
+			EventLogRecordType_Name,		// A name, under a new id
+			EventLogRecordType_Event,		// An event from the server, or one fired by BetteRCon
+			EventLogRecordType_Command,		// A command sent to the server
+			EventLogRecordType_Response,	// The response to a command, named after the command
+			EventLogRecordType_Count
+		};
+
+		inline constexpr std::string_view g_EventLogRecordTypeStr[EventLogRecordType_Count] = { "name", "event", "command", "response" };
+
+		enum EventLogRecordFlag : uint8_t
+		{
+			EventLogRecordFlag_Error = 1 << 0,	// The command failed before it got a response. The only word is the error
+		};
+
+		/*
+		 *	EventLog writes events, commands and responses to memory-mapped segments, so that a
+		 *	record is a copy into memory that the OS writes out on its own. Full segments are
+		 *	trimmed to the records in them, and the oldest are deleted past a limit.
+		 */
+		class EventLog
+		{
+		public:
+			using Clock_t = std::chrono::system_clock;
+
+			EventLog() = default;
+
+			EventLog(const EventLog& other) = delete;
+			EventLog& operator=(const EventLog& other) = delete;
+
+			// Starts a new segment in a directory, which is created if it doesn't exist. Segments are segmentSize bytes,
+			// unless a record needs more, and only the newest maxSegments are kept. Returns false on failure
+			bool Open(const std::string& directory, const size_t segmentSize = 16 * 1024 * 1024, const size_t maxSegments = 64);
+			// Trims and closes the segment
+			void Close();
+			// Returns whether or not the log is open
+			bool IsOpen() const noexcept;
+
+			// Logs an event, whose first word is its name. Records with an empty name are not logged
+			void LogEvent(const std::vector<std::string>& words, const Clock_t::time_point time);
+			// Logs a command, whose first word is its name, with the sequence it was sent with
+			void LogCommand(const int32_t sequence, const std::vector<std::string>& words, const Clock_t::time_point time);
+			// Logs the response to a command. If error is set, words is the error
+			void LogResponse(const int32_t sequence, const std::string_view commandName, const std::vector<std::string>& words, const bool error, const Clock_t::time_point time);
+
+			~EventLog();
+		private:
+			// writes the payload as a record under a name, interning the name first if the segment doesn't have it
+			void Append(const EventLogRecordType type, const uint8_t flags, const std::string_view name, const Clock_t::time_point time);
+			void WriteRecord(const EventLogRecordType type, const uint8_t flags, const uint16_t nameId, const Clock_t::time_point time, const std::string_view payload);
+			void WriteWords(const std::vector<std::string>& words, const size_t firstWord);
+
+			bool OpenSegment(const size_t minSize, const Clock_t::time_point time);
+			void CloseSegment();
+			bool MapSegment(const std::filesystem::path& path, const size_t size);
+			void UnmapSegment();
+
+			std::filesystem::path m_directory;
+			size_t m_segmentSize = 0;
+			size_t m_maxSegments = 0;
+			uint64_t m_nextSegment = 0;
+			// oldest first, including the open one
+			std::deque<std::filesystem::path> m_segments;
+
+#ifdef _WIN32
+			void* m_hFile = nullptr;
+			void* m_hMapping = nullptr;
+#else
+			int m_fd = -1;
+#endif
+			char* m_pData = nullptr;
+			size_t m_size = 0;
+			size_t m_used = 0;
+
+			// names in the open segment
+			std::unordered_map<std::string, uint16_t> m_nameIds;
+
+			// reused between records
+			RecordWriter m_payload;
+			std::string m_nameKey;
+		};
+
+		/*
+		 *	EventLogReader reads a segment in one go and hands out its records, with the names
+		 *	already looked up. Views point into the reader, and last until the next Open().
+		 */
+		class EventLogReader
+		{
+		public:
+			using Clock_t = EventLog::Clock_t;
+
+			enum Status
+			{
+				Status_OK,					// Success
+				Status_NotFound,			// The file could not be opened
+				Status_BadHeader,			// The file is not an event log
+				Status_UnsupportedVersion,	// The segment was written by a newer version
+				Status_Corrupt,				// A record was cut off, had an impossible length, or used a name that was never written
+				Status_Count
+			};
+
+			static constexpr std::string_view s_StatusStr[Status_Count] = { "OK", "Not found", "Bad header", "Unsupported version", "Corrupt record" };
+
+			struct Record
+			{
+				EventLogRecordType type;
+				uint8_t flags;
+				Clock_t::time_point time;
+				// the event or command
+				std::string_view name;
+				// for commands and responses
+				int32_t sequence;
+				// after the name
+				std::vector<std::string_view> words;
+			};
+
+			// Loads a segment and validates its header
+			Status Open(const std::string& path);
+			// Gets when the segment was started
+			Clock_t::time_point GetStartTime() const noexcept;
+
+			// Moves to the next event, command or response. Returns false at the end of the segment, or when a record is corrupt,
+			// in which case GetStatus() says so
+			bool Next(Record& recordOut);
+			// Gets the reason Next() stopped early, or Status_OK if it reached the end
+			Status GetStatus() const noexcept;
+		private:
+			std::vector<char> m_data;
+			size_t m_offset = 0;
+			Clock_t::time_point m_startTime;
+			Status m_status = Status_OK;
+
+			// indexed by name id
+			std::vector<std::string_view> m_names;
+		};
+	}
+}
+
+#endif
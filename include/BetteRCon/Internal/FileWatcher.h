@@ -0,0 +1,104 @@
+#ifndef BETTERCON_INTERNAL_FILEWATCHER_H_
+#define BETTERCON_INTERNAL_FILEWATCHER_H_
+
+/*
+ *	File Watcher
+ *	10/18/26 16:40
+ */
+
+// ASIO
+#define ASIO_STANDALONE 1
+#include <asio.hpp>
+
+// STL
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	FileWatcher notifies listeners when line-based files change on disk, with the
+		 *	lines that were added and removed since the last change. On linux it is driven
+		 *	by inotify on the worker, elsewhere it polls modification times.
+		 */
+		class FileWatcher
+		{
+		public:
+			struct FileDiff
+			{
+				std::string path;
+				std::vector<std::string> addedLines;
+				std::vector<std::string> removedLines;
+			};
+
+			using ErrorCode_t = asio::error_code;
+			using WatchCallback_t = std::function<void(const FileDiff& diff)>;
+			using WatchId_t = uint32_t;
+			using Worker_t = asio::io_context;
+
+			// Creates a file watcher that calls callbacks from the worker
+			FileWatcher(Worker_t& worker);
+
+			FileWatcher(const FileWatcher& other) = delete;
+			FileWatcher(FileWatcher&& other) = delete;
+			FileWatcher& operator=(const FileWatcher& other) = delete;
+			FileWatcher& operator=(FileWatcher&& other) = delete;
+
+			// Starts watching a file, which does not have to exist yet. The current contents are the baseline
+			// for the first diff. Must be called from the worker thread if the worker is running
+			WatchId_t Watch(const std::string& path, WatchCallback_t&& callback);
+			// Stops a single watch
+			void Unwatch(const WatchId_t id);
+			// Stops every watch
+			void Clear();
+
+			~FileWatcher();
+		private:
+			struct WatchedFile
+			{
+				std::filesystem::path path;
+				// sorted lines from the last read
+				std::vector<std::string> lines;
+				std::filesystem::file_time_type lastWriteTime;
+				std::unordered_map<WatchId_t, WatchCallback_t> callbacks;
+			};
+			using WatchedFileMap_t = std::unordered_map<std::string, WatchedFile>;
+
+			static std::vector<std::string> ReadLines(const std::filesystem::path& path);
+			static std::filesystem::file_time_type GetLastWriteTime(const std::filesystem::path& path);
+
+			void CheckFile(WatchedFile& watchedFile);
+
+			void StartWatching(const std::filesystem::path& directory);
+			void StopWatching();
+
+			void HandleNotification(const ErrorCode_t& ec, const size_t bytes_transferred);
+			void HandlePollTimerExpire(const ErrorCode_t& ec);
+
+			Worker_t& m_worker;
+
+			WatchId_t m_nextId = 0;
+			// keyed by normalized path
+			WatchedFileMap_t m_files;
+
+#ifdef __linux__
+			int m_inotifyFd = -1;
+			std::unique_ptr<asio::posix::stream_descriptor> m_pNotifyDescriptor;
+			std::vector<char> m_notifyBuf;
+			// inotify watch descriptor -> watched directory
+			std::unordered_map<int, std::filesystem::path> m_directories;
+#endif
+			asio::steady_timer m_pollTimer;
+			bool m_polling = false;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef BETTERCON_INTERNAL_HANDLERWATCHDOG_H_
+#define BETTERCON_INTERNAL_HANDLERWATCHDOG_H_
+
+/*
+ *	Handler Watchdog
+ *	10/19/26 11:45
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/CycleClock.h>
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	HandlerWatchdog times calls made on the worker, and watches them from a thread of
+		 *	its own, so that a call that holds up the worker is reported while it is still
+		 *	running. The worker publishes the call it is in with a sequence lock, which is a
+		 *	few plain stores on x86, and the watchdog checks it every quarter of the budget.
+		 */
+		class HandlerWatchdog
+		{
+		public:
+			// called from the watchdog's thread with the context of a call that is over the budget, and how long it has run
+			using StallCallback_t = std::function<void(const void* pContext, const std::chrono::nanoseconds elapsed)>;
+
+			// what Leave needs to know about a call
+			struct Call
+			{
+				const void* pOuterContext;
+				uint64_t outerStart;
+				uint64_t start;
+			};
+
+			HandlerWatchdog() = default;
+
+			HandlerWatchdog(const HandlerWatchdog& other) = delete;
+			HandlerWatchdog& operator=(const HandlerWatchdog& other) = delete;
+
+			// Starts the thread, which calls stallCallback once for each call that runs longer than budget.
+			// Stops it first if it is running
+			void Start(const std::chrono::nanoseconds budget, StallCallback_t&& stallCallback);
+			// Stops the thread. Calls are still timed
+			void Stop();
+
+			// Marks the start of a call. pContext is passed to the stall callback, and must outlive the
+			// watchdog. Can only be called from the worker
+			Call Enter(const void* pContext) noexcept
+			{
+				const Call call{ m_pContext.load(std::memory_order_relaxed), m_start.load(std::memory_order_relaxed), CycleClock::Now() };
+				Publish(pContext, call.start);
+
+				return call;
+			}
+
+			// Marks the end of a call, and returns how long it took in CycleClock ticks
+			uint64_t Leave(const Call& call) noexcept
+			{
+				const uint64_t elapsed = CycleClock::Now() - call.start;
+				// a call made from inside another goes back to watching the outer one
+				Publish(call.pOuterContext, call.outerStart);
+
+				return elapsed;
+			}
+
+			~HandlerWatchdog();
+		private:
+			// the sequence is odd while the call is being changed, so the watchdog reads the context
+			// and start again if the sequence moved under it
+			void Publish(const void* pContext, const uint64_t start) noexcept
+			{
+				const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+				m_sequence.store(sequence + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+
+				m_pContext.store(pContext, std::memory_order_relaxed);
+				m_start.store(start, std::memory_order_relaxed);
+
+				m_sequence.store(sequence + 2, std::memory_order_release);
+			}
+
+			void Watch();
+
+			alignas(64) std::atomic<uint64_t> m_sequence{ 0 };
+			std::atomic<const void*> m_pContext{ nullptr };
+			std::atomic<uint64_t> m_start{ 0 };
+
+			// only touched by the watchdog's thread once it is started
+			alignas(64) uint64_t m_budgetTicks = 0;
+			std::chrono::nanoseconds m_period{ 0 };
+			StallCallback_t m_stallCallback;
+			// the sequence of the last call that was reported, so that it is only reported once
+			uint64_t m_reportedSequence = 0;
+
+			std::mutex m_mutex;
+			std::condition_variable m_stopCondition;
+			bool m_stopping = false;
+			std::thread m_thread;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef BETTERCON_INTERNAL_HISTOGRAM_H_
+#define BETTERCON_INTERNAL_HISTOGRAM_H_
+
+/*
+ *	High Dynamic Range Histogram
+ *	10/19/26 08:30
+ */
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	Histogram counts values from 0 up to a highest value, keeping three significant
+		 *	digits at every magnitude. Values are grouped into buckets of powers of two, each
+		 *	split into 2048 linear sub-buckets, so recording is a few shifts and an increment
+		 *	no matter how many values there are, and percentiles are within 0.1%.
+		 */
+		class Histogram
+		{
+		public:
+			// Creates an empty histogram. Values above highestValue are counted as highestValue
+			Histogram(const uint64_t highestValue);
+
+			// Counts a value
+			void Record(const uint64_t value) noexcept;
+			// Counts a value count times
+			void Record(const uint64_t value, const uint64_t count) noexcept;
+			// Adds the counts of another histogram with the same highest value
+			void Add(const Histogram& other) noexcept;
+			// Forgets every value
+			void Reset() noexcept;
+
+			// Gets how many values were counted
+			uint64_t GetCount() const noexcept;
+			// Gets the smallest value counted, or 0 if there are none
+			uint64_t GetMin() const noexcept;
+			// Gets the largest value counted, or 0 if there are none
+			uint64_t GetMax() const noexcept;
+			// Gets the average of the values counted
+			double GetMean() const noexcept;
+			// Gets the value that percentile percent of the values are at or below, from 0 to 100
+			uint64_t GetValueAtPercentile(const double percentile) const noexcept;
+		private:
+			// 2048 sub-buckets keep three significant digits
+			static constexpr uint32_t s_subBucketBits = 11;
+			static constexpr uint64_t s_subBucketCount = uint64_t(1) << s_subBucketBits;
+			static constexpr uint64_t s_subBucketHalfCount = s_subBucketCount / 2;
+
+			size_t GetIndex(const uint64_t value) const noexcept;
+			// the largest value that lands in the same slot
+			uint64_t GetHighestEquivalentValue(const size_t index) const noexcept;
+
+			uint64_t m_highestValue;
+			std::vector<uint64_t> m_counts;
+			uint64_t m_totalCount;
+			uint64_t m_min;
+			uint64_t m_max;
+			// kept as a double so that long runs of large values can't overflow it
+			double m_sum;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef BETTERCON_INTERNAL_KVSTORE_H_
+#define BETTERCON_INTERNAL_KVSTORE_H_
+
+/*
+ *	Key-Value Store
+ *	10/18/26 19:30
+ */
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	KVStore is a log-structured key-value store in a single file. Every put and
+		 *	erase is appended as a checksummed record, and an ordered in-memory index maps
+		 *	each live key to its latest record, so values stay on disk until they are read.
+		 *	Reads go through an LRU cache of file pages. Dead records are reclaimed by
+		 *	compaction once they outweigh the live ones.
+		 */
+		class KVStore
+		{
+		public:
+			using Clock_t = std::chrono::system_clock;
+			// Called for each key in a scan, in order. Return false to stop the scan
+			using ScanCallback_t = std::function<bool(const std::string_view key, const std::string_view value)>;
+
+			// Creates a closed store that caches up to cachePages pages of the file
+			KVStore(const size_t cachePages = 256);
+
+			KVStore(const KVStore& other) = delete;
+			KVStore& operator=(const KVStore& other) = delete;
+
+			// Opens a store, creating it if it does not exist, and indexes it. Records after a torn write are discarded.
+			// Returns false if the file could not be opened
+			bool Open(const std::string& path);
+			// Closes the store
+			void Close();
+			// Returns whether or not the store is open
+			bool IsOpen() const noexcept;
+
+			// Sets a key's value. The value is treated as missing after expiry. Returns false if the write failed
+			bool Put(const std::string_view key, const std::string_view value, const Clock_t::time_point expiry = Clock_t::time_point::max());
+			// Gets a key's value if it exists and has not expired
+			std::optional<std::string> Get(const std::string_view key);
+			// Erases a key. Returns false if the key did not exist or the write failed
+			bool Erase(const std::string_view key);
+			// Calls scanCallback for each live key in [begin, end), in order. An empty end scans to the last key.
+			// The store must not be modified from scanCallback
+			void Scan(const std::string_view begin, const std::string_view end, const ScanCallback_t& scanCallback);
+
+			// Rewrites the store with only the live records. Returns false if it failed, in which case the store is unchanged
+			bool Compact();
+
+			// Gets the number of indexed keys, including expired keys that were not yet compacted
+			size_t Size() const noexcept;
+
+			~KVStore();
+		private:
+			enum RecordType : uint8_t
+			{
+				RecordType_Put,
+				RecordType_Erase
+			};
+
+			struct IndexEntry
+			{
+				uint64_t offset;
+				uint32_t size;
+				int64_t expirySeconds;
+			};
+			using Index_t = std::map<std::string, IndexEntry, std::less<>>;
+
+			struct Page
+			{
+				uint64_t pageNumber;
+				std::vector<char> data;
+			};
+			using PageList_t = std::list<Page>;
+
+			static constexpr size_t s_pageSize = 4096;
+
+			static bool IsExpired(const IndexEntry& entry, const int64_t nowSeconds) noexcept;
+
+			bool AppendRecord(const RecordType type, const std::string_view key, const std::string_view value, const int64_t expirySeconds, IndexEntry& entryOut);
+			bool ReadRecord(const IndexEntry& entry, std::vector<char>& recordOut);
+			bool ReadValue(const IndexEntry& entry, std::string& valueOut);
+
+			const std::vector<char>& GetPage(const uint64_t pageNumber);
+			void InvalidatePages(const uint64_t offset, const size_t size);
+
+			void MaybeCompact();
+
+			std::string m_path;
+			std::fstream m_file;
+			uint64_t m_fileSize = 0;
+
+			Index_t m_index;
+			// bytes of records that are no longer referenced by the index
+			uint64_t m_deadBytes = 0;
+
+			size_t m_cachePages;
+			// most recently used at the front
+			PageList_t m_pages;
+			std::unordered_map<uint64_t, PageList_t::iterator> m_pageMap;
+
+			// reused between reads
+			std::vector<char> m_recordBuf;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef BETTERCON_INTERNAL_KILLSTREAM_H_
+#define BETTERCON_INTERNAL_KILLSTREAM_H_
+
+/*
+ *	Kill Stream Processor
+ *	10/19/26 01:05
+ */
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	KillStream counts each player's kills, deaths, headshots and weapons over a
+		 *	sliding window. The window is a fixed ring of time buckets per player, and a
+		 *	bucket is reused once it falls out of the window, so a player's counters never
+		 *	grow. Subscribers are called when a player's stats cross a threshold, and again
+		 *	only after the player has dropped back below it.
+		 */
+		class KillStream
+		{
+		public:
+			using Clock_t = std::chrono::steady_clock;
+
+			struct WeaponKills
+			{
+				// points into the stream, which never forgets a weapon name until it is cleared
+				std::string_view weapon;
+				uint32_t kills;
+			};
+
+			// a player's stats over the window
+			struct Stats
+			{
+				uint32_t kills = 0;
+				uint32_t deaths = 0;
+				uint32_t headshots = 0;
+				// over the time the player was seen in the window, but at least a minute
+				float killsPerMinute = 0.f;
+				float headshotRatio = 0.f;
+				// most kills first
+				std::vector<WeaponKills> weapons;
+			};
+
+			enum Metric
+			{
+				Metric_KillsPerMinute,		// Kills per minute
+				Metric_HeadshotRatio,		// Headshots per kill
+				Metric_WeaponKills,			// Kills with the threshold's weapon
+				Metric_Count
+			};
+
+			struct Threshold
+			{
+				Metric metric;
+				// the player crosses the threshold when the metric reaches this value
+				float value;
+				// the player must have at least this many kills in the window, so that ratios mean something
+				uint32_t minKills = 0;
+				// for Metric_WeaponKills
+				std::string weapon;
+			};
+
+			using SubscriptionId_t = uint64_t;
+			// Called with the player that crossed the threshold, and their stats
+			using ThresholdCallback_t = std::function<void(const std::string& playerName, const Stats& stats)>;
+
+			// Creates a stream with a window of numBuckets buckets of bucketDuration each
+			KillStream(const size_t numBuckets = 30, const Clock_t::duration bucketDuration = std::chrono::seconds(10));
+
+			KillStream(const KillStream& other) = delete;
+			KillStream& operator=(const KillStream& other) = delete;
+
+			// Adds a kill. An empty killer, or a killer that is the victim, only counts as a death. Calls the subscribers the killer crossed
+			void AddKill(const std::string& killerName, const std::string& victimName, const std::string_view weapon, const bool headshot, const Clock_t::time_point now);
+
+			// Gets a player's stats over the window. Returns false if they have no kills or deaths in it
+			bool GetStats(const std::string_view playerName, const Clock_t::time_point now, Stats& statsOut) const;
+
+			// Forgets a player
+			void RemovePlayer(const std::string& playerName);
+			// Forgets the players that have nothing in the window
+			void Prune(const Clock_t::time_point now);
+
+			// Calls thresholdCallback whenever a player crosses the threshold
+			SubscriptionId_t Subscribe(const Threshold& threshold, ThresholdCallback_t&& thresholdCallback);
+			// Removes a subscription. Safe to call from a threshold callback
+			void Unsubscribe(const SubscriptionId_t subscriptionId);
+
+			// Forgets every player, weapon, and subscription
+			void Clear();
+		private:
+			struct Bucket
+			{
+				// which bucket of time this is, counted from the clock's epoch
+				int64_t number = -1;
+				uint16_t kills = 0;
+				uint16_t deaths = 0;
+				uint16_t headshots = 0;
+				// weapon id and kills
+				std::vector<std::pair<uint32_t, uint16_t>> weapons;
+			};
+
+			struct PlayerWindow
+			{
+				std::vector<Bucket> buckets;
+				Clock_t::time_point firstSeen;
+			};
+			using PlayerWindowMap_t = std::unordered_map<std::string, PlayerWindow>;
+
+			struct Subscription
+			{
+				Threshold threshold;
+				uint32_t weaponId;
+				ThresholdCallback_t thresholdCallback;
+				// players at or above the threshold, who are not called again until they drop below it
+				std::unordered_set<std::string> crossed;
+			};
+			using SubscriptionMap_t = std::map<SubscriptionId_t, Subscription>;
+
+			int64_t GetBucketNumber(const Clock_t::time_point now) const noexcept;
+			PlayerWindow& GetPlayerWindow(const std::string& playerName, const Clock_t::time_point now);
+			Bucket& GetBucket(PlayerWindow& playerWindow, const Clock_t::time_point now);
+			void CalculateStats(const PlayerWindow& playerWindow, const Clock_t::time_point now, Stats& statsOut) const;
+			float GetMetric(const Subscription& subscription, const Stats& stats) const;
+			void CheckThresholds(const std::string& playerName, const PlayerWindow& playerWindow, const Clock_t::time_point now);
+
+			uint32_t GetWeaponId(const std::string_view weapon);
+
+			size_t m_numBuckets;
+			Clock_t::duration m_bucketDuration;
+
+			PlayerWindowMap_t m_playerWindows;
+
+			// weapon names are kept until the stream is cleared, so weapon views stay valid
+			std::unordered_map<std::string, uint32_t> m_weaponIds;
+			std::vector<const std::string*> m_weaponNames;
+
+			SubscriptionMap_t m_subscriptions;
+			SubscriptionId_t m_nextSubscriptionId = 1;
+
+			// reused between threshold checks
+			Stats m_stats;
+			std::vector<SubscriptionId_t> m_crossedSubscriptions;
+			// indexed by weapon id
+			mutable std::vector<uint32_t> m_weaponKills;
+			mutable std::vector<uint32_t> m_windowWeapons;
+		};
+	}
+}
+
+#endif
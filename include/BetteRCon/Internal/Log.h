@@ -7,48 +7,383 @@
  */
 
 // STL
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
-#include <iomanip>
-#include <iostream>
-#include <mutex>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// lines below this level are compiled out. 0 is debug, 1 is info, 2 is warning, and 3 is error
+#ifndef BETTERCON_MIN_LOG_LEVEL
+#define BETTERCON_MIN_LOG_LEVEL 1
+#endif
 
 namespace BetteRCon
 {
 	namespace Internal
 	{
-		// Log wraps around an ostream with timestamps
-		/// TODO: Synchronization between threads
-		class Log
+		enum LogLevel
+		{
+			LogLevel_Debug,		// Written to stdout
+			LogLevel_Info,		// Written to stdout
+			LogLevel_Warning,	// Written to stderr
+			LogLevel_Error,		// Written to stderr
+			LogLevel_Count
+		};
+
+		class LogQueue;
+
+		// the queue that this module's lines go to. lines are written right away until there is one
+		inline std::atomic<LogQueue*> g_pLogQueue{ nullptr };
+
+		/*
+		 *	LogQueue is a ring of fixed-size slots that any thread can add lines to without
+		 *	locking, and a thread that drains it to stdout and stderr. A line takes as many
+		 *	slots in a row as it needs. Lines are stamped when they are added, and the drain
+		 *	only formats the date again when the second changes.
+		 */
+		class LogQueue
+		{
+		public:
+			using Clock_t = std::chrono::system_clock;
+
+			// Starts the drain thread
+			LogQueue() : m_slots(std::make_unique<Slot[]>(s_numSlots))
+			{
+				for (size_t i = 0; i < s_numSlots; ++i)
+					m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+				m_drainThread = std::thread(&LogQueue::Drain, this);
+			}
+
+			LogQueue(const LogQueue& other) = delete;
+			LogQueue& operator=(const LogQueue& other) = delete;
+
+			// Adds a line. Waits for the drain if it is a whole ring behind
+			void Push(const LogLevel level, const Clock_t::time_point time, const std::string_view text)
+			{
+				// very long lines are cut off, so that a line never needs more than the ring
+				const size_t numSlots = std::min((text.size() + s_slotTextSize - 1) / s_slotTextSize, s_maxLineSlots);
+				const uint64_t firstTicket = m_writeTicket.fetch_add(numSlots, std::memory_order_relaxed);
+
+				for (size_t i = 0; i < numSlots; ++i)
+				{
+					const uint64_t ticket = firstTicket + i;
+					Slot& slot = m_slots[ticket % s_numSlots];
+
+					// the slot is free once the drain has read it on the last lap
+					while (slot.sequence.load(std::memory_order_acquire) != ticket)
+						std::this_thread::yield();
+
+					const size_t offset = i * s_slotTextSize;
+					slot.time = time.time_since_epoch().count();
+					slot.length = static_cast<uint16_t>(std::min(text.size() - offset, s_slotTextSize));
+					slot.level = static_cast<uint8_t>(level);
+					slot.continues = (i + 1 != numSlots);
+					std::memcpy(slot.text, text.data() + offset, slot.length);
+
+					slot.sequence.store(ticket + 1, std::memory_order_release);
+				}
+			}
+
+			// Writes a line right away, for when there is no queue
+			static void Write(const LogLevel level, const Clock_t::time_point time, const std::string_view text)
+			{
+				thread_local int64_t cachedSecond = INT64_MIN;
+				thread_local std::string cachedPrefix;
+				thread_local std::string line;
+
+				line.clear();
+				AppendTimestamp(line, time, cachedSecond, cachedPrefix);
+				line.append(text);
+
+				std::FILE* pFile = (level >= LogLevel_Warning) ? stderr : stdout;
+				std::fwrite(line.data(), 1, line.size(), pFile);
+				std::fflush(pFile);
+			}
+
+			// Stops the drain thread once every line is written
+			~LogQueue()
+			{
+				// anything logged after this is written right away
+				LogQueue* pThis = this;
+				g_pLogQueue.compare_exchange_strong(pThis, nullptr, std::memory_order_acq_rel);
+
+				m_stopping.store(true, std::memory_order_release);
+				m_drainThread.join();
+			}
+		private:
+			// 128 bytes a slot
+			static constexpr size_t s_slotTextSize = 108;
+			static constexpr size_t s_numSlots = 8192;
+			static constexpr size_t s_maxLineSlots = s_numSlots / 4;
+			static constexpr size_t s_flushSize = 64 * 1024;
+
+			struct alignas(64) Slot
+			{
+				// the ticket that can write it, or one past the ticket that wrote it
+				std::atomic<uint64_t> sequence;
+				Clock_t::rep time;
+				uint16_t length;
+				uint8_t level;
+				// whether the line goes on in the next slot
+				bool continues;
+				char text[s_slotTextSize];
+			};
+
+			static void AppendTimestamp(std::string& out, const Clock_t::time_point time, int64_t& cachedSecond, std::string& cachedPrefix)
+			{
+				const int64_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+				const int64_t second = milliseconds / 1000;
+
+				// the date only changes once a second
+				if (second != cachedSecond)
+				{
+					const std::time_t timeSeconds = static_cast<std::time_t>(second);
+					std::tm localTime{};
+#ifdef _WIN32
+					localtime_s(&localTime, &timeSeconds);
+#else
+					localtime_r(&timeSeconds, &localTime);
+#endif
+
+					char prefix[32];
+					cachedPrefix.assign(prefix, std::strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S.", &localTime));
+					cachedSecond = second;
+				}
+
+				const int32_t millisecond = static_cast<int32_t>(milliseconds % 1000);
+
+				out.append(cachedPrefix);
+				out.push_back(static_cast<char>('0' + millisecond / 100));
+				out.push_back(static_cast<char>('0' + millisecond / 10 % 10));
+				out.push_back(static_cast<char>('0' + millisecond % 10));
+				out.append("]: ");
+			}
+
+			void Drain()
+			{
+				bool lineStart = true;
+				while (true)
+				{
+					Slot& slot = m_slots[m_readTicket % s_numSlots];
+					if (slot.sequence.load(std::memory_order_acquire) != m_readTicket + 1)
+					{
+						Flush();
+
+						// a line that was claimed is always finished, so wait for it even when stopping
+						if (m_stopping.load(std::memory_order_acquire) == true &&
+							m_writeTicket.load(std::memory_order_acquire) == m_readTicket)
+							break;
+
+						std::this_thread::sleep_for(std::chrono::milliseconds(2));
+						continue;
+					}
+
+					std::string& out = (slot.level >= LogLevel_Warning) ? m_errBuffer : m_outBuffer;
+					if (lineStart == true)
+						AppendTimestamp(out, Clock_t::time_point(Clock_t::duration(slot.time)), m_cachedSecond, m_cachedPrefix);
+
+					out.append(slot.text, slot.length);
+					lineStart = (slot.continues == false);
+
+					slot.sequence.store(m_readTicket + s_numSlots, std::memory_order_release);
+					++m_readTicket;
+
+					if (out.size() >= s_flushSize)
+						Flush();
+				}
+			}
+
+			void Flush()
+			{
+				if (m_outBuffer.empty() == false)
+				{
+					std::fwrite(m_outBuffer.data(), 1, m_outBuffer.size(), stdout);
+					std::fflush(stdout);
+					m_outBuffer.clear();
+				}
+
+				if (m_errBuffer.empty() == false)
+				{
+					std::fwrite(m_errBuffer.data(), 1, m_errBuffer.size(), stderr);
+					std::fflush(stderr);
+					m_errBuffer.clear();
+				}
+			}
+
+			std::unique_ptr<Slot[]> m_slots;
+			alignas(64) std::atomic<uint64_t> m_writeTicket{ 0 };
+			std::atomic<bool> m_stopping{ false };
+
+			// only touched by the drain thread
+			alignas(64) uint64_t m_readTicket = 0;
+			int64_t m_cachedSecond = INT64_MIN;
+			std::string m_cachedPrefix;
+			std::string m_outBuffer;
+			std::string m_errBuffer;
+
+			std::thread m_drainThread;
+		};
+
+		// Starts the queue for this module, which lasts until the program exits, and returns it
+		inline LogQueue* StartLogQueue()
+		{
+			static LogQueue s_logQueue;
+			g_pLogQueue.store(&s_logQueue, std::memory_order_release);
+			return &s_logQueue;
+		}
+
+		// Sends this module's lines to another module's queue, so that every module shares one drain
+		inline void UseLogQueue(LogQueue* pLogQueue)
+		{
+			g_pLogQueue.store(pLogQueue, std::memory_order_release);
+		}
+
+		/*
+		 *	LogLine collects the arguments of a single << chain on the stack, and adds them to
+		 *	the queue as one line when the chain ends, so lines from different threads never
+		 *	interleave.
+		 */
+		class LogLine
 		{
 		public:
-			// Creates a log wrapped around an ostream
-			Log(std::ostream& os) : m_os(os) {}
-			
-			// Writes an argument to the stream, returns the synchronized argument
 			template<typename T>
-			std::ostream& write(const T& arg)
+			LogLine(const LogLevel level, const std::string_view tag, const T& arg) : m_level(level), m_time(LogQueue::Clock_t::now())
 			{
-				auto tm = std::time(nullptr);
-				auto msTime = std::chrono::duration_cast<std::chrono::milliseconds>
-					(std::chrono::system_clock::now().time_since_epoch()).count()
-					% 1000;
+				if (tag.empty() == false)
+				{
+					Append("[");
+					Append(tag);
+					Append("]: ");
+				}
+
+				Write(arg);
+			}
 
-				return m_os << std::put_time(std::localtime(&tm), "[%Y-%m-%d %H:%M:%S") << '.' << std::setw(3) << std::setfill('0') << msTime << "]: " << arg;
+			LogLine(const LogLine& other) = delete;
+			LogLine& operator=(const LogLine& other) = delete;
+
+			template<typename T>
+			LogLine& operator<<(const T& arg)
+			{
+				Write(arg);
+				return *this;
 			}
+
+			~LogLine()
+			{
+				const std::string_view text = (m_overflow.empty() == true) ? std::string_view(m_text, m_size) : std::string_view(m_overflow);
+
+				LogQueue* pLogQueue = g_pLogQueue.load(std::memory_order_acquire);
+				if (pLogQueue != nullptr)
+					pLogQueue->Push(m_level, m_time, text);
+				else
+					LogQueue::Write(m_level, m_time, text);
+			}
+		private:
+			void Append(const std::string_view text)
+			{
+				if (m_overflow.empty() == true &&
+					m_size + text.size() <= sizeof(m_text))
+				{
+					std::memcpy(m_text + m_size, text.data(), text.size());
+					m_size += text.size();
+					return;
+				}
+
+				// long lines move to the heap
+				if (m_overflow.empty() == true)
+					m_overflow.assign(m_text, m_size);
+
+				m_overflow.append(text);
+			}
+
+			template<typename T>
+			void Write(const T& arg)
+			{
+				if constexpr (std::is_convertible_v<const T&, std::string_view> == true)
+					Append(std::string_view(arg));
+				else if constexpr (std::is_same_v<T, char> == true || std::is_same_v<T, signed char> == true || std::is_same_v<T, unsigned char> == true)
+					Append(std::string_view(reinterpret_cast<const char*>(&arg), 1));
+				else if constexpr (std::is_same_v<T, bool> == true)
+					Append((arg == true) ? "1" : "0");
+				else if constexpr (std::is_integral_v<T> == true)
+				{
+					char buffer[24];
+					const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), arg);
+					Append(std::string_view(buffer, result.ptr - buffer));
+				}
+				else if constexpr (std::is_floating_point_v<T> == true)
+				{
+					// the same as an ostream would print it
+					char buffer[32];
+					const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), arg, std::chars_format::general, 6);
+					Append(std::string_view(buffer, result.ptr - buffer));
+				}
+				else
+				{
+					std::ostringstream stream;
+					stream << arg;
+					Append(stream.str());
+				}
+			}
+
+			LogLevel m_level;
+			LogQueue::Clock_t::time_point m_time;
+
+			size_t m_size = 0;
+			char m_text[256];
+			std::string m_overflow;
+		};
+
+		// what a line that was compiled out turns into
+		class NullLogLine
+		{
+		public:
+			template<typename T>
+			const NullLogLine& operator<<(const T&) const { return *this; }
+		};
+
+		// Log writes lines at a level, with an optional tag in front of each of them
+		template<LogLevel level>
+		class Log
+		{
+		public:
+			// Creates a log with a tag, which must outlive it
+			constexpr Log(const std::string_view tag = std::string_view()) : m_tag(tag) {}
+
+			// Sets the tag, which must outlive the log
+			void SetTag(const std::string_view tag) { m_tag = tag; }
+			constexpr std::string_view GetTag() const noexcept { return m_tag; }
 		private:
-			std::ostream& m_os;
+			std::string_view m_tag;
 		};
 
-		static Log g_stdOutLog(std::cout);
-		static Log g_stdErrLog(std::cerr);
+		inline constexpr Log<LogLevel_Debug> g_stdDebugLog;
+		inline constexpr Log<LogLevel_Info> g_stdOutLog;
+		inline constexpr Log<LogLevel_Warning> g_stdWarnLog;
+		inline constexpr Log<LogLevel_Error> g_stdErrLog;
 
-		// Returns the stream in a synchronized manner, after outputting the timestamp
-		template<typename T>
-		std::ostream& operator<<(Log& log, const T& arg)
+		// Starts a line. The line is queued once the rest of the << chain is done
+		template<LogLevel level, typename T>
+		auto operator<<(const Log<level>& log, const T& arg)
 		{
-			return log.write(arg);
+			if constexpr (level < BETTERCON_MIN_LOG_LEVEL)
+				return NullLogLine();
+			else
+				return LogLine(level, log.GetTag(), arg);
 		}
 	}
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,190 @@
+#ifndef BETTERCON_INTERNAL_METRICS_H_
+#define BETTERCON_INTERNAL_METRICS_H_
+
+/*
+ *	Metrics
+ *	10/19/26 09:40
+ */
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		// counters and histograms are split into shards, and each thread adds to its own, so that threads
+		// on different cores don't fight over one cache line
+		inline constexpr size_t g_metricShardCount = 8;
+
+		// Gets the shard that the calling thread adds to
+		inline size_t GetMetricShard() noexcept
+		{
+			static std::atomic<size_t> s_nextShard{ 0 };
+			thread_local const size_t shard = s_nextShard.fetch_add(1, std::memory_order_relaxed) % g_metricShardCount;
+			return shard;
+		}
+
+		/*
+		 *	MetricCounter is a count that only goes up, like bytes sent. Adding to it is one
+		 *	relaxed atomic add to the calling thread's shard, and reading it adds the shards up.
+		 */
+		class MetricCounter
+		{
+		public:
+			MetricCounter() = default;
+
+			MetricCounter(const MetricCounter& other) = delete;
+			MetricCounter& operator=(const MetricCounter& other) = delete;
+
+			// Adds to the count. Can be called from any thread
+			void Increment(const uint64_t amount = 1) noexcept
+			{
+				m_shards[GetMetricShard()].value.fetch_add(amount, std::memory_order_relaxed);
+			}
+
+			// Gets the count
+			uint64_t GetValue() const noexcept;
+		private:
+			struct alignas(64) Shard
+			{
+				std::atomic<uint64_t> value{ 0 };
+			};
+
+			Shard m_shards[g_metricShardCount];
+		};
+
+		/*
+		 *	MetricGauge is a value that goes up and down, like the depth of a queue. It isn't
+		 *	sharded, since it is usually set from one place.
+		 */
+		class MetricGauge
+		{
+		public:
+			MetricGauge() = default;
+
+			MetricGauge(const MetricGauge& other) = delete;
+			MetricGauge& operator=(const MetricGauge& other) = delete;
+
+			// Sets the value. Can be called from any thread
+			void Set(const int64_t value) noexcept { m_value.store(value, std::memory_order_relaxed); }
+			// Adds to the value, which can be negative. Can be called from any thread
+			void Add(const int64_t amount) noexcept { m_value.fetch_add(amount, std::memory_order_relaxed); }
+
+			// Gets the value
+			int64_t GetValue() const noexcept { return m_value.load(std::memory_order_relaxed); }
+		private:
+			alignas(64) std::atomic<int64_t> m_value{ 0 };
+		};
+
+		/*
+		 *	MetricHistogram counts durations into buckets with fixed upper bounds, and keeps
+		 *	their sum. Observing one is a binary search over the bounds and two relaxed atomic
+		 *	adds to the calling thread's shard. Durations are exposed in seconds.
+		 */
+		class MetricHistogram
+		{
+		public:
+			using Bounds_t = std::vector<std::chrono::nanoseconds>;
+
+			struct Snapshot
+			{
+				// the number in each bucket, not added up, with the last for everything past the highest bound
+				std::vector<uint64_t> counts;
+				std::chrono::nanoseconds sum;
+			};
+
+			// Creates a histogram with a bucket ending at each of bounds, which must be ascending, and one after them
+			MetricHistogram(const Bounds_t& bounds);
+
+			MetricHistogram(const MetricHistogram& other) = delete;
+			MetricHistogram& operator=(const MetricHistogram& other) = delete;
+
+			// Counts a duration. Can be called from any thread
+			void Observe(const std::chrono::nanoseconds duration) noexcept;
+
+			// Gets the upper bounds of the buckets
+			const Bounds_t& GetBounds() const noexcept;
+			// Adds up the shards
+			void GetSnapshot(Snapshot& snapshotOut) const;
+
+			// Gets bounds from 1us to 10s in steps of 1, 2.5 and 5
+			static const Bounds_t& GetDefaultBounds();
+		private:
+			struct alignas(64) Shard
+			{
+				std::unique_ptr<std::atomic<uint64_t>[]> counts;
+				std::atomic<int64_t> sum{ 0 };
+			};
+
+			Bounds_t m_bounds;
+			Shard m_shards[g_metricShardCount];
+		};
+
+		/*
+		 *	MetricRegistry owns metrics by name and labels, and writes them all out in the
+		 *	Prometheus text format. Metrics are created the first time they are asked for and
+		 *	live as long as the registry, so callers look them up once and keep the pointer.
+		 *	Only creating metrics and writing them out take the lock.
+		 */
+		class MetricRegistry
+		{
+		public:
+			using Labels_t = std::vector<std::pair<std::string, std::string>>;
+
+			MetricRegistry() = default;
+
+			MetricRegistry(const MetricRegistry& other) = delete;
+			MetricRegistry& operator=(const MetricRegistry& other) = delete;
+
+			// Gets the counter with a name and labels, creating it if it doesn't exist. Returns nullptr
+			// if the name is already used by another type of metric. Can be called from any thread
+			MetricCounter* GetCounter(const std::string& name, const std::string& help, const Labels_t& labels = {});
+			// Gets the gauge with a name and labels, creating it if it doesn't exist. Returns nullptr
+			// if the name is already used by another type of metric. Can be called from any thread
+			MetricGauge* GetGauge(const std::string& name, const std::string& help, const Labels_t& labels = {});
+			// Gets the histogram with a name and labels, creating it with the default bounds if it doesn't exist.
+			// Returns nullptr if the name is already used by another type of metric. Can be called from any thread
+			MetricHistogram* GetHistogram(const std::string& name, const std::string& help, const Labels_t& labels = {});
+
+			// Writes every metric in the Prometheus text format, version 0.0.4. Can be called from any thread
+			void WriteText(std::string& out) const;
+		private:
+			enum MetricType
+			{
+				MetricType_Counter,
+				MetricType_Gauge,
+				MetricType_Histogram,
+				MetricType_Count
+			};
+
+			// keyed by the rendered labels, like {plugin="InGameAdmin"}, so that they are written out in order
+			struct Family
+			{
+				std::string help;
+				MetricType type;
+				std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+				std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+				std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+			};
+
+			Family* GetFamily(const std::string& name, const std::string& help, const MetricType type);
+
+			static std::string RenderLabels(const Labels_t& labels);
+
+			mutable std::mutex m_mutex;
+			std::map<std::string, Family> m_families;
+		};
+	}
+}
+
+#endif
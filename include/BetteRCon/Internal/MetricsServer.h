@@ -0,0 +1,93 @@
+#ifndef BETTERCON_INTERNAL_METRICSSERVER_H_
+#define BETTERCON_INTERNAL_METRICSSERVER_H_
+
+/*
+ *	Metrics HTTP Server
+ *	10/19/26 10:25
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/Metrics.h>
+
+// ASIO
+#define ASIO_STANDALONE 1
+#include <asio.hpp>
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	MetricsServer answers GET /metrics on the loopback address with a registry in the
+		 *	Prometheus text format. It runs on its own thread, so that the metrics can still be
+		 *	scraped while the worker is stuck in a handler. Requests are answered one at a time,
+		 *	and the connection is closed after each.
+		 */
+		class MetricsServer
+		{
+		public:
+			using ErrorCode_t = asio::error_code;
+			using Worker_t = asio::io_context;
+			using Proto_t = asio::ip::tcp;
+			using Endpoint_t = Proto_t::endpoint;
+			using Socket_t = Proto_t::socket;
+			using Acceptor_t = Proto_t::acceptor;
+
+			// Creates a server for a registry that isn't listening
+			MetricsServer(const MetricRegistry& registry);
+
+			// not moveable or copyable
+			MetricsServer(const MetricsServer& other) = delete;
+			MetricsServer(MetricsServer&& other) = delete;
+			MetricsServer& operator=(const MetricsServer& other) = delete;
+			MetricsServer& operator=(MetricsServer&& other) = delete;
+
+			// Starts listening on a port of the loopback address, and starts the thread. A port of 0 picks
+			// a free one, which GetPort() returns. Stops the server first if it is running
+			ErrorCode_t Start(const uint16_t port);
+
+			// Gets the port being listened on, or 0 if the server isn't running
+			uint16_t GetPort() const noexcept;
+
+			// Stops listening and joins the thread. Does nothing if the server isn't running
+			void Stop();
+
+			~MetricsServer();
+		private:
+			// requests bigger than this are dropped
+			static constexpr size_t s_maxRequestSize = 8192;
+			// clients that don't finish their request in this long are dropped
+			static constexpr std::chrono::seconds s_requestTimeout = std::chrono::seconds(5);
+
+			void AcceptClient();
+			void CloseClient();
+
+			void HandleAccept(const ErrorCode_t& ec);
+			void HandleRead(const ErrorCode_t& ec, const size_t bytes_transferred);
+			void HandleWrite(const ErrorCode_t& ec, const size_t bytes_transferred);
+			void HandleTimeout(const ErrorCode_t& ec, const uint32_t clientId);
+
+			const MetricRegistry& m_registry;
+
+			Worker_t m_worker;
+			Acceptor_t m_acceptor;
+			Socket_t m_socket;
+			asio::steady_timer m_timeoutTimer;
+			// changes with each client, so that a timeout for one that left does nothing
+			uint32_t m_clientId = 0;
+
+			std::string m_request;
+			std::string m_response;
+
+			std::thread m_thread;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef BETTERCON_INTERNAL_MOCKSERVER_H_
+#define BETTERCON_INTERNAL_MOCKSERVER_H_
+
+/*
+ *	Mock Frostbite Server
+ *	10/19/26 06:10
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/ServerEndpoint.h>
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	MockServer answers the commands BetteRCon sends the way a BF4 server does, and
+		 *	simulates players who join, kill, chat and leave at random with set rates. The same
+		 *	seed gives the same players and the same events in the same order. Scripted events
+		 *	and responses can be added on top.
+		 */
+		class MockServer
+		{
+		public:
+			using Clock_t = std::chrono::steady_clock;
+			using ErrorCode_t = ServerEndpoint::ErrorCode_t;
+			using Worker_t = ServerEndpoint::Worker_t;
+			using Endpoint_t = ServerEndpoint::Endpoint_t;
+			using Words_t = std::vector<std::string>;
+
+			struct Settings
+			{
+				// an empty password is not set, which BetteRCon refuses
+				std::string password = "mock";
+				std::string serverName = "BetteRCon Mock Server";
+				std::string gameMode = "ConquestLarge0";
+				std::string map = "MP_Prison";
+				uint32_t maxPlayers = 64;
+				// the players who are there before the client connects
+				uint32_t players = 32;
+				uint32_t tickets = 800;
+
+				// in events per minute. A rate of zero never happens
+				double joinsPerMinute = 4.0;
+				double leavesPerMinute = 4.0;
+				double killsPerMinute = 120.0;
+				double chatsPerMinute = 12.0;
+
+				uint32_t seed = 1;
+			};
+
+			struct Stats
+			{
+				uint64_t commands = 0;
+				uint64_t unknownCommands = 0;
+				uint64_t events = 0;
+				// events the client answered
+				uint64_t acknowledgedEvents = 0;
+			};
+
+			// Called with how long the client took to answer an event
+			using EventAckCallback_t = std::function<void(const Clock_t::duration latency)>;
+
+			// Creates a mock server that isn't listening yet
+			MockServer(Worker_t& worker, const Settings& settings);
+
+			// not moveable or copyable
+			MockServer(const MockServer& other) = delete;
+			MockServer(MockServer&& other) = delete;
+			MockServer& operator=(const MockServer& other) = delete;
+			MockServer& operator=(MockServer&& other) = delete;
+
+			// Starts listening. A port of 0 picks a free one, which GetLocalEndpoint() returns
+			ErrorCode_t Listen(const Endpoint_t& endpoint);
+			// Gets the endpoint being listened on
+			Endpoint_t GetLocalEndpoint() const;
+			// Stops listening and simulating, and disconnects the client
+			void Close();
+
+			// Answers a command with fixed words instead of the usual response
+			void SetResponse(const std::string& command, const Words_t& response);
+			// Sends an event a time after the client enables events
+			void ScheduleEvent(const Clock_t::duration offset, const Words_t& event);
+			// Sends an event now, if the client has enabled events
+			void SendEvent(const Words_t& event);
+
+			// Changes the simulation's rates, in events per minute. Can only be called from the worker thread
+			void SetRates(const double joinsPerMinute, const double leavesPerMinute, const double killsPerMinute, const double chatsPerMinute);
+			// Ends the round now, and the team with more tickets wins. Can only be called from the worker thread
+			void EndRound();
+			// Calls ackCallback from the worker thread with how long the client took to answer each event sent from now on
+			void SetEventAckCallback(EventAckCallback_t&& ackCallback);
+
+			// Gets what has been sent and received
+			const Stats& GetStats() const noexcept;
+		private:
+			struct Player
+			{
+				std::string name;
+				std::string guid;
+				std::string pbGuid;
+				std::string ip;
+				uint16_t port = 0;
+				uint8_t teamId = 0;
+				uint8_t squadId = 0;
+				uint32_t kills = 0;
+				uint32_t deaths = 0;
+				uint32_t score = 0;
+				uint16_t ping = 0;
+				uint32_t slot = 0;
+			};
+
+			struct ScheduledEvent
+			{
+				Clock_t::duration offset;
+				Words_t words;
+			};
+
+			void HandleAccept();
+			void HandlePacket(const Packet& packet);
+			void HandleDisconnect();
+			void HandleTick(const ErrorCode_t& ec);
+
+			Words_t HandleCommand(const Words_t& command);
+			Words_t GetServerInfo() const;
+			void AppendPlayers(Words_t& wordsOut) const;
+			void SendPlayerList();
+
+			Player MakePlayer();
+			void Join();
+			void Leave();
+			void Kill();
+			void Chat();
+			void EndRound(const uint8_t winner);
+
+			Clock_t::time_point GetNextTime(const Clock_t::time_point from, const double perMinute);
+
+			Worker_t& m_worker;
+			ServerEndpoint m_endpoint;
+			asio::steady_timer m_tickTimer;
+			Settings m_settings;
+
+			std::mt19937 m_random;
+			std::vector<Player> m_players;
+			uint32_t m_nextPlayerId = 0;
+			uint32_t m_nextSlot = 1;
+			int32_t m_sequence = 0;
+
+			std::string m_salt;
+			bool m_loggedIn = false;
+			bool m_eventsEnabled = false;
+
+			Clock_t::time_point m_startTime;
+			Clock_t::time_point m_roundStart;
+			uint32_t m_roundsPlayed = 0;
+			int32_t m_teamTickets[2] = {};
+
+			Clock_t::time_point m_nextJoin;
+			Clock_t::time_point m_nextLeave;
+			Clock_t::time_point m_nextKill;
+			Clock_t::time_point m_nextChat;
+
+			// sorted by offset
+			std::vector<ScheduledEvent> m_scheduledEvents;
+			size_t m_nextScheduledEvent = 0;
+			Clock_t::time_point m_eventsEnabledTime;
+
+			std::unordered_map<std::string, Words_t> m_responses;
+
+			// the sequence and send time of each event the client hasn't answered, which it answers in order
+			std::deque<std::pair<int32_t, Clock_t::time_point>> m_unacknowledgedEvents;
+			EventAckCallback_t m_eventAckCallback;
+
+			Stats m_stats;
+		};
+	}
+}
+
+#endif
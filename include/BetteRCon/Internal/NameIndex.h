@@ -0,0 +1,85 @@
+#ifndef BETTERCON_INTERNAL_NAMEINDEX_H_
+#define BETTERCON_INTERNAL_NAMEINDEX_H_
+
+/*
+ *	Player Name Index
+ *	10/18/26 14:02
+ */
+
+// STL
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	NameIndex is a case-insensitive index of player names. It keeps a prefix
+		 *	trie for as-you-type lookups and trigram postings for substring and
+		 *	typo-tolerant lookups, and is updated incrementally as players come and go.
+		 */
+		class NameIndex
+		{
+		public:
+			// Inserts a name into the index. Inserting a name twice has no effect
+			void Insert(const std::string& name);
+			// Removes a name from the index. Removing a name that is not indexed has no effect
+			void Erase(const std::string& name);
+			// Removes every name from the index
+			void Clear();
+
+			// Returns the number of indexed names
+			size_t Size() const noexcept;
+
+			// Finds up to limit names matching the query, best match first. Exact matches rank
+			// first, then prefix matches (shortest first), then substring matches, then names
+			// that share trigrams with the query (most similar first)
+			std::vector<std::string> Find(std::string_view query, const size_t limit) const;
+		private:
+			using Id_t = uint32_t;
+			using Trigram_t = uint32_t;
+
+			static constexpr Id_t s_invalidId = UINT32_MAX;
+
+			struct TrieNode
+			{
+				// sorted by character
+				std::vector<std::pair<char, uint32_t>> children;
+				// names that end at this node. names only collide if they differ by case
+				std::vector<Id_t> ids;
+				// the number of names in this node's subtree, used to prune empty branches
+				uint32_t subtreeCount = 0;
+			};
+
+			static std::string Lower(std::string_view str);
+			static void GetTrigrams(const std::string& lowerStr, std::vector<Trigram_t>& trigramsOut);
+
+			uint32_t FindNode(const std::string& lowerStr) const;
+			uint32_t AllocateNode();
+
+			std::vector<TrieNode> m_nodes{ TrieNode{} };
+			std::vector<uint32_t> m_freeNodes;
+
+			struct NameEntry
+			{
+				std::string name;
+				std::string lowerName;
+				uint32_t trigramCount = 0;
+			};
+
+			// indexed by id. entries with empty names are free slots
+			std::vector<NameEntry> m_names;
+			std::vector<Id_t> m_freeIds;
+			std::unordered_map<std::string, Id_t> m_ids;
+
+			std::unordered_map<Trigram_t, std::vector<Id_t>> m_trigramPostings;
+		};
+	}
+}
+
+#endif
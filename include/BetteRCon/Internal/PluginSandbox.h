@@ -0,0 +1,167 @@
+#ifndef BETTERCON_INTERNAL_PLUGINSANDBOX_H_
+#define BETTERCON_INTERNAL_PLUGINSANDBOX_H_
+
+/*
+ *	Plugin Sandbox
+ *	10/19/26 14:20
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/Metrics.h>
+#include <BetteRCon/Internal/SandboxChannel.h>
+
+// ASIO
+#define ASIO_STANDALONE 1
+#include <asio.hpp>
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	PluginSandbox runs a plugin in a bettercon-pluginhost process of its own, so that a
+		 *	plugin that crashes or never returns only takes itself down. Events are written to
+		 *	the host over a SandboxChannel, and the commands it sends back are passed to the
+		 *	server. A thread watches the host, and starts it again when it exits, or when it
+		 *	stops reading its events, waiting longer each time it goes down again soon after.
+		 */
+		class PluginSandbox : public std::enable_shared_from_this<PluginSandbox>
+		{
+		public:
+			using ErrorCode_t = asio::error_code;
+			using Worker_t = asio::io_context;
+
+			// called from the worker with each command the plugin sends. The response is passed back to PostResponse with
+			// the generation, which changes each time the host is started, so that a new host doesn't get an old host's responses
+			using CommandCallback_t = std::function<void(const std::shared_ptr<PluginSandbox>& pSandbox, const uint32_t generation, const uint32_t sequence, const std::vector<std::string>& command)>;
+			// called from the worker once the host has loaded the plugin, or with the reason it couldn't
+			using LoadCallback_t = std::function<void(const bool success, const std::string& failReason)>;
+			// called from the worker once the host has exited
+			using StoppedCallback_t = std::function<void()>;
+
+			// how long the host has to load the plugin
+			static constexpr std::chrono::seconds s_loadTimeout = std::chrono::seconds(10);
+			// a host that has events waiting, and hasn't read any in this long, is stuck
+			static constexpr std::chrono::seconds s_hangTimeout = std::chrono::seconds(10);
+			// how long the host has to exit once it is asked to
+			static constexpr std::chrono::seconds s_shutdownTimeout = std::chrono::seconds(2);
+			// a host is started again after the first delay, which doubles each time it goes down within the last
+			static constexpr std::chrono::seconds s_minRestartDelay = std::chrono::seconds(1);
+			static constexpr std::chrono::seconds s_maxRestartDelay = std::chrono::seconds(60);
+
+			// Creates a sandbox that isn't running. Must be owned by a shared_ptr
+			PluginSandbox(Worker_t& worker, MetricRegistry& metrics, CommandCallback_t&& commandCallback);
+
+			PluginSandbox(const PluginSandbox& other) = delete;
+			PluginSandbox& operator=(const PluginSandbox& other) = delete;
+
+			// Gets the path of bettercon-pluginhost next to the running program
+			static std::string GetDefaultHostPath();
+
+			// Starts a host for the plugin at pluginPath from the supervisor, without waiting for it to load the plugin.
+			// loadCallback is only called while the sandbox is alive. Can only be called once, from the worker
+			void Start(const std::string& hostPath, const std::string& pluginPath, LoadCallback_t&& loadCallback);
+
+			// Gets the plugin's name, as the host reported it
+			const std::string& GetPluginName() const noexcept;
+			const std::string& GetPluginVersion() const noexcept;
+			const std::string& GetPluginAuthor() const noexcept;
+
+			// Enables or disables the plugin, which stays that way when the host is started again. Can only be called from the worker
+			void Enable();
+			void Disable();
+			bool IsEnabled() const noexcept;
+
+			// Writes an event to the host. Events that don't fit because the host is behind are dropped and counted.
+			// Can only be called from the worker
+			void PostEvent(const std::vector<std::string>& eventArgs);
+			// Writes the response to one of the host's commands. Can only be called from the worker
+			void PostResponse(const uint32_t generation, const uint32_t sequence, const ErrorCode_t& ec, const std::vector<std::string>& response);
+			// Writes the server's latest serverInfo or admin.listPlayers response to the host, which doesn't poll for them itself.
+			// The latest of each is written again when the host is started again. Can only be called from the worker
+			void PostServerInfo(const std::vector<std::string>& serverInfo);
+			void PostPlayerList(const std::vector<std::string>& playerList);
+
+			// Asks the host to exit without waiting for it. The supervisor kills it if it takes too long, and then calls
+			// stoppedCallback, after which the sandbox can be destroyed without blocking. Can only be called from the worker
+			void Stop(StoppedCallback_t&& stoppedCallback = nullptr);
+
+			// Stops the sandbox if it wasn't, and waits for the supervisor to finish
+			~PluginSandbox();
+		private:
+			// starts the host with the channel, and waits for its hello
+			bool Spawn(std::string& failReasonOut);
+			bool WaitForHello(std::string& failReasonOut);
+			// returns true if the host has exited, and describes how
+			bool HasExited(std::string& howOut);
+			void Kill();
+
+			// the supervisor: loads the plugin, watches the host until the sandbox is stopped, and waits for it to exit
+			void Run(const LoadCallback_t loadCallback);
+			void WaitForExit();
+			void PostStopped(StoppedCallback_t&& stoppedCallback);
+
+			// passes the host's commands to the worker
+			void HandleHostMessages();
+			void Supervise();
+			// returns false if the sandbox was stopped while it was waiting
+			bool WaitToRestart(const std::chrono::steady_clock::duration delay);
+
+			Worker_t& m_worker;
+			MetricRegistry& m_metrics;
+			CommandCallback_t m_commandCallback;
+
+			std::string m_hostPath;
+			std::string m_pluginPath;
+			std::string m_pluginName;
+			std::string m_pluginVersion;
+			std::string m_pluginAuthor;
+
+			SandboxChannel m_channel;
+#ifdef _WIN32
+			void* m_hProcess = nullptr;
+#else
+			int m_processId = -1;
+#endif
+			std::atomic<uint32_t> m_generation{ 0 };
+
+			// only touched by the worker
+			bool m_enabled = false;
+			bool m_stopped = false;
+			std::vector<char> m_sendBuffer;
+			std::vector<std::string> m_serverInfo;
+			std::vector<std::string> m_playerList;
+
+			// only touched by the supervisor once it is started
+			std::vector<char> m_receiveBuffer;
+			SandboxChannel::Message m_message;
+
+			MetricCounter* m_pRestarts = nullptr;
+			MetricCounter* m_pDroppedEvents = nullptr;
+
+			std::string m_logTag;
+			Log<LogLevel_Warning> m_warnLog;
+
+			std::mutex m_mutex;
+			std::condition_variable m_stopCondition;
+			bool m_stopping = false;
+			StoppedCallback_t m_stoppedCallback;
+			std::thread m_supervisor;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef BETTERCON_INTERNAL_RATELIMITER_H_
+#define BETTERCON_INTERNAL_RATELIMITER_H_
+
+/*
+ *	Rate Limiter
+ *	10/19/26 03:10
+ */
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	RateLimiter keeps a token bucket for each key. A bucket holds up to a burst of tokens
+		 *	and gets one back every interval. Rather than counting tokens, each bucket is the time
+		 *	that it will be full again, so refilling costs nothing and a full bucket can be
+		 *	forgotten.
+		 */
+		class RateLimiter
+		{
+		public:
+			using Clock_t = std::chrono::steady_clock;
+
+			struct Limit
+			{
+				uint32_t burst = 1;
+				// an interval of zero is no limit
+				Clock_t::duration interval = Clock_t::duration::zero();
+			};
+
+			// Gets how long until a key's bucket has a token, or zero if it has one now
+			Clock_t::duration GetWait(const std::string& key, const Limit& limit, const Clock_t::time_point now) const;
+			// Takes a token from a key's bucket, even if it is empty
+			void Take(const std::string& key, const Limit& limit, const Clock_t::time_point now);
+
+			// Forgets the buckets that are full
+			void Prune(const Clock_t::time_point now);
+			// Forgets every bucket
+			void Clear();
+		private:
+			// when each bucket will be full again
+			std::unordered_map<std::string, Clock_t::time_point> m_buckets;
+		};
+	}
+}
+
+#endif
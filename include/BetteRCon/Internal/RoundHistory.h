@@ -0,0 +1,201 @@
+#ifndef BETTERCON_INTERNAL_ROUNDHISTORY_H_
+#define BETTERCON_INTERNAL_ROUNDHISTORY_H_
+
+/*
+ *	Round History Store
+ *	10/19/26 00:20
+ */
+
+// STL
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		class RecordReader;
+		class RecordWriter;
+
+		/*
+		 *	RoundHistory keeps one row per player per round, and never changes a row once it
+		 *	is written. Rounds are appended to one database file per week, so old weeks can be
+		 *	dropped whole and queries skip the weeks they don't cover. Each round is a single
+		 *	record of columns: player ids are sorted and delta-encoded, and the rest are
+		 *	varints. In memory, each week is kept as a set of flat columns that queries scan
+		 *	from the first round in their time range.
+		 */
+		class RoundHistory
+		{
+		public:
+			using Clock_t = std::chrono::system_clock;
+
+			struct PlayerRound
+			{
+				std::string name;
+				uint8_t teamId;
+				uint32_t kills;
+				uint32_t deaths;
+				uint32_t score;
+				// how much of the round the player was there for
+				uint32_t secondsPlayed;
+			};
+
+			struct Round
+			{
+				Clock_t::time_point end;
+				std::string map;
+				std::string gameMode;
+				uint32_t durationSeconds;
+				// 0 if nobody won
+				uint8_t winningTeam;
+				std::vector<PlayerRound> players;
+			};
+
+			// a player's totals over a time range, or every player's for server totals
+			struct PlayerTotals
+			{
+				// points into the history, which never forgets a name while it is open
+				std::string_view name;
+				uint32_t rounds = 0;
+				uint32_t wins = 0;
+				uint32_t kills = 0;
+				uint32_t deaths = 0;
+				uint64_t score = 0;
+				uint64_t secondsPlayed = 0;
+
+				float GetKDR() const noexcept { return (deaths != 0) ? static_cast<float>(kills) / deaths : static_cast<float>(kills); }
+				float GetKPM() const noexcept { return (secondsPlayed != 0) ? kills * 60.f / secondsPlayed : 0.f; }
+				float GetSPM() const noexcept { return (secondsPlayed != 0) ? score * 60.f / secondsPlayed : 0.f; }
+				float GetWinRate() const noexcept { return (rounds != 0) ? static_cast<float>(wins) / rounds : 0.f; }
+			};
+
+			// one of a player's rounds, for following their trend
+			struct PlayerRoundEntry
+			{
+				Clock_t::time_point end;
+				uint8_t teamId;
+				bool won;
+				uint32_t kills;
+				uint32_t deaths;
+				uint32_t score;
+				uint32_t secondsPlayed;
+			};
+
+			enum Metric
+			{
+				Metric_KDR,			// Kills per death
+				Metric_KPM,			// Kills per minute played
+				Metric_SPM,			// Score per minute played
+				Metric_WinRate,		// Rounds won per round played
+				Metric_Count
+			};
+
+			RoundHistory() = default;
+
+			RoundHistory(const RoundHistory& other) = delete;
+			RoundHistory& operator=(const RoundHistory& other) = delete;
+
+			// Opens the history in a directory, creating it if it does not exist, and loads the weeks that are within retention.
+			// Older weeks are deleted. Returns false if the directory could not be created. A read-only history is for another
+			// process than the one that writes it: it can't be appended to, and leaves missing, damaged and old weeks to the writer
+			bool Open(const std::string& directory, const std::chrono::hours retention, const bool readOnly = false);
+			// Loads the rounds that were appended to the files since they were loaded, and forgets the weeks that were deleted.
+			// For a read-only history, whose writer is another process. Returns false if the history isn't open
+			bool Refresh();
+			// Closes the history
+			void Close();
+			// Returns whether or not the history is open
+			bool IsOpen() const noexcept;
+
+			// Appends a round. Rounds should be appended in order of their end. Returns false if the write failed
+			bool AppendRound(const Round& round);
+
+			// Gets a player's totals for rounds that ended in [since, now). Returns false if they have no rounds in that range
+			bool GetPlayerTotals(const std::string_view name, const Clock_t::time_point since, PlayerTotals& totalsOut) const;
+			// Gets each of a player's rounds that ended in [since, now), oldest first
+			void GetPlayerRounds(const std::string_view name, const Clock_t::time_point since, std::vector<PlayerRoundEntry>& roundsOut) const;
+			// Gets the totals of every player together for rounds that ended in [since, now). The name is empty
+			PlayerTotals GetServerTotals(const Clock_t::time_point since) const;
+			// Gets up to limit players with at least minRounds rounds in [since, now), best first by metric
+			void GetTopPlayers(const Metric metric, const Clock_t::time_point since, const uint32_t minRounds, const size_t limit, std::vector<PlayerTotals>& topOut) const;
+		private:
+			// a week of rounds. round columns have one entry per round, and row columns one entry per player per round
+			struct Partition
+			{
+				int64_t number;
+				std::string path;
+
+				// round columns
+				std::vector<int64_t> roundEnds;
+				std::vector<uint32_t> roundDurations;
+				std::vector<uint8_t> roundWinners;
+				std::vector<std::string> roundMaps;
+				std::vector<std::string> roundGameModes;
+				// the first row of each round
+				std::vector<uint32_t> roundFirstRows;
+
+				// row columns
+				std::vector<uint32_t> playerIds;
+				std::vector<uint8_t> teamIds;
+				std::vector<uint32_t> kills;
+				std::vector<uint32_t> deaths;
+				std::vector<uint32_t> scores;
+				std::vector<uint32_t> secondsPlayed;
+
+				// names are numbered per partition in the order they first appear, so each file stands alone
+				std::vector<uint32_t> localToGlobal;
+				std::unordered_map<uint32_t, uint32_t> globalToLocal;
+			};
+			using Partitions_t = std::vector<Partition>;
+
+			static constexpr int64_t s_partitionSeconds = 7 * 24 * 60 * 60;
+
+			static int64_t ToSeconds(const Clock_t::time_point timePoint) noexcept;
+			static int64_t GetPartitionNumber(const int64_t seconds) noexcept;
+			static std::string GetPartitionPath(const std::string& directory, const int64_t number);
+			// the numbers of the weeks in the directory, in order
+			static std::vector<int64_t> GetPartitionNumbers(const std::string& directory);
+
+			bool LoadPartition(Partition& partition);
+			// decodes the rounds in a week's file after the ones that are loaded, without changing the file
+			void LoadNewRounds(Partition& partition);
+			bool DecodeRound(RecordReader& record, Partition& partition);
+			void EncodeRound(const Round& round, const int64_t endSeconds, const Partition& partition, RecordWriter& recordOut) const;
+			Partition& GetPartition(const int64_t seconds);
+			// deletes the weeks that ended before the retention
+			void DropExpiredPartitions(const int64_t nowSeconds);
+
+			uint32_t GetNameId(const std::string_view name);
+			uint32_t FindNameId(const std::string_view name) const;
+			// the first round that ended at or after since
+			static size_t FindFirstRound(const Partition& partition, const int64_t since) noexcept;
+			// the row after a round's last row
+			static size_t GetRoundEndRow(const Partition& partition, const size_t round) noexcept;
+
+			void AccumulateTotals(const Clock_t::time_point since) const;
+
+			std::string m_directory;
+			int64_t m_retentionSeconds = 0;
+			bool m_open = false;
+			bool m_readOnly = false;
+
+			// oldest first
+			Partitions_t m_partitions;
+
+			// names are kept forever while open, so name views stay valid
+			std::unordered_map<std::string, uint32_t> m_nameIds;
+			std::vector<const std::string*> m_names;
+
+			// reused between queries, indexed by name id
+			mutable std::vector<PlayerTotals> m_totals;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef BETTERCON_INTERNAL_SANDBOXCHANNEL_H_
+#define BETTERCON_INTERNAL_SANDBOXCHANNEL_H_
+
+/*
+ *	Plugin Sandbox Channel
+ *	10/19/26 13:55
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/SharedRing.h>
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	SandboxChannel is the shared memory between the server and a plugin host process: a
+		 *	ring of messages to the host, and a ring of messages back. The memory is created by
+		 *	the server and inherited by the host, so it has no name that could be left behind.
+		 *	Messages are a type, a sequence and a list of words, with the numbers and lengths
+		 *	written as varints, which keeps an event only a few bytes bigger than its words.
+		 */
+		class SandboxChannel
+		{
+		public:
+			enum MessageType
+			{
+				MessageType_Hello,			// Host: the plugin loaded. The words are its name, version and author
+				MessageType_LoadFailed,		// Host: the plugin couldn't be loaded. The word is why
+				MessageType_Event,			// Server: an event from the game server
+				MessageType_Enable,			// Server: enable the plugin
+				MessageType_Disable,		// Server: disable the plugin
+				MessageType_Command,		// Host: send a command to the game server
+				MessageType_Response,		// Server: the response to the host's command with the same sequence
+				MessageType_CommandFailed,	// Server: the command with the same sequence failed. The word is the error's value
+				MessageType_Shutdown,		// Server: unload the plugin and exit
+				MessageType_ServerInfo,		// Server: the game server's latest serverInfo response
+				MessageType_PlayerList,		// Server: the game server's latest admin.listPlayers response
+				MessageType_Count
+			};
+
+			struct Message
+			{
+				// MessageType_Count if it couldn't be decoded
+				MessageType type;
+				uint32_t sequence;
+				std::vector<std::string> words;
+			};
+
+			// 1MB each way holds thousands of events
+			static constexpr uint32_t s_defaultCapacity = 1 << 20;
+
+			// Creates a channel that isn't open
+			SandboxChannel() = default;
+
+			SandboxChannel(const SandboxChannel& other) = delete;
+			SandboxChannel& operator=(const SandboxChannel& other) = delete;
+
+			// Creates a channel in new shared memory, with rings of a capacity, which must be a power of 2.
+			// Returns false if the memory couldn't be created
+			bool Create(const uint32_t capacity);
+			// Opens a channel that the server's process created, from the handle it passed along
+			bool Open(const std::string& handle);
+			// Unmaps the memory, and closes the handle
+			void Close();
+
+			bool IsOpen() const noexcept;
+			// Gets the handle of the memory, which the host inherits, as an argument for it
+			std::string GetHandle() const;
+			// Gets the id of the process that created the channel
+			uint64_t GetServerProcessId() const noexcept;
+
+			SharedRing& GetToHost() noexcept;
+			SharedRing& GetToServer() noexcept;
+
+			// Encodes a message into buffer, and writes it to a ring. Returns false if the ring is full
+			static bool Send(SharedRing& ring, const MessageType type, const uint32_t sequence, const std::vector<std::string>& words, std::vector<char>& buffer);
+			// Reads a message from a ring into messageOut, through buffer. Returns false if there are none
+			static bool Receive(SharedRing& ring, Message& messageOut, std::vector<char>& buffer);
+
+			static void Encode(const MessageType type, const uint32_t sequence, const std::vector<std::string>& words, std::vector<char>& bufferOut);
+			// Returns false if the buffer isn't a whole message
+			static bool Decode(const std::vector<char>& buffer, Message& messageOut);
+
+			~SandboxChannel();
+		private:
+			struct Header
+			{
+				alignas(64) uint32_t magic;
+				uint32_t capacity;
+				uint64_t serverProcessId;
+			};
+
+			static constexpr uint32_t s_magic = 0x58424242;
+
+			bool Map(const size_t size);
+
+#ifdef _WIN32
+			void* m_hMapping = nullptr;
+#else
+			int m_fd = -1;
+#endif
+			void* m_pMemory = nullptr;
+			size_t m_size = 0;
+
+			SharedRing m_toHost;
+			SharedRing m_toServer;
+		};
+	}
+}
+
+#endif
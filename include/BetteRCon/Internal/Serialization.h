@@ -0,0 +1,483 @@
+#ifndef BETTERCON_INTERNAL_SERIALIZATION_H_
+#define BETTERCON_INTERNAL_SERIALIZATION_H_
+
+/*
+ *	Database Serialization
+ *	10/18/26 18:15
+ */
+
+// STL
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		// CRC32 lookup table, generated at compile time
+		constexpr std::array<uint32_t, 256> MakeCrc32Table() noexcept
+		{
+			std::array<uint32_t, 256> table{};
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+				for (int j = 0; j < 8; ++j)
+					crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+				table[i] = crc;
+			}
+			return table;
+		}
+
+		inline constexpr std::array<uint32_t, 256> g_crc32Table = MakeCrc32Table();
+
+		// Computes the CRC32 (IEEE) of a buffer. Pass the previous result as crc to continue a checksum
+		inline uint32_t Crc32(const void* data, const size_t size, const uint32_t crc = 0) noexcept
+		{
+			const uint8_t* pData = static_cast<const uint8_t*>(data);
+
+			uint32_t result = ~crc;
+			for (size_t i = 0; i < size; ++i)
+				result = g_crc32Table[(result ^ pData[i]) & 0xff] ^ (result >> 8);
+
+			return ~result;
+		}
+
+		/*
+		 *	RecordReader is a bounds-checked cursor over serialized data. Reads past the end
+		 *	return zeroes and put the reader in a failed state, so callers can read a whole
+		 *	record and check IsGood() once. Strings are returned as views into the data.
+		 *	Everything is little-endian.
+		 */
+		class RecordReader
+		{
+		public:
+			RecordReader() = default;
+			// Creates a reader over data, which must outlive the reader
+			RecordReader(const std::string_view data) : m_data(data) {}
+
+			// Reads an integral, floating point or enum value
+			template<typename T>
+			T Read() noexcept
+			{
+				static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only arithmetic and enum types can be read");
+
+				uint8_t bytes[sizeof(T)];
+				if (ReadBytes(bytes, sizeof(T)) == false)
+					return T{};
+
+				// assemble it little-endian regardless of the host
+				using Bits_t = std::conditional_t<sizeof(T) == 1, uint8_t,
+					std::conditional_t<sizeof(T) == 2, uint16_t,
+					std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+				Bits_t bits = 0;
+				for (size_t i = 0; i < sizeof(T); ++i)
+					bits |= static_cast<Bits_t>(bytes[i]) << (i * 8);
+
+				T value;
+				memcpy(&value, &bits, sizeof(T));
+				return value;
+			}
+			// Reads size raw bytes. The view points into the underlying data
+			std::string_view ReadView(const size_t size) noexcept
+			{
+				if (m_good == false ||
+					size > GetRemaining())
+				{
+					m_good = false;
+					return {};
+				}
+
+				const std::string_view view = m_data.substr(m_offset, size);
+				m_offset += size;
+
+				return view;
+			}
+			// Reads a length-prefixed string. The view points into the underlying data
+			std::string_view ReadString() noexcept
+			{
+				const uint32_t strLen = Read<uint32_t>();
+				return ReadView(strLen);
+			}
+			// Reads a time point stored as seconds since the epoch
+			std::chrono::system_clock::time_point ReadTimePoint() noexcept
+			{
+				return std::chrono::system_clock::time_point(std::chrono::seconds(Read<int64_t>()));
+			}
+			// Reads an unsigned LEB128 varint
+			uint64_t ReadVarInt() noexcept
+			{
+				uint64_t value = 0;
+				for (uint32_t shift = 0; shift < 64; shift += 7)
+				{
+					const uint8_t byte = Read<uint8_t>();
+					value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+					if ((byte & 0x80) == 0)
+						return value;
+				}
+
+				// more than 10 bytes can't be a 64-bit value
+				m_good = false;
+				return 0;
+			}
+			// Reads a zigzag-encoded signed varint
+			int64_t ReadVarSInt() noexcept
+			{
+				const uint64_t value = ReadVarInt();
+				return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+			}
+
+			// Returns whether or not every read so far was in bounds
+			bool IsGood() const noexcept { return m_good; }
+			// Returns the number of bytes left to read
+			size_t GetRemaining() const noexcept { return m_data.size() - m_offset; }
+		private:
+			bool ReadBytes(void* pOut, const size_t size) noexcept
+			{
+				if (m_good == false ||
+					size > GetRemaining())
+				{
+					m_good = false;
+					memset(pOut, 0, size);
+					return false;
+				}
+
+				memcpy(pOut, m_data.data() + m_offset, size);
+				m_offset += size;
+
+				return true;
+			}
+
+			std::string_view m_data;
+			size_t m_offset = 0;
+			bool m_good = true;
+		};
+
+		/*
+		 *	RecordWriter builds a single record. The buffer is kept between records
+		 *	so that writing many records does not allocate for each one.
+		 */
+		class RecordWriter
+		{
+		public:
+			// Writes an integral, floating point or enum value
+			template<typename T>
+			void Write(const T value)
+			{
+				static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only arithmetic and enum types can be written");
+
+				using Bits_t = std::conditional_t<sizeof(T) == 1, uint8_t,
+					std::conditional_t<sizeof(T) == 2, uint16_t,
+					std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+				Bits_t bits;
+				memcpy(&bits, &value, sizeof(T));
+
+				for (size_t i = 0; i < sizeof(T); ++i)
+					m_data.push_back(static_cast<char>(bits >> (i * 8)));
+			}
+			// Writes raw bytes
+			void WriteView(const std::string_view data)
+			{
+				m_data.insert(m_data.end(), data.begin(), data.end());
+			}
+			// Writes a string prefixed with its 32-bit length
+			void WriteString(const std::string_view str)
+			{
+				Write(static_cast<uint32_t>(str.size()));
+				m_data.insert(m_data.end(), str.begin(), str.end());
+			}
+			// Writes a time point as seconds since the epoch
+			void WriteTimePoint(const std::chrono::system_clock::time_point tp)
+			{
+				Write(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count()));
+			}
+			// Writes an unsigned LEB128 varint, which takes one byte for values under 128
+			void WriteVarInt(uint64_t value)
+			{
+				while (value >= 0x80)
+				{
+					m_data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+					value >>= 7;
+				}
+
+				m_data.push_back(static_cast<char>(value));
+			}
+			// Writes a signed varint, zigzag-encoded so that small negative values stay small
+			void WriteVarSInt(const int64_t value)
+			{
+				WriteVarInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+			}
+
+			// Clears the record, keeping the buffer
+			void Clear() noexcept { m_data.clear(); }
+
+			// Gets the serialized record
+			std::string_view GetData() const noexcept { return std::string_view(m_data.data(), m_data.size()); }
+		private:
+			std::vector<char> m_data;
+		};
+
+		/*
+		 *	Databases are a header followed by framed records:
+		 *
+		 *		header:	"BRDB" | u32 schema tag | u32 schema version | u32 crc of the previous 12 bytes
+		 *		record:	u32 payload length | payload | u32 crc of the payload
+		 */
+		inline constexpr char g_databaseMagic[4] = { 'B', 'R', 'D', 'B' };
+		inline constexpr size_t g_databaseHeaderSize = sizeof(g_databaseMagic) + sizeof(uint32_t) * 3;
+		// anything larger is a corrupt length rather than a real record
+		inline constexpr uint32_t g_maxDatabaseRecordSize = 16 * 1024 * 1024;
+
+		// Builds a schema tag from four characters, such as MakeSchemaTag("BANS")
+		constexpr uint32_t MakeSchemaTag(const char (&tag)[5]) noexcept
+		{
+			return static_cast<uint32_t>(static_cast<uint8_t>(tag[0])) |
+				static_cast<uint32_t>(static_cast<uint8_t>(tag[1])) << 8 |
+				static_cast<uint32_t>(static_cast<uint8_t>(tag[2])) << 16 |
+				static_cast<uint32_t>(static_cast<uint8_t>(tag[3])) << 24;
+		}
+
+		/*
+		 *	DatabaseReader loads a database in one read and validates each record as it is
+		 *	iterated. Records are handed out as RecordReaders over the loaded data.
+		 */
+		class DatabaseReader
+		{
+		public:
+			enum Status
+			{
+				Status_OK,					// Success
+				Status_NotFound,			// The file could not be opened
+				Status_BadHeader,			// The file is not a database of this schema. GetRawReader() can read older formats
+				Status_UnsupportedVersion,	// The database was written by a newer schema version
+				Status_Truncated,			// A record was cut off, likely by a crash mid-write
+				Status_Corrupt,				// A record failed its checksum or had an impossible length
+				Status_Count
+			};
+
+			static constexpr std::string_view s_StatusStr[Status_Count] = { "OK", "Not found", "Bad header", "Unsupported version", "Truncated record", "Corrupt record" };
+
+			// Loads a database and validates its header against the schema, accepting versions up to maxVersion
+			Status Open(const std::string& path, const uint32_t schemaTag, const uint32_t maxVersion)
+			{
+				m_data.clear();
+				m_offset = 0;
+				m_version = 0;
+				m_status = Status_OK;
+
+				// read the entire file in one go
+				std::ifstream inFile(path, std::ios::binary);
+				if (inFile.good() == false)
+					return Status_NotFound;
+
+				m_data.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+				inFile.close();
+
+				// validate the header
+				RecordReader header(std::string_view(m_data.data(), m_data.size()));
+				const std::string_view magic = header.ReadView(sizeof(g_databaseMagic));
+				const uint32_t tag = header.Read<uint32_t>();
+				const uint32_t version = header.Read<uint32_t>();
+				const uint32_t headerCrc = header.Read<uint32_t>();
+
+				if (header.IsGood() == false ||
+					magic != std::string_view(g_databaseMagic, sizeof(g_databaseMagic)) ||
+					tag != schemaTag ||
+					headerCrc != Crc32(m_data.data(), g_databaseHeaderSize - sizeof(uint32_t)))
+					return Status_BadHeader;
+
+				if (version > maxVersion)
+					return Status_UnsupportedVersion;
+
+				m_version = version;
+				m_offset = g_databaseHeaderSize;
+
+				return Status_OK;
+			}
+
+			// Gets the schema version the database was written with
+			uint32_t GetVersion() const noexcept { return m_version; }
+
+			// Moves to the next record and validates it. Returns false at the end, or when a record is truncated
+			// or corrupt, in which case GetStatus() says which. Records before a bad one are still valid
+			bool Next(RecordReader& recordOut)
+			{
+				if (m_status != Status_OK ||
+					m_offset >= m_data.size())
+					return false;
+
+				RecordReader frame(std::string_view(m_data.data() + m_offset, m_data.size() - m_offset));
+				const uint32_t recordSize = frame.Read<uint32_t>();
+
+				if (frame.IsGood() == false)
+				{
+					m_status = Status_Truncated;
+					return false;
+				}
+
+				if (recordSize > g_maxDatabaseRecordSize)
+				{
+					m_status = Status_Corrupt;
+					return false;
+				}
+
+				const std::string_view payload = frame.ReadView(recordSize);
+				const uint32_t recordCrc = frame.Read<uint32_t>();
+				if (frame.IsGood() == false)
+				{
+					m_status = Status_Truncated;
+					return false;
+				}
+
+				if (recordCrc != Crc32(payload.data(), payload.size()))
+				{
+					m_status = Status_Corrupt;
+					return false;
+				}
+
+				recordOut = RecordReader(payload);
+				m_offset += sizeof(uint32_t) * 2 + recordSize;
+
+				return true;
+			}
+			// Gets the reason Next() stopped early, or Status_OK if it reached the end
+			Status GetStatus() const noexcept { return m_status; }
+
+			// Gets a reader over the whole file, for reading formats from before this one
+			RecordReader GetRawReader() const noexcept { return RecordReader(std::string_view(m_data.data(), m_data.size())); }
+		private:
+			std::vector<char> m_data;
+			size_t m_offset = 0;
+			uint32_t m_version = 0;
+			Status m_status = Status_OK;
+		};
+
+		/*
+		 *	DatabaseWriter streams records to disk one at a time. Create() writes to a
+		 *	temporary file that replaces the database on Commit(), so a crash mid-write
+		 *	leaves the old database intact. Append() adds records to an existing database.
+		 */
+		class DatabaseWriter
+		{
+		public:
+			// Starts writing a new database, replacing path on Commit(). Returns false if the file could not be opened
+			bool Create(const std::string& path, const uint32_t schemaTag, const uint32_t version)
+			{
+				m_path = path;
+				m_tempPath = path + ".tmp";
+
+				m_outFile.open(m_tempPath, std::ios::binary | std::ios::trunc);
+				if (m_outFile.good() == false)
+					return false;
+
+				WriteHeader(schemaTag, version);
+
+				return m_outFile.good();
+			}
+			// Opens a database for appending, writing the header if it is empty. Returns false if the file could not be opened
+			bool Append(const std::string& path, const uint32_t schemaTag, const uint32_t version)
+			{
+				m_path = path;
+				m_tempPath.clear();
+
+				m_outFile.open(m_path, std::ios::binary | std::ios::app);
+				if (m_outFile.good() == false)
+					return false;
+
+				// a new file needs a header first
+				std::error_code ec;
+				if (std::filesystem::file_size(m_path, ec) == 0)
+					WriteHeader(schemaTag, version);
+
+				return m_outFile.good();
+			}
+
+			// Writes a record. Returns false if the write failed
+			bool WriteRecord(const RecordWriter& record)
+			{
+				const std::string_view payload = record.GetData();
+
+				// frame the record with its size and checksum
+				WriteU32(static_cast<uint32_t>(payload.size()));
+				m_outFile.write(payload.data(), payload.size());
+				WriteU32(Crc32(payload.data(), payload.size()));
+
+				return m_outFile.good();
+			}
+
+			// Finishes writing. For Create(), replaces the database. Returns false if anything failed
+			bool Commit()
+			{
+				if (m_outFile.is_open() == false)
+					return false;
+
+				m_outFile.close();
+				if (m_outFile.fail() == true)
+					return false;
+
+				// appends are already in place
+				if (m_tempPath.empty() == true)
+					return true;
+
+				// swap the new database in
+				std::error_code ec;
+				std::filesystem::rename(m_tempPath, m_path, ec);
+				if (ec)
+					return false;
+
+				m_tempPath.clear();
+				return true;
+			}
+
+			~DatabaseWriter()
+			{
+				// a database that was never committed is thrown away
+				if (m_outFile.is_open() == true)
+					m_outFile.close();
+
+				if (m_tempPath.empty() == false)
+				{
+					std::error_code ignored;
+					std::filesystem::remove(m_tempPath, ignored);
+				}
+			}
+		private:
+			void WriteU32(const uint32_t value)
+			{
+				const char bytes[sizeof(uint32_t)] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+				m_outFile.write(bytes, sizeof(bytes));
+			}
+
+			void WriteHeader(const uint32_t schemaTag, const uint32_t version)
+			{
+				RecordWriter header;
+				for (const char c : g_databaseMagic)
+					header.Write(c);
+				header.Write(schemaTag);
+				header.Write(version);
+
+				// the header checksum covers everything before it
+				header.Write(Crc32(header.GetData().data(), header.GetData().size()));
+
+				m_outFile.write(header.GetData().data(), header.GetData().size());
+			}
+
+			std::ofstream m_outFile;
+			std::string m_path;
+			std::string m_tempPath;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef BETTERCON_INTERNAL_SERVERENDPOINT_H_
+#define BETTERCON_INTERNAL_SERVERENDPOINT_H_
+
+/*
+ *	Server Endpoint
+ *	10/19/26 05:20
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/Packet.h>
+
+// ASIO
+#define ASIO_STANDALONE 1
+#include <asio.hpp>
+
+// STL
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	ServerEndpoint is the game server's side of a connection, for standing in for a
+		 *	server without one. It accepts one client at a time, hands every packet the client
+		 *	sends to a callback, and sends packets back in order.
+		 */
+		class ServerEndpoint
+		{
+		public:
+			using ErrorCode_t = asio::error_code;
+			using Worker_t = asio::io_context;
+			using Proto_t = asio::ip::tcp;
+			using Endpoint_t = Proto_t::endpoint;
+			using Socket_t = Proto_t::socket;
+			using Acceptor_t = Proto_t::acceptor;
+
+			using AcceptCallback_t = std::function<void()>;
+			using PacketCallback_t = std::function<void(const Packet&)>;
+			using DisconnectCallback_t = std::function<void(const ErrorCode_t&)>;
+
+			// Creates an endpoint that isn't listening
+			ServerEndpoint(Worker_t& worker);
+
+			// not moveable or copyable
+			ServerEndpoint(const ServerEndpoint& other) = delete;
+			ServerEndpoint(ServerEndpoint&& other) = delete;
+			ServerEndpoint& operator=(const ServerEndpoint& other) = delete;
+			ServerEndpoint& operator=(ServerEndpoint&& other) = delete;
+
+			// Starts listening on an endpoint. A port of 0 picks a free one, which GetLocalEndpoint() returns.
+			// @acceptCallback is called when a client connects, and @packetCallback for each packet it sends.
+			// @disconnectCallback is called when the client leaves, after which the next client is accepted.
+			// Must be called from the worker thread if the worker is running
+			ErrorCode_t Listen(const Endpoint_t& endpoint, AcceptCallback_t&& acceptCallback,
+				PacketCallback_t&& packetCallback, DisconnectCallback_t&& disconnectCallback);
+
+			// Gets the endpoint being listened on
+			Endpoint_t GetLocalEndpoint() const;
+
+			// Returns whether or not a client is connected
+			bool IsConnected() const noexcept;
+
+			// Sends a packet to the client, if there is one. Can only be called from the worker thread
+			void SendPacket(const Packet& packet);
+
+			// Disconnects the client, if there is one, without calling the disconnect callback.
+			// Can only be called from the worker thread
+			void Disconnect();
+
+			// Stops listening and disconnects the client. Can only be called from the worker thread
+			void Close();
+
+			~ServerEndpoint();
+		private:
+			void AcceptClient();
+			void CloseClient(const ErrorCode_t& ec);
+
+			void HandleAccept(const ErrorCode_t& ec);
+			void HandleReadHeader(const ErrorCode_t& ec, const size_t bytes_transferred);
+			void HandleReadBody(const ErrorCode_t& ec, const size_t bytes_transferred);
+			void HandleWrite(const ErrorCode_t& ec, const size_t bytes_transferred);
+
+			void ReadHeader();
+			void SendUnsentBuffers();
+
+			Worker_t& m_worker;
+
+			Acceptor_t m_acceptor;
+			Socket_t m_socket;
+			bool m_connected;
+			// changes with each client, so that handlers for one that left do nothing
+			uint32_t m_clientId = 0;
+
+			std::vector<char> m_incomingBuf;
+			std::queue<std::vector<char>> m_sendQueue;
+
+			AcceptCallback_t m_acceptCallback;
+			PacketCallback_t m_packetCallback;
+			DisconnectCallback_t m_disconnectCallback;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef BETTERCON_INTERNAL_SESSIONCAPTURE_H_
+#define BETTERCON_INTERNAL_SESSIONCAPTURE_H_
+
+/*
+ *	RCON Session Capture
+ *	10/19/26 05:05
+ */
+
+// BetteRCon
+#include <BetteRCon/Internal/Serialization.h>
+
+// STL
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	Captures are databases with one record per frame:
+		 *
+		 *		record:	u8 frame type | i64 microseconds since the epoch | data
+		 *
+		 *	Inbound and outbound frames are the packets exactly as they were on the wire.
+		 *	Connect frames are the address that was connected to, and disconnect frames
+		 *	are the reason the connection ended.
+		 */
+		enum SessionFrameType : uint8_t
+		{
+			SessionFrameType_Connect,		// The connection was made
+			SessionFrameType_Inbound,		// A packet from the server
+			SessionFrameType_Outbound,		// A packet to the server
+			SessionFrameType_Disconnect,	// The connection ended
+			SessionFrameType_Count
+		};
+
+		inline constexpr std::string_view g_SessionFrameTypeStr[SessionFrameType_Count] = { "connect", "inbound", "outbound", "disconnect" };
+
+		inline constexpr uint32_t g_sessionCaptureTag = MakeSchemaTag("RCAP");
+		inline constexpr uint32_t g_sessionCaptureVersion = 1;
+
+		/*
+		 *	SessionCapture appends every frame of a session to a capture file, so that it can
+		 *	be replayed later without the server.
+		 */
+		class SessionCapture
+		{
+		public:
+			using Clock_t = std::chrono::system_clock;
+
+			// Starts a new capture, replacing the file if it exists. Returns false if it couldn't be opened
+			bool Open(const std::string& path);
+			// Flushes and closes the capture
+			void Close();
+			// Returns whether or not a capture is open
+			bool IsOpen() const noexcept;
+
+			// Writes a frame
+			void Write(const SessionFrameType type, const std::string_view data, const Clock_t::time_point time);
+		private:
+			DatabaseWriter m_writer;
+			bool m_open = false;
+
+			// reused between frames
+			RecordWriter m_record;
+		};
+
+		/*
+		 *	SessionCaptureReader reads a capture in one go and hands out its frames.
+		 */
+		class SessionCaptureReader
+		{
+		public:
+			using Clock_t = SessionCapture::Clock_t;
+			using Status = DatabaseReader::Status;
+
+			struct Frame
+			{
+				SessionFrameType type;
+				Clock_t::time_point time;
+				// points into the reader
+				std::string_view data;
+			};
+
+			// Loads a capture
+			Status Open(const std::string& path);
+
+			// Moves to the next frame. Returns false at the end, or when a frame is bad, in which case GetStatus() says so
+			bool Next(Frame& frameOut);
+			// Gets the reason Next() stopped early, or Status_OK if it reached the end
+			Status GetStatus() const noexcept;
+		private:
+			DatabaseReader m_reader;
+			DatabaseReader::Status m_status = DatabaseReader::Status_OK;
+		};
+	}
+}
+
+#endif
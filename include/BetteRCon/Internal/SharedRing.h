@@ -0,0 +1,90 @@
+#ifndef BETTERCON_INTERNAL_SHAREDRING_H_
+#define BETTERCON_INTERNAL_SHAREDRING_H_
+
+/*
+ *	Shared Memory Ring
+ *	10/19/26 13:30
+ */
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	SharedRing is a ring of length-prefixed records in memory that can be shared between
+		 *	processes, with one writer and one reader. Neither side takes a lock: the writer
+		 *	publishes a record by moving its position past it, and the reader frees the space by
+		 *	moving its own. A reader with nothing to read sleeps on a futex in the ring, which the
+		 *	writer only wakes when somebody is asleep, so a busy reader costs the writer nothing.
+		 */
+		class SharedRing
+		{
+		public:
+			// Gets how much memory a ring with a capacity takes. The capacity must be a power of 2
+			static size_t GetMemorySize(const uint32_t capacity) noexcept;
+			// Lays out an empty ring in memory of GetMemorySize(capacity) bytes, aligned to 64 bytes
+			static void Initialize(void* pMemory, const uint32_t capacity) noexcept;
+
+			// Creates a ring that isn't attached to any memory
+			SharedRing() = default;
+
+			// Attaches to a ring that was laid out by Initialize, possibly in another process
+			void Attach(void* pMemory, const uint32_t capacity) noexcept;
+			// Detaches from the ring
+			void Detach() noexcept;
+
+			// Copies a record into the ring, and wakes the reader if it is asleep. Returns false if there
+			// isn't room for it. Can only be called by the writer
+			bool TryWrite(const char* pData, const uint32_t size) noexcept;
+
+			// Copies the oldest record out of the ring, and frees its space. Returns false if there are
+			// none, or if the writer's position or the record's size don't fit in the ring, which marks
+			// it as corrupt until it is cleared. Can only be called by the reader
+			bool TryRead(std::vector<char>& recordOut);
+			// Returns when there is a record to read, or when the timeout passes. Can only be called by the reader
+			void Wait(const std::chrono::milliseconds timeout) noexcept;
+			// Frees every record that has been written, and forgets a reader that went away while it was
+			// asleep. Can only be called while nothing else is reading
+			void Reset() noexcept;
+			// Lays the ring out again, empty. Can only be called once the other side is gone for good
+			void Clear() noexcept;
+			// Returns whether a read found the ring's header or a record's size to be bogus
+			bool IsCorrupt() const noexcept;
+
+			// Returns whether there are no records to read
+			bool IsEmpty() const noexcept;
+			// Gets how many bytes have been read since the ring was laid out, which only moves while the reader is reading
+			uint64_t GetReadPosition() const noexcept;
+		private:
+			struct Header
+			{
+				// each is only written by one side, so they are kept on lines of their own
+				alignas(64) std::atomic<uint64_t> writePosition;
+				alignas(64) std::atomic<uint64_t> readPosition;
+				// changed by the writer to wake the reader, which sleeps on it
+				alignas(64) std::atomic<uint32_t> doorbell;
+				std::atomic<uint32_t> sleepers;
+			};
+
+			static_assert(std::atomic<uint64_t>::is_always_lock_free == true, "the ring's positions must be lock-free to be shared between processes");
+
+			void CopyIn(const uint64_t position, const char* pData, const uint32_t size) noexcept;
+			void CopyOut(const uint64_t position, char* pData, const uint32_t size) const noexcept;
+
+			Header* m_pHeader = nullptr;
+			char* m_pData = nullptr;
+			uint32_t m_capacity = 0;
+			// only touched by the reader
+			bool m_corrupt = false;
+		};
+	}
+}
+
+#endif
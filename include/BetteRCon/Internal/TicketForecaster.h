@@ -0,0 +1,87 @@
+#ifndef BETTERCON_INTERNAL_TICKETFORECASTER_H_
+#define BETTERCON_INTERNAL_TICKETFORECASTER_H_
+
+/*
+ *	Ticket Forecaster
+ *	10/18/26 23:05
+ */
+
+// STL
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	TicketForecaster keeps the recent team scores of the current round in a ring
+		 *	buffer, and estimates how fast each team's score is moving with a weighted
+		 *	linear fit that favors recent samples. From those rates it predicts when the
+		 *	round ends and who wins, either by running a team out of tickets or by
+		 *	reaching the goal score first.
+		 */
+		class TicketForecaster
+		{
+		public:
+			static constexpr size_t s_maxTeams = 4;
+			static constexpr size_t s_maxSamples = 64;
+
+			struct TeamForecast
+			{
+				int32_t score;
+				// smoothed change in score per minute. negative when the team is bleeding tickets
+				float ratePerMinute;
+				// the score the team is predicted to have at the end of the round
+				int32_t predictedScore;
+			};
+
+			struct Forecast
+			{
+				std::vector<TeamForecast> teams;
+				// whether the scores count up to a goal, rather than down to zero
+				bool countsUp = false;
+				// 0 if there is no leader yet
+				uint8_t predictedWinner = 0;
+				// negative if the scores aren't moving towards an end
+				float secondsRemaining = -1.f;
+				size_t samples = 0;
+			};
+
+			// Forgets the current round
+			void Reset();
+
+			// Adds a sample of the team scores at a round time. A round time that goes backwards starts a new round.
+			// A goal score of 0 means that teams lose when they run out of tickets
+			void AddSample(const int32_t roundSeconds, const std::vector<int32_t>& teamScores, const int32_t goalScore);
+
+			// Gets the forecast from the samples so far
+			const Forecast& GetForecast() const noexcept;
+		private:
+			struct Sample
+			{
+				int32_t roundSeconds;
+				std::array<int32_t, s_maxTeams> scores;
+			};
+
+			// samples this far in the past count for about a third as much as the latest one
+			static constexpr float s_rateTimeConstant = 120.f;
+
+			const Sample& GetSample(const size_t age) const noexcept;
+			float EstimateRate(const size_t team) const;
+			void UpdateForecast(const int32_t goalScore);
+
+			// oldest sample first, starting at m_first
+			std::array<Sample, s_maxSamples> m_samples;
+			size_t m_first = 0;
+			size_t m_numSamples = 0;
+			size_t m_numTeams = 0;
+
+			Forecast m_forecast;
+		};
+	}
+}
+
+#endif
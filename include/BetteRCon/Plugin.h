@@ -31,14 +31,14 @@ namespace BetteRCon
 	class Plugin
 	{
 	public: 
-		using CommandHandler_t = std::function<void(const std::shared_ptr<Server::PlayerInfo>& pPlayer, const std::vector<std::string>& args, const char prefix)>;
+		using CommandHandler_t = Server::CommandHandler_t;
 		using CommandHandlerMap_t = std::unordered_map<std::string, CommandHandler_t>;
 		using EventHandler_t = std::function<void(const std::vector<std::string>& eventWords)>;
 		using EventHandlerMap_t = std::unordered_multimap<std::string, EventHandler_t>;
 		using Worker_t = asio::io_context;
 
 		// Creates a plugin with the server
-		Plugin(Server* pServer) : m_pServer(pServer) {}
+		Plugin(Server* pServer) : m_pServer(pServer) { Internal::UseLogQueue(pServer->GetLogQueue()); }
 
 		// Returns the name of the plugin's author
 		virtual std::string_view GetPluginAuthor() const = 0;
@@ -48,9 +48,9 @@ namespace BetteRCon
 		virtual std::string_view GetPluginVersion() const = 0;
 
 		// Enables a plugin. BetteRCon will start calling handlers from this point
-		virtual void Enable() { m_enabled = true; BetteRCon::Internal::g_stdOutLog << "[" << GetPluginName() << "]: Enabled " << GetPluginName() << " version " << GetPluginVersion() << " by " << GetPluginAuthor() << '\n'; }
+		virtual void Enable() { m_enabled = true; BetteRCon::Internal::Log<BetteRCon::Internal::LogLevel_Info>(GetPluginName()) << "Enabled " << GetPluginName() << " version " << GetPluginVersion() << " by " << GetPluginAuthor() << '\n'; }
 		// Disables a plugin. BetteRCon will stop calling handlers from this point
-		virtual void Disable() { m_enabled = false; BetteRCon::Internal::g_stdOutLog << "[" << GetPluginName() << "]: Disabled " << GetPluginName() << " version " << GetPluginVersion() << " by " << GetPluginAuthor() << '\n'; }
+		virtual void Disable() { m_enabled = false; BetteRCon::Internal::Log<BetteRCon::Internal::LogLevel_Info>(GetPluginName()) << "Disabled " << GetPluginName() << " version " << GetPluginVersion() << " by " << GetPluginAuthor() << '\n'; }
 
 		// Retreives whether or not the plugin should be enabled
 		const bool IsEnabled() const { return m_enabled == true; }
@@ -66,12 +66,45 @@ namespace BetteRCon
 		// If the plugin is enabled, schedules an action in the milliseconds from now
 		void ScheduleAction(Server::TimedAction_t&& timedAction, const size_t millisecondsFromNow) { m_pServer->ScheduleAction([this, timedAction = std::move(timedAction)]{ if (IsEnabled() == true) timedAction(); }, millisecondsFromNow); }
 
+		// Watches a line-based file, and calls watchCallback with the added and removed lines when it changes while the plugin is enabled
+		Server::FileWatchId_t WatchFile(const std::string& path, Server::FileWatchCallback_t&& watchCallback) { return m_pServer->WatchFile(path, [this, watchCallback = std::move(watchCallback)](const Server::FileDiff_t& diff){ if (IsEnabled() == true) watchCallback(diff); }); }
+		// Stops watching a file
+		void UnwatchFile(const Server::FileWatchId_t watchId) { m_pServer->UnwatchFile(watchId); }
+
+		// Sets a key's value in the plugin's namespace of the key-value store. The value expires after ttl, unless ttl is zero
+		bool StorePut(const std::string_view key, const std::string_view value, const std::chrono::seconds ttl = std::chrono::seconds::zero()) { return m_pServer->StorePut(GetPluginName(), key, value, ttl); }
+		// Gets a key's value from the plugin's namespace of the key-value store, if it exists and has not expired
+		std::optional<std::string> StoreGet(const std::string_view key) { return m_pServer->StoreGet(GetPluginName(), key); }
+		// Erases a key from the plugin's namespace of the key-value store
+		bool StoreErase(const std::string_view key) { return m_pServer->StoreErase(GetPluginName(), key); }
+		// Calls scanCallback in order for each key in [begin, end) in the plugin's namespace of the key-value store. An empty end scans to the last key.
+		// scanCallback returns false to stop, and must not modify the store
+		void StoreScan(const std::string_view begin, const std::string_view end, const Server::StoreScanCallback_t& scanCallback) { m_pServer->StoreScan(GetPluginName(), begin, end, scanCallback); }
+
+		// Gets a player's kills, deaths, headshots and weapons over the last 5 minutes. Returns false if they have none
+		bool GetKillStats(const std::string_view playerName, Server::KillStats_t& statsOut) const { return m_pServer->GetKillStats(playerName, statsOut); }
+		// Calls thresholdCallback whenever a player's kill stats cross the threshold while the plugin is enabled
+		Server::KillThresholdId_t SubscribeKillThreshold(const Server::KillThreshold_t& threshold, Server::KillThresholdCallback_t&& thresholdCallback) { return m_pServer->SubscribeKillThreshold(threshold, [this, thresholdCallback = std::move(thresholdCallback)](const std::string& playerName, const Server::KillStats_t& stats){ if (IsEnabled() == true) thresholdCallback(playerName, stats); }); }
+		// Stops calling a threshold's callback
+		void UnsubscribeKillThreshold(const Server::KillThresholdId_t thresholdId) { m_pServer->UnsubscribeKillThreshold(thresholdId); }
+
+		// Gets a player's totals for the rounds that ended since a time. Returns false if they have no rounds since then
+		bool GetPlayerHistory(const std::string_view playerName, const std::chrono::system_clock::time_point since, Server::PlayerHistory_t& historyOut) { return m_pServer->GetPlayerHistory(playerName, since, historyOut); }
+		// Gets each of a player's rounds that ended since a time, oldest first
+		std::vector<Server::PlayerHistoryRound_t> GetPlayerHistoryRounds(const std::string_view playerName, const std::chrono::system_clock::time_point since) { return m_pServer->GetPlayerHistoryRounds(playerName, since); }
+		// Gets the totals of every player together for the rounds that ended since a time
+		Server::PlayerHistory_t GetServerHistory(const std::chrono::system_clock::time_point since) { return m_pServer->GetServerHistory(since); }
+		// Gets up to limit players with at least minRounds rounds since a time, best first by metric
+		std::vector<Server::PlayerHistory_t> GetTopPlayers(const Server::HistoryMetric_t metric, const std::chrono::system_clock::time_point since, const uint32_t minRounds, const size_t limit) { return m_pServer->GetTopPlayers(metric, since, minRounds, limit); }
+
 		// If the plugin is enabled, attempts to send a command to the server, and calls recvCallback when the response is received.
 		// RecvCallback_t must not block, as it is called from the worker thread
 		void SendCommand(const std::vector<std::string>& command, Server::RecvCallback_t&& recvCallback) { if (IsEnabled() == true) m_pServer->SendCommand(command, std::move(recvCallback)); }
 
 		// Gets server info such as name, teams
 		const Server::ServerInfo& GetServerInfo() const noexcept { return m_pServer->GetServerInfo(); }
+		// Gets the predicted end of the round from the score history of the current round
+		const Server::TicketForecast_t& GetTicketForecast() const noexcept { return m_pServer->GetTicketForecast(); }
 		// Gets server players
 		const Server::PlayerMap_t& GetPlayers() const noexcept { return m_pServer->GetPlayers(); }
 		// Gets all of the teams
@@ -80,6 +113,8 @@ namespace BetteRCon
 		const Server::Team& GetTeam(const uint8_t teamId) const noexcept { return m_pServer->GetTeam(teamId); }
 		// Gets a squad
 		const Server::PlayerMap_t& GetSquad(const uint8_t teamId, const uint8_t squadId) const noexcept { return m_pServer->GetSquad(teamId, squadId); }
+		// Finds up to limit players whose names match the query case-insensitively, best match first
+		std::vector<std::shared_ptr<Server::PlayerInfo>> FindPlayers(const std::string_view query, const size_t limit) const { return m_pServer->FindPlayers(query, limit); }
 
 		// Sends a chat message to everybody, of max 128 characters
 		void SendChatMessage(const std::string& message) { SendCommand({ "admin.say", "[" + std::string(GetPluginName()) + "] " + message, "all" }, [](const Server::ErrorCode_t&, const std::vector<std::string>&) {}); }
@@ -92,31 +127,20 @@ namespace BetteRCon
 		// Sends a chat message to a set of players, of max 128 characters
 		void SendChatMessage(const std::string& message, const std::vector<std::shared_ptr<Server::PlayerInfo>>& players) { for (const auto& pPlayer : players) { SendChatMessage(message, pPlayer); } }
 
+		// Plans moves that bring the teams within the options' strength ratio, with each player's strength from strengthCallback. Requests are planned first if they
+		// don't push the teams further out of balance. Squads stay together, commanders and spectators stay put, and teams stay within the max team size
+		Server::BalancePlan PlanTeamBalance(const std::vector<Server::MoveRequest_t>& requests, const Server::PlayerStrengthCallback_t& strengthCallback, const Server::BalanceOptions_t& options) { return m_pServer->PlanTeamBalance(requests, strengthCallback, options); }
+
 		// Moves a player by killing them if they are alive. If squadId is UINT8_MAX, find a suitable squad
-		void MovePlayer(const uint8_t teamId, uint8_t squadId, const std::shared_ptr<Server::PlayerInfo>& pPlayer) 
-		{ 
-			if (squadId == UINT8_MAX)
-			{
-				// find them a squad
-				const Server::Team& newTeam = GetTeam(teamId);
-
-				constexpr size_t SQUAD_MAX = 5;
-
-				for (const Server::SquadMap_t::value_type& squad : newTeam.squads)
-				{
-					if (squad.second.size() < SQUAD_MAX)
-					{
-						squadId = squad.first;
-						break;
-					}
-				}
-
-				// we didn't find a squad
-				if (squadId == UINT8_MAX)
-					squadId = 0;
-			}
-
-			m_pServer->MovePlayer(teamId, squadId, pPlayer); 
+		void MovePlayer(const uint8_t teamId, const uint8_t squadId, const std::shared_ptr<Server::PlayerInfo>& pPlayer) { m_pServer->MovePlayer(teamId, squadId, pPlayer); }
+		// Moves players by killing them if they are alive. Squads are picked together for moves with a squadId of UINT8_MAX, keeping players from the same squad
+		// together and filling partial squads first. Failed moves are undone, and moveBatchCallback is called with the results while the plugin is enabled
+		void MoveBatch(const std::vector<Server::BatchMove>& moves, Server::MoveBatchCallback_t&& moveBatchCallback = nullptr)
+		{
+			if (moveBatchCallback == nullptr)
+				return m_pServer->MoveBatch(moves, nullptr);
+
+			m_pServer->MoveBatch(moves, [this, moveBatchCallback = std::move(moveBatchCallback)](const std::vector<Server::BatchMoveResult>& results){ if (IsEnabled() == true) moveBatchCallback(results); });
 		}
 
 		// Kills a player
@@ -127,7 +151,7 @@ namespace BetteRCon
 		// Kicks a player without reason
 		void KickPlayer(const std::shared_ptr<Server::PlayerInfo>& pPlayer) { KickPlayer(pPlayer, ""); }
 
-		// Registers a command with a given handler, which will be called regardless of case
+		// Registers a command with a given handler, which will be called regardless of case. Commands take effect once plugins are loaded, or when the plugin is next enabled
 		void RegisterCommand(const std::string& commandName, CommandHandler_t&& commandHandler) 
 		{
 			std::string lowerCommand;
@@ -7,16 +7,34 @@
  */
 
  // BetteRCon
+#include <BetteRCon/Internal/BalanceSolver.h>
+#include <BetteRCon/Internal/ChatFilter.h>
+#include <BetteRCon/Internal/CommandRouter.h>
 #include <BetteRCon/Internal/Connection.h>
+#include <BetteRCon/Internal/EventLog.h>
+#include <BetteRCon/Internal/FileWatcher.h>
+#include <BetteRCon/Internal/HandlerWatchdog.h>
+#include <BetteRCon/Internal/KillStream.h>
+#include <BetteRCon/Internal/KVStore.h>
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/Metrics.h>
+#include <BetteRCon/Internal/MetricsServer.h>
+#include <BetteRCon/Internal/NameIndex.h>
+#include <BetteRCon/Internal/PluginSandbox.h>
+#include <BetteRCon/Internal/RateLimiter.h>
+#include <BetteRCon/Internal/RoundHistory.h>
+#include <BetteRCon/Internal/TicketForecaster.h>
 
 // STL
 #include <functional>
+#include <map>
 #include <mutex>
 #include <set>
 #include <string>
 #include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #ifdef _WIN32
@@ -30,6 +48,12 @@ namespace BetteRCon
 {
 	class Plugin;
 
+	namespace Internal
+	{
+		class PluginHost;
+		class ServerBenchmark;
+	}
+
 	/*
 	 *	BetteRConServer is a class signifying a connection to a Battlefield server.
 	 *	It encompasses the connection itself, the thread, layer, player management,
@@ -49,6 +73,13 @@ namespace BetteRCon
 
 		static constexpr std::string_view s_LoginResultStr[LoginResult_Count] = { "OK", "Password was not set by the server", "Password was incorrect", "Unknown" };
 
+		enum SlowHandlerAction
+		{
+			SlowHandlerAction_Log,		// Slow plugin handlers are logged
+			SlowHandlerAction_Disable,	// Slow plugin handlers are logged, and their plugin is disabled once they return
+			SlowHandlerAction_Count
+		};
+
 		struct ServerInfo
 		{
 			std::string m_serverName;
@@ -109,13 +140,30 @@ namespace BetteRCon
 		using PluginDestructor_t = std::add_pointer_t<void(Plugin*)>;
 		using PluginFactory_t = std::add_pointer_t<Plugin*(Server*)>;
 
+		// every call to a plugin's handlers is timed into one of these. They are kept for the life of the server, so that
+		// the watchdog can read them while a handler is running, and they are there again if the plugin is loaded again
+		struct HandlerStats
+		{
+			std::string pluginName;
+			// the event or command, for the log
+			std::string description;
+			Internal::MetricHistogram* pSeconds = nullptr;
+			Internal::MetricCounter* pSlowCalls = nullptr;
+		};
+
 		struct PluginInfo
 		{
 			HMOD hPluginModule;
 			Plugin* pPlugin;
 			PluginDestructor_t pDestructor;
+			// found by handler, since the event has already been looked up to find it
+			std::unordered_map<const void*, HandlerStats*> eventHandlerStats;
 		};
 	public:
+		using BalanceOptions_t = Internal::BalanceSolver::Options;
+		// args are the command and the arguments after it, split by spaces or quotes. prefix is the character before the command, or 0 for /
+		using CommandHandler_t = std::function<void(const std::shared_ptr<PlayerInfo>& pPlayer, const std::vector<std::string>& args, const char prefix)>;
+		using CommandTiming_t = Internal::Connection::CommandTiming_t;
 		using Connection_t = Internal::Connection;
 		using Endpoint_t = Connection_t::Endpoint_t;
 		using ErrorCode_t = Connection_t::ErrorCode_t;
@@ -123,9 +171,37 @@ namespace BetteRCon
 		using EventCallbackMap_t = std::unordered_multimap<std::string, EventCallback_t>;
 		using ConnectCallback_t = std::function<void(const ErrorCode_t& ec)>;
 		using DisconnectCallback_t = std::function<void(const ErrorCode_t& ec)>;
+		using FileDiff_t = Internal::FileWatcher::FileDiff;
+		using FileWatchCallback_t = Internal::FileWatcher::WatchCallback_t;
+		using FileWatchId_t = Internal::FileWatcher::WatchId_t;
 		using FinishedLoadingPluginsCallback_t = std::function<void()>;
+		using KillStats_t = Internal::KillStream::Stats;
+		using KillThreshold_t = Internal::KillStream::Threshold;
+		using KillThresholdCallback_t = Internal::KillStream::ThresholdCallback_t;
+		using KillThresholdId_t = Internal::KillStream::SubscriptionId_t;
+		using HistoryMetric_t = Internal::RoundHistory::Metric;
 		using LoginCallback_t = std::function<void(const LoginResult result)>;
+		struct BatchMove
+		{
+			std::shared_ptr<PlayerInfo> pPlayer;
+			uint8_t teamId;
+			// UINT8_MAX to pick a squad with room
+			uint8_t squadId = UINT8_MAX;
+		};
+		struct BatchMoveResult
+		{
+			std::shared_ptr<PlayerInfo> pPlayer;
+			uint8_t teamId;
+			// the squad that was picked
+			uint8_t squadId;
+			// empty if the move succeeded
+			std::string error;
+		};
+		using MoveBatchCallback_t = std::function<void(const std::vector<BatchMoveResult>& results)>;
+		// a player that asked to be moved, and the team they want to go to
+		using MoveRequest_t = std::pair<std::shared_ptr<PlayerInfo>, uint8_t>;
 		using Packet_t = Internal::Packet;
+		using PendingCommand_t = Internal::Connection::PendingCommand_t;
 		using PlayerMap_t = std::unordered_map<std::string, std::shared_ptr<PlayerInfo>>;
 		using PlayerTimerMap_t = std::unordered_map<std::string, std::pair<std::shared_ptr<PlayerInfo>, asio::steady_timer>>;
 		// unordered map of teams, with val of unordered map of squads, with val of unordered map of playernames, with val of playerInfo ptr
@@ -137,12 +213,34 @@ namespace BetteRCon
 			uint32_t commanderCount = 0;
 		};
 		using TeamMap_t = std::unordered_map<uint8_t, Team>;
+		using PlayerHistory_t = Internal::RoundHistory::PlayerTotals;
+		using PlayerHistoryRound_t = Internal::RoundHistory::PlayerRoundEntry;
 		using PlayerInfoCallback_t = std::function<void(const PlayerMap_t& players, const TeamMap_t& teams)>;
+		using PlayerStrengthCallback_t = std::function<float(const PlayerInfo& player)>;
+		struct BalanceMove
+		{
+			std::shared_ptr<PlayerInfo> pPlayer;
+			uint8_t teamId;
+			// UINT8_MAX if any squad with room will do
+			uint8_t squadId;
+			// whether the move was requested, or was planned to balance the teams
+			bool requested;
+		};
+		struct BalancePlan
+		{
+			std::vector<BalanceMove> moves;
+			float strengthRatioBefore;
+			float strengthRatioAfter;
+			// whether the teams are within the strength ratio after the moves
+			bool balanced;
+		};
 		// success is always true when load is false. failReason is only populated if success is false
 		using PluginCallback_t = std::function<void(const std::string& pluginName, const bool load, const bool success, const std::string& failReason)>;
 		using PluginMap_t = std::unordered_map<std::string, PluginInfo>;
 		using RecvCallback_t = std::function<void(const ErrorCode_t& ec, const std::vector<std::string>& response)>;
 		using ServerInfoCallback_t = std::function<void(const ServerInfo& info)>;
+		using StoreScanCallback_t = Internal::KVStore::ScanCallback_t;
+		using TicketForecast_t = Internal::TicketForecaster::Forecast;
 		using TimedAction_t = std::function<void()>;
 		using Worker_t = Connection_t::Worker_t;
 		// Default constructor
@@ -179,8 +277,46 @@ namespace BetteRCon
 		// Returns whether or not we are connected
 		bool IsConnected() const noexcept;
 
+		// Gets the queue that log lines go to. Plugins send their lines to it, so that one thread writes every module's lines
+		virtual Internal::LogQueue* GetLogQueue() const noexcept;
+
+		// Starts writing every event, command and response to a binary event log in a directory, which bettercon-logdump reads.
+		// Returns false if the log couldn't be started
+		bool StartEventLog(const std::string& directory);
+		// Stops writing the event log
+		void StopEventLog();
+
+		// Starts capturing the raw session to a file, which bettercon-replay plays back without the server.
+		// Returns false if the capture couldn't be started
+		bool StartCapture(const std::string& path);
+		// Stops capturing the session
+		void StopCapture();
+
+		// Gets the metrics of the connection, events, polls and plugins
+		const Internal::MetricRegistry& GetMetrics() const noexcept;
+		// Starts serving the metrics in the Prometheus text format at http://127.0.0.1:port/metrics, from a thread of their own.
+		// A port of 0 picks a free one, which GetMetricsPort() returns. Returns false if the port couldn't be bound
+		bool StartMetricsServer(const uint16_t port);
+		// Gets the port the metrics are served on, or 0 if they aren't
+		uint16_t GetMetricsPort() const noexcept;
+		// Stops serving the metrics
+		void StopMetricsServer();
+
+		// Sets how long a single call to a plugin's event or command handler may hold up the worker. Calls that run longer are
+		// logged by a watchdog thread while they are still running, and again when they return, which is when action is taken.
+		// A budget of zero stops the watchdog. Defaults to 250ms, with slow handlers logged
+		void SetHandlerBudget(const std::chrono::milliseconds budget, const SlowHandlerAction action);
+
+		// Sets whether plugins are loaded into bettercon-pluginhost processes of their own instead of this one, from the next login.
+		// An isolated plugin that crashes or hangs is started again without taking the server down. Its host is sent the events and
+		// this server's serverInfo and player list, and picks up each round this server records in the history when the round ends.
+		// An empty hostPath uses the host next to the running program
+		void SetPluginIsolation(const bool isolate, const std::string& hostPath = "");
+
 		// Gets server info
 		virtual const ServerInfo& GetServerInfo() const noexcept;
+		// Gets the predicted end of the round from the score history of the current round. Updated with each serverInfo, before bettercon.ticketForecast is fired
+		virtual const TicketForecast_t& GetTicketForecast() const noexcept;
 		// Gets server players
 		virtual const PlayerMap_t& GetPlayers() const noexcept;
 		// Gets teams
@@ -189,10 +325,18 @@ namespace BetteRCon
 		virtual const Team& GetTeam(const uint8_t teamId) const noexcept;
 		// Gets team squad
 		virtual const PlayerMap_t& GetSquad(const uint8_t teamId, const uint8_t squadId) const noexcept;
+		// Finds up to limit players whose names match the query case-insensitively, best match first.
+		// Exact matches rank first, then prefix matches, then substring matches, then similar names
+		virtual std::vector<std::shared_ptr<PlayerInfo>> FindPlayers(const std::string_view query, const size_t limit) const;
 
 		// Attempts to send a command to the server, and calls recvCallback when the response is received.
 		// RecvCallback_t must not block, as it is called from the worker thread
 		virtual void SendCommand(const std::vector<std::string>& command, RecvCallback_t&& recvCallback);
+		// Gets how long each command name has waited to be written, and waited on the server after that, since the server was created.
+		// Commands that were dropped when the connection closed are counted as unanswered
+		virtual void GetCommandTimings(std::vector<CommandTiming_t>& timingsOut) const;
+		// Gets the commands that are waiting for their response, oldest first
+		virtual void GetPendingCommands(std::vector<PendingCommand_t>& pendingOut) const;
 
 		// Registers a callback that will be called any time an event is received, before any plugin event callbacks are called. Alias to RegisterPrePluginCallback
 		void RegisterCallback(const std::string& eventName, EventCallback_t&& eventCallback);
@@ -212,11 +356,60 @@ namespace BetteRCon
 		// Schedules an action to be executed in the future
 		virtual void ScheduleAction(TimedAction_t&& timedAction, const size_t millisecondsFromNow);
 
-		// Moves a player by forcekilling them if they are alive. Updates the teams to affect the change
+		// Watches a line-based file and calls watchCallback from the worker thread with the lines that were added
+		// and removed whenever it changes on disk. Watches are removed when the server disconnects
+		virtual FileWatchId_t WatchFile(const std::string& path, FileWatchCallback_t&& watchCallback);
+		// Stops watching a file
+		virtual void UnwatchFile(const FileWatchId_t watchId);
+
+		// Sets a key's value in a namespace of the key-value store. The value expires after ttl, unless ttl is zero. Returns false on failure
+		virtual bool StorePut(const std::string_view storeNamespace, const std::string_view key, const std::string_view value, const std::chrono::seconds ttl);
+		// Gets a key's value from a namespace of the key-value store, if it exists and has not expired
+		virtual std::optional<std::string> StoreGet(const std::string_view storeNamespace, const std::string_view key);
+		// Erases a key from a namespace of the key-value store. Returns false if it did not exist
+		virtual bool StoreErase(const std::string_view storeNamespace, const std::string_view key);
+		// Calls scanCallback in order for each key in [begin, end) in a namespace of the key-value store. An empty end scans the rest
+		// of the namespace. scanCallback returns false to stop, and must not modify the store
+		virtual void StoreScan(const std::string_view storeNamespace, const std::string_view begin, const std::string_view end, const StoreScanCallback_t& scanCallback);
+
+		// Gets a player's kills, deaths, headshots and weapons over the last 5 minutes. Returns false if they have none
+		virtual bool GetKillStats(const std::string_view playerName, KillStats_t& statsOut) const;
+		// Calls thresholdCallback from the worker thread whenever a player's kill stats cross the threshold. A player is only called
+		// again after their stats drop back below it. Subscriptions are removed when the server disconnects
+		virtual KillThresholdId_t SubscribeKillThreshold(const KillThreshold_t& threshold, KillThresholdCallback_t&& thresholdCallback);
+		// Stops calling a threshold's callback
+		virtual void UnsubscribeKillThreshold(const KillThresholdId_t thresholdId);
+
+		// Gets a player's totals for the rounds that ended since a time. Every round is recorded when it ends, before plugins see server.onRoundOverPlayers.
+		// Returns false if they have no rounds since then. The name stays valid for the life of the server
+		virtual bool GetPlayerHistory(const std::string_view playerName, const std::chrono::system_clock::time_point since, PlayerHistory_t& historyOut);
+		// Gets each of a player's rounds that ended since a time, oldest first
+		virtual std::vector<PlayerHistoryRound_t> GetPlayerHistoryRounds(const std::string_view playerName, const std::chrono::system_clock::time_point since);
+		// Gets the totals of every player together for the rounds that ended since a time
+		virtual PlayerHistory_t GetServerHistory(const std::chrono::system_clock::time_point since);
+		// Gets up to limit players with at least minRounds rounds since a time, best first by metric
+		virtual std::vector<PlayerHistory_t> GetTopPlayers(const HistoryMetric_t metric, const std::chrono::system_clock::time_point since, const uint32_t minRounds, const size_t limit);
+
+		// Plans the fewest moves that bring the teams' total strengths, as given by strengthCallback, within the options' ratio. Squads are moved
+		// together, commanders and spectators are never moved, and teams are kept within the max team size, which is capped by the server's.
+		// Requests are planned first, in order, unless they would push the teams further out of balance. Nothing is actually moved
+		virtual BalancePlan PlanTeamBalance(const std::vector<MoveRequest_t>& requests, const PlayerStrengthCallback_t& strengthCallback, const BalanceOptions_t& options);
+
+		// Moves a player by forcekilling them if they are alive. Updates the teams to affect the change. If squadId is UINT8_MAX, picks a squad with room
 		virtual void MovePlayer(const uint8_t teamId, const uint8_t squadId, const std::shared_ptr<PlayerInfo>& pPlayer);
+		// Moves players by forcekilling them if they are alive. Squads are picked together for moves with a squadId of UINT8_MAX: players moving from the
+		// same squad to the same team are kept together, and partial squads are filled before empty ones are used. The commands are all sent at once and
+		// the teams are updated right away. Once every response is in, the moves that failed are undone together and moveBatchCallback is called, if set.
+		// Moves that are still waiting when the connection closes fail with "Disconnected"
+		virtual void MoveBatch(const std::vector<BatchMove>& moves, MoveBatchCallback_t&& moveBatchCallback);
 
 		~Server();
 	private:
+		// the benchmarks feed events and player lists straight in, without a connection
+		friend class Internal::ServerBenchmark;
+		// and the plugin host feeds in the events it is sent
+		friend class Internal::PluginHost;
+
 		void ClearContainers();
 
 		void SendResponse(const std::vector<std::string>& response, const int32_t sequence);
@@ -225,6 +418,7 @@ namespace BetteRCon
 		void HandleLoginRecvHash(const ErrorCode_t& ec, const std::vector<std::string>& response, const std::string& password, const LoginCallback_t& loginCallback);
 		void HandleLoginRecvResponse(const ErrorCode_t& ec, const std::vector<std::string>& response, const LoginCallback_t& loginCallback);
 
+		void DispatchEvent(const std::vector<std::string>& eventArgs);
 		void FireEvent(const std::vector<std::string>& eventArgs);
 		
 		void HandlePlayerInfo(const std::vector<std::string>& playerInfo);
@@ -239,32 +433,143 @@ namespace BetteRCon
 		void HandleOnSpawn(const std::vector<std::string>& eventArgs);
 		void HandleOnSquadChange(const std::vector<std::string>& eventArgs);
 		void HandleOnTeamChange(const std::vector<std::string>& eventArgs);
+		void HandleOnRoundOver(const std::vector<std::string>& eventArgs);
 		void HandleOnRoundEnd(const std::vector<std::string>& eventArgs);
 		void HandlePunkbusterMessage(const std::vector<std::string>& eventArgs);
 
-		void HandleMovePlayer(const uint8_t oldTeamId, const uint8_t oldSquadId, const std::shared_ptr<PlayerInfo>& pPlayer, const ErrorCode_t& ec, const std::vector<std::string>& response);
+		struct MoveBatchState
+		{
+			std::vector<BatchMoveResult> results;
+			// the team and squad each player was in before the batch
+			std::vector<std::pair<uint8_t, uint8_t>> oldSquads;
+			// moves that didn't need to be sent are not undone
+			std::vector<bool> sent;
+			// moves whose response came in, or that were failed when we disconnected
+			std::vector<bool> answered;
+			size_t pendingMoves;
+			MoveBatchCallback_t moveBatchCallback;
+		};
+
+		static constexpr size_t s_maxSquadSize = 5;
+
+		void PlanBatchSquads(std::vector<BatchMoveResult>& moves) const;
+		void HandleBatchMovePlayer(const std::shared_ptr<MoveBatchState>& pBatch, const size_t moveIndex, const ErrorCode_t& ec, const std::vector<std::string>& response);
+		void FailMoveBatches();
+		void FinishMoveBatch(const std::shared_ptr<MoveBatchState>& pBatch);
 
 		void AddPlayerToSquad(const std::shared_ptr<PlayerInfo>& pPlayer, const uint8_t teamId, const uint8_t squadId);
 		void RemovePlayerFromSquad(const std::shared_ptr<PlayerInfo>& pPlayer, const uint8_t teamId, const uint8_t squadId);
 
 		void LoadPlugins();
+		// returns false if the plugin couldn't be loaded, after calling the plugin callback either way
+		bool LoadPlugin(const std::string& path);
+		// starts a host for the plugin, which calls the plugin callback once it has loaded it, or failed to
+		void LoadSandbox(const std::string& path);
+		void StopSandbox(const std::shared_ptr<Internal::PluginSandbox>& pSandbox);
+		void RegisterServerHandlers();
 		void InitializeServer();
 
+		// chat commands are routed straight to the handlers of the plugins that registered them
+		struct CommandRoute
+		{
+			Plugin* pPlugin;
+			const CommandHandler_t* pCommandHandler;
+			HandlerStats* pStats;
+		};
+
+		Internal::CommandRouter m_commandRouter;
+		std::vector<CommandRoute> m_commandRoutes;
+		// reused between chat messages, so that the strings keep their storage
+		std::vector<std::string_view> m_commandTokens;
+		std::vector<std::string> m_commandArgs;
+
+		void BuildCommandRouter();
+
+		// chat is checked against the patterns in plugins/ChatFilter.cfg, one per line, and any that match are fired as
+		// bettercon.chatViolation with the player, the message, and the pattern, offset and length of each match
+		Internal::ChatFilter m_chatFilter;
+		std::set<std::string> m_chatFilterPatterns;
+		std::vector<Internal::ChatFilter::Violation> m_chatViolations;
+
+		void LoadChatFilter();
+		void HandleChatFilterChanged(const FileDiff_t& diff);
+		void CompileChatFilter();
+
+		// each player's commands are limited altogether, and per command, before any handler sees them. The limits are read from
+		// plugins/CommandLimits.cfg, with lines of [player],burst,seconds and [command],burst,seconds for the defaults,
+		// command,burst,seconds for a single command, and [reply],message for what limited players are told
+		using CommandLimit_t = Internal::RateLimiter::Limit;
+		using CommandLimitMap_t = std::unordered_map<std::string, CommandLimit_t>;
+
+		static constexpr CommandLimit_t s_defaultPlayerCommandLimit{ 8, std::chrono::seconds(2) };
+		static constexpr CommandLimit_t s_defaultCommandLimit{ 3, std::chrono::seconds(5) };
+		// {command} and {seconds} are replaced with the command and how long until it can be used
+		static constexpr std::string_view s_defaultCooldownReply = "[BetteRCon] Slow down! You can use {command} again in {seconds} seconds";
+
+		Internal::RateLimiter m_commandLimiter;
+		CommandLimit_t m_playerCommandLimit;
+		CommandLimit_t m_commandLimit;
+		CommandLimitMap_t m_commandLimits;
+		std::string m_cooldownReply;
+		// players who were told to slow down, and aren't told again until one of their commands goes through
+		std::unordered_set<std::string> m_cooldownRepliedPlayers;
+		// reused between commands
+		std::string m_commandLimitName;
+		std::string m_commandLimitKey;
+
+		void LoadCommandLimits();
+		void ReadCommandLimits();
+		bool TakeCommandLimit(const std::string& playerName, const std::string_view commandName);
+
 		bool m_gotServerInfo;
 		bool m_gotServerPlayers;
 		bool m_initializedServer;
 
 		int32_t m_lastSequence;
 
+		// written from the worker, like everything else that touches the connection
+		Internal::EventLog m_eventLog;
+
+		// declared before the connection, which counts its traffic in them
+		Internal::MetricRegistry m_metrics;
+		Internal::MetricsServer m_metricsServer;
+		Internal::MetricCounter* m_pConnects;
+		Internal::MetricCounter* m_pReconnects;
+		Internal::MetricCounter* m_pDisconnects;
+		Internal::MetricGauge* m_pConnected;
+		Internal::MetricHistogram* m_pServerInfoPollSeconds;
+		Internal::MetricHistogram* m_pPlayerListPollSeconds;
+		Internal::MetricHistogram* m_pPunkbusterPlayerListPollSeconds;
+		// looked up by event name, and added to the first time each event is seen
+		std::unordered_map<std::string, Internal::MetricCounter*> m_eventCounters;
+
+		// keyed by plugin and description. The watchdog is declared after them, so that it stops before they go
+		std::map<std::pair<std::string, std::string>, HandlerStats> m_handlerStats;
+		Internal::HandlerWatchdog m_handlerWatchdog;
+		std::chrono::milliseconds m_handlerBudget;
+		// zero when there is no budget
+		uint64_t m_handlerBudgetTicks;
+		SlowHandlerAction m_slowHandlerAction;
+
+		HandlerStats* GetHandlerStats(const std::string_view pluginName, const std::string& handlerName, const bool command);
+		void FinishPluginHandler(HandlerStats& stats, Plugin* pPlugin, const uint64_t elapsedTicks);
+		void HandleStalledHandler(const HandlerStats& stats, const std::chrono::nanoseconds elapsed);
+
 		Worker_t& m_worker;
 		Connection_t m_connection;
 
+		// lines are tagged with the server's address, so that servers on the same host can be told apart
+		std::string m_logTag;
+		Internal::Log<Internal::LogLevel_Warning> m_warnLog;
+		Internal::Log<Internal::LogLevel_Error> m_errLog;
+
 		EventCallbackMap_t m_prePluginEventCallbacks;
 		EventCallbackMap_t m_postPluginEventCallbacks;
 
 		// server info
 		ServerInfo m_serverInfo;
 		asio::steady_timer m_serverInfoTimer;
+		Internal::TicketForecaster m_ticketForecaster;
 
 		void HandleServerInfo(const ErrorCode_t& ec, const std::vector<std::string>& serverInfo);
 		void HandleServerInfoTimerExpire(const ErrorCode_t& ec);
@@ -279,15 +584,51 @@ namespace BetteRCon
 		// plugins
 		PluginMap_t m_plugins;
 
+		// isolated plugins, by name. Each is sent every event and poll response from the server, and keeps its own copy of the players from them
+		bool m_isolatePlugins;
+		// set in a plugin host, which is sent the polls instead of making them, and reads the round history the server process records
+		bool m_isPluginHost;
+		std::string m_pluginHostPath;
+		std::unordered_map<std::string, std::shared_ptr<Internal::PluginSandbox>> m_sandboxes;
+		// sandboxes whose hosts haven't loaded their plugins yet, and ones whose hosts haven't exited yet
+		std::vector<std::shared_ptr<Internal::PluginSandbox>> m_loadingSandboxes;
+		std::vector<std::shared_ptr<Internal::PluginSandbox>> m_stoppingSandboxes;
+		// the latest poll responses, for hosts that are still loading
+		std::vector<std::string> m_serverInfoResponse;
+		std::vector<std::string> m_playerListResponse;
+
 		// player info
 		// we store as shared_ptrs with redundancy because we want fast accessing of teams and squads, as well as easy traversal of all players
 		PlayerMap_t m_players;
+		Internal::NameIndex m_playerNameIndex;
 		PlayerTimerMap_t m_playerTimers;
 		TeamMap_t m_teams;
 		asio::steady_timer m_playerInfoTimer;
+
+		// reused between balance plans
+		Internal::BalanceSolver m_balanceSolver;
+		Internal::BalanceSolver::Plan m_balancePlan;
+		std::vector<std::shared_ptr<PlayerInfo>> m_balancePlayers;
+		std::unordered_map<const PlayerInfo*, size_t> m_balancePlayerIndices;
+		// move batches still waiting on responses
+		std::vector<std::shared_ptr<MoveBatchState>> m_moveBatches;
 		asio::steady_timer m_punkbusterPlayerListTimer;
 		
 		std::set<std::shared_ptr<asio::steady_timer>> m_scheduledTimers;
+		Internal::KillStream m_killStream;
+		Internal::FileWatcher m_fileWatcher;
+
+		// opened the first time a plugin uses it
+		Internal::KVStore m_store;
+		bool OpenStore();
+
+		// rounds are kept for a year, and the history is opened the first time it is used
+		static constexpr std::chrono::hours s_roundHistoryRetention = std::chrono::hours(24 * 365);
+
+		Internal::RoundHistory m_roundHistory;
+		uint8_t m_roundWinner;
+		bool OpenRoundHistory();
+		void RecordRound();
 
 		void HandlePlayerList(const ErrorCode_t& ec, const std::vector<std::string>& playerList);
 		void HandlePlayerListTimerExpire(const ErrorCode_t& ec);
@@ -1,4 +1,10 @@
 ./buildBRF.sh	# build the framework
 ./buildBRT.sh	# build the testbench
+./buildBRLD.sh	# build the event log dumper
+./buildBRR.sh	# build the replay tool
+./buildBRMS.sh	# build the mock server
+./buildBRB.sh	# build the benchmarks
+./buildBRLB.sh	# build the load benchmark
 ./buildBRC.sh	# build the console
+./buildBRPH.sh	# build the plugin host
 ./buildBRSP.sh	# build the sample plugin
\ No newline at end of file
@@ -0,0 +1,2 @@
+[ ! -d "bin/" ] && mkdir bin
+g++ --std=c++17 -O2 -I../include -I../dependencies/asio/asio/include -I../dependencies/MD5 ../src/BetteRConBench.cpp ../src/Internal/*.cpp ../src/Server.cpp ../dependencies/MD5/MD5.cpp -lpthread -ldl -lstdc++fs -obin/bettercon-bench
\ No newline at end of file
@@ -1,5 +1,5 @@
 [ ! -d "lib/" ] && mkdir lib
-g++ --std=c++17 -fPIC -Wall -I../include -I../dependencies/asio/asio/include -I../dependencies/MD5 ../src/Internal/Connection.cpp ../src/Internal/ErrorCode.cpp ../src/Internal/Packet.cpp ../src/Server.cpp ../dependencies/MD5/MD5.cpp -c
-ar rcs libBetteRConFramework.a Connection.o ErrorCode.o Packet.o Server.o MD5.o
+g++ --std=c++17 -fPIC -Wall -I../include -I../dependencies/asio/asio/include -I../dependencies/MD5 ../src/Internal/BalanceSolver.cpp ../src/Internal/ChatFilter.cpp ../src/Internal/CommandRouter.cpp ../src/Internal/CommandTracer.cpp ../src/Internal/Connection.cpp ../src/Internal/ErrorCode.cpp ../src/Internal/EventLog.cpp ../src/Internal/FileWatcher.cpp ../src/Internal/HandlerWatchdog.cpp ../src/Internal/Histogram.cpp ../src/Internal/KVStore.cpp ../src/Internal/KillStream.cpp ../src/Internal/Metrics.cpp ../src/Internal/MetricsServer.cpp ../src/Internal/MockServer.cpp ../src/Internal/NameIndex.cpp ../src/Internal/Packet.cpp ../src/Internal/PluginSandbox.cpp ../src/Internal/RateLimiter.cpp ../src/Internal/RoundHistory.cpp ../src/Internal/SandboxChannel.cpp ../src/Internal/ServerEndpoint.cpp ../src/Internal/SessionCapture.cpp ../src/Internal/SharedRing.cpp ../src/Internal/TicketForecaster.cpp ../src/Server.cpp ../dependencies/MD5/MD5.cpp -c
+ar rcs libBetteRConFramework.a BalanceSolver.o ChatFilter.o CommandRouter.o CommandTracer.o Connection.o ErrorCode.o EventLog.o FileWatcher.o HandlerWatchdog.o Histogram.o KVStore.o KillStream.o Metrics.o MetricsServer.o MockServer.o NameIndex.o Packet.o PluginSandbox.o RateLimiter.o RoundHistory.o SandboxChannel.o ServerEndpoint.o SessionCapture.o SharedRing.o TicketForecaster.o Server.o MD5.o
 mv libBetteRConFramework.a lib/
 rm *.o
\ No newline at end of file
@@ -0,0 +1,2 @@
+[ ! -d "bin/" ] && mkdir bin
+g++ --std=c++17 -I../include -I../dependencies/asio/asio/include -Llib ../src/BetteRConMockServer.cpp -Wl,-Bstatic -lBetteRConFramework -Wl,-Bdynamic -lpthread -ldl -lstdc++fs -obin/bettercon-mockserver
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include <BetteRCon/Plugin.h>
+#include <BetteRCon/Internal/Serialization.h>
 
 // STL
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
 #include <list>
 #include <streambuf>
@@ -12,7 +16,7 @@
 #include <Windows.h>
 #endif
 
-// Assist allows players to assist the losing team if they are unable to switch manually. ONLY FOR CONQUEST LARGE RIGHT NOW
+// Assist allows players to assist the losing team if they are unable to switch manually
 class Assist : public BetteRCon::Plugin
 {
 public:
@@ -27,6 +31,79 @@ public:
 		int assists;
 	};
 
+	// how a game mode's team scores work
+	enum ScoreType
+	{
+		ScoreType_Tickets,		// scores count down, and a team loses when it runs out
+		ScoreType_Points,		// scores count up, and a team wins when it reaches the goal
+		ScoreType_Objectives	// scores don't say how far along the round is, so the round time does
+	};
+
+	struct GameMode
+	{
+		std::string_view name;
+		std::string_view displayName;
+		ScoreType scoreType;
+		// tickets or goal points at a game mode counter of 100%
+		int32_t maxScore;
+		// how long a round usually takes, for modes where the scores don't tell us
+		int32_t roundSeconds;
+		// whether there are two teams that players can help by switching
+		bool allowAssist;
+		// how far along the round is, from 0 to 1
+		float(*getRoundProgress)(const GameMode& gameMode, const BetteRCon::Server::ServerInfo& serverInfo, const float gameModeCounter);
+	};
+
+	// a sum whose value decays exponentially over time, so recent performance matters more than old performance.
+	// because every sum decays at the same rate, the sum of several accumulators can be kept in another one
+	class DecayedSum
+	{
+	public:
+		void Add(const float amount, const std::chrono::system_clock::time_point now)
+		{
+			m_value = Get(now) + amount;
+			m_lastUpdate = now;
+		}
+
+		float Get(const std::chrono::system_clock::time_point now) const
+		{
+			if (m_value == 0.f)
+				return 0.f;
+
+			const float elapsedSeconds = std::chrono::duration<float>(now - m_lastUpdate).count();
+			return m_value * std::exp(-elapsedSeconds / s_decaySeconds);
+		}
+
+		void Reset() { m_value = 0.f; }
+	private:
+		// performance from 3 minutes ago counts for about a third as much as current performance
+		static constexpr float s_decaySeconds = 180.f;
+
+		float m_value = 0.f;
+		std::chrono::system_clock::time_point m_lastUpdate;
+	};
+
+	// a player on a playing team, and what they have contributed to their team's totals
+	struct TrackedPlayer
+	{
+		uint8_t teamId;
+		float strength;
+		float kd;
+		int32_t lastScore;
+		DecayedSum kills;
+		DecayedSum score;
+	};
+
+	// running totals for a team, kept up to date as players kill, score, and move
+	struct TeamStats
+	{
+		float strength;
+		uint32_t playerCount;
+		float kdTotal;
+		DecayedSum kills;
+		DecayedSum score;
+	};
+
 	using MoveQueue_t = std::list<std::string>;
 	using PlayerInfo = BetteRCon::Server::PlayerInfo;
 	using PlayerMap_t = BetteRCon::Server::PlayerMap_t;
@@ -35,12 +112,17 @@ public:
 	using Team_t = BetteRCon::Server::Team;
 	using PlayerAssistMap_t = std::unordered_map<std::string, std::chrono::system_clock::time_point>;
 	using PlayerStrengthMap_t = std::unordered_map<std::string, PlayerStrengthEntry>;
+	using TeamStatsVec_t = std::vector<TeamStats>;
+	using TrackedPlayerMap_t = std::unordered_map<std::string, TrackedPlayer>;
 
 	Assist(BetteRCon::Server* pServer)
 		: Plugin(pServer)
 	{
-		// read the player information flatfile database
-		ReadPlayerDatabase();
+		// move the old flatfile database into the store
+		ImportPlayerDatabase();
+
+		// the settings are read again whenever the file changes
+		WatchFile("plugins/Assist.cfg", [this](const BetteRCon::Server::FileDiff_t&) { ReadSettings(); UpdateRecentServerHistory(); });
 
 		// listen for the assist command
 		RegisterCommand("assist", std::bind(&Assist::HandleAssist, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -48,7 +130,10 @@ public:
 		// don't let them get away so easily
 		RegisterHandler("player.onLeave", std::bind(&Assist::HandlePlayerLeave, this, std::placeholders::_1));
 
-		// listen for team changes so that we can remove them from the move queue if they manually switch
+		// keep the team totals up to date as players kill each other
+		RegisterHandler("player.onKill", std::bind(&Assist::HandleKill, this, std::placeholders::_1));
+
+		// listen for team changes so that we can move their stats and remove them from the move queue if they manually switch
 		RegisterHandler("player.onTeamChange", std::bind(&Assist::HandleTeamChange, this, std::placeholders::_1));
 
 		// store the current round time
@@ -60,48 +145,37 @@ public:
 		// also listen for round end players to store player information in our flatfile database
 		RegisterHandler("server.onRoundOverPlayers", std::bind(&Assist::HandleRoundOverPlayers, this, std::placeholders::_1));
 
-		// listen for serverInfo so we can calculate the ticket deficit
-		RegisterHandler("bettercon.serverInfo", std::bind(&Assist::HandleServerInfo, this, std::placeholders::_1));
-
 		// listen for playerInfo too so we can execute moves in the queue with updated team information
 		RegisterHandler("bettercon.playerInfo", std::bind(&Assist::HandlePlayerInfo, this, std::placeholders::_1));
 	}
 
 	virtual std::string_view GetPluginAuthor() const { return "MrElectrify"; }
 	virtual std::string_view GetPluginName() const { return "Assist"; }
-	virtual std::string_view GetPluginVersion() const { return "v1.2.4"; }
+	virtual std::string_view GetPluginVersion() const { return "v1.8.0"; }
 
 	virtual void Enable()
 	{
 		Plugin::Enable();
 
-		// check serverInfo to see if we are conquest or in endscreen
+		// check serverInfo to see which mode we are in and if we are in endscreen
 		const ServerInfo& serverInfo = GetServerInfo();
 
-		if (serverInfo.m_gameMode.find("Conquest") == std::string::npos)
-		{
-			BetteRCon::Internal::g_stdErrLog << "[Assist]: Failed to start: Mode must be ConquestSmall or ConquestLarge\n";
-			Plugin::Disable();
-			return;
-		}
+		SetGameMode(serverInfo.m_gameMode);
 
-		m_inRound = serverInfo.m_scores.m_teamScores.size() > 0;
-		for (const int32_t teamTickets : serverInfo.m_scores.m_teamScores)
-		{
-			if (teamTickets <= 0)
-			{
-				m_inRound = false;
-				continue;
-			}
-		}
-
-		// save the scores
-		m_lastScores = serverInfo.m_scores.m_teamScores;
-		m_lastScoreDiffs.resize(m_lastScores.size());
+		// a finished round has a team out of tickets or at the goal
+		m_inRound = serverInfo.m_scores.m_teamScores.size() > 0 &&
+			(m_pGameMode->scoreType == ScoreType_Objectives || GetRoundProgress(serverInfo) < 1.f);
 
 		// in case we are starting mid-round
 		m_levelStart = std::chrono::system_clock::now();
 
+		// we missed everything that happened while we were disabled, so start the totals over
+		m_trackedPlayers.clear();
+		m_teamStats.clear();
+		ReadSettings();
+		UpdateRecentServerHistory();
+		ReconcilePlayers(m_levelStart);
+
 		// get ticket multiplier
 		SendCommand({ "vars.gameModeCounter" }, [this](const BetteRCon::Server::ErrorCode_t& ec, const std::vector<std::string>& response)
 		{
@@ -135,132 +209,525 @@ public:
 
 	virtual ~Assist() {}
 private:
-	void ReadPlayerDatabase()
+	static constexpr uint32_t s_playerDatabaseTag = BetteRCon::Internal::MakeSchemaTag("ASST");
+	static constexpr uint32_t s_playerDatabaseVersion = 1;
+	static constexpr uint8_t s_playerStrengthVersion = 1;
+	static float GetTicketProgress(const GameMode& gameMode, const ServerInfo& serverInfo, const float gameModeCounter)
 	{
-		// try to open the database
-		std::ifstream inFile("plugins/Assist.db", std::ios::binary);
-		if (inFile.good() == false)
-			return;
+		const std::vector<int32_t>& teamScores = serverInfo.m_scores.m_teamScores;
+		const float maxScore = gameMode.maxScore * gameModeCounter;
+		if (teamScores.empty() == true ||
+			maxScore <= 0.f)
+			return 0.f;
+
+		// the round is as far along as the team with the fewest tickets
+		const int32_t minScore = *std::min_element(teamScores.begin(), teamScores.end());
+		return std::clamp((maxScore - minScore) / maxScore, 0.f, 1.f);
+	}
 
-		// read the entire file
-		std::vector<char> dbData((std::istreambuf_iterator<char>(inFile)),
-			std::istreambuf_iterator<char>());
+	static float GetPointProgress(const GameMode& gameMode, const ServerInfo& serverInfo, const float gameModeCounter)
+	{
+		const std::vector<int32_t>& teamScores = serverInfo.m_scores.m_teamScores;
+
+		// the server tells us the goal if it has one
+		const float goalScore = (serverInfo.m_scores.m_goalScore > 0) ? static_cast<float>(serverInfo.m_scores.m_goalScore) : gameMode.maxScore * gameModeCounter;
+		if (teamScores.empty() == true ||
+			goalScore <= 0.f)
+			return 0.f;
+
+		// the round is as far along as the team closest to the goal
+		const int32_t maxScore = *std::max_element(teamScores.begin(), teamScores.end());
+		return std::clamp(maxScore / goalScore, 0.f, 1.f);
+	}
 
-		inFile.close();
+	static float GetTimeProgress(const GameMode& gameMode, const ServerInfo& serverInfo, const float gameModeCounter)
+	{
+		if (gameMode.roundSeconds <= 0)
+			return 0.f;
+
+		return std::clamp(static_cast<float>(serverInfo.m_roundTime) / gameMode.roundSeconds, 0.f, 1.f);
+	}
 
-		const uint32_t mapSize = *reinterpret_cast<uint32_t*>(&dbData[0]);
+	// default tickets and goals, before the game mode counter
+	static constexpr GameMode s_gameModes[] =
+	{
+		{ "ConquestLarge0", "Conquest Large", ScoreType_Tickets, 800, 0, true, &Assist::GetTicketProgress },
+		{ "ConquestSmall0", "Conquest", ScoreType_Tickets, 400, 0, true, &Assist::GetTicketProgress },
+		{ "ConquestAssaultLarge0", "Conquest Assault Large", ScoreType_Tickets, 800, 0, true, &Assist::GetTicketProgress },
+		{ "ConquestAssaultSmall0", "Conquest Assault", ScoreType_Tickets, 400, 0, true, &Assist::GetTicketProgress },
+		{ "ConquestAssaultSmall1", "Conquest Assault", ScoreType_Tickets, 400, 0, true, &Assist::GetTicketProgress },
+		{ "Domination0", "Domination", ScoreType_Tickets, 300, 0, true, &Assist::GetTicketProgress },
+		{ "AirSuperiority0", "Air Superiority", ScoreType_Tickets, 250, 0, true, &Assist::GetTicketProgress },
+		{ "TankSuperiority0", "Tank Superiority", ScoreType_Tickets, 400, 0, true, &Assist::GetTicketProgress },
+		{ "Scavenger0", "Scavenger", ScoreType_Tickets, 400, 0, true, &Assist::GetTicketProgress },
+		{ "TeamDeathMatch0", "Team Deathmatch", ScoreType_Points, 100, 0, true, &Assist::GetPointProgress },
+		{ "TeamDeathMatchC0", "TDM Close Quarters", ScoreType_Points, 100, 0, true, &Assist::GetPointProgress },
+		{ "CaptureTheFlag0", "Capture the Flag", ScoreType_Objectives, 0, 1200, true, &Assist::GetTimeProgress },
+		{ "Chainlink0", "Chain Link", ScoreType_Objectives, 0, 1200, true, &Assist::GetTimeProgress },
+		{ "Obliteration", "Obliteration", ScoreType_Objectives, 0, 1800, true, &Assist::GetTimeProgress },
+		{ "CarrierAssaultLarge0", "Carrier Assault Large", ScoreType_Objectives, 0, 1800, true, &Assist::GetTimeProgress },
+		{ "CarrierAssaultSmall0", "Carrier Assault", ScoreType_Objectives, 0, 1500, true, &Assist::GetTimeProgress },
+		// attackers and defenders aren't equal, so there is no losing team to help
+		{ "RushLarge0", "Rush", ScoreType_Tickets, 75, 0, false, &Assist::GetTicketProgress },
+		{ "SquadRush0", "Squad Rush", ScoreType_Tickets, 20, 0, false, &Assist::GetTicketProgress },
+		// more than two teams, or no teams to help at all
+		{ "SquadDeathMatch0", "Squad Deathmatch", ScoreType_Points, 50, 0, false, &Assist::GetPointProgress },
+		{ "SquadObliteration0", "Squad Obliteration", ScoreType_Objectives, 0, 900, false, &Assist::GetTimeProgress },
+		{ "Elimination0", "Defuse", ScoreType_Objectives, 0, 900, false, &Assist::GetTimeProgress },
+		{ "GunMaster0", "Gun Master", ScoreType_Objectives, 0, 1200, false, &Assist::GetTimeProgress },
+		{ "GunMaster1", "Gun Master", ScoreType_Objectives, 0, 1200, false, &Assist::GetTimeProgress },
+	};
 
-		size_t offset = sizeof(uint32_t);
-		for (size_t i = 0; i < mapSize; ++i)
+	// used for modes we don't know about
+	static constexpr GameMode s_unknownGameMode = { "", "this mode", ScoreType_Objectives, 0, 1200, false, &Assist::GetTimeProgress };
+
+	void SetGameMode(const std::string_view gameModeName)
+	{
+		for (const GameMode& gameMode : s_gameModes)
 		{
-			// some naive bounds checking
-			if (offset >= dbData.size())
+			if (gameMode.name == gameModeName)
 			{
-				BetteRCon::Internal::g_stdErrLog << "[Assist]: Invalid DB\n";
+				m_pGameMode = &gameMode;
 				return;
 			}
+		}
+
+		BetteRCon::Internal::g_stdErrLog << "[Assist]: Unknown game mode " << gameModeName << ", assist is disabled until the next level\n";
+		m_pGameMode = &s_unknownGameMode;
+	}
+
+	float GetRoundProgress(const ServerInfo& serverInfo) const
+	{
+		return m_pGameMode->getRoundProgress(*m_pGameMode, serverInfo, m_gameModeCounter);
+	}
+
+	// the other team can't be made this much stronger by assisting
+	static constexpr float s_maxAssistStrengthRatio = 1.75f;
+	// players that haven't been seen in this long are forgotten
+	static constexpr std::chrono::hours s_playerStrengthTTL = std::chrono::hours(24 * 180);
+	// rounds in this window make up a player's recent form
+	static constexpr std::chrono::hours s_defaultRecentFormWindow = std::chrono::hours(24 * 7);
+	// recent form counts fully once a player has this many rounds in the window
+	static constexpr uint32_t s_defaultRecentFormRounds = 5;
+	// recent form can move a player's strength by at most half of the difference
+	static constexpr float s_defaultRecentFormWeight = 0.5f;
+
+	// reads plugins/Assist.cfg, which has a setting per line as name,value. Settings that are missing or invalid keep their defaults
+	void ReadSettings()
+	{
+		m_recentFormWindow = s_defaultRecentFormWindow;
+		m_recentFormRounds = s_defaultRecentFormRounds;
+		m_recentFormWeight = s_defaultRecentFormWeight;
+
+		std::ifstream inFile("plugins/Assist.cfg");
+
+		std::string settingLine;
+		while (std::getline(inFile, settingLine))
+		{
+			// files edited on windows
+			if (settingLine.empty() == false &&
+				settingLine.back() == '\r')
+				settingLine.pop_back();
+
+			if (settingLine.empty() == true)
+				continue;
+
+			const size_t comma = settingLine.find(',');
+			if (comma == std::string::npos)
+			{
+				BetteRCon::Internal::g_stdErrLog << "[Assist]: Failed to find comma for setting " << settingLine << '\n';
+				continue;
+			}
+
+			const std::string name = settingLine.substr(0, comma);
+			const std::string value = settingLine.substr(comma + 1);
+			try
+			{
+				if (name == "recentFormDays")
+				{
+					const int days = std::stoi(value);
+					if (days <= 0)
+						throw std::out_of_range("recentFormDays must be positive");
+
+					m_recentFormWindow = std::chrono::hours(24 * days);
+				}
+				else if (name == "recentFormRounds")
+				{
+					const int rounds = std::stoi(value);
+					if (rounds <= 0)
+						throw std::out_of_range("recentFormRounds must be positive");
+
+					m_recentFormRounds = static_cast<uint32_t>(rounds);
+				}
+				else if (name == "recentFormWeight")
+				{
+					const float weight = std::stof(value);
+					if (weight < 0.f ||
+						weight > 1.f)
+						throw std::out_of_range("recentFormWeight must be between 0 and 1");
+
+					m_recentFormWeight = weight;
+				}
+				else
+					BetteRCon::Internal::g_stdErrLog << "[Assist]: Unknown setting " << name << '\n';
+			}
+			catch (const std::exception& e)
+			{
+				BetteRCon::Internal::g_stdErrLog << "[Assist]: Invalid value for " << name << ": " << e.what() << '\n';
+			}
+		}
+	}
+
+	static void ReadPlayerStrengthEntry(BetteRCon::Internal::RecordReader& reader, PlayerStrengthEntry& entryOut)
+	{
+		entryOut.roundSamples = reader.Read<float>();
+		entryOut.relativeKDR = reader.Read<float>();
+		entryOut.relativeKPR = reader.Read<float>();
+		entryOut.relativeSPR = reader.Read<float>();
+		entryOut.winLossRatio = reader.Read<float>();
+		entryOut.assists = reader.Read<int32_t>();
+	}
+
+	// finds a player's entry, loading it from the store if they aren't in memory yet
+	PlayerStrengthEntry* FindPlayerStrength(const std::string& playerName)
+	{
+		const PlayerStrengthMap_t::iterator playerStrengthIt = m_playerStrengthDatabase.find(playerName);
+		if (playerStrengthIt != m_playerStrengthDatabase.end())
+			return &playerStrengthIt->second;
 
-			// this is a new entry. read the size of the name
-			const uint8_t nameLen = *reinterpret_cast<uint8_t*>(&dbData[offset]);
-			offset += sizeof(uint8_t);
+		const std::optional<std::string> value = StoreGet(playerName);
+		if (value.has_value() == false)
+			return nullptr;
 
-			// read the player's name
-			std::string playerName(&dbData[offset], nameLen);
-			offset += nameLen;
+		BetteRCon::Internal::RecordReader reader(*value);
+		PlayerStrengthEntry entry;
+		if (reader.Read<uint8_t>() != s_playerStrengthVersion)
+			return nullptr;
 
-			// add their entry and copy the data in
-			memcpy(&m_playerStrengthDatabase.emplace(std::move(playerName), PlayerStrengthEntry{}).first->second, &dbData[offset], sizeof(PlayerStrengthEntry));
-			offset += sizeof(PlayerStrengthEntry);
+		ReadPlayerStrengthEntry(reader, entry);
+		if (reader.IsGood() == false)
+		{
+			BetteRCon::Internal::g_stdErrLog << "[Assist]: Malformed entry for " << playerName << '\n';
+			return nullptr;
 		}
+
+		return &m_playerStrengthDatabase.emplace(playerName, entry).first->second;
+	}
+
+	// finds a player's entry, creating an empty one if they are new
+	PlayerStrengthEntry& GetPlayerStrength(const std::string& playerName)
+	{
+		PlayerStrengthEntry* pPlayerStrengthEntry = FindPlayerStrength(playerName);
+		if (pPlayerStrengthEntry != nullptr)
+			return *pPlayerStrengthEntry;
+
+		return m_playerStrengthDatabase.emplace(playerName, PlayerStrengthEntry{}).first->second;
 	}
 
-	void WritePlayerDatabase()
+	void SavePlayerStrength(const std::string& playerName, const PlayerStrengthEntry& entry)
 	{
-		std::vector<char> dbData(sizeof(uint32_t));
+		BetteRCon::Internal::RecordWriter writer;
+		writer.Write(s_playerStrengthVersion);
+		writer.Write(entry.roundSamples);
+		writer.Write(entry.relativeKDR);
+		writer.Write(entry.relativeKPR);
+		writer.Write(entry.relativeSPR);
+		writer.Write(entry.winLossRatio);
+		writer.Write(static_cast<int32_t>(entry.assists));
+
+		if (StorePut(playerName, writer.GetData(), s_playerStrengthTTL) == false)
+			BetteRCon::Internal::g_stdErrLog << "[Assist]: Failed to save entry for " << playerName << '\n';
+	}
+
+	// moves the players from the old flatfile database into the store
+	void ImportPlayerDatabase()
+	{
+		BetteRCon::Internal::DatabaseReader dbReader;
+		const BetteRCon::Internal::DatabaseReader::Status status = dbReader.Open("plugins/Assist.db", s_playerDatabaseTag, s_playerDatabaseVersion);
+		if (status == BetteRCon::Internal::DatabaseReader::Status_NotFound)
+			return;
 
-		// insert the map size
-		*reinterpret_cast<uint32_t*>(&dbData[0]) = m_playerStrengthDatabase.size();
+		size_t numImported = 0;
+		PlayerStrengthEntry entry;
 
-		for (const PlayerStrengthMap_t::value_type& entry : m_playerStrengthDatabase)
+		if (status == BetteRCon::Internal::DatabaseReader::Status_BadHeader)
 		{
-			// write the size of the player. player names will be max 64 players, so one char is necessary
-			dbData.push_back(entry.first.size() & 0xff);
+			// the format from before the shared database format is a count, then one-byte name lengths, names, and the raw entry
+			BetteRCon::Internal::RecordReader reader = dbReader.GetRawReader();
 
-			// copy their name
-			dbData.resize(dbData.size() + entry.first.size());
-			memcpy(&dbData[dbData.size() - entry.first.size()], entry.first.c_str(), entry.first.size());
+			const uint32_t mapSize = reader.Read<uint32_t>();
+			for (uint32_t i = 0; i < mapSize && reader.IsGood() == true; ++i)
+			{
+				const std::string playerName(reader.ReadView(reader.Read<uint8_t>()));
+				ReadPlayerStrengthEntry(reader, entry);
+
+				if (reader.IsGood() == false)
+					break;
 
-			// make space for their data
-			dbData.resize(dbData.size() + sizeof(PlayerStrengthEntry));
+				SavePlayerStrength(playerName, entry);
+				++numImported;
+			}
 
-			// copy their data
-			memcpy(&dbData[dbData.size() - sizeof(PlayerStrengthEntry)], &entry.second, sizeof(PlayerStrengthEntry));
+			if (reader.IsGood() == false)
+				BetteRCon::Internal::g_stdErrLog << "[Assist]: Invalid DB\n";
 		}
+		else if (status == BetteRCon::Internal::DatabaseReader::Status_OK)
+		{
+			BetteRCon::Internal::RecordReader record;
+			while (dbReader.Next(record) == true)
+			{
+				const std::string playerName(record.ReadString());
+				ReadPlayerStrengthEntry(record, entry);
+
+				if (record.IsGood() == false)
+					continue;
 
-		// try to open the output database
-		std::ofstream outFile("plugins/Assist.db", std::ios::binary);
+				SavePlayerStrength(playerName, entry);
+				++numImported;
+			}
+		}
+		else
+		{
+			BetteRCon::Internal::g_stdErrLog << "[Assist]: Failed to open DB: " << BetteRCon::Internal::DatabaseReader::s_StatusStr[status] << '\n';
+			return;
+		}
 
-		// write the file
-		outFile.write(dbData.data(), dbData.size());
+		// keep the old file around, but don't import it again
+		std::error_code ec;
+		std::filesystem::rename("plugins/Assist.db", "plugins/Assist.db.imported", ec);
 
-		outFile.close();
+		BetteRCon::Internal::g_stdOutLog << "[Assist]: Imported " << numImported << " players into the store\n";
 	}
 	
-	float CalculatePlayerStrength(const PlayerStrengthEntry& playerStrengthEntry)
+	float CalculatePlayerStrength(const std::string& playerName, const PlayerStrengthEntry& playerStrengthEntry)
 	{
 		const float relativeKDR = playerStrengthEntry.relativeKDR;
 		const float relativeKPR = playerStrengthEntry.relativeKPR;
 		const float relativeSPR = playerStrengthEntry.relativeSPR;
 
-		return (relativeKDR) + (relativeKPR * 2) + (relativeSPR * 4) + (playerStrengthEntry.winLossRatio * 3);
+		const float strength = (relativeKDR) + (relativeKPR * 2) + (relativeSPR * 4) + (playerStrengthEntry.winLossRatio * 3);
+
+		return strength * CalculateRecentForm(playerName);
 	}
 
-	void CalculatePlayerStats(const BetteRCon::Server::ServerInfo& serverInfo, const size_t numTeams, const std::shared_ptr<BetteRCon::Server::PlayerInfo>& pPlayer,
-		const std::vector<float>& playerStrengths, const std::vector<float>& playerKDTotals, const std::vector<float>& playerKPRTotals, const std::vector<float>& playerSPRTotals,
-		PlayerStrengthEntry& playerStrengthEntry, bool roundEnd = false, bool win = false)
+	// how a player has done lately compared to everybody else on the server, as a multiplier for their strength
+	float CalculateRecentForm(const std::string& playerName)
 	{
-		const uint8_t enemyTeam = (pPlayer->teamId % 2) + 1;
-		const uint8_t friendlyTeam = pPlayer->teamId;
+		if (m_recentServerHistory.secondsPlayed == 0)
+			return 1.f;
 
-		// teamIds start at 1, but our vector starts at 0. it is size 2
-		const float enemyStrength = playerStrengths[enemyTeam - 1];
-		const float friendlyStrength = playerStrengths[friendlyTeam - 1];
+		BetteRCon::Server::PlayerHistory_t playerHistory;
+		if (GetPlayerHistory(playerName, std::chrono::system_clock::now() - m_recentFormWindow, playerHistory) == false)
+			return 1.f;
+
+		const float serverKPM = m_recentServerHistory.GetKPM();
+		const float serverSPM = m_recentServerHistory.GetSPM();
+
+		const float relativeKPM = (serverKPM > 0.f) ? playerHistory.GetKPM() / serverKPM : 1.f;
+		const float relativeSPM = (serverSPM > 0.f) ? playerHistory.GetSPM() / serverSPM : 1.f;
+
+		// score counts more than kills, like it does for the overall strength
+		const float form = std::max(std::min((relativeKPM + relativeSPM * 2) / 3, 2.f), 0.5f);
+
+		// a round or two isn't much to go on
+		const float weight = m_recentFormWeight * std::min(static_cast<float>(playerHistory.rounds) / m_recentFormRounds, 1.f);
+
+		return 1.f + (form - 1.f) * weight;
+	}
+
+	void UpdateRecentServerHistory()
+	{
+		m_recentServerHistory = GetServerHistory(std::chrono::system_clock::now() - m_recentFormWindow);
+	}
+
+	static float CalculateKD(const int32_t kills, const int32_t deaths)
+	{
+		return (deaths != 0) ? (static_cast<float>(kills) / deaths) : kills;
+	}
+
+	TeamStats& GetTeamStats(const uint8_t teamId)
+	{
+		if (teamId >= m_teamStats.size())
+			m_teamStats.resize(teamId + 1);
+
+		return m_teamStats[teamId];
+	}
+
+	// gets a team's totals without adding the team
+	const TeamStats& FindTeamStats(const uint8_t teamId) const
+	{
+		static const TeamStats emptyTeamStats{};
+		return (teamId < m_teamStats.size()) ? m_teamStats[teamId] : emptyTeamStats;
+	}
+
+	// starts counting a player towards their team's totals. they must be on a playing team
+	TrackedPlayer& TrackPlayer(const PlayerInfo& player, const std::chrono::system_clock::time_point now)
+	{
+		const PlayerStrengthEntry* pPlayerStrengthEntry = FindPlayerStrength(player.name);
+
+		TrackedPlayer trackedPlayer{};
+		trackedPlayer.teamId = player.teamId;
+		trackedPlayer.strength = (pPlayerStrengthEntry != nullptr) ? CalculatePlayerStrength(player.name, *pPlayerStrengthEntry) : 0.f;
+		trackedPlayer.kd = CalculateKD(player.kills, player.deaths);
+		trackedPlayer.lastScore = player.score;
+
+		// whatever they did before we saw them counts as if it just happened
+		trackedPlayer.kills.Add(static_cast<float>(player.kills), now);
+		trackedPlayer.score.Add(static_cast<float>(player.score), now);
+
+		AddToTeam(trackedPlayer, now);
+
+		return m_trackedPlayers.insert_or_assign(player.name, trackedPlayer).first->second;
+	}
+
+	void AddToTeam(const TrackedPlayer& trackedPlayer, const std::chrono::system_clock::time_point now)
+	{
+		TeamStats& teamStats = GetTeamStats(trackedPlayer.teamId);
+
+		teamStats.strength += trackedPlayer.strength;
+		++teamStats.playerCount;
+		teamStats.kdTotal += trackedPlayer.kd;
+		teamStats.kills.Add(trackedPlayer.kills.Get(now), now);
+		teamStats.score.Add(trackedPlayer.score.Get(now), now);
+	}
+
+	void RemoveFromTeam(const TrackedPlayer& trackedPlayer, const std::chrono::system_clock::time_point now)
+	{
+		TeamStats& teamStats = GetTeamStats(trackedPlayer.teamId);
+
+		teamStats.strength -= trackedPlayer.strength;
+		--teamStats.playerCount;
+		teamStats.kdTotal -= trackedPlayer.kd;
+		teamStats.kills.Add(-trackedPlayer.kills.Get(now), now);
+		teamStats.score.Add(-trackedPlayer.score.Get(now), now);
+
+		// rounding errors build up, so start over once the team is empty
+		if (teamStats.playerCount == 0)
+			teamStats = TeamStats{};
+	}
+
+	void UntrackPlayer(const std::string& playerName, const std::chrono::system_clock::time_point now)
+	{
+		const TrackedPlayerMap_t::iterator trackedPlayerIt = m_trackedPlayers.find(playerName);
+		if (trackedPlayerIt == m_trackedPlayers.end())
+			return;
+
+		RemoveFromTeam(trackedPlayerIt->second, now);
+		m_trackedPlayers.erase(trackedPlayerIt);
+	}
+
+	// brings a player's tracked team and stats in line with the server's view of them
+	void UpdateTrackedPlayer(const PlayerInfo& player, const std::chrono::system_clock::time_point now)
+	{
+		if (player.teamId == 0)
+		{
+			UntrackPlayer(player.name, now);
+			return;
+		}
+
+		const TrackedPlayerMap_t::iterator trackedPlayerIt = m_trackedPlayers.find(player.name);
+		if (trackedPlayerIt == m_trackedPlayers.end())
+		{
+			TrackPlayer(player, now);
+			return;
+		}
+
+		TrackedPlayer& trackedPlayer = trackedPlayerIt->second;
+		if (trackedPlayer.teamId != player.teamId)
+		{
+			RemoveFromTeam(trackedPlayer, now);
+			trackedPlayer.teamId = player.teamId;
+			AddToTeam(trackedPlayer, now);
+		}
+
+		TeamStats& teamStats = GetTeamStats(trackedPlayer.teamId);
+
+		const float kd = CalculateKD(player.kills, player.deaths);
+		teamStats.kdTotal += kd - trackedPlayer.kd;
+		trackedPlayer.kd = kd;
+
+		// score only arrives with playerInfo
+		const int32_t scoreDelta = player.score - trackedPlayer.lastScore;
+		if (scoreDelta > 0)
+		{
+			trackedPlayer.score.Add(static_cast<float>(scoreDelta), now);
+			teamStats.score.Add(static_cast<float>(scoreDelta), now);
+		}
+		trackedPlayer.lastScore = player.score;
+	}
+
+	void SetTrackedStrength(TrackedPlayer& trackedPlayer, const float strength)
+	{
+		GetTeamStats(trackedPlayer.teamId).strength += strength - trackedPlayer.strength;
+		trackedPlayer.strength = strength;
+	}
+
+	// picks up anything the events missed
+	void ReconcilePlayers(const std::chrono::system_clock::time_point now)
+	{
+		const PlayerMap_t& players = GetPlayers();
+
+		for (const PlayerMap_t::value_type& player : players)
+			UpdateTrackedPlayer(*player.second, now);
+
+		// forget anybody who left without us seeing it
+		for (TrackedPlayerMap_t::iterator trackedPlayerIt = m_trackedPlayers.begin(); trackedPlayerIt != m_trackedPlayers.end();)
+		{
+			if (players.find(trackedPlayerIt->first) == players.end())
+			{
+				RemoveFromTeam(trackedPlayerIt->second, now);
+				trackedPlayerIt = m_trackedPlayers.erase(trackedPlayerIt);
+			}
+			else
+				++trackedPlayerIt;
+		}
+	}
+
+	void CalculatePlayerStats(const BetteRCon::Server::ServerInfo& serverInfo, const std::shared_ptr<BetteRCon::Server::PlayerInfo>& pPlayer, const TrackedPlayer& trackedPlayer,
+		const std::chrono::system_clock::time_point now, PlayerStrengthEntry& playerStrengthEntry, bool roundEnd = false, bool win = false)
+	{
+		const uint8_t enemyTeam = (trackedPlayer.teamId % 2) + 1;
+		const uint8_t friendlyTeam = trackedPlayer.teamId;
+
+		const TeamStats& enemyStats = FindTeamStats(enemyTeam);
+		const TeamStats& friendlyStats = FindTeamStats(friendlyTeam);
+
+		const float enemyStrength = enemyStats.strength;
+		const float friendlyStrength = friendlyStats.strength;
 
 		// multipliers
-		const int32_t minScore = *std::min_element(serverInfo.m_scores.m_teamScores.begin(), serverInfo.m_scores.m_teamScores.end());
-		const int32_t maxScore = ((serverInfo.m_gameMode == "ConquestLarge0") ? 800 : 400) * m_gameModeCounter;
+		const float roundProgress = (roundEnd == true) ? 1.f : GetRoundProgress(serverInfo);
 
-		const std::chrono::system_clock::duration timeSinceFirstSeen = std::chrono::system_clock::now() - pPlayer->firstSeen;
-		const std::chrono::system_clock::duration timeSinceLevelStart = std::chrono::system_clock::now() - m_levelStart;
+		const std::chrono::system_clock::duration timeSinceFirstSeen = now - pPlayer->firstSeen;
+		const std::chrono::system_clock::duration timeSinceLevelStart = now - m_levelStart;
 
-		const float levelAttendance = (pPlayer->firstSeen > m_levelStart) ? static_cast<float>(timeSinceFirstSeen.count()) / timeSinceLevelStart.count() : 1.f;
-		const float roundTime = levelAttendance * ((maxScore != 0) ? ((roundEnd == true) ? 1.f : (static_cast<float>(maxScore - minScore) / maxScore)) : 1.f);
+		const float levelAttendance = (pPlayer->firstSeen > m_levelStart && timeSinceLevelStart.count() != 0) ? static_cast<float>(timeSinceFirstSeen.count()) / timeSinceLevelStart.count() : 1.f;
+		const float roundTime = levelAttendance * roundProgress;
 		const float strengthMultiplier = std::max(std::min((friendlyStrength != 0.f) ? enemyStrength / friendlyStrength : 1.f, 2.f), 0.5f);
 
-		const uint32_t friendlyTeamSize = GetTeam(friendlyTeam).playerCount;
+		const uint32_t friendlyTeamSize = friendlyStats.playerCount;
 
-		// friendly stats for comparison
-		const float friendlyAvgKDR = (friendlyTeamSize > 0) ? playerKDTotals[pPlayer->teamId - 1] / friendlyTeamSize : 1.f;
-		const float friendlyAvgKPR = (friendlyTeamSize > 0) ? playerKPRTotals[pPlayer->teamId - 1] / friendlyTeamSize : 1.f;
-		const float friendlyAvgSPR = (friendlyTeamSize > 0) ? playerSPRTotals[pPlayer->teamId - 1] / friendlyTeamSize : 1.f;
+		// friendly stats for comparison. kills and score are decayed, so they compare how players are doing lately
+		const float friendlyAvgKDR = (friendlyTeamSize > 0) ? friendlyStats.kdTotal / friendlyTeamSize : 1.f;
+		const float friendlyAvgKPR = (friendlyTeamSize > 0) ? friendlyStats.kills.Get(now) / friendlyTeamSize : 1.f;
+		const float friendlyAvgSPR = (friendlyTeamSize > 0) ? friendlyStats.score.Get(now) / friendlyTeamSize : 1.f;
 
 		const float totalTime = (roundTime + playerStrengthEntry.roundSamples);
 
 		const float weightedTotalRelativeKDR = playerStrengthEntry.relativeKDR * playerStrengthEntry.roundSamples;
-		const float roundKD = (pPlayer->deaths != 0) ? (static_cast<float>(pPlayer->kills) / pPlayer->deaths) : pPlayer->kills;
-		const float roundRelativeKDR = (friendlyAvgKDR != 0.f) ? roundKD / friendlyAvgKDR : 1.f;
+		const float roundRelativeKDR = (friendlyAvgKDR > 0.f) ? trackedPlayer.kd / friendlyAvgKDR : 1.f;
 		const float weightedRoundRelativeKDR = roundRelativeKDR * roundTime * strengthMultiplier;
 
 		playerStrengthEntry.relativeKDR = (totalTime != 0.f) ? (weightedTotalRelativeKDR + weightedRoundRelativeKDR) / totalTime : 0.f;
 
 		const float weightedTotalRelativeKPR = playerStrengthEntry.relativeKPR * playerStrengthEntry.roundSamples;
-		const float roundRelativeKPR = (friendlyAvgKPR != 0.f) ? ((pPlayer->kills / roundTime) / friendlyAvgKPR) : 1.f;
+		const float roundRelativeKPR = (friendlyAvgKPR > 0.f) ? trackedPlayer.kills.Get(now) / friendlyAvgKPR : 1.f;
 		const float weightedRoundRelativeKPR = roundRelativeKPR * roundTime * strengthMultiplier;
 
 		playerStrengthEntry.relativeKPR = (totalTime != 0.f) ? (weightedTotalRelativeKPR + weightedRoundRelativeKPR) / totalTime : 0.f;
 
 		const float weightedTotalRelativeSPR = playerStrengthEntry.relativeSPR * playerStrengthEntry.roundSamples;
-		const float roundRelativeSPR = (friendlyAvgSPR != 0.f) ? pPlayer->score / friendlyAvgSPR : 1.f;
+		const float roundRelativeSPR = (friendlyAvgSPR > 0.f) ? trackedPlayer.score.Get(now) / friendlyAvgSPR : 1.f;
 		const float weightedRoundRelativeSPR = roundRelativeSPR * roundTime * strengthMultiplier;
 
 		playerStrengthEntry.relativeSPR = (totalTime != 0.f) ? (weightedTotalRelativeSPR + weightedRoundRelativeSPR) / totalTime : 0.f;
@@ -285,43 +752,61 @@ private:
 
 	void ProcessQueue()
 	{
-		const ServerInfo& serverInfo = GetServerInfo();
-		const PlayerMap_t& players = GetPlayers();
-		const std::vector<int32_t>& teamScores = serverInfo.m_scores.m_teamScores;
+		if (m_moveQueue.empty() == true)
+			return;
 
-		const int32_t maxTeamSize = (teamScores.size() != 0) ? serverInfo.m_maxPlayerCount / teamScores.size() : 0;
+		const PlayerMap_t& players = GetPlayers();
 
-		while (m_moveQueue.empty() == false)
+		// everybody in the queue wants to go to the other team
+		std::vector<BetteRCon::Server::MoveRequest_t> requests;
+		for (MoveQueue_t::iterator queueIt = m_moveQueue.begin(); queueIt != m_moveQueue.end();)
 		{
-			const std::string& firstPlayer = m_moveQueue.front();
-
 			// find the player in our player list
-			const PlayerMap_t::const_iterator playerIt = players.find(firstPlayer);
+			const PlayerMap_t::const_iterator playerIt = players.find(*queueIt);
 			if (playerIt == players.end())
 			{
-				m_moveQueue.pop_front();
+				queueIt = m_moveQueue.erase(queueIt);
 				continue;
 			}
 
 			const std::shared_ptr<PlayerInfo>& pPlayer = playerIt->second;
+			requests.emplace_back(pPlayer, (pPlayer->teamId % 2) + 1);
 
-			const uint8_t newTeamId = (pPlayer->teamId % 2) + 1;
-			const Team_t& newTeam = GetTeam(newTeamId);
+			++queueIt;
+		}
 
-			// make sure the enemy team has space
-			uint32_t teamSize = newTeam.playerCount - newTeam.commanderCount;
+		// only move the players in the queue, as long as there is space and it doesn't make the other team too strong
+		BetteRCon::Server::BalanceOptions_t options;
+		options.maxStrengthRatio = s_maxAssistStrengthRatio;
+		options.maxBalanceMoves = 0;
 
-			if (teamSize >= maxTeamSize)
-				// there is not enough space. wait until the next time around
-				break;
+		const BetteRCon::Server::BalancePlan plan = PlanTeamBalance(requests, [this](const PlayerInfo& player)
+		{
+			const TrackedPlayerMap_t::const_iterator trackedPlayerIt = m_trackedPlayers.find(player.name);
+			return (trackedPlayerIt != m_trackedPlayers.end()) ? trackedPlayerIt->second.strength : 0.f;
+		}, options);
 
-			// we are good to switch them. let's do it
-			MovePlayer(newTeamId, UINT8_MAX, pPlayer);
+		// the rest wait until the next time around
+		std::vector<BetteRCon::Server::BatchMove> moves;
+		for (const BetteRCon::Server::BalanceMove& move : plan.moves)
+		{
+			moves.push_back(BetteRCon::Server::BatchMove{ move.pPlayer, move.teamId, move.squadId });
+			m_moveQueue.remove(move.pPlayer->name);
+		}
 
-			SendChatMessage("Thanks for assisting the losing team, " + pPlayer->name + "!\n", pPlayer);
+		if (moves.empty() == true)
+			return;
 
-			m_moveQueue.pop_front();
-		}
+		MoveBatch(moves, [this](const std::vector<BetteRCon::Server::BatchMoveResult>& results)
+		{
+			for (const BetteRCon::Server::BatchMoveResult& result : results)
+			{
+				if (result.error.empty() == true)
+					SendChatMessage("Thanks for assisting the losing team, " + result.pPlayer->name + "!\n", result.pPlayer);
+				else
+					SendChatMessage("Sorry, we couldn't move you to the other team (" + result.error + ")", result.pPlayer);
+			}
+		});
 	}
 
 	void HandleAssist(const std::shared_ptr<PlayerInfo>& pPlayer, const std::vector<std::string>& args, const char prefix)
@@ -333,6 +818,13 @@ private:
 			return;
 		}
 
+		// see if assisting makes sense in this mode
+		if (m_pGameMode->allowAssist == false)
+		{
+			SendChatMessage("Assist is not available in " + std::string(m_pGameMode->displayName) + "!", pPlayer);
+			return;
+		}
+
 		// see if the server is not official
 		if (m_isNotOfficial == false)
 		{
@@ -340,18 +832,23 @@ private:
 			return;
 		}
 
+		// the forecast smooths out the scores, so a single good or bad tick doesn't decide anything
+		const BetteRCon::Server::TicketForecast_t& forecast = GetTicketForecast();
+
 		// see if the game is active
 		if (m_inRound == false ||
-			m_lastScores.size() != 2)
+			forecast.teams.size() != 2)
 		{
 			SendChatMessage("The round must be in play in order to use assist!");
 			return;
 		}
 
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+
 		// see if it has been long enough
 		constexpr std::chrono::minutes timeBeforeAssist(3);
 
-		std::chrono::seconds timeLeft = std::chrono::duration_cast<std::chrono::seconds>((m_levelStart + timeBeforeAssist) - std::chrono::system_clock::now());
+		std::chrono::seconds timeLeft = std::chrono::duration_cast<std::chrono::seconds>((m_levelStart + timeBeforeAssist) - now);
 		if (timeLeft.count() > 0)
 		{
 			SendChatMessage(std::to_string(timeLeft.count()) + " seconds left before players are allowed to use assist (3 minutes after round start)!", pPlayer);
@@ -362,72 +859,48 @@ private:
 		const uint8_t friendlyTeam = pPlayer->teamId;
 
 		// see if their team is winning
-		const int32_t enemyScore = m_lastScores[enemyTeam - 1];
-		const int32_t friendlyScore = m_lastScores[friendlyTeam - 1];
-
-		const ServerInfo& serverInfo = GetServerInfo();
-		const int32_t maxScore = ((serverInfo.m_gameMode == "ConquestLarge0") ? 800 : 400) * m_gameModeCounter;
+		const int32_t enemyScore = forecast.teams[enemyTeam - 1].score;
+		const int32_t friendlyScore = forecast.teams[friendlyTeam - 1].score;
 
 		// see if it is too close to the end of the round
-		if (enemyScore < maxScore / 4 ||
-			friendlyScore < maxScore / 4)
+		if (GetRoundProgress(GetServerInfo()) > 0.75f)
 		{
-			SendChatMessage("Less than 25% of tickets are left, you cannot use assist!", pPlayer);
+			SendChatMessage("Less than 25% of the round is left, you cannot use assist!", pPlayer);
 			return;
 		}
 
-		const int32_t enemyScoreDifference = m_lastScoreDiffs[enemyTeam - 1];
-		const int32_t friendlyScoreDifference = m_lastScoreDiffs[friendlyTeam - 1];
+		// the higher score is winning in every mode, and a team is doing better if its score goes up faster or down slower
+		const float enemyScoreRate = forecast.teams[enemyTeam - 1].ratePerMinute;
+		const float friendlyScoreRate = forecast.teams[friendlyTeam - 1].ratePerMinute;
 
 		if (enemyScore > friendlyScore)
 		{
 			// the enemy is winning. they have no reason to switch. see if they are coming back
-			if (enemyScoreDifference > friendlyScoreDifference)
+			if (friendlyScoreRate > enemyScoreRate)
 				SendChatMessage("Your team is coming back, but the enemy is still winning!", pPlayer);
 			else
 				SendChatMessage("The enemy team is winning and is still gaining!", pPlayer);
 			return;
 		}
-		else if (friendlyScoreDifference > enemyScoreDifference)
+		else if (forecast.predictedWinner == enemyTeam)
 		{
-			// the enemy is coming back
-			SendChatMessage("The enemy is losing, but they are making a comeback!", pPlayer);
+			// the enemy is behind, but at this rate they will win anyways
+			SendChatMessage("The enemy is losing, but they are on track to win!", pPlayer);
 			return;
 		}
-
-		const size_t numTeams = GetTeams().size();
-		const PlayerMap_t& players = GetPlayers();
-
-		std::vector<float> playerStrengths(numTeams);
-
-		// first find the total strength for each team
-		for (const PlayerMap_t::value_type& player : players)
+		else if (enemyScoreRate > friendlyScoreRate)
 		{
-			const std::shared_ptr<PlayerInfo>& pPlayer = player.second;
-
-			// make sure they are on a playing team
-			if (pPlayer->teamId == 0)
-				continue;
-
-			// see if they are already in the database
-			const PlayerStrengthMap_t::const_iterator playerStrengthIt = m_playerStrengthDatabase.find(pPlayer->name);
-			if (playerStrengthIt == m_playerStrengthDatabase.end())
-				continue;
-
-			const PlayerStrengthEntry& playerStrengthEntry = playerStrengthIt->second;
-
-			const float playerStrength = CalculatePlayerStrength(playerStrengthEntry);
-
-			// don't include the neutral team's info
-			playerStrengths[pPlayer->teamId - 1] += playerStrength;
+			// the enemy is coming back
+			SendChatMessage("The enemy is losing, but they are making a comeback!", pPlayer);
+			return;
 		}
 
-		const uint32_t enemyTeamSize = GetTeam(enemyTeam).playerCount;
-		const uint32_t friendlyTeamSize = GetTeam(friendlyTeam).playerCount;
+		const TeamStats& enemyStats = FindTeamStats(enemyTeam);
+		const TeamStats& friendlyStats = FindTeamStats(friendlyTeam);
 
 		// see if the enemy team is at least 20% stronger than they are
-		const float enemyStrength = (enemyTeamSize > 0) ? playerStrengths[enemyTeam - 1] / enemyTeamSize : 0.f;
-		const float friendlyStrength = (friendlyTeamSize > 0) ? playerStrengths[friendlyTeam - 1] / friendlyTeamSize : 0.f;
+		const float enemyStrength = (enemyStats.playerCount > 0) ? enemyStats.strength / enemyStats.playerCount : 0.f;
+		const float friendlyStrength = (friendlyStats.playerCount > 0) ? friendlyStats.strength / friendlyStats.playerCount : 0.f;
 
 		const float strengthRatio = (friendlyStrength != 0.f) ? enemyStrength / friendlyStrength : 1.f;
 
@@ -444,7 +917,7 @@ private:
 		const PlayerAssistMap_t::iterator lastAssistIt = m_lastPlayerAssists.find(pPlayer->name);
 		if (lastAssistIt != m_lastPlayerAssists.end())
 		{
-			if (std::chrono::system_clock::now() < (lastAssistIt->second + assistTimeout))
+			if (now < (lastAssistIt->second + assistTimeout))
 			{
 				SendChatMessage("You can only use assist once every 5 minutes!", pPlayer);
 				return;
@@ -452,18 +925,18 @@ private:
 		}
 
 		// see if they would be too powerful
-		const PlayerStrengthMap_t::iterator playerStrengthIt = m_playerStrengthDatabase.find(pPlayer->name);
-		if (playerStrengthIt != m_playerStrengthDatabase.end())
+		PlayerStrengthEntry* pPlayerStrengthEntry = FindPlayerStrength(pPlayer->name);
+		if (pPlayerStrengthEntry != nullptr)
 		{
-			PlayerStrengthEntry& playerStrengthEntry = playerStrengthIt->second;
+			PlayerStrengthEntry& playerStrengthEntry = *pPlayerStrengthEntry;
 
-			const float playerStrength = CalculatePlayerStrength(playerStrengthEntry);
+			const float playerStrength = CalculatePlayerStrength(pPlayer->name, playerStrengthEntry);
 			const float adjustedEnemyStrength = enemyStrength + playerStrength;
 			const float adjustedFriendlyStrength = friendlyStrength - playerStrength;
 
 			const float adjustedStrengthRatio = (adjustedFriendlyStrength != 0.f) ? adjustedEnemyStrength / adjustedFriendlyStrength : 1.f;
 
-			if (adjustedStrengthRatio > 1.75f)
+			if (adjustedStrengthRatio > s_maxAssistStrengthRatio)
 			{
 				const uint32_t strengthPctDiff = static_cast<uint32_t>((adjustedStrengthRatio - 1.f) * 100);
 				SendChatMessage("You would make the other team " + std::to_string(strengthPctDiff) + "% stronger than your team (>75%) (" + std::to_string(adjustedEnemyStrength) + ":" + std::to_string(adjustedFriendlyStrength) + ")!\n", pPlayer);
@@ -472,11 +945,12 @@ private:
 
 			// add a successful assist
 			++playerStrengthEntry.assists;
+			SavePlayerStrength(pPlayer->name, playerStrengthEntry);
 		}
 
 		// they are good. add them to the move queue
 		m_moveQueue.push_back(pPlayer->name);
-		m_lastPlayerAssists.emplace(pPlayer->name, std::chrono::system_clock::now());
+		m_lastPlayerAssists.emplace(pPlayer->name, now);
 		SendChatMessage("Your assist request has been accepted and you are number " + std::to_string(m_moveQueue.size()) + " in queue!", pPlayer);
 
 		// try to process the queue now
@@ -484,90 +958,65 @@ private:
 	}
 
 	void HandlePlayerLeave(const std::vector<std::string>& eventArgs)
+	{
+		const std::string& playerName = eventArgs[1];
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+
+		UpdateLeavingPlayer(playerName, now);
+
+		// they don't count towards their team anymore
+		UntrackPlayer(playerName, now);
+
+		// their entry is saved in the store, so only keep the players on the server in memory
+		m_playerStrengthDatabase.erase(playerName);
+
+		// try to process the queue, maybe a spot just opened up on the other team
+		if (m_inRound == true)
+			ProcessQueue();
+	}
+
+	void UpdateLeavingPlayer(const std::string& playerName, const std::chrono::system_clock::time_point now)
 	{
 		// their stats are already handled somewhere else
 		if (m_inRound == false)
 			return;
 
-		const std::string& playerName = eventArgs[1];
-
 		const ServerInfo& serverInfo = GetServerInfo();
 		const PlayerMap_t& players = GetPlayers();
 
+		// there are not loaded teams yet
+		if (serverInfo.m_scores.m_teamScores.size() == 0)
+			return;
+
 		// the player was not found
 		const PlayerMap_t::const_iterator playerIt = players.find(playerName);
 		if (playerIt == players.end())
 			return;
 
-		// make sure they are on a playing team
-		if (playerIt->second->teamId == 0)
+		// make sure they were counted on a playing team
+		const TrackedPlayerMap_t::const_iterator trackedPlayerIt = m_trackedPlayers.find(playerName);
+		if (trackedPlayerIt == m_trackedPlayers.end())
 			return;
 
-		const size_t numTeams = serverInfo.m_scores.m_teamScores.size();
-
-		// there are not loaded teams yet
-		if (numTeams == 0)
-			return;
-
-		std::vector<float> playerStrengths(numTeams);
-		std::vector<float> playerKDTotals(numTeams);
-		std::vector<float> playerKPRTotals(numTeams);
-		std::vector<float> playerSPRTotals(numTeams);
-
-		const int32_t minScore = *std::min_element(serverInfo.m_scores.m_teamScores.begin(), serverInfo.m_scores.m_teamScores.end());
-		const int32_t maxScore = ((serverInfo.m_gameMode == "ConquestLarge0") ? 800 : 400) * m_gameModeCounter;
-
-		// first find the total strength for each team
-		for (const PlayerMap_t::value_type& player : players)
-		{
-			const std::shared_ptr<PlayerInfo>& pPlayer = player.second;
-
-			// make sure they are on a playing team
-			if (pPlayer->teamId == 0)
-				continue;
-
-			const std::chrono::system_clock::duration timeSinceFirstSeen = std::chrono::system_clock::now() - pPlayer->firstSeen;
-			const std::chrono::system_clock::duration timeSinceLevelStart = std::chrono::system_clock::now() - m_levelStart;
-
-			const float levelAttendance = (pPlayer->firstSeen > m_levelStart) ? static_cast<float>(timeSinceFirstSeen.count()) / timeSinceLevelStart.count() : 1.f;
-			const float roundTime = (maxScore != 0) ? levelAttendance * ((static_cast<float>(maxScore) - minScore) / maxScore) : 1.f;
-
-			// add team telemetry
-			playerKDTotals[pPlayer->teamId - 1] += (pPlayer->deaths != 0) ? (static_cast<float>(pPlayer->kills) / pPlayer->deaths) : pPlayer->kills;
-			playerKPRTotals[pPlayer->teamId - 1] += (roundTime != 0.f) ? pPlayer->kills / roundTime : 0.f;
-			playerSPRTotals[pPlayer->teamId - 1] += (roundTime != 0.f) ? pPlayer->score / roundTime : 0.f;
-
-			// see if they are already in the database
-			const PlayerStrengthMap_t::const_iterator playerStrengthIt = m_playerStrengthDatabase.find(pPlayer->name);
-			if (playerStrengthIt == m_playerStrengthDatabase.end())
-				continue;
-
-			const PlayerStrengthEntry& playerStrengthEntry = playerStrengthIt->second;
-
-			const float playerStrength = CalculatePlayerStrength(playerStrengthEntry);
-
-			// don't include the neutral team's info
-			playerStrengths[pPlayer->teamId - 1] += playerStrength;
-		}
-
 		// see how they did and update their entry
-		PlayerStrengthMap_t::iterator playerStrengthIt = m_playerStrengthDatabase.find(playerName);
-		if (playerStrengthIt == m_playerStrengthDatabase.end())
-			playerStrengthIt = m_playerStrengthDatabase.emplace(playerName, PlayerStrengthEntry{ 0 }).first;
-
-		PlayerStrengthEntry& playerStrengthEntry = playerStrengthIt->second;
-		const std::shared_ptr<PlayerInfo>& pPlayer = playerIt->second;
-
-		CalculatePlayerStats(serverInfo, numTeams, pPlayer, playerStrengths, playerKDTotals, playerKPRTotals, playerSPRTotals, playerStrengthEntry);
+		PlayerStrengthEntry& playerStrengthEntry = GetPlayerStrength(playerName);
 
-		// try to process the queue, maybe a spot just opened up on the other team
-		ProcessQueue();
+		CalculatePlayerStats(serverInfo, playerIt->second, trackedPlayerIt->second, now, playerStrengthEntry);
+		SavePlayerStrength(playerName, playerStrengthEntry);
 	}
 
 	void HandleLevelLoaded(const std::vector<std::string>& eventArgs)
 	{
+		// rotations can mix modes
+		if (eventArgs.size() >= 3)
+			SetGameMode(eventArgs[2]);
+
 		m_levelStart = std::chrono::system_clock::now();
 		m_inRound = true;
+
+		// everybody starts the new round from nothing. they will be tracked again with the next playerInfo
+		m_trackedPlayers.clear();
+		m_teamStats.clear();
 	}
 
 	void HandleRoundOver(const std::vector<std::string>& eventArgs)
@@ -581,112 +1030,105 @@ private:
 
 		const ServerInfo& serverInfo = GetServerInfo();
 		const PlayerMap_t& players = GetPlayers();
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
 
-		const size_t numTeams = serverInfo.m_scores.m_teamScores.size();
+		// the server just gave us everybody's final stats, and recorded the round in the history
+		ReconcilePlayers(now);
+		UpdateRecentServerHistory();
 
-		std::vector<float> playerStrengths(numTeams);
-		std::vector<float> playerKDTotals(numTeams);
-		std::vector<float> playerKPRTotals(numTeams);
-		std::vector<float> playerSPRTotals(numTeams);
+		std::vector<std::pair<TrackedPlayer*, float>> newStrengths;
+		newStrengths.reserve(m_trackedPlayers.size());
 
-		// first find the total strength for each team
-		for (const PlayerMap_t::value_type& player : players)
+		// the team totals are up to date, so see how each player did
+		for (TrackedPlayerMap_t::value_type& trackedPlayer : m_trackedPlayers)
 		{
-			const std::shared_ptr<PlayerInfo>& pPlayer = player.second;
-
-			// make sure they are on a playing team
-			if (pPlayer->teamId == 0)
+			const PlayerMap_t::const_iterator playerIt = players.find(trackedPlayer.first);
+			if (playerIt == players.end())
 				continue;
 
-			const std::chrono::system_clock::duration timeSinceFirstSeen = std::chrono::system_clock::now() - pPlayer->firstSeen;
-			const std::chrono::system_clock::duration timeSinceLevelStart = std::chrono::system_clock::now() - m_levelStart;
-
-			const float levelAttendance = (pPlayer->firstSeen > m_levelStart) ? static_cast<float>(timeSinceFirstSeen.count()) / timeSinceLevelStart.count() : 1.f;
-
-			// add team telemetry
-			playerKDTotals[pPlayer->teamId - 1] += (pPlayer->deaths != 0) ? (static_cast<float>(pPlayer->kills) / pPlayer->deaths) : pPlayer->kills;
-			playerKPRTotals[pPlayer->teamId - 1] += (levelAttendance != 0) ? pPlayer->kills / levelAttendance : 0.f;
-			playerSPRTotals[pPlayer->teamId - 1] += (levelAttendance != 0) ? pPlayer->score / levelAttendance : 0.f;
-
-			// see if they are already in the database
-			const PlayerStrengthMap_t::const_iterator playerStrengthIt = m_playerStrengthDatabase.find(pPlayer->name);
-			if (playerStrengthIt == m_playerStrengthDatabase.end())
-				continue;
+			PlayerStrengthEntry& playerStrengthEntry = GetPlayerStrength(trackedPlayer.first);
 
-			const PlayerStrengthEntry& playerStrengthEntry = playerStrengthIt->second;
+			const bool playerWon = trackedPlayer.second.teamId == m_lastWinningTeam;
 
-			const float playerStrength = CalculatePlayerStrength(playerStrengthEntry);
+			CalculatePlayerStats(serverInfo, playerIt->second, trackedPlayer.second, now, playerStrengthEntry, true, playerWon);
+			SavePlayerStrength(trackedPlayer.first, playerStrengthEntry);
 
-			// don't include the neutral team's info
-			playerStrengths[pPlayer->teamId - 1] += playerStrength;
+			newStrengths.emplace_back(&trackedPlayer.second, CalculatePlayerStrength(trackedPlayer.first, playerStrengthEntry));
 		}
 
-		// now that we have the strengths, see how each player did
-		for (const PlayerMap_t::value_type& player : players)
-		{
-			const std::shared_ptr<PlayerInfo>& pPlayer = player.second;
-
-			// make sure they are on a playing team
-			if (pPlayer->teamId == 0)
-				continue;
-
-			// see if they are already in the database
-			PlayerStrengthMap_t::iterator playerStrengthIt = m_playerStrengthDatabase.find(pPlayer->name);
-			if (playerStrengthIt == m_playerStrengthDatabase.end())
-				playerStrengthIt = m_playerStrengthDatabase.emplace(pPlayer->name, PlayerStrengthEntry{}).first;
+		// only now apply the new strengths, so that every player was compared against the same teams
+		for (const std::pair<TrackedPlayer*, float>& newStrength : newStrengths)
+			SetTrackedStrength(*newStrength.first, newStrength.second);
 
-			PlayerStrengthEntry& playerStrengthEntry = playerStrengthIt->second;
-
-			const bool playerWon = pPlayer->teamId == m_lastWinningTeam;
-
-			CalculatePlayerStats(serverInfo, numTeams, pPlayer, playerStrengths, playerKDTotals, playerKPRTotals, playerSPRTotals, playerStrengthEntry, true, playerWon);
+		// forget anybody who left without us seeing it
+		for (PlayerStrengthMap_t::iterator playerStrengthIt = m_playerStrengthDatabase.begin(); playerStrengthIt != m_playerStrengthDatabase.end();)
+		{
+			if (players.find(playerStrengthIt->first) == players.end())
+				playerStrengthIt = m_playerStrengthDatabase.erase(playerStrengthIt);
+			else
+				++playerStrengthIt;
 		}
-
-		// write the database
-		WritePlayerDatabase();
 	}
 
-	void HandleServerInfo(const std::vector<std::string>& eventArgs)
+	void HandlePlayerInfo(const std::vector<std::string>& eventArgs)
 	{
 		if (m_inRound == false)
 			return;
 
-		// serverInfo doesn't actually give us the event information, we need to retrieve that from the server
-		const ServerInfo& serverInfo = GetServerInfo();
+		ReconcilePlayers(std::chrono::system_clock::now());
+
+		ProcessQueue();
+	}
 
-		// fetch the latest scores
-		const std::vector<int32_t>& scores = serverInfo.m_scores.m_teamScores;
+	void HandleKill(const std::vector<std::string>& eventArgs)
+	{
+		const std::string& killerName = eventArgs[1];
+		const std::string& victimName = eventArgs[2];
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
 
-		// calculate score differences
-		if (m_lastScoreDiffs.size() != scores.size())
-			m_lastScoreDiffs.resize(scores.size());
+		const PlayerMap_t& players = GetPlayers();
 
-		if (m_lastScores.size() != scores.size())
-			m_lastScores.resize(scores.size());
+		// the server already counted the kill, so just pick up their new stats
+		const PlayerMap_t::const_iterator victimIt = players.find(victimName);
+		if (victimIt != players.end())
+			UpdateTrackedPlayer(*victimIt->second, now);
 
-		for (size_t i = 0; i < scores.size(); ++i)
-			m_lastScoreDiffs[i] = std::abs(scores[i] - m_lastScores[i]);
+		// they suicided
+		if (killerName.size() == 0 ||
+			killerName == victimName)
+			return;
 
-		// save the current scores as the last scores
-		m_lastScores = scores;
-	}
+		const PlayerMap_t::const_iterator killerIt = players.find(killerName);
+		if (killerIt == players.end())
+			return;
 
-	void HandlePlayerInfo(const std::vector<std::string>& eventArgs)
-	{
-		if (m_inRound == false)
+		// a player we haven't seen yet is tracked with the kill already in their stats
+		const TrackedPlayerMap_t::iterator trackedKillerIt = m_trackedPlayers.find(killerName);
+		UpdateTrackedPlayer(*killerIt->second, now);
+		if (trackedKillerIt == m_trackedPlayers.end() ||
+			killerIt->second->teamId == 0)
 			return;
 
-		ProcessQueue();
+		TrackedPlayer& trackedKiller = trackedKillerIt->second;
+		trackedKiller.kills.Add(1.f, now);
+		GetTeamStats(trackedKiller.teamId).kills.Add(1.f, now);
 	}
 
 	void HandleTeamChange(const std::vector<std::string>& eventArgs)
 	{
+		const std::string& playerName = eventArgs[1];
+
+		const PlayerMap_t& players = GetPlayers();
+
+		// move their stats over to their new team
+		const PlayerMap_t::const_iterator changedPlayerIt = players.find(playerName);
+		if (changedPlayerIt != players.end())
+			UpdateTrackedPlayer(*changedPlayerIt->second, std::chrono::system_clock::now());
+
 		// no need to search for the player if there is nobody in the queue
 		if (m_moveQueue.empty() == true)
 			return;
 
-		const std::string& playerName = eventArgs[1];
-
 		const MoveQueue_t::iterator playerQueueIt = std::find(m_moveQueue.begin(), m_moveQueue.end(), playerName);
 
 		// they are not in the move queue, ignore them
@@ -696,8 +1138,6 @@ private:
 		// they switched with a pending assist, cancel the assist
 		m_moveQueue.erase(playerQueueIt);
 
-		const PlayerMap_t& players = GetPlayers();
-
 		// find their player so we can notify them that they were removed
 		const PlayerMap_t::const_iterator playerIt = players.find(playerName);
 
@@ -709,22 +1149,30 @@ private:
 	}
 
 	// scores
-	std::vector<int32_t> m_lastScores;
-	std::vector<int32_t> m_lastScoreDiffs;
-	std::chrono::system_clock::time_point m_lastScoreCalculation;
 	uint8_t m_lastWinningTeam;
 
 	// round stuff
 	bool m_isNotOfficial = true;
 	bool m_inRound = true;
 	float m_gameModeCounter = 1.f;
+	const GameMode* m_pGameMode = &s_unknownGameMode;
 	std::chrono::system_clock::time_point m_levelStart;
 
 	// assists
 	PlayerAssistMap_t m_lastPlayerAssists;
 
-	// strength
+	// strength of the players on the server. everybody else is in the store
 	PlayerStrengthMap_t m_playerStrengthDatabase;
+	// everybody's totals over the recent form window, refreshed every round
+	BetteRCon::Server::PlayerHistory_t m_recentServerHistory;
+	// from the settings
+	std::chrono::hours m_recentFormWindow = s_defaultRecentFormWindow;
+	uint32_t m_recentFormRounds = s_defaultRecentFormRounds;
+	float m_recentFormWeight = s_defaultRecentFormWeight;
+
+	// players on playing teams and their teams' running totals, indexed by teamId
+	TrackedPlayerMap_t m_trackedPlayers;
+	TeamStatsVec_t m_teamStats;
 
 	// move queue
 	MoveQueue_t m_moveQueue;
@@ -0,0 +1,539 @@
+#include <BetteRCon/Plugin.h>
+#include <BetteRCon/Server.h>
+#include <BetteRCon/Internal/EditDistance.h>
+#include <BetteRCon/Internal/Packet.h>
+#include <BetteRCon/Internal/SandboxChannel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using BetteRCon::Plugin;
+using BetteRCon::Server;
+using BetteRCon::Internal::Packet;
+
+namespace
+{
+	// every allocation in the process is counted, so that a benchmark can report how many it makes
+	std::atomic<uint64_t> g_allocations{ 0 };
+}
+
+void* operator new(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	ServerBenchmark holds a server that never connects, and feeds it events and player
+		 *	lists the way the connection would. The server's own chat and kill handlers are
+		 *	registered, and plugins that handle every event can be swapped in.
+		 */
+		class ServerBenchmark
+		{
+		public:
+			ServerBenchmark(Server::Worker_t& worker) : m_server(worker)
+			{
+				m_server.m_eventCallback = [](const std::vector<std::string>&) {};
+				m_server.m_playerInfoCallback = [](const Server::PlayerMap_t&, const Server::TeamMap_t&) {};
+				m_server.m_pluginCallback = [](const std::string&, const bool, const bool, const std::string&) {};
+
+				// what InitializeServer registers for the events we send, without the files and plugins it loads
+				m_server.RegisterPrePluginCallback("player.onChat", std::bind(&Server::HandleOnChat, &m_server, std::placeholders::_1));
+				m_server.RegisterPrePluginCallback("player.onKill", std::bind(&Server::HandleOnKill, &m_server, std::placeholders::_1));
+			}
+
+			ServerBenchmark(const ServerBenchmark& other) = delete;
+			ServerBenchmark& operator=(const ServerBenchmark& other) = delete;
+
+			// Makes these the server's plugins. They stay owned by the caller
+			void SetPlugins(const std::vector<Plugin*>& plugins)
+			{
+				m_server.m_plugins.clear();
+				for (Plugin* pPlugin : plugins)
+					m_server.m_plugins.emplace(pPlugin->GetPluginName(), Server::PluginInfo{ nullptr, pPlugin, [](Plugin*) {} });
+			}
+
+			Server& GetServer() noexcept
+			{
+				return m_server;
+			}
+
+			void HandleEvent(const std::optional<Packet>& event)
+			{
+				m_server.HandleEvent(Server::ErrorCode_t{}, event);
+			}
+
+			void HandlePlayerInfo(const std::vector<std::string>& playerInfo)
+			{
+				m_server.HandlePlayerInfo(playerInfo);
+			}
+
+			~ServerBenchmark()
+			{
+				m_server.m_plugins.clear();
+			}
+		private:
+			Server m_server;
+		};
+	}
+}
+
+using BetteRCon::Internal::ServerBenchmark;
+
+namespace
+{
+	using Clock_t = std::chrono::steady_clock;
+	using Words_t = std::vector<std::string>;
+
+	// results go here, so that the work that makes them can't be optimized away
+	volatile size_t g_sink = 0;
+
+	// a plugin with a handler for every event we send, like the bundled plugins have
+	class BenchPlugin : public Plugin
+	{
+	public:
+		BenchPlugin(Server* pServer, const size_t index) : Plugin(pServer), m_name("BenchPlugin" + std::to_string(index))
+		{
+			for (const char* eventName : { "player.onKill", "player.onChat", "bettercon.playerInfo" })
+				RegisterHandler(eventName, [this](const std::vector<std::string>& eventWords) { m_words += eventWords.size(); });
+		}
+
+		virtual std::string_view GetPluginAuthor() const { return "BetteRCon"; }
+		virtual std::string_view GetPluginName() const { return m_name; }
+		virtual std::string_view GetPluginVersion() const { return "1.0"; }
+
+		virtual ~BenchPlugin() { g_sink = g_sink + m_words; }
+	private:
+		std::string m_name;
+		size_t m_words = 0;
+	};
+
+	struct Benchmark
+	{
+		std::string name;
+		// runs the operation this many times
+		std::function<void(const size_t iterations)> run;
+	};
+
+	struct Result
+	{
+		double nsPerOp = 0.0;
+		double allocsPerOp = 0.0;
+	};
+
+	using ResultMap_t = std::unordered_map<std::string, Result>;
+
+	// each sample runs for at least this long, and the fastest sample is kept, since noise only ever adds time
+	constexpr std::chrono::milliseconds s_minSampleTime(20);
+	constexpr size_t s_numSamples = 7;
+
+	Result Measure(const Benchmark& benchmark)
+	{
+		// warm up, and find how many iterations make a sample long enough
+		size_t iterations = 1;
+		while (true)
+		{
+			const Clock_t::time_point start = Clock_t::now();
+			benchmark.run(iterations);
+			if (Clock_t::now() - start >= s_minSampleTime ||
+				iterations >= (size_t(1) << 30))
+				break;
+
+			iterations *= 2;
+		}
+
+		Result best;
+		for (size_t i = 0; i < s_numSamples; ++i)
+		{
+			const uint64_t allocationsBefore = g_allocations.load(std::memory_order_relaxed);
+			const Clock_t::time_point start = Clock_t::now();
+			benchmark.run(iterations);
+			const Clock_t::duration elapsed = Clock_t::now() - start;
+			const uint64_t allocations = g_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+			const double nsPerOp = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations;
+			if (i == 0 ||
+				nsPerOp < best.nsPerOp)
+				best = Result{ nsPerOp, static_cast<double>(allocations) / iterations };
+		}
+
+		return best;
+	}
+
+	// names like the ones on a real server, of different lengths, with clan tags and numbers
+	std::vector<std::string> MakePlayerNames(const size_t count, std::mt19937& random)
+	{
+		static constexpr const char* s_parts[] = { "Sn1per", "xX", "Tank", "Medic", "Ghost", "Recon", "Wolf", "Shadow", "Killer", "Pro", "Noob", "Dark" };
+
+		std::vector<std::string> names;
+		while (names.size() < count)
+		{
+			std::string name = std::string(s_parts[random() % std::size(s_parts)]) + s_parts[random() % std::size(s_parts)];
+			if (random() % 3 == 0)
+				name += std::to_string(random() % 1000);
+
+			if (std::find(names.begin(), names.end(), name) == names.end())
+				names.push_back(std::move(name));
+		}
+
+		return names;
+	}
+
+	// the response to admin.listPlayers all for a full server
+	Words_t MakeListPlayers(const std::vector<std::string>& names, std::mt19937& random)
+	{
+		Words_t words{ "OK", "10", "name", "guid", "teamId", "squadId", "kills", "deaths", "score", "rank", "ping", "type", std::to_string(names.size()) };
+
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			std::string guid = "EA_";
+			for (size_t j = 0; j < 32; ++j)
+				guid.push_back("0123456789ABCDEF"[random() % 16]);
+
+			words.insert(words.end(), { names[i], guid, std::to_string(i % 2 + 1), std::to_string(i / 2 % 8 + 1), std::to_string(random() % 60),
+				std::to_string(random() % 60), std::to_string(random() % 20000), std::to_string(random() % 141), std::to_string(random() % 200), "0" });
+		}
+
+		return words;
+	}
+
+	std::vector<Packet> MakeKills(const std::vector<std::string>& names, const size_t count, std::mt19937& random)
+	{
+		static constexpr const char* s_weapons[] = { "M416", "AK-12", "SCAR-H", "M98B", "U_Glock18", "Knife" };
+
+		std::vector<Packet> kills;
+		for (size_t i = 0; i < count; ++i)
+			kills.emplace_back(Words_t{ "player.onKill", names[random() % names.size()], names[random() % names.size()],
+				s_weapons[random() % std::size(s_weapons)], (random() % 4 == 0) ? "true" : "false" }, static_cast<int32_t>(i));
+
+		return kills;
+	}
+
+	std::vector<Packet> MakeChats(const std::vector<std::string>& names, const size_t count, std::mt19937& random)
+	{
+		static constexpr const char* s_messages[] = { "gg", "lol", "nice shot", "who is camping B", "rush C", "anyone want to squad up?" };
+
+		std::vector<Packet> chats;
+		for (size_t i = 0; i < count; ++i)
+			chats.emplace_back(Words_t{ "player.onChat", names[random() % names.size()], s_messages[random() % std::size(s_messages)], "all" }, static_cast<int32_t>(i));
+
+		return chats;
+	}
+
+	// the baseline is lines of name,ns/op,allocs/op
+	bool ReadBaseline(const std::string& path, ResultMap_t& baselineOut)
+	{
+		std::ifstream inFile(path);
+		if (inFile.good() == false)
+			return false;
+
+		std::string line;
+		while (std::getline(inFile, line))
+		{
+			if (line.empty() == true ||
+				line.front() == '#')
+				continue;
+
+			const size_t firstComma = line.find(',');
+			const size_t secondComma = line.find(',', firstComma + 1);
+			if (firstComma == std::string::npos ||
+				secondComma == std::string::npos)
+				continue;
+
+			try
+			{
+				baselineOut[line.substr(0, firstComma)] = Result{ std::stod(line.substr(firstComma + 1, secondComma - firstComma - 1)), std::stod(line.substr(secondComma + 1)) };
+			}
+			catch (const std::exception&)
+			{
+				continue;
+			}
+		}
+
+		return true;
+	}
+
+	bool WriteBaseline(const std::string& path, const std::vector<std::pair<std::string, Result>>& results)
+	{
+		std::ofstream outFile(path, std::ios::trunc);
+		if (outFile.good() == false)
+			return false;
+
+		outFile << "# saved by bettercon-bench --save. Times are for the machine that saved them, allocations are exact\n";
+		outFile << "# name,ns/op,allocs/op\n";
+
+		char line[256];
+		for (const std::pair<std::string, Result>& result : results)
+		{
+			snprintf(line, sizeof(line), "%s,%.1f,%.2f\n", result.first.c_str(), result.second.nsPerOp, result.second.allocsPerOp);
+			outFile << line;
+		}
+
+		return outFile.good();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string baselinePath;
+	std::string savePath;
+	std::string filter;
+	// how much slower than the baseline a benchmark can be before it counts as a regression
+	double tolerance = 0.2;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+
+		if (arg.substr(0, 11) == "--baseline=")
+			baselinePath = arg.substr(11);
+		else if (arg.substr(0, 7) == "--save=")
+			savePath = arg.substr(7);
+		else if (arg.substr(0, 9) == "--filter=")
+			filter = arg.substr(9);
+		else if (arg.substr(0, 12) == "--tolerance=")
+			tolerance = std::atof(argv[i] + 12) / 100.0;
+		else
+		{
+			std::cout << "Usage: " << argv[0] << " [--baseline=file] [--save=file] [--filter=substring] [--tolerance=percent, default 20]\n";
+			return 1;
+		}
+	}
+
+	ResultMap_t baseline;
+	if (baselinePath.empty() == false &&
+		ReadBaseline(baselinePath, baseline) == false)
+	{
+		std::cerr << "Failed to read baseline " << baselinePath << '\n';
+		return 1;
+	}
+
+	// the same data every run
+	std::mt19937 random(1);
+
+	const std::vector<std::string> names = MakePlayerNames(64, random);
+	const Words_t listPlayers = MakeListPlayers(names, random);
+	const std::vector<Packet> kills = MakeKills(names, 256, random);
+	const std::vector<Packet> chats = MakeChats(names, 256, random);
+
+	const Packet listPlayersPacket(listPlayers, 1, true);
+	std::vector<char> listPlayersBuf;
+	listPlayersPacket.Serialize(listPlayersBuf);
+
+	std::vector<char> killBuf;
+	kills.front().Serialize(killBuf);
+
+	Server::Worker_t worker;
+	ServerBenchmark server(worker);
+
+	// the server knows everybody before the events come in, like it would after its first player list
+	server.HandlePlayerInfo(listPlayers);
+
+	// every plugin is made and enabled up front, and each benchmark uses as many as it wants
+	std::vector<std::unique_ptr<BenchPlugin>> plugins;
+	for (size_t i = 0; i < 32; ++i)
+	{
+		plugins.push_back(std::make_unique<BenchPlugin>(&server.GetServer(), i));
+		plugins.back()->Enable();
+	}
+
+	std::vector<Benchmark> benchmarks;
+
+	benchmarks.push_back({ "packet.construct.listPlayers64", [&listPlayers](const size_t iterations)
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const Packet packet(listPlayers, static_cast<int32_t>(i), true);
+			g_sink = g_sink + packet.GetWords().size();
+		}
+	} });
+
+	benchmarks.push_back({ "packet.serialize.listPlayers64", [&listPlayersPacket](const size_t iterations)
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			// a new buffer each time, like the connection
+			std::vector<char> buf;
+			listPlayersPacket.Serialize(buf);
+			g_sink = g_sink + buf.size();
+		}
+	} });
+
+	benchmarks.push_back({ "packet.parse.listPlayers64", [&listPlayersBuf](const size_t iterations)
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const Packet packet(listPlayersBuf);
+			g_sink = g_sink + packet.GetWords().size();
+		}
+	} });
+
+	benchmarks.push_back({ "packet.parse.onKill", [&killBuf](const size_t iterations)
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const Packet packet(killBuf);
+			g_sink = g_sink + packet.GetWords().size();
+		}
+	} });
+
+	for (const size_t numPlugins : { 0, 1, 8, 32 })
+	{
+		const std::string suffix = "/plugins:" + std::to_string(numPlugins);
+
+		// the optional is made once per event, like the connection does
+		benchmarks.push_back({ "server.handleEvent.onKill" + suffix, [&server, &kills](const size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+				server.HandleEvent(std::make_optional(kills[i % kills.size()]));
+		} });
+
+		benchmarks.push_back({ "server.handleEvent.onChat" + suffix, [&server, &chats](const size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+				server.HandleEvent(std::make_optional(chats[i % chats.size()]));
+		} });
+
+		// the same players every time, which is what almost every player list is
+		benchmarks.push_back({ "server.handlePlayerInfo.players64" + suffix, [&server, &listPlayers](const size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+				server.HandlePlayerInfo(listPlayers);
+		} });
+	}
+
+	// what an isolated plugin adds to each event: the server writing it to the host, and the host reading it back out
+	BetteRCon::Internal::SandboxChannel channel;
+	if (channel.Create(BetteRCon::Internal::SandboxChannel::s_defaultCapacity) == true)
+	{
+		benchmarks.push_back({ "sandbox.channel.onKill", [&channel, &kills](const size_t iterations)
+		{
+			std::vector<char> sendBuffer;
+			std::vector<char> receiveBuffer;
+			BetteRCon::Internal::SandboxChannel::Message message;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				BetteRCon::Internal::SandboxChannel::Send(channel.GetToHost(), BetteRCon::Internal::SandboxChannel::MessageType_Event, 0, kills[i % kills.size()].GetWords(), sendBuffer);
+				BetteRCon::Internal::SandboxChannel::Receive(channel.GetToHost(), message, receiveBuffer);
+				g_sink = g_sink + message.words.size();
+			}
+		} });
+	}
+
+	// one name against each player on the server, like the fuzzy match does
+	benchmarks.push_back({ "levenshteinDistance", [&names](const size_t iterations)
+	{
+		const std::string query = "shadowkiler";
+		for (size_t i = 0; i < iterations; ++i)
+			g_sink = g_sink + BetteRCon::Internal::LevenshteinDistance(query, names[i % names.size()]);
+	} });
+
+	std::vector<std::pair<std::string, Result>> results;
+	size_t regressions = 0;
+	size_t numPlugins = 0;
+
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (filter.empty() == false &&
+			benchmark.name.find(filter) == std::string::npos)
+			continue;
+
+		// the server benchmarks say how many plugins they want
+		const size_t pluginsPos = benchmark.name.find("/plugins:");
+		const size_t wantedPlugins = (pluginsPos == std::string::npos) ? 0 : std::stoul(benchmark.name.substr(pluginsPos + 9));
+		if (wantedPlugins != numPlugins)
+		{
+			std::vector<Plugin*> pluginPtrs;
+			for (size_t i = 0; i < wantedPlugins && i < plugins.size(); ++i)
+				pluginPtrs.push_back(plugins[i].get());
+
+			server.SetPlugins(pluginPtrs);
+			numPlugins = wantedPlugins;
+		}
+
+		const Result result = Measure(benchmark);
+		results.emplace_back(benchmark.name, result);
+
+		char line[256];
+		snprintf(line, sizeof(line), "%-44s %12.1f ns/op %10.2f allocs/op", benchmark.name.c_str(), result.nsPerOp, result.allocsPerOp);
+		std::cout << line;
+
+		const ResultMap_t::const_iterator baselineIt = baseline.find(benchmark.name);
+		if (baselineIt != baseline.end())
+		{
+			// allocations don't depend on the machine, so any more than before is a regression
+			const bool slower = result.nsPerOp > baselineIt->second.nsPerOp * (1.0 + tolerance);
+			const bool moreAllocations = result.allocsPerOp > baselineIt->second.allocsPerOp + 0.005;
+
+			snprintf(line, sizeof(line), "   %+7.1f%% vs %.1f ns, %.2f allocs%s", (result.nsPerOp / baselineIt->second.nsPerOp - 1.0) * 100.0,
+				baselineIt->second.nsPerOp, baselineIt->second.allocsPerOp, (slower == true || moreAllocations == true) ? "   REGRESSED" : "");
+			std::cout << line;
+
+			if (slower == true ||
+				moreAllocations == true)
+				++regressions;
+		}
+
+		std::cout << std::endl;
+	}
+
+	server.SetPlugins({});
+
+	if (savePath.empty() == false &&
+		WriteBaseline(savePath, results) == false)
+	{
+		std::cerr << "Failed to write baseline " << savePath << '\n';
+		return 1;
+	}
+
+	if (regressions != 0)
+	{
+		std::cout << regressions << " benchmark(s) regressed\n";
+		return 2;
+	}
+
+	return 0;
+}
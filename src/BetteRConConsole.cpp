@@ -4,6 +4,7 @@
 #include <functional>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using BetteRCon::Server;
@@ -13,7 +14,7 @@ int main(int argc, char* argv[])
 {
 	if (argc < 4)
 	{
-		std::cout << "Usage: " << argv[0] << " [ip:string] [port:ushort] [password:string] [plugins:string...]\n";
+		std::cout << "Usage: " << argv[0] << " [ip:string] [port:ushort] [password:string] [--eventlog=directory] [--capture=file] [--metrics=port] [--handler-budget=ms] [--disable-slow-plugins] [--isolate-plugins[=host]] [plugins:string...]\n";
 		return 1;
 	}
 
@@ -25,6 +26,54 @@ int main(int argc, char* argv[])
 	Server::Worker_t worker;
 	Server server(worker);
 
+	// options start with --, and everything else is a plugin
+	static constexpr std::string_view s_eventLogOption = "--eventlog=";
+	static constexpr std::string_view s_captureOption = "--capture=";
+	static constexpr std::string_view s_metricsOption = "--metrics=";
+	static constexpr std::string_view s_handlerBudgetOption = "--handler-budget=";
+	static constexpr std::string_view s_disableSlowPluginsOption = "--disable-slow-plugins";
+	static constexpr std::string_view s_isolatePluginsOption = "--isolate-plugins";
+	std::chrono::milliseconds handlerBudget(250);
+	Server::SlowHandlerAction slowHandlerAction = Server::SlowHandlerAction_Log;
+	for (int i = 4; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg.compare(0, s_eventLogOption.size(), s_eventLogOption) == 0)
+		{
+			const std::string directory(arg.substr(s_eventLogOption.size()));
+			if (server.StartEventLog(directory) == true)
+				BetteRCon::Internal::g_stdOutLog << "Logging events to " << directory << '\n';
+			else
+				BetteRCon::Internal::g_stdErrLog << "Failed to start the event log in " << directory << '\n';
+		}
+		else if (arg.compare(0, s_captureOption.size(), s_captureOption) == 0)
+		{
+			const std::string path(arg.substr(s_captureOption.size()));
+			if (server.StartCapture(path) == true)
+				BetteRCon::Internal::g_stdOutLog << "Capturing the session to " << path << '\n';
+			else
+				BetteRCon::Internal::g_stdErrLog << "Failed to start capturing to " << path << '\n';
+		}
+		else if (arg.compare(0, s_metricsOption.size(), s_metricsOption) == 0)
+		{
+			const uint16_t metricsPort = static_cast<uint16_t>(atoi(std::string(arg.substr(s_metricsOption.size())).c_str()));
+			if (server.StartMetricsServer(metricsPort) == true)
+				BetteRCon::Internal::g_stdOutLog << "Serving metrics at http://127.0.0.1:" << server.GetMetricsPort() << "/metrics\n";
+		}
+		else if (arg.compare(0, s_handlerBudgetOption.size(), s_handlerBudgetOption) == 0)
+			handlerBudget = std::chrono::milliseconds(atoi(std::string(arg.substr(s_handlerBudgetOption.size())).c_str()));
+		else if (arg == s_disableSlowPluginsOption)
+			slowHandlerAction = Server::SlowHandlerAction_Disable;
+		else if (arg.compare(0, s_isolatePluginsOption.size(), s_isolatePluginsOption) == 0)
+		{
+			// the host can be given after an =, and is otherwise next to us
+			const std::string_view hostPath = arg.substr(s_isolatePluginsOption.size());
+			server.SetPluginIsolation(true, (hostPath.empty() == true) ? "" : std::string(hostPath.substr(1)));
+		}
+	}
+
+	server.SetHandlerBudget(handlerBudget, slowHandlerAction);
+
 	// try to connect
 	Server::Endpoint_t endpoint(asio::ip::make_address_v4(ip), port);
 	Server::ErrorCode_t ec;
@@ -52,6 +101,10 @@ int main(int argc, char* argv[])
 					// enable all of the plugins that are in the list
 					for (int i = 4; i < argc; ++i)
 					{
+						if (argv[i][0] == '-' &&
+							argv[i][1] == '-')
+							continue;
+
 						if (server.EnablePlugin(argv[i]) == true)
 							BetteRCon::Internal::g_stdOutLog << "Enabled plugin " << argv[i] << '\n';
 						else
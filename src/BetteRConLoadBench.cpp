@@ -0,0 +1,487 @@
+#include <BetteRCon/Server.h>
+#include <BetteRCon/Internal/Histogram.h>
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/MockServer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using BetteRCon::Server;
+using BetteRCon::Internal::Histogram;
+using BetteRCon::Internal::MockServer;
+
+namespace
+{
+	using Clock_t = std::chrono::steady_clock;
+
+	// latencies are kept in nanoseconds, up to a minute
+	constexpr uint64_t s_highestLatency = 60'000'000'000;
+	// the server is sent a command this often, to time how long commands wait behind the events
+	constexpr std::chrono::milliseconds s_commandInterval(10);
+	// how long to wait for the server to answer the events of a step once they stop
+	constexpr std::chrono::seconds s_drainTimeout(10);
+
+	enum Scenario
+	{
+		Scenario_KillStorm,		// Kills, with the victim's spawn
+		Scenario_ChatFlood,		// Chat messages
+		Scenario_RoundOverDump,	// Rounds ending, with every player's stats
+		Scenario_Count
+	};
+
+	constexpr std::string_view s_ScenarioStr[Scenario_Count] = { "killStorm", "chatFlood", "roundOverDump" };
+	// what a scenario's rate counts, which can be more than one event each
+	constexpr std::string_view s_ScenarioUnitStr[Scenario_Count] = { "kills", "chats", "rounds" };
+
+	// per second. Each scenario ramps until a step can't be sustained
+	const std::vector<double> s_scenarioRates[Scenario_Count] = {
+		{ 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000 },
+		{ 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000 },
+		{ 1, 2, 5, 10, 20, 50, 100, 200 }
+	};
+
+	struct StepResult
+	{
+		Scenario scenario;
+		// in the scenario's unit per second
+		double rate;
+		uint64_t eventsSent;
+		uint64_t eventsAcknowledged;
+		// answered per second, from the start of the step until it drained
+		double eventsPerSecond;
+		// everything was answered, with the 99th percentile under the limit. A server that falls behind
+		// answers later and later, so its latency climbs past any limit
+		bool sustained;
+		Histogram eventLatency{ s_highestLatency };
+		Histogram commandLatency{ s_highestLatency };
+	};
+
+	/*
+	 *	LoadDriver runs the steps on the mock server's worker. Each step sets a rate, runs for
+	 *	the duration, then stops sending and waits for the server to answer what it was sent.
+	 */
+	class LoadDriver
+	{
+	public:
+		using FinishCallback_t = std::function<void()>;
+
+		LoadDriver(MockServer::Worker_t& worker, MockServer& mockServer, const Clock_t::duration stepDuration, const uint64_t maxP99,
+			std::mutex& commandLatencyMutex, Histogram& commandLatency)
+			: m_mockServer(mockServer), m_stepTimer(worker), m_stepDuration(stepDuration), m_maxP99(maxP99),
+			m_commandLatencyMutex(commandLatencyMutex), m_commandLatency(commandLatency)
+		{
+			m_mockServer.SetEventAckCallback([this](const MockServer::Clock_t::duration latency)
+			{
+				if (m_pCurrentStep != nullptr)
+					m_pCurrentStep->eventLatency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+			});
+		}
+
+		// Runs every step, and calls finishCallback from the worker thread when done
+		void Start(FinishCallback_t&& finishCallback)
+		{
+			m_finishCallback = std::move(finishCallback);
+			StartStep();
+		}
+
+		const std::vector<StepResult>& GetResults() const noexcept
+		{
+			return m_results;
+		}
+
+		// Gets the highest rate of a scenario that was sustained, or 0 if none was
+		double GetMaxSustainedRate(const Scenario scenario) const noexcept
+		{
+			double maxRate = 0.0;
+			for (const StepResult& result : m_results)
+			{
+				if (result.scenario == scenario &&
+					result.sustained == true)
+					maxRate = std::max(maxRate, result.rate);
+			}
+
+			return maxRate;
+		}
+	private:
+		void StartStep()
+		{
+			if (m_scenario == Scenario_Count)
+			{
+				m_pCurrentStep = nullptr;
+				return m_finishCallback();
+			}
+
+			m_results.push_back(StepResult{ static_cast<Scenario>(m_scenario), s_scenarioRates[m_scenario][m_rateIndex] });
+			m_pCurrentStep = &m_results.back();
+
+			{
+				std::lock_guard lock(m_commandLatencyMutex);
+				m_commandLatency.Reset();
+			}
+
+			m_statsBefore = m_mockServer.GetStats();
+			m_stepStart = Clock_t::now();
+			m_roundsEnded = 0;
+			m_drained = false;
+
+			const double perMinute = m_pCurrentStep->rate * 60.0;
+			if (m_pCurrentStep->scenario == Scenario_KillStorm)
+				m_mockServer.SetRates(0.0, 0.0, perMinute, 0.0);
+			else if (m_pCurrentStep->scenario == Scenario_ChatFlood)
+				m_mockServer.SetRates(0.0, 0.0, 0.0, perMinute);
+
+			m_stepTimer.expires_after(std::chrono::milliseconds(1));
+			m_stepTimer.async_wait(std::bind(&LoadDriver::HandleStepTimer, this, std::placeholders::_1));
+		}
+
+		void HandleStepTimer(const MockServer::ErrorCode_t& ec)
+		{
+			if (ec)
+				return;
+
+			const Clock_t::time_point now = Clock_t::now();
+
+			// rounds are ended here, since the mock server only ends them when the tickets run out. The first
+			// one ends straight away, so that every step ends at least one
+			if (m_pCurrentStep->scenario == Scenario_RoundOverDump)
+			{
+				const double stepSeconds = std::chrono::duration<double>(m_stepDuration).count();
+				const uint64_t totalRounds = std::max<uint64_t>(static_cast<uint64_t>(stepSeconds * m_pCurrentStep->rate + 0.5), 1);
+				const uint64_t roundsDue = std::min(static_cast<uint64_t>(std::chrono::duration<double>(now - m_stepStart).count() * m_pCurrentStep->rate) + 1, totalRounds);
+				for (; m_roundsEnded < roundsDue; ++m_roundsEnded)
+					m_mockServer.EndRound();
+			}
+
+			if (now - m_stepStart < m_stepDuration)
+			{
+				m_stepTimer.expires_after(std::chrono::milliseconds(1));
+				m_stepTimer.async_wait(std::bind(&LoadDriver::HandleStepTimer, this, std::placeholders::_1));
+				return;
+			}
+
+			m_mockServer.SetRates(0.0, 0.0, 0.0, 0.0);
+			m_drainStart = now;
+			HandleDrainTimer(ec);
+		}
+
+		void HandleDrainTimer(const MockServer::ErrorCode_t& ec)
+		{
+			if (ec)
+				return;
+
+			const MockServer::Stats& stats = m_mockServer.GetStats();
+			const Clock_t::time_point now = Clock_t::now();
+
+			m_drained = stats.acknowledgedEvents >= stats.events;
+			if (m_drained == false &&
+				now - m_drainStart < s_drainTimeout)
+			{
+				m_stepTimer.expires_after(std::chrono::milliseconds(1));
+				m_stepTimer.async_wait(std::bind(&LoadDriver::HandleDrainTimer, this, std::placeholders::_1));
+				return;
+			}
+
+			FinishStep(now);
+		}
+
+		void FinishStep(const Clock_t::time_point now)
+		{
+			const MockServer::Stats& stats = m_mockServer.GetStats();
+
+			StepResult& result = *m_pCurrentStep;
+			result.eventsSent = stats.events - m_statsBefore.events;
+			result.eventsAcknowledged = stats.acknowledgedEvents - m_statsBefore.acknowledgedEvents;
+			result.eventsPerSecond = result.eventsAcknowledged / std::chrono::duration<double>(now - m_stepStart).count();
+
+			{
+				std::lock_guard lock(m_commandLatencyMutex);
+				result.commandLatency.Add(m_commandLatency);
+			}
+
+			result.sustained = m_drained == true &&
+				result.eventsSent != 0 &&
+				result.eventLatency.GetValueAtPercentile(99.0) <= m_maxP99;
+
+			char line[256];
+			snprintf(line, sizeof(line), "%-14s %8.0f %s/s: %8.0f events/s, event p50 %8.1fus p99 %9.1fus p99.9 %9.1fus, command p50 %8.1fus p99 %9.1fus%s",
+				s_ScenarioStr[result.scenario].data(), result.rate, s_ScenarioUnitStr[result.scenario].data(), result.eventsPerSecond,
+				result.eventLatency.GetValueAtPercentile(50.0) / 1000.0, result.eventLatency.GetValueAtPercentile(99.0) / 1000.0,
+				result.eventLatency.GetValueAtPercentile(99.9) / 1000.0, result.commandLatency.GetValueAtPercentile(50.0) / 1000.0,
+				result.commandLatency.GetValueAtPercentile(99.0) / 1000.0, (result.sustained == true) ? "" : "   NOT SUSTAINED");
+			BetteRCon::Internal::g_stdOutLog << line << '\n';
+
+			// the next scenario starts once this one can't keep up, or runs out of rates
+			if (result.sustained == false ||
+				++m_rateIndex == s_scenarioRates[m_scenario].size())
+			{
+				++m_scenario;
+				m_rateIndex = 0;
+			}
+
+			// let anything that was queued settle before the next step
+			m_pCurrentStep = nullptr;
+			m_stepTimer.expires_after(std::chrono::milliseconds(250));
+			m_stepTimer.async_wait([this](const MockServer::ErrorCode_t& ec)
+			{
+				if (!ec)
+					StartStep();
+			});
+		}
+
+		MockServer& m_mockServer;
+		asio::steady_timer m_stepTimer;
+		Clock_t::duration m_stepDuration;
+		uint64_t m_maxP99;
+
+		std::mutex& m_commandLatencyMutex;
+		Histogram& m_commandLatency;
+
+		size_t m_scenario = 0;
+		size_t m_rateIndex = 0;
+		// results are only added between steps, so the pointer stays valid for the step
+		std::vector<StepResult> m_results;
+		StepResult* m_pCurrentStep = nullptr;
+
+		MockServer::Stats m_statsBefore;
+		Clock_t::time_point m_stepStart;
+		Clock_t::time_point m_drainStart;
+		bool m_drained = false;
+		uint64_t m_roundsEnded = 0;
+
+		FinishCallback_t m_finishCallback;
+	};
+
+	void WriteLatency(std::ostream& out, const Histogram& histogram)
+	{
+		out << "{\"count\":" << histogram.GetCount() << ",\"mean\":" << static_cast<uint64_t>(histogram.GetMean())
+			<< ",\"p50\":" << histogram.GetValueAtPercentile(50.0) << ",\"p99\":" << histogram.GetValueAtPercentile(99.0)
+			<< ",\"p999\":" << histogram.GetValueAtPercentile(99.9) << ",\"max\":" << histogram.GetMax() << '}';
+	}
+
+	// one JSON object, with latencies in nanoseconds
+	std::string MakeReport(const LoadDriver& driver, const Clock_t::duration stepDuration, const std::vector<std::string>& plugins)
+	{
+		std::ostringstream out;
+		out << "{\"stepSeconds\":" << std::chrono::duration<double>(stepDuration).count() << ",\"plugins\":[";
+		for (size_t i = 0; i < plugins.size(); ++i)
+			out << ((i == 0) ? "" : ",") << '"' << plugins[i] << '"';
+
+		out << "],\"steps\":[";
+		const std::vector<StepResult>& results = driver.GetResults();
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const StepResult& result = results[i];
+			out << ((i == 0) ? "" : ",") << "{\"scenario\":\"" << s_ScenarioStr[result.scenario] << "\",\"rate\":" << result.rate
+				<< ",\"rateUnit\":\"" << s_ScenarioUnitStr[result.scenario] << "/s\""
+				<< ",\"eventsSent\":" << result.eventsSent << ",\"eventsAcknowledged\":" << result.eventsAcknowledged
+				<< ",\"eventsPerSecond\":" << static_cast<uint64_t>(result.eventsPerSecond)
+				<< ",\"sustained\":" << ((result.sustained == true) ? "true" : "false") << ",\"eventLatencyNs\":";
+			WriteLatency(out, result.eventLatency);
+			out << ",\"commandLatencyNs\":";
+			WriteLatency(out, result.commandLatency);
+			out << '}';
+		}
+
+		out << "],\"maxSustainedRate\":{";
+		for (size_t scenario = 0; scenario < Scenario_Count; ++scenario)
+			out << ((scenario == 0) ? "" : ",") << '"' << s_ScenarioStr[scenario] << "\":" << driver.GetMaxSustainedRate(static_cast<Scenario>(scenario));
+
+		out << "}}\n";
+		return out.str();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	double stepSeconds = 3.0;
+	double maxP99Ms = 100.0;
+	std::string reportPath;
+	std::vector<std::string> plugins;
+
+	// options start with --, and everything else is a plugin
+	static constexpr std::string_view s_durationOption = "--duration=";
+	static constexpr std::string_view s_maxP99Option = "--max-p99=";
+	static constexpr std::string_view s_reportOption = "--report=";
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg.compare(0, s_durationOption.size(), s_durationOption) == 0)
+			stepSeconds = std::atof(argv[i] + s_durationOption.size());
+		else if (arg.compare(0, s_maxP99Option.size(), s_maxP99Option) == 0)
+			maxP99Ms = std::atof(argv[i] + s_maxP99Option.size());
+		else if (arg.compare(0, s_reportOption.size(), s_reportOption) == 0)
+			reportPath = arg.substr(s_reportOption.size());
+		else if (arg.compare(0, 2, "--") == 0 ||
+			stepSeconds <= 0.0)
+		{
+			std::cout << "Usage: " << argv[0] << " [--duration=seconds per step, default 3] [--max-p99=ms, default 100] [--report=file] [plugins:string...]\n";
+			return 1;
+		}
+		else
+			plugins.emplace_back(arg);
+	}
+
+	const Clock_t::duration stepDuration = std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double>(stepSeconds));
+
+	// a full server whose only events are the ones the steps send
+	MockServer::Settings settings;
+	settings.players = settings.maxPlayers;
+	settings.tickets = 1'000'000'000;
+	settings.joinsPerMinute = settings.leavesPerMinute = settings.killsPerMinute = settings.chatsPerMinute = 0.0;
+
+	MockServer::Worker_t mockWorker;
+	MockServer mockServer(mockWorker, settings);
+
+	const MockServer::ErrorCode_t listenEc = mockServer.Listen(MockServer::Endpoint_t(asio::ip::address_v4::loopback(), 0));
+	if (listenEc)
+	{
+		BetteRCon::Internal::g_stdErrLog << "Failed to listen: " << listenEc.message() << '\n';
+		return 1;
+	}
+
+	std::mutex commandLatencyMutex;
+	Histogram commandLatency(s_highestLatency);
+	LoadDriver driver(mockWorker, mockServer, stepDuration, static_cast<uint64_t>(maxP99Ms * 1'000'000), commandLatencyMutex, commandLatency);
+
+	Server::Worker_t worker;
+	Server server(worker);
+	asio::steady_timer commandTimer(worker);
+	bool started = false;
+	bool finished = false;
+
+	// commands are sent from the server's worker, so they queue behind the events like a plugin's would
+	std::function<void(const Server::ErrorCode_t&)> sendCommand = [&](const Server::ErrorCode_t& ec)
+	{
+		if (ec ||
+			finished == true)
+			return;
+
+		const Clock_t::time_point sent = Clock_t::now();
+		server.SendCommand({ "serverInfo" }, [&commandLatencyMutex, &commandLatency, sent](const Server::ErrorCode_t& ec, const std::vector<std::string>&)
+		{
+			if (ec)
+				return;
+
+			std::lock_guard lock(commandLatencyMutex);
+			commandLatency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock_t::now() - sent).count());
+		});
+
+		commandTimer.expires_after(s_commandInterval);
+		commandTimer.async_wait(sendCommand);
+	};
+
+	auto finish = [&]()
+	{
+		const std::string report = MakeReport(driver, stepDuration, plugins);
+		if (reportPath.empty() == false)
+		{
+			std::ofstream outFile(reportPath, std::ios::trunc);
+			outFile << report;
+			if (outFile.good() == true)
+				BetteRCon::Internal::g_stdOutLog << "Wrote the report to " << reportPath << '\n';
+			else
+				BetteRCon::Internal::g_stdErrLog << "Failed to write the report to " << reportPath << '\n';
+		}
+
+		for (size_t scenario = 0; scenario < Scenario_Count; ++scenario)
+			BetteRCon::Internal::g_stdOutLog << "Max sustained " << s_ScenarioStr[scenario] << ": " << driver.GetMaxSustainedRate(static_cast<Scenario>(scenario)) << ' ' << s_ScenarioUnitStr[scenario] << "/s\n";
+
+		// the server has to know it's finished before the mock server hangs up on it
+		asio::post(worker, [&]()
+		{
+			finished = true;
+			Server::ErrorCode_t ignored;
+			commandTimer.cancel(ignored);
+			server.Disconnect();
+
+			// the disconnect is posted, and has to happen before the server is destroyed
+			asio::post(worker, [&worker]() { worker.stop(); });
+		});
+		mockServer.Close();
+	};
+
+	server.AsyncConnect(mockServer.GetLocalEndpoint(),
+		[&](const Server::ErrorCode_t& ec)
+		{
+			if (ec)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Failed to connect: " << ec.message() << '\n';
+				return worker.stop();
+			}
+
+			server.AsyncLogin(settings.password, [&](const Server::LoginResult loginRes)
+				{
+					if (loginRes != Server::LoginResult_OK)
+					{
+						BetteRCon::Internal::g_stdErrLog << "Failed to login to the mock server: " << Server::s_LoginResultStr[loginRes] << '\n';
+						server.Disconnect();
+						worker.stop();
+					}
+				},
+				[&]()
+				{
+					for (const std::string& plugin : plugins)
+					{
+						if (server.EnablePlugin(plugin) == true)
+							BetteRCon::Internal::g_stdOutLog << "Enabled plugin " << plugin << '\n';
+						else
+							BetteRCon::Internal::g_stdErrLog << "Failed to enable plugin " << plugin << '\n';
+					}
+				},
+				[](const std::string& pluginName, const bool load, const bool success, const std::string& failReason)
+				{
+					if (load == true &&
+						success == false)
+						BetteRCon::Internal::g_stdErrLog << "Failed to load plugin " << pluginName << ": " << failReason << '\n';
+				},
+				[](const std::vector<std::string>&) {},
+				[](const Server::ServerInfo&) {},
+				[&](const Server::PlayerMap_t& players, const Server::TeamMap_t&)
+				{
+					// the steps start once the server knows the players, and has had time to get the PB list
+					if (started == true)
+						return;
+
+					started = true;
+					BetteRCon::Internal::g_stdOutLog << "Connected with " << players.size() << " players. Starting in a second\n";
+
+					sendCommand(Server::ErrorCode_t{});
+
+					std::shared_ptr<asio::steady_timer> pStartTimer = std::make_shared<asio::steady_timer>(mockWorker, std::chrono::seconds(1));
+					pStartTimer->async_wait([&driver, &finish, pStartTimer](const MockServer::ErrorCode_t& ec)
+					{
+						if (!ec)
+							driver.Start(finish);
+					});
+				});
+		}, [&](const Server::ErrorCode_t& ec)
+		{
+			if (finished == false)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Disconnected from the mock server: " << ec.message() << '\n';
+				asio::post(mockWorker, [&mockServer, &mockWorker]()
+				{
+					mockServer.Close();
+					mockWorker.stop();
+				});
+				worker.stop();
+			}
+		});
+
+	std::thread mockThread([&mockWorker]() { mockWorker.run(); });
+	worker.run();
+
+	mockThread.join();
+
+	return (finished == true) ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+#include <BetteRCon/Internal/EventLog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using BetteRCon::Internal::EventLogReader;
+
+namespace
+{
+	struct Filter
+	{
+		std::set<std::string, std::less<>> types;
+		std::set<std::string, std::less<>> names;
+		std::vector<std::string> contains;
+		EventLogReader::Clock_t::time_point since = EventLogReader::Clock_t::time_point::min();
+		EventLogReader::Clock_t::time_point until = EventLogReader::Clock_t::time_point::max();
+	};
+
+	bool Matches(const Filter& filter, const EventLogReader::Record& record)
+	{
+		if (record.time < filter.since ||
+			record.time >= filter.until)
+			return false;
+
+		if (filter.types.empty() == false &&
+			filter.types.find(BetteRCon::Internal::g_EventLogRecordTypeStr[record.type]) == filter.types.end())
+			return false;
+
+		if (filter.names.empty() == false &&
+			filter.names.find(record.name) == filter.names.end())
+			return false;
+
+		// every string has to be in one of the words
+		for (const std::string& text : filter.contains)
+		{
+			if (std::none_of(record.words.begin(), record.words.end(), [&text](const std::string_view word) { return word.find(text) != std::string_view::npos; }))
+				return false;
+		}
+
+		return true;
+	}
+
+	void PrintJSONString(const std::string_view str)
+	{
+		static constexpr char s_hexDigits[] = "0123456789abcdef";
+
+		std::cout << '"';
+		for (const char c : str)
+		{
+			switch (c)
+			{
+			case '"': std::cout << "\\\""; break;
+			case '\\': std::cout << "\\\\"; break;
+			case '\n': std::cout << "\\n"; break;
+			case '\r': std::cout << "\\r"; break;
+			case '\t': std::cout << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+					std::cout << "\\u00" << s_hexDigits[c >> 4] << s_hexDigits[c & 0xf];
+				else
+					std::cout << c;
+			}
+		}
+		std::cout << '"';
+	}
+
+	void PrintJSON(const EventLogReader::Record& record)
+	{
+		std::cout << "{\"time\":" << std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch()).count()
+			<< ",\"type\":\"" << BetteRCon::Internal::g_EventLogRecordTypeStr[record.type] << "\",\"name\":";
+		PrintJSONString(record.name);
+
+		if (record.type != BetteRCon::Internal::EventLogRecordType_Event)
+			std::cout << ",\"sequence\":" << record.sequence;
+
+		if ((record.flags & BetteRCon::Internal::EventLogRecordFlag_Error) != 0)
+			std::cout << ",\"error\":true";
+
+		std::cout << ",\"words\":[";
+		for (size_t i = 0; i < record.words.size(); ++i)
+		{
+			if (i != 0)
+				std::cout << ',';
+
+			PrintJSONString(record.words[i]);
+		}
+		std::cout << "]}\n";
+	}
+
+	void PrintText(const EventLogReader::Record& record)
+	{
+		// UTC, so that logs from different hosts line up
+		const time_t seconds = EventLogReader::Clock_t::to_time_t(record.time);
+		const int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch()).count() % 1000000;
+
+		std::tm tm{};
+#ifdef _WIN32
+		gmtime_s(&tm, &seconds);
+#else
+		gmtime_r(&seconds, &tm);
+#endif
+
+		std::cout << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(6) << std::setfill('0') << micros
+			<< ' ' << BetteRCon::Internal::g_EventLogRecordTypeStr[record.type];
+
+		if (record.type != BetteRCon::Internal::EventLogRecordType_Event)
+			std::cout << " #" << record.sequence;
+
+		if ((record.flags & BetteRCon::Internal::EventLogRecordFlag_Error) != 0)
+			std::cout << " (error)";
+
+		std::cout << ' ' << record.name;
+
+		// quote words that would be ambiguous otherwise
+		for (const std::string_view word : record.words)
+		{
+			if (word.empty() == true ||
+				word.find_first_of(" \"") != std::string_view::npos)
+				std::cout << " \"" << word << '"';
+			else
+				std::cout << ' ' << word;
+		}
+
+		std::cout << '\n';
+	}
+
+	bool ParseTime(const std::string_view value, EventLogReader::Clock_t::time_point& timeOut)
+	{
+		try
+		{
+			timeOut = EventLogReader::Clock_t::time_point(std::chrono::seconds(std::stoll(std::string(value))));
+			return true;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " [--json] [--type=event|command|response...] [--name=name...] [--contains=text...] [--since=unixSeconds] [--until=unixSeconds] [segment or directory...]\n";
+		return 1;
+	}
+
+	Filter filter;
+	bool json = false;
+	std::vector<std::filesystem::path> segments;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		const size_t equals = arg.find('=');
+		const std::string_view option = arg.substr(0, equals);
+		const std::string_view value = (equals != std::string_view::npos) ? arg.substr(equals + 1) : std::string_view{};
+
+		if (arg == "--json")
+			json = true;
+		else if (option == "--type")
+			filter.types.emplace(value);
+		else if (option == "--name")
+			filter.names.emplace(value);
+		else if (option == "--contains")
+			filter.contains.emplace_back(value);
+		else if (option == "--since" || option == "--until")
+		{
+			if (ParseTime(value, (option == "--since") ? filter.since : filter.until) == false)
+			{
+				std::cerr << "Invalid time " << value << '\n';
+				return 1;
+			}
+		}
+		else if (arg.compare(0, 2, "--") == 0)
+		{
+			std::cerr << "Unknown option " << arg << '\n';
+			return 1;
+		}
+		else if (std::filesystem::is_directory(arg) == true)
+		{
+			// every segment in the directory, oldest first
+			std::vector<std::filesystem::path> directorySegments;
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(arg))
+			{
+				if (entry.path().extension() == BetteRCon::Internal::g_eventLogExtension)
+					directorySegments.push_back(entry.path());
+			}
+
+			std::sort(directorySegments.begin(), directorySegments.end());
+			segments.insert(segments.end(), directorySegments.begin(), directorySegments.end());
+		}
+		else
+			segments.emplace_back(arg);
+	}
+
+	int result = 0;
+
+	EventLogReader reader;
+	EventLogReader::Record record;
+	for (const std::filesystem::path& segment : segments)
+	{
+		const EventLogReader::Status status = reader.Open(segment.string());
+		if (status != EventLogReader::Status_OK)
+		{
+			std::cerr << segment.string() << ": " << EventLogReader::s_StatusStr[status] << '\n';
+			result = 1;
+			continue;
+		}
+
+		while (reader.Next(record) == true)
+		{
+			if (Matches(filter, record) == false)
+				continue;
+
+			if (json == true)
+				PrintJSON(record);
+			else
+				PrintText(record);
+		}
+
+		if (reader.GetStatus() != EventLogReader::Status_OK)
+		{
+			std::cerr << segment.string() << ": " << EventLogReader::s_StatusStr[reader.GetStatus()] << '\n';
+			result = 1;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,144 @@
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/MockServer.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using BetteRCon::Internal::MockServer;
+
+namespace
+{
+	std::vector<std::string> SplitLine(const std::string& line)
+	{
+		std::vector<std::string> words;
+
+		size_t start = 0;
+		for (size_t comma = line.find(','); comma != std::string::npos; comma = line.find(',', start))
+		{
+			words.push_back(line.substr(start, comma - start));
+			start = comma + 1;
+		}
+
+		words.push_back(line.substr(start));
+		return words;
+	}
+
+	// scripts are lines of setting,value, event,seconds,words... and response,command,words...
+	bool ReadScript(const std::string& path, MockServer::Settings& settingsOut,
+		std::vector<std::pair<double, std::vector<std::string>>>& eventsOut, std::vector<std::vector<std::string>>& responsesOut)
+	{
+		std::ifstream inFile(path);
+		if (inFile.good() == false)
+		{
+			BetteRCon::Internal::g_stdErrLog << "Failed to open script " << path << '\n';
+			return false;
+		}
+
+		std::string scriptLine;
+		while (std::getline(inFile, scriptLine))
+		{
+			// files edited on windows
+			if (scriptLine.empty() == false &&
+				scriptLine.back() == '\r')
+				scriptLine.pop_back();
+
+			if (scriptLine.empty() == true ||
+				scriptLine.front() == '#')
+				continue;
+
+			std::vector<std::string> words = SplitLine(scriptLine);
+			if (words.size() < 2)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Failed to find comma for script line " << scriptLine << '\n';
+				continue;
+			}
+
+			const std::string& key = words[0];
+			const std::string& value = words[1];
+
+			try
+			{
+				if (key == "event" && words.size() > 2)
+					eventsOut.emplace_back(std::stod(value), std::vector<std::string>(words.begin() + 2, words.end()));
+				else if (key == "response" && words.size() > 2)
+					responsesOut.emplace_back(words.begin() + 1, words.end());
+				else if (key == "password")
+					settingsOut.password = value;
+				else if (key == "serverName")
+					settingsOut.serverName = value;
+				else if (key == "gameMode")
+					settingsOut.gameMode = value;
+				else if (key == "map")
+					settingsOut.map = value;
+				else if (key == "maxPlayers")
+					settingsOut.maxPlayers = static_cast<uint32_t>(std::stoul(value));
+				else if (key == "players")
+					settingsOut.players = static_cast<uint32_t>(std::stoul(value));
+				else if (key == "tickets")
+					settingsOut.tickets = static_cast<uint32_t>(std::stoul(value));
+				else if (key == "joinsPerMinute")
+					settingsOut.joinsPerMinute = std::stod(value);
+				else if (key == "leavesPerMinute")
+					settingsOut.leavesPerMinute = std::stod(value);
+				else if (key == "killsPerMinute")
+					settingsOut.killsPerMinute = std::stod(value);
+				else if (key == "chatsPerMinute")
+					settingsOut.chatsPerMinute = std::stod(value);
+				else if (key == "seed")
+					settingsOut.seed = static_cast<uint32_t>(std::stoul(value));
+				else
+					BetteRCon::Internal::g_stdErrLog << "Unknown script line " << scriptLine << '\n';
+			}
+			catch (const std::exception&)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Invalid script line " << scriptLine << '\n';
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " [port:ushort] [script:string, optional]\n";
+		return 1;
+	}
+
+	const uint16_t port = atoi(argv[1]);
+
+	MockServer::Settings settings;
+	std::vector<std::pair<double, std::vector<std::string>>> events;
+	std::vector<std::vector<std::string>> responses;
+
+	if (argc > 2 &&
+		ReadScript(argv[2], settings, events, responses) == false)
+		return 1;
+
+	MockServer::Worker_t worker;
+	MockServer mockServer(worker, settings);
+
+	for (const std::pair<double, std::vector<std::string>>& event : events)
+		mockServer.ScheduleEvent(std::chrono::duration_cast<MockServer::Clock_t::duration>(std::chrono::duration<double>(event.first)), event.second);
+
+	for (const std::vector<std::string>& response : responses)
+		mockServer.SetResponse(response.front(), std::vector<std::string>(response.begin() + 1, response.end()));
+
+	const MockServer::ErrorCode_t ec = mockServer.Listen(MockServer::Endpoint_t(asio::ip::address_v4::loopback(), port));
+	if (ec)
+	{
+		BetteRCon::Internal::g_stdErrLog << "Failed to listen on port " << port << ": " << ec.message() << '\n';
+		return 1;
+	}
+
+	BetteRCon::Internal::g_stdOutLog << "Mock server listening on " << mockServer.GetLocalEndpoint().address().to_string() << ':' << mockServer.GetLocalEndpoint().port()
+		<< " with " << settings.players << " players and password " << settings.password << '\n';
+
+	worker.run();
+
+	return 0;
+}
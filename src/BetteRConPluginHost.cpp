@@ -0,0 +1,328 @@
+#include <BetteRCon/Plugin.h>
+#include <BetteRCon/Server.h>
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/SandboxChannel.h>
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using BetteRCon::Server;
+using BetteRCon::Internal::SandboxChannel;
+
+namespace BetteRCon
+{
+	namespace Internal
+	{
+		/*
+		 *	PluginHost loads a single plugin into a server that has no connection of its own.
+		 *	The server's events are read from the channel and dispatched as if they came from
+		 *	the connection, so the host keeps its own players and teams, and the plugin's
+		 *	commands are written back for the server process to send.
+		 */
+		class PluginHost
+		{
+		public:
+			PluginHost(Server::Worker_t& worker) : m_worker(worker), m_server(worker, *this) {}
+
+			PluginHost(const PluginHost& other) = delete;
+			PluginHost& operator=(const PluginHost& other) = delete;
+
+			// Opens the channel and loads the plugin, and tells the server process how it went. Returns false if either failed
+			bool Start(const std::string& handle, const std::string& pluginPath)
+			{
+				if (m_channel.Open(handle) == false)
+				{
+					g_stdErrLog << "Failed to open the channel " << handle << '\n';
+					return false;
+				}
+
+#ifdef _WIN32
+				m_hServerProcess = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(m_channel.GetServerProcessId()));
+#else
+				if (static_cast<uint64_t>(getppid()) != m_channel.GetServerProcessId())
+				{
+					g_stdErrLog << "The channel " << handle << " wasn't created by our parent\n";
+					return false;
+				}
+#endif
+
+				std::string failReason;
+				m_server.m_eventCallback = [](const std::vector<std::string>&) {};
+				m_server.m_finishedLoadingPluginsCallback = []() {};
+				m_server.m_pluginCallback = [&failReason](const std::string&, const bool load, const bool success, const std::string& reason)
+				{
+					if (load == true &&
+						success == false)
+						failReason = reason;
+				};
+				m_server.m_serverInfoCallback = [](const Server::ServerInfo&) {};
+				m_server.m_playerInfoCallback = [](const Server::PlayerMap_t&, const Server::TeamMap_t&) {};
+
+				// the server process sends us its serverInfo and players, and records the rounds in the history
+				m_server.m_isPluginHost = true;
+
+				// what InitializeServer does, with only the one plugin
+				m_server.RegisterServerHandlers();
+				m_server.LoadChatFilter();
+				m_server.LoadCommandLimits();
+				const bool loaded = m_server.LoadPlugin(pluginPath);
+				m_server.m_pluginCallback = [](const std::string&, const bool, const bool, const std::string&) {};
+
+				if (loaded == false)
+				{
+					SandboxChannel::Send(m_channel.GetToServer(), SandboxChannel::MessageType_LoadFailed, 0, { failReason }, m_sendBuffer);
+					return false;
+				}
+
+				m_server.BuildCommandRouter();
+				m_server.m_initializedServer = true;
+
+				const Plugin* pPlugin = m_server.m_plugins.begin()->second.pPlugin;
+				m_pluginName = m_server.m_plugins.begin()->first;
+				SandboxChannel::Send(m_channel.GetToServer(), SandboxChannel::MessageType_Hello, 0,
+					{ m_pluginName, std::string(pPlugin->GetPluginVersion()), std::string(pPlugin->GetPluginAuthor()) }, m_sendBuffer);
+
+				m_waiter = std::thread(&PluginHost::Wait, this);
+
+				return true;
+			}
+
+			~PluginHost()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stopping = true;
+				}
+				m_drainedCondition.notify_one();
+
+				if (m_waiter.joinable() == true)
+					m_waiter.join();
+
+#ifdef _WIN32
+				if (m_hServerProcess != nullptr)
+					CloseHandle(m_hServerProcess);
+#endif
+			}
+		private:
+			/*
+			 *	HostedServer sends its commands over the channel instead of a connection. Everything
+			 *	that sends a command, from the polls to the plugin, goes through here.
+			 */
+			class HostedServer : public Server
+			{
+			public:
+				HostedServer(Worker_t& worker, PluginHost& host) : Server(worker), m_host(host) {}
+
+				void SendCommand(const std::vector<std::string>& command, RecvCallback_t&& recvCallback) override
+				{
+					m_host.SendCommand(command, std::move(recvCallback));
+				}
+			private:
+				PluginHost& m_host;
+			};
+
+			void SendCommand(const std::vector<std::string>& command, Server::RecvCallback_t&& recvCallback)
+			{
+				const uint32_t sequence = m_nextSequence++;
+				if (SandboxChannel::Send(m_channel.GetToServer(), SandboxChannel::MessageType_Command, sequence, command, m_sendBuffer) == false)
+				{
+					// the server process is behind, so the command fails like it would on a full socket
+					asio::post(m_worker, [recvCallback{ std::move(recvCallback) }]()
+					{
+						recvCallback(asio::error::no_buffer_space, std::vector<std::string>{});
+					});
+					return;
+				}
+
+				m_pendingCommands.emplace(sequence, std::move(recvCallback));
+			}
+
+			// waits on the channel from a thread of its own, and has the worker drain it. The worker is only woken once for
+			// each burst of messages, and the thread doesn't wait again until they have been drained
+			void Wait()
+			{
+				SharedRing& toHost = m_channel.GetToHost();
+
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (m_stopping == false)
+				{
+					lock.unlock();
+					toHost.Wait(std::chrono::milliseconds(100));
+
+					if (toHost.IsEmpty() == true)
+					{
+						// nobody is left to send us anything
+						if (IsServerAlive() == false)
+						{
+							g_stdErrLog << "The server process went away, exiting\n";
+							asio::post(m_worker, [this]() { Stop(); });
+							return;
+						}
+
+						lock.lock();
+						continue;
+					}
+
+					lock.lock();
+					m_drainPending = true;
+					asio::post(m_worker, [this]() { Drain(); });
+					m_drainedCondition.wait(lock, [this]() { return m_drainPending == false || m_stopping == true; });
+				}
+			}
+
+			bool IsServerAlive() const
+			{
+#ifdef _WIN32
+				return m_hServerProcess == nullptr ||
+					WaitForSingleObject(m_hServerProcess, 0) != WAIT_OBJECT_0;
+#else
+				return static_cast<uint64_t>(getppid()) == m_channel.GetServerProcessId();
+#endif
+			}
+
+			void Drain()
+			{
+				while (SandboxChannel::Receive(m_channel.GetToHost(), m_message, m_receiveBuffer) == true)
+				{
+					switch (m_message.type)
+					{
+					case SandboxChannel::MessageType_Event:
+						// like the server process, events are only handled once we know the server and its players
+						if (m_message.words.empty() == false &&
+							m_server.m_gotServerInfo == true &&
+							m_server.m_gotServerPlayers == true)
+							m_server.DispatchEvent(m_message.words);
+						break;
+					case SandboxChannel::MessageType_ServerInfo:
+					m_server.HandleServerInfo(Server::ErrorCode_t{}, m_message.words);
+					break;
+				case SandboxChannel::MessageType_PlayerList:
+					m_server.HandlePlayerList(Server::ErrorCode_t{}, m_message.words);
+					break;
+				case SandboxChannel::MessageType_Enable:
+						m_server.EnablePlugin(m_pluginName);
+						break;
+					case SandboxChannel::MessageType_Disable:
+						m_server.DisablePlugin(m_pluginName);
+						break;
+					case SandboxChannel::MessageType_Response:
+					case SandboxChannel::MessageType_CommandFailed:
+					{
+						const std::unordered_map<uint32_t, Server::RecvCallback_t>::iterator pendingIt = m_pendingCommands.find(m_message.sequence);
+						if (pendingIt == m_pendingCommands.end())
+							break;
+
+						// the callback may send more commands
+						const Server::RecvCallback_t recvCallback = std::move(pendingIt->second);
+						m_pendingCommands.erase(pendingIt);
+
+						// the error is rebuilt from its value, which is all that crosses the channel
+						if (m_message.type == SandboxChannel::MessageType_CommandFailed)
+							recvCallback(Server::ErrorCode_t(std::atoi(m_message.words.empty() == true ? "0" : m_message.words.front().c_str()), asio::error::get_system_category()), std::vector<std::string>{});
+						else
+							recvCallback(Server::ErrorCode_t{}, m_message.words);
+						break;
+					}
+					case SandboxChannel::MessageType_Shutdown:
+						Stop();
+						return;
+					default:
+						g_stdErrLog << "Unexpected message of type " << m_message.type << " from the server process\n";
+						break;
+					}
+				}
+
+				// the server process never writes a bad record, so something is badly wrong
+				if (m_channel.GetToHost().IsCorrupt() == true)
+				{
+					g_stdErrLog << "The channel from the server process is corrupt, exiting\n";
+					Stop();
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_drainPending = false;
+				}
+				m_drainedCondition.notify_one();
+			}
+
+			void Stop()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stopping = true;
+				}
+				m_drainedCondition.notify_one();
+
+				// disables and unloads the plugin, and cancels its timers
+				m_server.ClearContainers();
+
+				Server::ErrorCode_t ignored;
+				m_server.m_serverInfoTimer.cancel(ignored);
+				m_server.m_playerInfoTimer.cancel(ignored);
+				m_server.m_punkbusterPlayerListTimer.cancel(ignored);
+				m_pendingCommands.clear();
+
+				m_worker.stop();
+			}
+
+			Server::Worker_t& m_worker;
+			HostedServer m_server;
+			std::string m_pluginName;
+
+			SandboxChannel m_channel;
+#ifdef _WIN32
+			HANDLE m_hServerProcess = nullptr;
+#endif
+
+			// only touched by the worker
+			uint32_t m_nextSequence = 0;
+			std::unordered_map<uint32_t, Server::RecvCallback_t> m_pendingCommands;
+			std::vector<char> m_sendBuffer;
+			std::vector<char> m_receiveBuffer;
+			SandboxChannel::Message m_message;
+
+			std::mutex m_mutex;
+			std::condition_variable m_drainedCondition;
+			bool m_drainPending = false;
+			bool m_stopping = false;
+			std::thread m_waiter;
+		};
+	}
+}
+
+using BetteRCon::Internal::PluginHost;
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		std::cout << "Usage: " << argv[0] << " [channel:handle] [plugin:path]\n";
+		std::cout << "Started by the server for each plugin when plugins are isolated\n";
+		return 1;
+	}
+
+	Server::Worker_t worker;
+	PluginHost host(worker);
+
+	if (host.Start(argv[1], argv[2]) == false)
+		return 1;
+
+	// keep running until we are asked to stop, or the server process goes away
+	asio::executor_work_guard<Server::Worker_t::executor_type> workGuard(worker.get_executor());
+	worker.run();
+
+	return 0;
+}
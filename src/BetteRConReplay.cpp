@@ -0,0 +1,406 @@
+#include <BetteRCon/Server.h>
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/ServerEndpoint.h>
+#include <BetteRCon/Internal/SessionCapture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using BetteRCon::Server;
+using BetteRCon::Internal::Packet;
+using BetteRCon::Internal::ServerEndpoint;
+using BetteRCon::Internal::SessionCaptureReader;
+
+namespace
+{
+	using Clock_t = std::chrono::steady_clock;
+	using Words_t = std::vector<std::string>;
+
+	struct RecordedEvent
+	{
+		// since the capture connected
+		Clock_t::duration offset;
+		Words_t words;
+	};
+
+	struct RecordedResponse
+	{
+		Clock_t::duration offset;
+		Words_t words;
+	};
+
+	struct ResponseList
+	{
+		std::vector<RecordedResponse> responses;
+		size_t next = 0;
+	};
+
+	// the login hash depends on the password, so any hash matches the one in the capture
+	std::string MakeCommandKey(const Words_t& words)
+	{
+		if (words.empty() == true)
+			return {};
+
+		if (words.size() > 1 &&
+			(words.front() == "login.hashed" || words.front() == "login.plainText"))
+			return words.front() + '\0' + '*';
+
+		std::string key;
+		for (const std::string& word : words)
+		{
+			key += word;
+			key += '\0';
+		}
+
+		return key;
+	}
+
+	/*
+	 *	Replayer stands in for the server in a capture. It sends the captured events at their
+	 *	original times scaled by a speed, or in lockstep with the client's replies at a speed of
+	 *	zero, and answers each command with what the server answered to it in the capture.
+	 */
+	class Replayer
+	{
+	public:
+		Replayer(ServerEndpoint& endpoint, const double speed) : m_endpoint(endpoint), m_speed(speed) {}
+
+		bool Load(const std::string& path)
+		{
+			SessionCaptureReader reader;
+			SessionCaptureReader::Status status = reader.Open(path);
+			if (status != BetteRCon::Internal::DatabaseReader::Status_OK)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Failed to open " << path << ": " << BetteRCon::Internal::DatabaseReader::s_StatusStr[status] << '\n';
+				return false;
+			}
+
+			std::optional<SessionCaptureReader::Clock_t::time_point> connectTime;
+			// commands that are waiting for their response, by sequence
+			std::unordered_map<int32_t, Words_t> sentCommands;
+
+			SessionCaptureReader::Frame frame;
+			while (reader.Next(frame) == true)
+			{
+				// the first frame is the start if the capture began mid-session
+				if (connectTime.has_value() == false)
+					connectTime = frame.time;
+
+				if (frame.type != BetteRCon::Internal::SessionFrameType_Inbound &&
+					frame.type != BetteRCon::Internal::SessionFrameType_Outbound)
+					continue;
+
+				std::optional<Packet> packet;
+				try
+				{
+					packet.emplace(std::vector<char>(frame.data.begin(), frame.data.end()));
+				}
+				catch (const Packet::ErrorCode_t&)
+				{
+					++m_badFrames;
+					continue;
+				}
+
+				const Clock_t::duration offset = std::chrono::duration_cast<Clock_t::duration>(frame.time - *connectTime);
+
+				if (frame.type == BetteRCon::Internal::SessionFrameType_Outbound)
+				{
+					// replies to events don't need anything
+					if (packet->IsResponse() == false)
+						sentCommands[packet->GetSequence()] = packet->GetWords();
+				}
+				else if (packet->IsResponse() == true)
+				{
+					const std::unordered_map<int32_t, Words_t>::iterator commandIt = sentCommands.find(packet->GetSequence());
+					if (commandIt == sentCommands.end() ||
+						commandIt->second.empty() == true)
+						continue;
+
+					m_responsesByCommand[MakeCommandKey(commandIt->second)].responses.push_back(RecordedResponse{ offset, packet->GetWords() });
+					m_responsesByName[commandIt->second.front()].responses.push_back(RecordedResponse{ offset, packet->GetWords() });
+
+					sentCommands.erase(commandIt);
+				}
+				else if (packet->GetWords().empty() == false)
+					m_events.push_back(RecordedEvent{ offset, packet->GetWords() });
+			}
+
+			if (reader.GetStatus() != BetteRCon::Internal::DatabaseReader::Status_OK)
+				BetteRCon::Internal::g_stdErrLog << "Stopped reading " << path << " early: " << BetteRCon::Internal::DatabaseReader::s_StatusStr[reader.GetStatus()] << '\n';
+
+			BetteRCon::Internal::g_stdOutLog << "Loaded " << m_events.size() << " events and " << CountResponses() << " responses\n";
+
+			return true;
+		}
+
+		void Start(asio::steady_timer& timer)
+		{
+			m_pTimer = &timer;
+			m_start = Clock_t::now();
+
+			SendEvents();
+		}
+
+		void HandlePacket(const Packet& packet)
+		{
+			if (packet.IsResponse() == true)
+			{
+				// in lockstep, the next event goes once the client is done with the last one
+				++m_acknowledgedEvents;
+				if (m_speed == 0.0)
+					SendEvents();
+				return;
+			}
+
+			const Words_t& command = packet.GetWords();
+			const Words_t* pResponse = nullptr;
+
+			if (command.empty() == false)
+			{
+				pResponse = FindResponse(m_responsesByCommand, MakeCommandKey(command));
+				if (pResponse != nullptr)
+					++m_exactResponses;
+				else
+				{
+					// the same command with other arguments is closer than nothing
+					pResponse = FindResponse(m_responsesByName, command.front());
+					if (pResponse != nullptr)
+						++m_nameResponses;
+				}
+			}
+
+			if (pResponse == nullptr)
+			{
+				++m_unknownCommands;
+				m_endpoint.SendPacket(Packet({ "UnknownCommand" }, packet.GetSequence(), true));
+				return;
+			}
+
+			m_endpoint.SendPacket(Packet(*pResponse, packet.GetSequence(), true));
+		}
+
+		bool IsFinished() const noexcept
+		{
+			return m_nextEvent == m_events.size();
+		}
+
+		void PrintStats() const
+		{
+			BetteRCon::Internal::g_stdOutLog << "Replayed " << m_nextEvent << '/' << m_events.size() << " events (" << m_acknowledgedEvents << " acknowledged). Commands: "
+				<< m_exactResponses << " answered exactly, " << m_nameResponses << " answered by name, " << m_unknownCommands << " unknown. "
+				<< m_badFrames << " bad frames\n";
+		}
+	private:
+		size_t CountResponses() const
+		{
+			size_t count = 0;
+			for (const std::unordered_map<std::string, ResponseList>::value_type& list : m_responsesByName)
+				count += list.second.responses.size();
+
+			return count;
+		}
+
+		// how far into the capture the replay is
+		Clock_t::duration GetCaptureTime() const
+		{
+			const Clock_t::duration lastEvent = (m_nextEvent > 0) ? m_events[m_nextEvent - 1].offset : Clock_t::duration::zero();
+			if (m_speed == 0.0)
+				return lastEvent;
+
+			const Clock_t::duration scaled = std::chrono::duration_cast<Clock_t::duration>((Clock_t::now() - m_start) * m_speed);
+			return std::max(scaled, lastEvent);
+		}
+
+		// gets the latest response that was recorded by the time the replay is at, or the next one if none were yet
+		const Words_t* FindResponse(std::unordered_map<std::string, ResponseList>& responseMap, const std::string& key)
+		{
+			const std::unordered_map<std::string, ResponseList>::iterator listIt = responseMap.find(key);
+			if (listIt == responseMap.end())
+				return nullptr;
+
+			ResponseList& list = listIt->second;
+			const Clock_t::duration captureTime = GetCaptureTime();
+			while (list.next + 1 < list.responses.size() &&
+				list.responses[list.next + 1].offset <= captureTime)
+				++list.next;
+
+			const Words_t* pResponse = &list.responses[list.next].words;
+
+			// the last response keeps being used once the rest are
+			if (list.next + 1 < list.responses.size())
+				++list.next;
+
+			return pResponse;
+		}
+
+		void SendEvents()
+		{
+			if (m_endpoint.IsConnected() == false)
+				return;
+
+			if (m_speed == 0.0)
+			{
+				// one at a time, each after the client replied to the last
+				if (m_nextEvent < m_events.size() &&
+					m_acknowledgedEvents == m_nextEvent)
+					m_endpoint.SendPacket(Packet(m_events[m_nextEvent++].words, NextSequence()));
+				return;
+			}
+
+			const Clock_t::duration elapsed = std::chrono::duration_cast<Clock_t::duration>((Clock_t::now() - m_start) * m_speed);
+			while (m_nextEvent < m_events.size() &&
+				m_events[m_nextEvent].offset <= elapsed)
+				m_endpoint.SendPacket(Packet(m_events[m_nextEvent++].words, NextSequence()));
+
+			if (m_nextEvent == m_events.size())
+				return;
+
+			// wait for the next event
+			const Clock_t::duration wait = std::chrono::duration_cast<Clock_t::duration>((m_events[m_nextEvent].offset - elapsed) / m_speed);
+			m_pTimer->expires_after(wait);
+			m_pTimer->async_wait([this](const ServerEndpoint::ErrorCode_t& ec)
+				{
+					if (!ec)
+						SendEvents();
+				});
+		}
+
+		int32_t NextSequence()
+		{
+			// sequences are 30 bits
+			m_sequence = (m_sequence + 1) & 0x3FFFFFFF;
+			return m_sequence;
+		}
+
+		ServerEndpoint& m_endpoint;
+		const double m_speed;
+		asio::steady_timer* m_pTimer = nullptr;
+		Clock_t::time_point m_start;
+
+		std::vector<RecordedEvent> m_events;
+		size_t m_nextEvent = 0;
+		int32_t m_sequence = 0;
+
+		// the full command, and then just its name if nothing matched
+		std::unordered_map<std::string, ResponseList> m_responsesByCommand;
+		std::unordered_map<std::string, ResponseList> m_responsesByName;
+
+		size_t m_acknowledgedEvents = 0;
+		size_t m_exactResponses = 0;
+		size_t m_nameResponses = 0;
+		size_t m_unknownCommands = 0;
+		size_t m_badFrames = 0;
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: " << argv[0] << " [capture:string] [speed:double, 0 for lockstep] [plugins:string...]\n";
+		return 1;
+	}
+
+	const std::string capturePath = argv[1];
+	const double speed = std::max(atof(argv[2]), 0.0);
+
+	Server::Worker_t worker;
+	ServerEndpoint endpoint(worker);
+	asio::steady_timer eventTimer(worker);
+	asio::steady_timer finishTimer(worker);
+
+	Replayer replayer(endpoint, speed);
+	if (replayer.Load(capturePath) == false)
+		return 1;
+
+	Server server(worker);
+
+	// stand in for the server on a free local port
+	const ServerEndpoint::ErrorCode_t listenEc = endpoint.Listen(ServerEndpoint::Endpoint_t(asio::ip::address_v4::loopback(), 0),
+		[&replayer, &eventTimer]()
+		{
+			replayer.Start(eventTimer);
+		},
+		[&replayer, &server, &finishTimer](const Packet& packet)
+		{
+			replayer.HandlePacket(packet);
+
+			// give plugins a second to finish with the last event
+			if (replayer.IsFinished() == true &&
+				finishTimer.expiry() == asio::steady_timer::time_point{})
+			{
+				finishTimer.expires_after(std::chrono::seconds(1));
+				finishTimer.async_wait([&server](const Server::ErrorCode_t& ec)
+					{
+						if (!ec)
+							server.Disconnect();
+					});
+			}
+		},
+		[](const ServerEndpoint::ErrorCode_t&) {});
+
+	if (listenEc)
+	{
+		BetteRCon::Internal::g_stdErrLog << "Failed to listen: " << listenEc.message() << '\n';
+		return 1;
+	}
+
+	server.AsyncConnect(endpoint.GetLocalEndpoint(),
+		[&server, &endpoint, argc, argv](const Server::ErrorCode_t& ec)
+		{
+			if (ec)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Failed to connect: " << ec.message() << '\n';
+				endpoint.Close();
+				return;
+			}
+
+			// the capture answers the login, whatever the password
+			server.AsyncLogin("replay", [&server](const Server::LoginResult loginRes)
+				{
+					if (loginRes != Server::LoginResult_OK)
+					{
+						BetteRCon::Internal::g_stdErrLog << "Failed to login to the replay: " << Server::s_LoginResultStr[loginRes] << '\n';
+						server.Disconnect();
+					}
+				},
+				[&server, argc, argv]()
+				{
+					for (int i = 3; i < argc; ++i)
+					{
+						if (server.EnablePlugin(argv[i]) == true)
+							BetteRCon::Internal::g_stdOutLog << "Enabled plugin " << argv[i] << '\n';
+						else
+							BetteRCon::Internal::g_stdErrLog << "Failed to enable plugin " << argv[i] << '\n';
+					}
+				},
+					[](const std::string& pluginName, const bool load, const bool success, const std::string& failReason)
+				{
+					if (load == true &&
+						success == false)
+						BetteRCon::Internal::g_stdErrLog << "Failed to load plugin " << pluginName << ": " << failReason << '\n';
+				},
+					[](const std::vector<std::string>&) {},
+					[](const Server::ServerInfo&) {},
+					[](const Server::PlayerMap_t&, const Server::TeamMap_t&) {});
+		}, [&replayer, &endpoint, &eventTimer, &finishTimer](const Server::ErrorCode_t&)
+		{
+			replayer.PrintStats();
+
+			// nothing is left to keep the worker running
+			eventTimer.cancel();
+			finishTimer.cancel();
+			endpoint.Close();
+		});
+
+	worker.run();
+
+	return 0;
+}
@@ -18,6 +18,15 @@ public:
 		// register the join handler that will be called every time player.onJoin is fired
 		RegisterHandler("player.onJoin", std::bind(&SamplePlugin::HandleJoin, this, std::placeholders::_1));
 
+		// subscribe to players getting 5 kills per minute, which will be called again only after they cool down
+		BetteRCon::Server::KillThreshold_t killThreshold;
+		killThreshold.metric = BetteRCon::Internal::KillStream::Metric_KillsPerMinute;
+		killThreshold.value = 5.f;
+		SubscribeKillThreshold(killThreshold, [](const std::string& playerName, const BetteRCon::Server::KillStats_t& stats)
+		{
+			BetteRCon::Internal::g_stdOutLog << "[Sample Plugin]: " << playerName << " is on a streak with " << stats.killsPerMinute << " kills per minute\n";
+		});
+
 		// schedule an action for 1000 ms in the future, that will print that 1000 milliseconds have passed
 		ScheduleAction([] { BetteRCon::Internal::g_stdOutLog << "[Sample Plugin]: It has been 1000 milliseconds since creation\n"; }, 1000);
 
@@ -43,7 +52,7 @@ public:
 
 	virtual std::string_view GetPluginAuthor() const { return "MrElectrify"; }
 	virtual std::string_view GetPluginName() const { return "Sample Plugin"; }
-	virtual std::string_view GetPluginVersion() const { return "v1.0.1"; }
+	virtual std::string_view GetPluginVersion() const { return "v1.0.2"; }
 
 	virtual void Enable()
 	{
@@ -83,22 +83,23 @@ int main(int argc, char* argv[])
 					},
 						[](const std::vector<std::string>& eventWords)
 					{
-						BetteRCon::Internal::g_stdOutLog << "Event " << eventWords.front() << ": ";
-
 						// special case for punkBuster.onMessage
 						if (eventWords.front() == "punkBuster.onMessage")
 						{
 							auto& message = eventWords.at(1);
-							std::cout << message.substr(0, message.size() - 1) << '\n';
+							BetteRCon::Internal::g_stdOutLog << "Event " << eventWords.front() << ": " << std::string_view(message).substr(0, message.size() - 1) << '\n';
 							return;
 						}
 
-						// print out the event for debugging
+						// print out the event for debugging, as one line so that it isn't split up by other lines
+						std::string eventLine;
 						for (size_t i = 1; i < eventWords.size(); ++i)
 						{
-							std::cout << eventWords.at(i) << ' ';
+							eventLine += eventWords.at(i);
+							eventLine += ' ';
 						}
-						std::cout << '\n';
+
+						BetteRCon::Internal::g_stdOutLog << "Event " << eventWords.front() << ": " << eventLine << '\n';
 					},
 						[](const Server::ServerInfo& serverInfo)
 					{
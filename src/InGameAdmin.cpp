@@ -1,4 +1,6 @@
 #include <BetteRCon/Plugin.h>
+#include <BetteRCon/Internal/EditDistance.h>
+#include <BetteRCon/Internal/Serialization.h>
 
 // STL
 #include <algorithm>
@@ -17,6 +19,8 @@
 #include <Windows.h>
 #endif
 
+using BetteRCon::Internal::LevenshteinDistance;
+
 // A set of in-game commands including admin commands.
 class InGameAdmin : public BetteRCon::Plugin
 {
@@ -58,6 +62,9 @@ public:
 		// read the player information flatfile database
 		ReadAdminDatabase();
 
+		// pick up admins that are added or removed while we are running
+		WatchFile("plugins/Admins.cfg", std::bind(&InGameAdmin::HandleAdminDatabaseChanged, this, std::placeholders::_1));
+
 		// register commands
 		RegisterCommand("ban", std::bind(&InGameAdmin::HandleBan, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
 		RegisterCommand("find", std::bind(&InGameAdmin::HandleFind, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -76,16 +83,24 @@ public:
 		RegisterHandler("player.onKill", std::bind(&InGameAdmin::HandleOnKill, this, std::placeholders::_1));
 		RegisterHandler("player.onLeave", std::bind(&InGameAdmin::HandleOnKill, this, std::placeholders::_1));
 		RegisterHandler("player.onTeamChange", std::bind(&InGameAdmin::HandleOnTeamSwitch, this, std::placeholders::_1));
-		RegisterHandler("server.onLevelLoaded", std::bind(&InGameAdmin::HandleOnLevelLoaded, this, std::placeholders::_1));
 	}
 
 	virtual std::string_view GetPluginAuthor() const { return "MrElectrify"; }
 	virtual std::string_view GetPluginName() const { return "InGameAdmin"; }
-	virtual std::string_view GetPluginVersion() const { return "v1.0.1"; }
+	virtual std::string_view GetPluginVersion() const { return "v1.0.3"; }
 
 	virtual void Enable() { Plugin::Enable(); ReadAdminDatabase(); ReadBanDatabase(); }
 
-	virtual void Disable() { Plugin::Disable(); WriteAdminDatabase(); WriteBanDatabase(); }
+	virtual void Disable()
+	{
+		// a plugin that disabled itself because it couldn't read the ban database must not write over it
+		if (IsEnabled() == false)
+			return;
+
+		Plugin::Disable();
+		WriteAdminDatabase();
+		WriteBanDatabase();
+	}
 
 	virtual ~InGameAdmin() {}
 private:
@@ -155,130 +170,143 @@ private:
 		outFile.close();
 	}
 	
-	void ReadBanDatabase() 
-	{
-		// try to open the file
-		std::ifstream inFile("plugins/Bans.db", std::ios::binary);
-		if (inFile.good() == false)
-			return;
-
-		// read the file
-		std::vector<char> dbFile(std::istreambuf_iterator<char>(inFile), {});
-
-		// read the size
-		const uint32_t banCount = *reinterpret_cast<uint32_t*>(&dbFile[0]);
-		
-		size_t offset = sizeof(uint32_t);
+	static constexpr uint32_t s_banDatabaseTag = BetteRCon::Internal::MakeSchemaTag("BANS");
+	static constexpr uint32_t s_banDatabaseVersion = 1;
 
-		const auto readString = [&dbFile, &offset]() -> std::string
+	// reads a ban in either format. the old format has one-byte string lengths and a raw time_t
+	static std::shared_ptr<BannedPlayer> ReadBan(BetteRCon::Internal::RecordReader& reader, const bool legacy)
+	{
+		const auto readString = [&reader, legacy]() -> std::string
 		{
-			// read the string size
-			const uint8_t strLen = static_cast<uint8_t>(dbFile[offset]);
-			++offset;
-
-			// read the string
-			std::string res(&dbFile[offset], strLen);
-			offset += strLen;
-
-			return res;
+			return std::string((legacy == true) ? reader.ReadView(reader.Read<uint8_t>()) : reader.ReadString());
 		};
-		
-		const auto readStrVec = [&dbFile, &offset, &readString]() -> std::vector<std::string>
+
+		const auto readStrVec = [&reader, &readString]() -> std::vector<std::string>
 		{
-			// read the vector size
-			const uint32_t vecLen = *reinterpret_cast<uint32_t*>(&dbFile[offset]);
-			offset += sizeof(uint32_t);
+			// don't trust the count to reserve, it might be garbage
+			const uint32_t vecLen = reader.Read<uint32_t>();
 
-			// read each string
 			std::vector<std::string> res;
-			for (uint32_t i = 0; i < vecLen; ++i)
+			for (uint32_t i = 0; i < vecLen && reader.IsGood() == true; ++i)
 				res.push_back(readString());
 
 			return res;
 		};
-		
-		for (uint32_t i = 0; i < banCount; ++i)
-		{
-			// naive bounds check
-			if (offset >= dbFile.size())
-			{
-				BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Invalid DB\n";
-				return;
-			}
 
-			const std::vector<std::string> names = readStrVec();
-			const std::vector<std::string> guids = readStrVec();
-			const std::vector<std::string> ips = readStrVec();
-			const std::string reason = readString();
+		std::shared_ptr<BannedPlayer> pBannedPlayer = std::make_shared<BannedPlayer>();
+		pBannedPlayer->names = readStrVec();
+		pBannedPlayer->guids = readStrVec();
+		pBannedPlayer->ips = readStrVec();
+		pBannedPlayer->reason = readString();
+		pBannedPlayer->perm = reader.Read<uint8_t>() != 0;
+		pBannedPlayer->expiry = reader.ReadTimePoint();
 
-			const bool perm = static_cast<bool>(dbFile[offset]);
-			++offset;
+		if (reader.IsGood() == false)
+			return nullptr;
+
+		return pBannedPlayer;
+	}
 
-			const std::chrono::system_clock::time_point tp = std::chrono::system_clock::from_time_t(*reinterpret_cast<time_t*>(&dbFile[offset]));
-			offset += sizeof(time_t);
+	void ReadBanDatabase() 
+	{
+		BetteRCon::Internal::DatabaseReader dbReader;
+		const BetteRCon::Internal::DatabaseReader::Status status = dbReader.Open("plugins/Bans.db", s_banDatabaseTag, s_banDatabaseVersion);
+		if (status == BetteRCon::Internal::DatabaseReader::Status_NotFound)
+			return;
 
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+		const auto addBan = [this, now](std::shared_ptr<BannedPlayer>&& pBannedPlayer)
+		{
 			// see if the ban already expired
-			if (perm == false &&
-				std::chrono::system_clock::now() >= tp)
-				continue;
+			if (pBannedPlayer->perm == false &&
+				now >= pBannedPlayer->expiry)
+				return;
 
-			// add the ban to the databases
-			std::shared_ptr<BannedPlayer> pBannedPlayer = std::make_shared<BannedPlayer>(BannedPlayer{ std::move(names), std::move(guids), std::move(ips), std::move(reason), perm, tp });
 			AddBan(std::move(pBannedPlayer));
+		};
+
+		if (status == BetteRCon::Internal::DatabaseReader::Status_BadHeader)
+		{
+			// a database from before the shared format
+			BetteRCon::Internal::RecordReader reader = dbReader.GetRawReader();
+
+			const uint32_t banCount = reader.Read<uint32_t>();
+			for (uint32_t i = 0; i < banCount && reader.IsGood() == true; ++i)
+			{
+				std::shared_ptr<BannedPlayer> pBannedPlayer = ReadBan(reader, true);
+				if (pBannedPlayer == nullptr)
+				{
+					BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Invalid DB\n";
+					break;
+				}
+
+				addBan(std::move(pBannedPlayer));
+			}
+		}
+		else if (status == BetteRCon::Internal::DatabaseReader::Status_OK)
+		{
+			// one record per ban
+			BetteRCon::Internal::RecordReader record;
+			while (dbReader.Next(record) == true)
+			{
+				std::shared_ptr<BannedPlayer> pBannedPlayer = ReadBan(record, false);
+				if (pBannedPlayer == nullptr)
+				{
+					BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Malformed ban record\n";
+					continue;
+				}
+
+				addBan(std::move(pBannedPlayer));
+			}
+
+			if (dbReader.GetStatus() != BetteRCon::Internal::DatabaseReader::Status_OK)
+				BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Stopped reading DB: " << BetteRCon::Internal::DatabaseReader::s_StatusStr[dbReader.GetStatus()] << '\n';
+		}
+		else
+		{
+			// don't overwrite a database we can't read. Bans would be added to a partial list and written over it, so stop here
+			BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Failed to open DB, disabling: " << BetteRCon::Internal::DatabaseReader::s_StatusStr[status] << '\n';
+			Plugin::Disable();
+			return;
 		}
 
-		inFile.close();
 		// write the database to reflect removed bans
 		WriteBanDatabase();
 	}
 	void WriteBanDatabase() 
 	{
-		// try to open the ban database
-		std::ofstream outFile("plugins/Bans.db", std::ios::binary);
-		if (outFile.good() == false)
+		BetteRCon::Internal::DatabaseWriter dbWriter;
+		if (dbWriter.Create("plugins/Bans.db", s_banDatabaseTag, s_banDatabaseVersion) == false)
+		{
+			BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Failed to open DB for writing\n";
 			return;
+		}
 
-		// write the ban database size
-		std::vector<char> dbData(sizeof(uint32_t));
-		*reinterpret_cast<uint32_t*>(&dbData[0]) = m_bans.size();
+		BetteRCon::Internal::RecordWriter record;
 
-		const auto writeString = [&dbData](const std::string& str)
+		const auto writeStrVec = [&record](const std::vector<std::string>& vec)
 		{
-			// write the size
-			dbData.push_back(str.size() & 0xff);
-			// write the string
-			dbData.insert(dbData.end(), str.begin(), str.end());
-		};
-
-		const auto writeStrVec = [&dbData, &writeString](const std::vector<std::string>& vec)
-		{
-			// write the size
-			dbData.resize(dbData.size() + sizeof(uint32_t));
-			*reinterpret_cast<uint32_t*>(&dbData[dbData.size() - sizeof(uint32_t)]) = vec.size();
-
-			// write each string
+			record.Write(static_cast<uint32_t>(vec.size()));
 			for (const std::string& str : vec)
-				writeString(str);
+				record.WriteString(str);
 		};
 
-		// write each ban
+		// stream one record per ban
 		for (const BanSet_t::value_type& pBannedPlayer : m_bans)
 		{
+			record.Clear();
 			writeStrVec(pBannedPlayer->names);
 			writeStrVec(pBannedPlayer->guids);
 			writeStrVec(pBannedPlayer->ips);
-			writeString(pBannedPlayer->reason);
+			record.WriteString(pBannedPlayer->reason);
+			record.Write(static_cast<uint8_t>(pBannedPlayer->perm));
+			record.WriteTimePoint(pBannedPlayer->expiry);
 
-			dbData.push_back(pBannedPlayer->perm);
-
-			dbData.resize(dbData.size() + sizeof(time_t));
-			*reinterpret_cast<time_t*>(&dbData[dbData.size() - sizeof(time_t)]) = std::chrono::system_clock::to_time_t(pBannedPlayer->expiry);
+			dbWriter.WriteRecord(record);
 		}
 
-		// write the db
-		outFile.write(dbData.data(), dbData.size());
-		// close the file
-		outFile.close();
+		if (dbWriter.Commit() == false)
+			BetteRCon::Internal::g_stdErrLog << "[InGameAdmin] Failed to write DB\n";
 	}
 
 	bool IsAdmin(const std::shared_ptr<PlayerInfo_t>& pPlayer) const
@@ -351,40 +379,22 @@ private:
 		return pBannedPlayer;
 	}
 
-	// Credits to AdKats and those who Col gave credit to
-	static size_t LevenshteinDistance(std::string s, std::string t)
+	// Finds the in-game player whose name best matches, using the server's name index and falling back to edit distance for typos
+	std::shared_ptr<PlayerInfo_t> FuzzyMatchPlayer(const std::string& playerName) const
 	{
-		std::transform(s.begin(), s.end(), s.begin(), [](char& c) { return std::tolower(c); });
-		std::transform(t.begin(), t.end(), t.begin(), [](char& c) { return std::tolower(c); });
-		size_t n = s.size();
-		size_t m = t.size();
-		std::vector<std::vector<size_t>> d(n + 1, std::vector<size_t>(m + 1));
-		if (n == 0)
-		{
-			return m;
-		}
-		if (m == 0)
-		{
-			return n;
-		}
-		for (size_t i = 0; i <= n;)
-		{
-			d[i][0] = i;
-			++i;
-		}
-		for (size_t j = 0; j <= m;)
-		{
-			d[0][j] = j;
-			++j;
-		}
-		for (size_t i = 1; i <= n; i++)
+		const std::vector<std::shared_ptr<PlayerInfo_t>> matches = FindPlayers(playerName, 1);
+		if (matches.empty() == false)
+			return matches.front();
+
+		const PlayerMap_t& players = GetPlayers();
+		if (players.empty() == true)
+			return nullptr;
+
+		return std::min_element(players.begin(), players.end(),
+			[&playerName](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
 		{
-			for (size_t j = 1; j <= m; j++)
-			{
-				d[i][j] = std::min(std::min(d[i - 1][j] + 1, d[i][j - 1] + 0), d[i - 1][j - 1] + ((t[j - 1] == s[i - 1]) ? 0 : 1));
-			}
-		}
-		return d[n][m];
+			return LevenshteinDistance(playerName, left.second->name) < LevenshteinDistance(playerName, right.second->name);
+		})->second;
 	}
 
 	void ProcessMoveQueue()
@@ -687,10 +697,47 @@ private:
 		CheckQueue(m_moveQueue);
 	}
 
-	void HandleOnLevelLoaded(const std::vector<std::string>& eventArgs)
+	void HandleAdminDatabaseChanged(const BetteRCon::Server::FileDiff_t& diff)
 	{
-		// read the admin database
-		ReadAdminDatabase();
+		// splits an admin line into the name and guid
+		const auto splitAdminLine = [](const std::string& adminLine, std::string& adminName, std::string& adminGUID)
+		{
+			const size_t comma = adminLine.find(',');
+			if (comma == std::string::npos)
+				return false;
+
+			adminName = adminLine.substr(0, comma);
+			adminGUID = adminLine.substr(comma + 1);
+			return true;
+		};
+
+		std::string adminName, adminGUID;
+
+		// remove first, so that an edited line replaces the old admin
+		for (const std::string& adminLine : diff.removedLines)
+		{
+			if (splitAdminLine(adminLine, adminName, adminGUID) == false)
+				continue;
+
+			m_adminNames.erase(adminName);
+			m_adminGUIDs.erase(adminGUID);
+		}
+
+		for (const std::string& adminLine : diff.addedLines)
+		{
+			if (splitAdminLine(adminLine, adminName, adminGUID) == false)
+			{
+				BetteRCon::Internal::g_stdErrLog << "Failed to find comma for admin " << adminLine << '\n';
+				continue;
+			}
+
+			const std::shared_ptr<Admin> pAdmin = std::make_shared<Admin>(Admin{ std::move(adminName), std::move(adminGUID) });
+
+			m_adminNames.insert_or_assign(pAdmin->name, pAdmin);
+			m_adminGUIDs.insert_or_assign(pAdmin->guid, std::move(pAdmin));
+		}
+
+		BetteRCon::Internal::g_stdOutLog << "[InGameAdmin] Admins changed: " << diff.addedLines.size() << " added, " << diff.removedLines.size() << " removed\n";
 	}
 
 	void HandleBan(const std::shared_ptr<PlayerInfo_t>& pPlayer, const std::vector<std::string>& args, const char prefix)
@@ -717,11 +764,12 @@ private:
 		if (targetIt == players.end())
 		{
 			// find a fuzzy match
-			const std::shared_ptr<PlayerInfo_t>& pTarget = std::min_element(players.begin(), players.end(),
-				[&targetPlayer](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
+			const std::shared_ptr<PlayerInfo_t> pTarget = FuzzyMatchPlayer(targetPlayer);
+			if (pTarget == nullptr)
 			{
-				return LevenshteinDistance(targetPlayer, left.second->name) < LevenshteinDistance(targetPlayer, right.second->name);
-			})->second;
+				SendChatMessage("Player " + targetPlayer + " was not found!", pPlayer);
+				return;
+			}
 
 			std::vector<std::string> fuzzyArgs(args);
 			fuzzyArgs[1] = pTarget->name;
@@ -862,11 +910,12 @@ private:
 		if (targetIt == players.end())
 		{
 			// find a fuzzy match
-			const std::shared_ptr<PlayerInfo_t>& pTarget = std::min_element(players.begin(), players.end(),
-				[&targetPlayer](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
+			const std::shared_ptr<PlayerInfo_t> pTarget = FuzzyMatchPlayer(targetPlayer);
+			if (pTarget == nullptr)
 			{
-				return LevenshteinDistance(targetPlayer, left.second->name) < LevenshteinDistance(targetPlayer, right.second->name);
-			})->second;
+				SendChatMessage("Player " + targetPlayer + " was not found!", pPlayer);
+				return;
+			}
 
 			std::vector<std::string> fuzzyArgs(args);
 			fuzzyArgs[1] = pTarget->name;
@@ -940,11 +989,12 @@ private:
 		if (targetIt == players.end())
 		{
 			// find a fuzzy match
-			const std::shared_ptr<PlayerInfo_t>& pTarget = std::min_element(players.begin(), players.end(),
-				[&targetPlayer](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
+			const std::shared_ptr<PlayerInfo_t> pTarget = FuzzyMatchPlayer(targetPlayer);
+			if (pTarget == nullptr)
 			{
-				return LevenshteinDistance(targetPlayer, left.second->name) < LevenshteinDistance(targetPlayer, right.second->name);
-			})->second;
+				SendChatMessage("Player " + targetPlayer + " was not found!", pPlayer);
+				return;
+			}
 
 			std::vector<std::string> fuzzyArgs(args);
 			fuzzyArgs[1] = pTarget->name;
@@ -993,11 +1043,12 @@ private:
 		if (targetIt == players.end())
 		{
 			// find a fuzzy match
-			const std::shared_ptr<PlayerInfo_t>& pTarget = std::min_element(players.begin(), players.end(),
-				[&targetPlayer](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
+			const std::shared_ptr<PlayerInfo_t> pTarget = FuzzyMatchPlayer(targetPlayer);
+			if (pTarget == nullptr)
 			{
-				return LevenshteinDistance(targetPlayer, left.second->name) < LevenshteinDistance(targetPlayer, right.second->name);
-			})->second;
+				SendChatMessage("Player " + targetPlayer + " was not found!", pPlayer);
+				return;
+			}
 
 			std::vector<std::string> fuzzyArgs(args);
 			fuzzyArgs[1] = pTarget->name;
@@ -1053,11 +1104,12 @@ private:
 		if (targetIt == players.end())
 		{
 			// find a fuzzy match
-			const std::shared_ptr<PlayerInfo_t>& pTarget = std::min_element(players.begin(), players.end(),
-				[&targetPlayer](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
+			const std::shared_ptr<PlayerInfo_t> pTarget = FuzzyMatchPlayer(targetPlayer);
+			if (pTarget == nullptr)
 			{
-				return LevenshteinDistance(targetPlayer, left.second->name) < LevenshteinDistance(targetPlayer, right.second->name);
-			})->second;
+				SendChatMessage("Player " + targetPlayer + " was not found!", pPlayer);
+				return;
+			}
 
 			std::vector<std::string> fuzzyArgs(args);
 			fuzzyArgs[1] = pTarget->name;
@@ -1129,11 +1181,12 @@ private:
 		if (targetIt == players.end())
 		{
 			// find a fuzzy match
-			const std::shared_ptr<PlayerInfo_t>& pTarget = std::min_element(players.begin(), players.end(),
-				[&targetPlayer](const PlayerMap_t::value_type& left, const PlayerMap_t::value_type& right)
+			const std::shared_ptr<PlayerInfo_t> pTarget = FuzzyMatchPlayer(targetPlayer);
+			if (pTarget == nullptr)
 			{
-				return LevenshteinDistance(targetPlayer, left.second->name) < LevenshteinDistance(targetPlayer, right.second->name);
-			})->second;
+				SendChatMessage("Player " + targetPlayer + " was not found!", pPlayer);
+				return;
+			}
 
 			std::vector<std::string> fuzzyArgs(args);
 			fuzzyArgs[1] = pTarget->name;
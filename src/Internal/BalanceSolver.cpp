@@ -0,0 +1,357 @@
+#include <BetteRCon/Internal/BalanceSolver.h>
+
+#include <algorithm>
+#include <tuple>
+
+using BetteRCon::Internal::BalanceSolver;
+
+void BalanceSolver::Clear()
+{
+	m_teams.clear();
+	m_players.clear();
+	m_requests.clear();
+}
+
+void BalanceSolver::AddTeam(const uint8_t teamId)
+{
+	if (FindTeam(teamId) != SIZE_MAX)
+		return;
+
+	TeamState team;
+	team.teamId = teamId;
+	m_teams.push_back(team);
+}
+
+size_t BalanceSolver::AddPlayer(const Player& player)
+{
+	AddTeam(player.teamId);
+
+	TeamState& team = m_teams[FindTeam(player.teamId)];
+	team.strength += player.strength;
+	++team.size;
+
+	if (player.squadId != 0 &&
+		player.squadId <= s_maxSquadId)
+		team.usedSquads.set(player.squadId);
+
+	m_players.push_back(player);
+	return m_players.size() - 1;
+}
+
+void BalanceSolver::RequestMove(const size_t playerIndex, const uint8_t teamId)
+{
+	AddTeam(teamId);
+	m_requests.emplace_back(playerIndex, teamId);
+}
+
+void BalanceSolver::Solve(const Options& options, Plan& planOut)
+{
+	planOut.moves.clear();
+	planOut.strengthRatioBefore = GetStrengthRatio(SIZE_MAX, SIZE_MAX, 0.f);
+
+	m_locked.assign(m_players.size(), false);
+
+	// requested moves come first. they are only planned if they don't push the teams further out of balance
+	for (const std::pair<size_t, uint8_t>& request : m_requests)
+	{
+		const size_t playerIndex = request.first;
+		if (playerIndex >= m_players.size() ||
+			m_locked[playerIndex] == true)
+			continue;
+
+		Player& player = m_players[playerIndex];
+		if (player.movable == false)
+			continue;
+
+		const size_t fromTeam = FindTeam(player.teamId);
+		const size_t toTeam = FindTeam(request.second);
+		if (fromTeam == toTeam)
+			continue;
+
+		if (IsAllowed(options, fromTeam, toTeam, 1) == false)
+			continue;
+
+		const float strengthRatio = GetStrengthRatio(SIZE_MAX, SIZE_MAX, 0.f);
+		if (GetStrengthRatio(fromTeam, toTeam, player.strength) > std::max(options.maxStrengthRatio, strengthRatio))
+			continue;
+
+		m_teams[fromTeam].strength -= player.strength;
+		--m_teams[fromTeam].size;
+		m_teams[toTeam].strength += player.strength;
+		++m_teams[toTeam].size;
+
+		player.teamId = request.second;
+		player.squadId = 0;
+		m_locked[playerIndex] = true;
+
+		planOut.moves.push_back(Move{ playerIndex, request.second, s_anySquad, true });
+	}
+
+	BuildUnits(options);
+	m_unitMoved.assign(m_units.size(), false);
+
+	// now move or swap units between the strongest and weakest team until they are balanced
+	size_t balanceMoves = 0;
+	while (m_teams.size() > 1)
+	{
+		const float strengthRatio = GetStrengthRatio(SIZE_MAX, SIZE_MAX, 0.f);
+		if (strengthRatio <= options.maxStrengthRatio)
+			break;
+
+		const std::vector<TeamState>::const_iterator strongestIt = std::max_element(m_teams.begin(), m_teams.end(),
+			[](const TeamState& first, const TeamState& second) { return first.strength < second.strength; });
+		const std::vector<TeamState>::const_iterator weakestIt = std::min_element(m_teams.begin(), m_teams.end(),
+			[](const TeamState& first, const TeamState& second) { return first.strength < second.strength; });
+
+		const size_t strongTeam = strongestIt - m_teams.begin();
+		const size_t weakTeam = weakestIt - m_teams.begin();
+
+		// the cheapest candidate that balances the teams, otherwise the one that improves them the most
+		Candidate best{ SIZE_MAX, SIZE_MAX, 0, strengthRatio };
+		bool bestBalances = false;
+
+		const auto consider = [&](const size_t strongUnit, const size_t weakUnit, const uint32_t cost, const int32_t sizeChange, const float strengthChange)
+		{
+			if (cost > options.maxBalanceMoves - balanceMoves)
+				return;
+
+			if (IsAllowed(options, strongTeam, weakTeam, sizeChange) == false)
+				return;
+
+			const float candidateRatio = GetStrengthRatio(strongTeam, weakTeam, strengthChange);
+			const bool balances = candidateRatio <= options.maxStrengthRatio;
+
+			bool better;
+			if (balances == true)
+				better = bestBalances == false || std::tie(cost, candidateRatio) < std::tie(best.cost, best.strengthRatio);
+			else
+				better = bestBalances == false && (candidateRatio < best.strengthRatio ||
+					(best.strongUnit != SIZE_MAX && candidateRatio == best.strengthRatio && cost < best.cost));
+
+			if (better == false)
+				return;
+
+			best = Candidate{ strongUnit, weakUnit, cost, candidateRatio };
+			bestBalances = balances;
+		};
+
+		for (size_t strongUnit = 0; strongUnit < m_units.size(); ++strongUnit)
+		{
+			const Unit& strong = m_units[strongUnit];
+			if (strong.teamIndex != strongTeam ||
+				m_unitMoved[strongUnit] == true)
+				continue;
+
+			// move the unit to the weak team
+			consider(strongUnit, SIZE_MAX, strong.size, static_cast<int32_t>(strong.size), strong.strength);
+
+			// or swap it with a unit from the weak team
+			for (size_t weakUnit = 0; weakUnit < m_units.size(); ++weakUnit)
+			{
+				const Unit& weak = m_units[weakUnit];
+				if (weak.teamIndex != weakTeam ||
+					m_unitMoved[weakUnit] == true ||
+					weak.strength >= strong.strength)
+					continue;
+
+				consider(strongUnit, weakUnit, strong.size + weak.size, static_cast<int32_t>(strong.size) - static_cast<int32_t>(weak.size), strong.strength - weak.strength);
+			}
+		}
+
+		// nothing helps
+		if (best.strongUnit == SIZE_MAX)
+			break;
+
+		MoveUnit(best.strongUnit, weakTeam, planOut);
+		if (best.weakUnit != SIZE_MAX)
+			MoveUnit(best.weakUnit, strongTeam, planOut);
+
+		balanceMoves += best.cost;
+	}
+
+	planOut.strengthRatioAfter = GetStrengthRatio(SIZE_MAX, SIZE_MAX, 0.f);
+	planOut.balanced = planOut.strengthRatioAfter <= options.maxStrengthRatio;
+}
+
+float BalanceSolver::GetStrengthRatio(const float strongest, const float weakest) noexcept
+{
+	if (weakest <= 0.f)
+		return (strongest <= 0.f) ? 1.f : std::numeric_limits<float>::infinity();
+
+	return strongest / weakest;
+}
+
+size_t BalanceSolver::FindTeam(const uint8_t teamId) const noexcept
+{
+	for (size_t i = 0; i < m_teams.size(); ++i)
+	{
+		if (m_teams[i].teamId == teamId)
+			return i;
+	}
+
+	return SIZE_MAX;
+}
+
+float BalanceSolver::GetStrengthRatio(const size_t fromTeam, const size_t toTeam, const float strengthChange) const noexcept
+{
+	if (m_teams.size() < 2)
+		return 1.f;
+
+	float strongest = -std::numeric_limits<float>::infinity();
+	float weakest = std::numeric_limits<float>::infinity();
+	for (size_t i = 0; i < m_teams.size(); ++i)
+	{
+		float strength = m_teams[i].strength;
+		if (i == fromTeam)
+			strength -= strengthChange;
+		if (i == toTeam)
+			strength += strengthChange;
+
+		strongest = std::max(strongest, strength);
+		weakest = std::min(weakest, strength);
+	}
+
+	return GetStrengthRatio(strongest, weakest);
+}
+
+bool BalanceSolver::IsAllowed(const Options& options, const size_t fromTeam, const size_t toTeam, const int32_t sizeChange) const noexcept
+{
+	int64_t largest = INT64_MIN;
+	int64_t smallest = INT64_MAX;
+	int64_t largestBefore = INT64_MIN;
+	int64_t smallestBefore = INT64_MAX;
+	for (size_t i = 0; i < m_teams.size(); ++i)
+	{
+		const int64_t sizeBefore = m_teams[i].size;
+		int64_t size = sizeBefore;
+		if (i == fromTeam)
+			size -= sizeChange;
+		if (i == toTeam)
+			size += sizeChange;
+
+		// a team that grows must have room
+		if (size > sizeBefore &&
+			size > options.maxTeamSize)
+			return false;
+
+		largest = std::max(largest, size);
+		smallest = std::min(smallest, size);
+		largestBefore = std::max(largestBefore, sizeBefore);
+		smallestBefore = std::min(smallestBefore, sizeBefore);
+	}
+
+	return largest - smallest <= std::max<int64_t>(options.maxTeamSizeDifference, largestBefore - smallestBefore);
+}
+
+void BalanceSolver::BuildUnits(const Options& options)
+{
+	m_units.clear();
+	m_unitMembers.clear();
+
+	// players that were already moved stay where they were requested, but don't hold back their squad
+	m_sortedPlayers.clear();
+	for (size_t i = 0; i < m_players.size(); ++i)
+	{
+		if (m_locked[i] == false)
+			m_sortedPlayers.push_back(i);
+	}
+
+	std::sort(m_sortedPlayers.begin(), m_sortedPlayers.end(), [this](const size_t first, const size_t second)
+	{
+		return std::tie(m_players[first].teamId, m_players[first].squadId) < std::tie(m_players[second].teamId, m_players[second].squadId);
+	});
+
+	for (size_t i = 0; i < m_sortedPlayers.size();)
+	{
+		const Player& first = m_players[m_sortedPlayers[i]];
+
+		// squads move together, and players without a squad move alone
+		size_t end = i + 1;
+		if (options.keepSquadsTogether == true &&
+			first.squadId != 0)
+		{
+			while (end < m_sortedPlayers.size() &&
+				m_players[m_sortedPlayers[end]].teamId == first.teamId &&
+				m_players[m_sortedPlayers[end]].squadId == first.squadId)
+				++end;
+		}
+
+		Unit unit{ FindTeam(first.teamId), (options.keepSquadsTogether == true) ? first.squadId : uint8_t{ 0 }, 0.f, 0, m_unitMembers.size() };
+
+		bool movable = true;
+		for (size_t j = i; j < end; ++j)
+		{
+			const Player& member = m_players[m_sortedPlayers[j]];
+			movable = movable && member.movable;
+
+			unit.strength += member.strength;
+			++unit.size;
+			m_unitMembers.push_back(m_sortedPlayers[j]);
+		}
+
+		// a squad with a player that can't move stays where it is
+		if (movable == true)
+			m_units.push_back(unit);
+		else
+			m_unitMembers.resize(unit.firstMember);
+
+		i = end;
+	}
+}
+
+uint8_t BalanceSolver::TakeSquad(TeamState& team, const uint8_t preferredSquadId)
+{
+	if (preferredSquadId != 0 &&
+		preferredSquadId <= s_maxSquadId &&
+		team.usedSquads.test(preferredSquadId) == false)
+	{
+		team.usedSquads.set(preferredSquadId);
+		return preferredSquadId;
+	}
+
+	for (uint8_t squadId = 1; squadId <= s_maxSquadId; ++squadId)
+	{
+		if (team.usedSquads.test(squadId) == false)
+		{
+			team.usedSquads.set(squadId);
+			return squadId;
+		}
+	}
+
+	// every squad is taken, so the members will have to be split up
+	return s_anySquad;
+}
+
+void BalanceSolver::MoveUnit(const size_t unitIndex, const size_t toTeam, Plan& planOut)
+{
+	Unit& unit = m_units[unitIndex];
+	TeamState& from = m_teams[unit.teamIndex];
+	TeamState& to = m_teams[toTeam];
+
+	from.strength -= unit.strength;
+	from.size -= unit.size;
+	to.strength += unit.strength;
+	to.size += unit.size;
+
+	// a whole squad keeps its squad on the new team if it can
+	uint8_t squadId = s_anySquad;
+	if (unit.squadId != 0)
+	{
+		if (unit.squadId <= s_maxSquadId)
+			from.usedSquads.reset(unit.squadId);
+
+		squadId = TakeSquad(to, unit.squadId);
+	}
+
+	for (size_t i = unit.firstMember; i < unit.firstMember + unit.size; ++i)
+	{
+		Player& member = m_players[m_unitMembers[i]];
+		member.teamId = to.teamId;
+		member.squadId = (squadId != s_anySquad) ? squadId : 0;
+
+		planOut.moves.push_back(Move{ m_unitMembers[i], to.teamId, squadId, false });
+	}
+
+	unit.teamIndex = toTeam;
+	m_unitMoved[unitIndex] = true;
+}
@@ -0,0 +1,214 @@
+#include <BetteRCon/Internal/ChatFilter.h>
+
+#include <utility>
+
+using BetteRCon::Internal::ChatFilter;
+
+const std::array<uint8_t, 256> ChatFilter::s_symbols = []()
+{
+	std::array<uint8_t, 256> symbols{};
+
+	for (char c = 'a'; c <= 'z'; ++c)
+	{
+		symbols[static_cast<uint8_t>(c)] = static_cast<uint8_t>(1 + c - 'a');
+		symbols[static_cast<uint8_t>(c - 'a' + 'A')] = static_cast<uint8_t>(1 + c - 'a');
+	}
+
+	for (char c = '0'; c <= '9'; ++c)
+		symbols[static_cast<uint8_t>(c)] = static_cast<uint8_t>(27 + c - '0');
+
+	// leetspeak
+	constexpr std::pair<char, char> leetspeak[] = { { '0', 'o' }, { '1', 'i' }, { '3', 'e' }, { '4', 'a' }, { '5', 's' }, { '7', 't' }, { '8', 'b' }, { '@', 'a' }, { '$', 's' } };
+	for (const std::pair<char, char>& leet : leetspeak)
+		symbols[static_cast<uint8_t>(leet.first)] = symbols[static_cast<uint8_t>(leet.second)];
+
+	return symbols;
+}();
+
+size_t ChatFilter::Compile(const std::vector<std::string>& patterns)
+{
+	Clear();
+
+	std::vector<uint8_t> symbols;
+	for (const std::string& text : patterns)
+	{
+		const uint32_t patternIndex = static_cast<uint32_t>(m_patterns.size());
+		Pattern& pattern = m_patterns.emplace_back(Pattern{ text, 0, true, true, UINT32_MAX });
+
+		// a * lets that side match inside a word
+		std::string_view patternText = text;
+		if (patternText.empty() == false &&
+			patternText.front() == '*')
+		{
+			pattern.wholeWordStart = false;
+			patternText.remove_prefix(1);
+		}
+
+		if (patternText.empty() == false &&
+			patternText.back() == '*')
+		{
+			pattern.wholeWordEnd = false;
+			patternText.remove_suffix(1);
+		}
+
+		// fold it the same way messages are, without separators on either end
+		symbols.clear();
+		for (const char c : patternText)
+		{
+			const uint8_t symbol = GetSymbol(c);
+			if (symbol == s_separator &&
+				(symbols.empty() == true || symbols.back() == s_separator))
+				continue;
+
+			symbols.push_back(symbol);
+		}
+
+		if (symbols.empty() == false &&
+			symbols.back() == s_separator)
+			symbols.pop_back();
+
+		if (symbols.empty() == true)
+			continue;
+
+		uint32_t node = 0;
+		for (const uint8_t symbol : symbols)
+		{
+			uint32_t child = m_transitions[node * s_numSymbols + symbol];
+			if (child == 0)
+			{
+				child = static_cast<uint32_t>(m_nodes.size());
+				m_transitions[node * s_numSymbols + symbol] = child;
+
+				m_nodes.emplace_back();
+				m_transitions.resize(m_transitions.size() + s_numSymbols, 0);
+			}
+
+			node = child;
+		}
+
+		pattern.length = static_cast<uint32_t>(symbols.size());
+		pattern.nextPattern = m_nodes[node].pattern;
+		m_nodes[node].pattern = patternIndex;
+		++m_numCompiledPatterns;
+	}
+
+	Build();
+
+	return m_numCompiledPatterns;
+}
+
+void ChatFilter::Clear()
+{
+	m_patterns.clear();
+	m_nodes.assign(1, Node{});
+	m_transitions.assign(s_numSymbols, 0);
+	m_numCompiledPatterns = 0;
+}
+
+bool ChatFilter::IsEmpty() const noexcept
+{
+	return m_numCompiledPatterns == 0;
+}
+
+const std::string& ChatFilter::GetPattern(const uint32_t pattern) const noexcept
+{
+	return m_patterns[pattern].text;
+}
+
+bool ChatFilter::Scan(const std::string_view message, std::vector<Violation>& violationsOut) const
+{
+	violationsOut.clear();
+
+	if (IsEmpty() == true)
+		return false;
+
+	m_symbolOffsets.clear();
+
+	uint32_t node = 0;
+	for (size_t offset = 0; offset < message.size(); ++offset)
+	{
+		const uint8_t symbol = GetSymbol(message[offset]);
+
+		// runs of separators are read once, and never at the start
+		if (symbol == s_separator &&
+			(m_symbolOffsets.empty() == true || IsSeparator(message, m_symbolOffsets.back()) == true))
+			continue;
+
+		m_symbolOffsets.push_back(static_cast<uint32_t>(offset));
+		node = m_transitions[node * s_numSymbols + symbol];
+
+		// walk every node down the failure links where a pattern ends
+		for (uint32_t outputNode = (m_nodes[node].pattern != UINT32_MAX) ? node : m_nodes[node].outputLink; outputNode != 0; outputNode = m_nodes[outputNode].outputLink)
+		{
+			for (uint32_t patternIndex = m_nodes[outputNode].pattern; patternIndex != UINT32_MAX; patternIndex = m_patterns[patternIndex].nextPattern)
+			{
+				const Pattern& pattern = m_patterns[patternIndex];
+				const size_t firstSymbol = m_symbolOffsets.size() - pattern.length;
+
+				if (pattern.wholeWordStart == true &&
+					firstSymbol != 0 &&
+					IsSeparator(message, m_symbolOffsets[firstSymbol - 1]) == false)
+					continue;
+
+				if (pattern.wholeWordEnd == true &&
+					offset + 1 != message.size() &&
+					IsSeparator(message, offset + 1) == false)
+					continue;
+
+				const uint32_t matchOffset = m_symbolOffsets[firstSymbol];
+				violationsOut.push_back(Violation{ patternIndex, matchOffset, static_cast<uint32_t>(offset + 1 - matchOffset) });
+			}
+		}
+	}
+
+	return violationsOut.empty() == false;
+}
+
+uint8_t ChatFilter::GetSymbol(const char c) noexcept
+{
+	return s_symbols[static_cast<uint8_t>(c)];
+}
+
+bool ChatFilter::IsSeparator(const std::string_view message, const size_t offset) noexcept
+{
+	return GetSymbol(message[offset]) == s_separator;
+}
+
+void ChatFilter::Build()
+{
+	// breadth first, so that a node's failure is complete before its children need it
+	std::vector<uint32_t> queue;
+	queue.reserve(m_nodes.size());
+
+	for (uint32_t symbol = 0; symbol < s_numSymbols; ++symbol)
+	{
+		const uint32_t child = m_transitions[symbol];
+		if (child != 0)
+			queue.push_back(child);
+	}
+
+	for (size_t head = 0; head < queue.size(); ++head)
+	{
+		const uint32_t node = queue[head];
+		const uint32_t failure = m_nodes[node].failure;
+
+		for (uint32_t symbol = 0; symbol < s_numSymbols; ++symbol)
+		{
+			uint32_t& transition = m_transitions[node * s_numSymbols + symbol];
+			const uint32_t fallback = m_transitions[failure * s_numSymbols + symbol];
+
+			// missing transitions go where the failure would, so scanning never follows failures
+			if (transition == 0)
+			{
+				transition = fallback;
+				continue;
+			}
+
+			Node& child = m_nodes[transition];
+			child.failure = fallback;
+			child.outputLink = (m_nodes[fallback].pattern != UINT32_MAX) ? fallback : m_nodes[fallback].outputLink;
+
+			queue.push_back(transition);
+		}
+	}
+}
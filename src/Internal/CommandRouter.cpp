@@ -0,0 +1,96 @@
+#include <BetteRCon/Internal/CommandRouter.h>
+
+using BetteRCon::Internal::CommandRouter;
+
+void CommandRouter::Clear()
+{
+	m_nodes.clear();
+	m_nodes.emplace_back();
+}
+
+void CommandRouter::AddRoute(const std::string_view commandName, const Route_t route)
+{
+	uint32_t node = 0;
+	for (const char c : commandName)
+	{
+		const char lower = ToLower(c);
+
+		uint32_t child = FindChild(node, lower);
+		if (child == UINT32_MAX)
+		{
+			child = static_cast<uint32_t>(m_nodes.size());
+			m_nodes[node].children.emplace_back(lower, child);
+
+			// this may move the nodes, so nothing holds a reference across it
+			m_nodes.emplace_back();
+		}
+
+		node = child;
+	}
+
+	m_nodes[node].routes.push_back(route);
+}
+
+const CommandRouter::Routes_t* CommandRouter::FindRoutes(const std::string_view commandName) const noexcept
+{
+	uint32_t node = 0;
+	for (const char c : commandName)
+	{
+		node = FindChild(node, ToLower(c));
+		if (node == UINT32_MAX)
+			return nullptr;
+	}
+
+	const Routes_t& routes = m_nodes[node].routes;
+	return (routes.empty() == false) ? &routes : nullptr;
+}
+
+size_t CommandRouter::Tokenize(const std::string_view message, std::vector<std::string_view>& tokensOut)
+{
+	tokensOut.clear();
+
+	size_t offset = 0;
+	while (offset < message.size())
+	{
+		// skip the spaces between tokens
+		if (message[offset] == ' ')
+		{
+			++offset;
+			continue;
+		}
+
+		if (message[offset] == '"')
+		{
+			const size_t closingQuote = message.find('"', offset + 1);
+			const size_t end = (closingQuote != std::string_view::npos) ? closingQuote : message.size();
+
+			tokensOut.push_back(message.substr(offset + 1, end - offset - 1));
+			offset = end + 1;
+			continue;
+		}
+
+		const size_t space = message.find(' ', offset);
+		const size_t end = (space != std::string_view::npos) ? space : message.size();
+
+		tokensOut.push_back(message.substr(offset, end - offset));
+		offset = end;
+	}
+
+	return tokensOut.size();
+}
+
+char CommandRouter::ToLower(const char c) noexcept
+{
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+uint32_t CommandRouter::FindChild(const uint32_t node, const char c) const noexcept
+{
+	for (const std::pair<char, uint32_t>& child : m_nodes[node].children)
+	{
+		if (child.first == c)
+			return child.second;
+	}
+
+	return UINT32_MAX;
+}
@@ -0,0 +1,75 @@
+#include <BetteRCon/Internal/CommandTracer.h>
+
+using BetteRCon::Internal::CommandTracer;
+
+CommandTracer::CommandTracer(MetricRegistry& metrics)
+	: m_metrics(metrics) {}
+
+CommandTracer::Trace CommandTracer::Queued(const std::string_view command, const Clock_t::time_point now)
+{
+	std::map<std::string, CommandStats, std::less<>>::iterator statsIt = m_commandStats.find(command);
+	if (statsIt == m_commandStats.end())
+	{
+		const MetricRegistry::Labels_t labels{ { "command", std::string(command) } };
+
+		CommandStats stats;
+		stats.command = command;
+		stats.pQueued = m_metrics.GetHistogram("bettercon_command_queued_seconds", "Time commands waited to be written to the server, by command", labels);
+		stats.pServer = m_metrics.GetHistogram("bettercon_command_server_seconds", "Time from commands being written to their response, by command", labels);
+		stats.pRoundTrip = m_metrics.GetHistogram("bettercon_command_round_trip_seconds", "Time from commands being queued to their response, by command", labels);
+		stats.pSent = m_metrics.GetCounter("bettercon_commands_sent_total", "Commands queued to be sent, by command", labels);
+		stats.pUnanswered = m_metrics.GetCounter("bettercon_commands_unanswered_total", "Commands dropped without a response when the connection closed, by command", labels);
+
+		statsIt = m_commandStats.emplace(std::string(command), std::move(stats)).first;
+	}
+
+	statsIt->second.pSent->Increment();
+
+	return Trace{ &statsIt->second, now, Clock_t::time_point{} };
+}
+
+void CommandTracer::Written(Trace& trace, const Clock_t::time_point now) noexcept
+{
+	trace.written = now;
+	trace.pStats->pQueued->Observe(now - trace.queued);
+}
+
+void CommandTracer::Answered(const Trace& trace, const Clock_t::time_point now) noexcept
+{
+	// the response can be read before the write's handler has run, in which case it never waited on the server
+	Clock_t::time_point written = trace.written;
+	if (written == Clock_t::time_point{})
+	{
+		written = now;
+		trace.pStats->pQueued->Observe(now - trace.queued);
+	}
+
+	trace.pStats->pServer->Observe(now - written);
+	trace.pStats->pRoundTrip->Observe(now - trace.queued);
+}
+
+void CommandTracer::Unanswered(const Trace& trace) noexcept
+{
+	trace.pStats->pUnanswered->Increment();
+}
+
+void CommandTracer::GetTimings(std::vector<Timing>& timingsOut) const
+{
+	timingsOut.clear();
+	timingsOut.reserve(m_commandStats.size());
+
+	for (const std::map<std::string, CommandStats, std::less<>>::value_type& commandStats : m_commandStats)
+	{
+		const CommandStats& stats = commandStats.second;
+
+		Timing timing;
+		timing.command = stats.command;
+		timing.sent = stats.pSent->GetValue();
+		timing.unanswered = stats.pUnanswered->GetValue();
+		stats.pQueued->GetSnapshot(timing.queued);
+		stats.pServer->GetSnapshot(timing.server);
+		stats.pRoundTrip->GetSnapshot(timing.roundTrip);
+
+		timingsOut.emplace_back(std::move(timing));
+	}
+}
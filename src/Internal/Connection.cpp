@@ -1,11 +1,19 @@
 #include <BetteRCon/Internal/Connection.h>
 
+#include <algorithm>
+
 using BetteRCon::Internal::Connection;
 using BetteRCon::Internal::Packet;
 
-Connection::Connection(Worker_t& worker) 
+Connection::Connection(Worker_t& worker, MetricRegistry& metrics)
 	: m_worker(worker), m_connected(false),
-	m_socket(m_worker), m_timeoutTimer(m_worker) {}
+	m_socket(m_worker), m_timeoutTimer(m_worker), m_tracer(metrics),
+	m_pBytesSent(metrics.GetCounter("bettercon_connection_sent_bytes_total", "Bytes written to the server")),
+	m_pBytesReceived(metrics.GetCounter("bettercon_connection_received_bytes_total", "Bytes read from the server")),
+	m_pFramesSent(metrics.GetCounter("bettercon_connection_sent_frames_total", "Packets written to the server")),
+	m_pFramesReceived(metrics.GetCounter("bettercon_connection_received_frames_total", "Packets read from the server")),
+	m_pSendQueueDepth(metrics.GetGauge("bettercon_connection_send_queue_depth", "Packets waiting to be written, including the one being written")),
+	m_pPendingCommands(metrics.GetGauge("bettercon_connection_pending_commands", "Commands waiting for a response")) {}
 
 void Connection::AsyncConnect(const Endpoint_t& endpoint, ConnectCallback_t&& connectCallback, 
 	DisconnectCallback_t&& disconnectCallback, RecvCallback_t&& eventCallback) noexcept
@@ -18,15 +26,25 @@ void Connection::AsyncConnect(const Endpoint_t& endpoint, ConnectCallback_t&& co
 	m_eventCallback = std::move(eventCallback);
 	// try to connect
 	ErrorCode_t ec;
-	m_socket.async_connect(endpoint, [this, connectCallback = std::move(connectCallback)]
+	m_socket.async_connect(endpoint, [this, endpoint, connectCallback = std::move(connectCallback)]
 		(const ErrorCode_t& ec)
 		{
 			if (ec)
 				return connectCallback(ec);
 
+			if (m_capture.IsOpen() == true)
+			{
+				const std::string address = endpoint.address().to_string() + ':' + std::to_string(endpoint.port());
+				m_capture.Write(SessionFrameType_Connect, address, SessionCapture::Clock_t::now());
+			}
+
 			// we are successfully connected.
 			m_connected = true;
 
+			// commands are small and each one is waited on, so they shouldn't sit in the socket waiting for more
+			ErrorCode_t ignored;
+			m_socket.set_option(Proto_t::no_delay(true), ignored);
+
 			// start the 2-minute connection timeout
 			m_timeoutTimer.expires_from_now(std::chrono::minutes(2));
 			m_timeoutTimer.async_wait(std::bind(&Connection::HandleTimeout, this, std::placeholders::_1));
@@ -64,13 +82,56 @@ void Connection::SendPacket(const Packet& packet, RecvCallback_t&& callback)
 	// serialize the data into our buffer
 	std::vector<char> sendBuf;
 	packet.Serialize(sendBuf);
+
+	if (m_capture.IsOpen() == true)
+		m_capture.Write(SessionFrameType_Outbound, std::string_view(sendBuf.data(), sendBuf.size()), SessionCapture::Clock_t::now());
+	// save the callback, and start timing the command. nothing answers a response, and the server numbers its events
+	// separately from our commands, so a response's callback would only be left behind to take a command's place
+	const bool command = packet.IsResponse() == false;
+	if (command == true)
+	{
+		const std::vector<std::string>& words = packet.GetWords();
+		const std::string_view commandName = (words.empty() == false) ? std::string_view(words.front()) : std::string_view();
+
+		m_recvCallbacks.emplace(packet.GetSequence(), PendingCommand{ std::move(callback), m_tracer.Queued(commandName, CommandTracer::Clock_t::now()) });
+		m_pPendingCommands->Set(static_cast<int64_t>(m_recvCallbacks.size()));
+	}
 	// insert the buffer into the queue
-	m_sendQueue.push(std::move(sendBuf));
+	m_sendQueue.push(QueuedPacket{ std::move(sendBuf), packet.GetSequence(), command });
+	m_pSendQueueDepth->Set(static_cast<int64_t>(m_sendQueue.size()));
 	// ours is the only one. otherwise, a callback will handle sending our data
 	if (m_sendQueue.size() == 1)
 		SendUnsentBuffers();
-	// save the callback
-	m_recvCallbacks.emplace(packet.GetSequence(), std::move(callback));
+}
+
+void Connection::GetCommandTimings(std::vector<CommandTiming_t>& timingsOut) const
+{
+	m_tracer.GetTimings(timingsOut);
+}
+
+void Connection::GetPendingCommands(std::vector<PendingCommand_t>& pendingOut) const
+{
+	pendingOut.clear();
+	pendingOut.reserve(m_recvCallbacks.size());
+
+	const CommandTracer::Clock_t::time_point now = CommandTracer::Clock_t::now();
+	for (const RecvCallbackMap_t::value_type& pendingCommand : m_recvCallbacks)
+	{
+		const CommandTracer::Trace& trace = pendingCommand.second.trace;
+		pendingOut.push_back(PendingCommand_t{ trace.pStats->command, pendingCommand.first, now - trace.queued, trace.written != CommandTracer::Clock_t::time_point{} });
+	}
+
+	std::sort(pendingOut.begin(), pendingOut.end(), [](const PendingCommand_t& first, const PendingCommand_t& second) { return first.age > second.age; });
+}
+
+bool Connection::StartCapture(const std::string& path)
+{
+	return m_capture.Open(path);
+}
+
+void Connection::StopCapture()
+{
+	m_capture.Close();
 }
 
 Connection::~Connection()
@@ -90,6 +151,14 @@ void Connection::CloseConnection(const ErrorCode_t& ec)
 	m_timeoutTimer.cancel(ignored);
 	// update connected status
 	m_connected = false;
+	// the commands still waiting will never be answered, and the server would number its responses to a new connection from scratch
+	for (const RecvCallbackMap_t::value_type& pendingCommand : m_recvCallbacks)
+		m_tracer.Unanswered(pendingCommand.second.trace);
+	m_recvCallbacks.clear();
+	m_pPendingCommands->Set(0);
+
+	if (m_capture.IsOpen() == true)
+		m_capture.Write(SessionFrameType_Disconnect, ec.message(), SessionCapture::Clock_t::now());
 	// call the disconnect callback
 	m_disconnectCallback(ec);
 }
@@ -122,6 +191,11 @@ void Connection::HandleReadBody(const ErrorCode_t& ec, const size_t bytes_transf
 	// update the 2-minute connection timeout
 	m_timeoutTimer.expires_from_now(std::chrono::minutes(2));
 	m_timeoutTimer.async_wait(std::bind(&Connection::HandleTimeout, this, std::placeholders::_1));
+	m_pBytesReceived->Increment(m_incomingBuf.size());
+	m_pFramesReceived->Increment();
+	// capture the packet before it is parsed, so bad packets can be replayed too
+	if (m_capture.IsOpen() == true)
+		m_capture.Write(SessionFrameType_Inbound, std::string_view(m_incomingBuf.data(), m_incomingBuf.size()), SessionCapture::Clock_t::now());
 	// parse the packet
 	std::optional<Packet> receivedPacket;
 	try
@@ -144,9 +218,11 @@ void Connection::HandleReadBody(const ErrorCode_t& ec, const size_t bytes_transf
 			// this should not happen. abort
 			return CloseConnection(asio::error::make_error_code(asio::error::invalid_argument));
 		}
-		const auto fn = callbackFnIt->second;
+		m_tracer.Answered(callbackFnIt->second.trace, CommandTracer::Clock_t::now());
+		const auto fn = std::move(callbackFnIt->second.callback);
 		// remove the callback
 		m_recvCallbacks.erase(callbackFnIt);
+		m_pPendingCommands->Set(static_cast<int64_t>(m_recvCallbacks.size()));
 		// call the callback
 		fn(ErrorCode_t{}, receivedPacket);
 	}
@@ -175,12 +251,27 @@ void Connection::HandleWrite(const ErrorCode_t& ec, const size_t bytes_transferr
 {
 	if (ec)
 	{
+		// nothing else in the queue will be written on this connection, and leaving it would stop the next one from writing
+		m_sendQueue = SendQueue_t();
+		m_pSendQueueDepth->Set(0);
+
 		if (ec != asio::error::operation_aborted)
 			CloseConnection(ec);
 		return;
 	}
+	m_pBytesSent->Increment(bytes_transferred);
+	m_pFramesSent->Increment();
+	// the command is out, and is waiting on the server now
+	const QueuedPacket& sentPacket = m_sendQueue.front();
+	if (sentPacket.command == true)
+	{
+		const RecvCallbackMap_t::iterator pendingIt = m_recvCallbacks.find(sentPacket.sequence);
+		if (pendingIt != m_recvCallbacks.end())
+			m_tracer.Written(pendingIt->second.trace, CommandTracer::Clock_t::now());
+	}
 	// pop the buffer, we don't need it any more
 	m_sendQueue.pop();
+	m_pSendQueueDepth->Set(static_cast<int64_t>(m_sendQueue.size()));
 	// send more packets if there are some lined up
 	if (m_sendQueue.empty() == false)
 		SendUnsentBuffers();
@@ -189,7 +280,7 @@ void Connection::HandleWrite(const ErrorCode_t& ec, const size_t bytes_transferr
 void Connection::SendUnsentBuffers()
 {
 	// get the first buffer
-	const std::vector<char>& frontBuf = m_sendQueue.front();
+	const std::vector<char>& frontBuf = m_sendQueue.front().buffer;
 	// there is no send in progress
 	asio::async_write(m_socket, asio::buffer(frontBuf),
 		std::bind(&Connection::HandleWrite, this,
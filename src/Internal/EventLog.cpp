@@ -0,0 +1,448 @@
+#include <BetteRCon/Internal/EventLog.h>
+#include <BetteRCon/Internal/Log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using BetteRCon::Internal::EventLog;
+using BetteRCon::Internal::EventLogReader;
+
+namespace
+{
+	int64_t ToMicroseconds(const EventLog::Clock_t::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+	}
+
+	// little-endian, the same as RecordWriter
+	template<typename T>
+	char* Store(char* pOut, const T value)
+	{
+		for (size_t i = 0; i < sizeof(T); ++i)
+			pOut[i] = static_cast<char>(static_cast<std::make_unsigned_t<T>>(value) >> (i * 8));
+
+		return pOut + sizeof(T);
+	}
+}
+
+bool EventLog::Open(const std::string& directory, const size_t segmentSize, const size_t maxSegments)
+{
+	Close();
+
+	m_directory = directory;
+	m_segmentSize = std::max<size_t>(segmentSize, g_eventLogHeaderSize + g_eventLogRecordHeaderSize);
+	m_maxSegments = std::max<size_t>(maxSegments, 1);
+
+	std::error_code ec;
+	std::filesystem::create_directories(m_directory, ec);
+
+	// carry on numbering after the segments that are already there
+	m_segments.clear();
+	m_nextSegment = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_directory, ec))
+	{
+		if (entry.path().extension() != g_eventLogExtension)
+			continue;
+
+		try
+		{
+			m_nextSegment = std::max<uint64_t>(m_nextSegment, std::stoull(entry.path().stem().string()) + 1);
+			m_segments.push_back(entry.path());
+		}
+		catch (const std::exception&) {}
+	}
+
+	if (ec)
+	{
+		g_stdErrLog << "EventLog: Failed to open " << directory << ": " << ec.message() << '\n';
+		return false;
+	}
+
+	// the names are zero-padded, so they sort in order
+	std::sort(m_segments.begin(), m_segments.end());
+
+	return OpenSegment(0, Clock_t::now());
+}
+
+void EventLog::Close()
+{
+	CloseSegment();
+	m_segments.clear();
+}
+
+bool EventLog::IsOpen() const noexcept
+{
+	return m_pData != nullptr;
+}
+
+void EventLog::LogEvent(const std::vector<std::string>& words, const Clock_t::time_point time)
+{
+	if (IsOpen() == false ||
+		words.empty() == true)
+		return;
+
+	m_payload.Clear();
+	WriteWords(words, 1);
+
+	Append(EventLogRecordType_Event, 0, words.front(), time);
+}
+
+void EventLog::LogCommand(const int32_t sequence, const std::vector<std::string>& words, const Clock_t::time_point time)
+{
+	if (IsOpen() == false ||
+		words.empty() == true)
+		return;
+
+	m_payload.Clear();
+	m_payload.WriteVarSInt(sequence);
+	WriteWords(words, 1);
+
+	Append(EventLogRecordType_Command, 0, words.front(), time);
+}
+
+void EventLog::LogResponse(const int32_t sequence, const std::string_view commandName, const std::vector<std::string>& words, const bool error, const Clock_t::time_point time)
+{
+	if (IsOpen() == false)
+		return;
+
+	m_payload.Clear();
+	m_payload.WriteVarSInt(sequence);
+	WriteWords(words, 0);
+
+	Append(EventLogRecordType_Response, (error == true) ? EventLogRecordFlag_Error : 0, commandName, time);
+}
+
+EventLog::~EventLog()
+{
+	Close();
+}
+
+void EventLog::Append(const EventLogRecordType type, const uint8_t flags, const std::string_view name, const Clock_t::time_point time)
+{
+	// a name record with no payload would read as the end of the segment
+	if (name.empty() == true)
+		return;
+
+	const std::string_view payload = m_payload.GetData();
+	const size_t recordSize = g_eventLogRecordHeaderSize + payload.size();
+	const size_t nameRecordSize = g_eventLogRecordHeaderSize + name.size();
+
+	// looking up through a reused string doesn't allocate once it has grown
+	m_nameKey.assign(name.data(), name.size());
+
+	std::unordered_map<std::string, uint16_t>::const_iterator nameIt = m_nameIds.find(m_nameKey);
+	const size_t neededSize = recordSize + ((nameIt == m_nameIds.end()) ? nameRecordSize : 0);
+
+	// ids are 16 bits, so a segment with that many names is full too
+	if (m_size - m_used < neededSize ||
+		(nameIt == m_nameIds.end() && m_nameIds.size() > UINT16_MAX))
+	{
+		// a new segment starts without any names
+		if (OpenSegment(recordSize + nameRecordSize, time) == false)
+			return;
+
+		nameIt = m_nameIds.end();
+	}
+
+	uint16_t nameId;
+	if (nameIt == m_nameIds.end())
+	{
+		nameId = static_cast<uint16_t>(m_nameIds.size());
+		m_nameIds.emplace(m_nameKey, nameId);
+
+		WriteRecord(EventLogRecordType_Name, 0, nameId, time, name);
+	}
+	else
+		nameId = nameIt->second;
+
+	WriteRecord(type, flags, nameId, time, payload);
+}
+
+void EventLog::WriteRecord(const EventLogRecordType type, const uint8_t flags, const uint16_t nameId, const Clock_t::time_point time, const std::string_view payload)
+{
+	char* pRecord = m_pData + m_used;
+
+	// the length goes in last, so a record that was cut off halfway reads as the end of the segment
+	char* pOut = pRecord + sizeof(uint32_t);
+	pOut = Store(pOut, static_cast<uint8_t>(type));
+	pOut = Store(pOut, flags);
+	pOut = Store(pOut, nameId);
+	pOut = Store(pOut, ToMicroseconds(time));
+	memcpy(pOut, payload.data(), payload.size());
+	Store(pRecord, static_cast<uint32_t>(payload.size()));
+
+	m_used += g_eventLogRecordHeaderSize + payload.size();
+}
+
+void EventLog::WriteWords(const std::vector<std::string>& words, const size_t firstWord)
+{
+	m_payload.WriteVarInt(words.size() - std::min(firstWord, words.size()));
+	for (size_t i = firstWord; i < words.size(); ++i)
+	{
+		m_payload.WriteVarInt(words[i].size());
+		m_payload.WriteView(words[i]);
+	}
+}
+
+bool EventLog::OpenSegment(const size_t minSize, const Clock_t::time_point time)
+{
+	CloseSegment();
+
+	// keep a segment for the one that is about to be opened
+	while (m_segments.size() >= m_maxSegments)
+	{
+		std::error_code ec;
+		std::filesystem::remove(m_segments.front(), ec);
+		m_segments.pop_front();
+	}
+
+	std::ostringstream segmentName;
+	segmentName << std::setw(8) << std::setfill('0') << m_nextSegment++ << g_eventLogExtension;
+
+	const std::filesystem::path segmentPath = m_directory / segmentName.str();
+	if (MapSegment(segmentPath, std::max(m_segmentSize, g_eventLogHeaderSize + minSize)) == false)
+	{
+		g_stdErrLog << "EventLog: Failed to map " << segmentPath.string() << ", logging is stopped\n";
+		return false;
+	}
+
+	m_segments.push_back(segmentPath);
+
+	char* pOut = m_pData;
+	memcpy(pOut, g_eventLogMagic, sizeof(g_eventLogMagic));
+	pOut = Store(pOut + sizeof(g_eventLogMagic), g_eventLogVersion);
+	Store(pOut, ToMicroseconds(time));
+
+	m_used = g_eventLogHeaderSize;
+
+	return true;
+}
+
+void EventLog::CloseSegment()
+{
+	UnmapSegment();
+	m_nameIds.clear();
+}
+
+#ifdef _WIN32
+bool EventLog::MapSegment(const std::filesystem::path& path, const size_t size)
+{
+	m_hFile = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		m_hFile = nullptr;
+		return false;
+	}
+
+	const uint64_t mappingSize = size;
+	m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize), nullptr);
+	if (m_hMapping != nullptr)
+		m_pData = static_cast<char*>(MapViewOfFile(m_hMapping, FILE_MAP_WRITE, 0, 0, size));
+
+	if (m_pData == nullptr)
+	{
+		UnmapSegment();
+		return false;
+	}
+
+	m_size = size;
+	return true;
+}
+
+void EventLog::UnmapSegment()
+{
+	if (m_pData != nullptr)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+
+	if (m_hMapping != nullptr)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+
+	if (m_hFile != nullptr)
+	{
+		// trim the space that was never used
+		LARGE_INTEGER used;
+		used.QuadPart = static_cast<LONGLONG>(m_used);
+		if (SetFilePointerEx(m_hFile, used, nullptr, FILE_BEGIN) == TRUE)
+			SetEndOfFile(m_hFile);
+
+		CloseHandle(m_hFile);
+		m_hFile = nullptr;
+	}
+
+	m_size = 0;
+	m_used = 0;
+}
+#else
+bool EventLog::MapSegment(const std::filesystem::path& path, const size_t size)
+{
+	m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_fd == -1)
+		return false;
+
+	// the file is sparse until records are written to it
+	if (ftruncate(m_fd, static_cast<off_t>(size)) == -1)
+	{
+		UnmapSegment();
+		return false;
+	}
+
+	void* pData = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (pData == MAP_FAILED)
+	{
+		UnmapSegment();
+		return false;
+	}
+
+	m_pData = static_cast<char*>(pData);
+	m_size = size;
+	return true;
+}
+
+void EventLog::UnmapSegment()
+{
+	if (m_pData != nullptr)
+	{
+		munmap(m_pData, m_size);
+		m_pData = nullptr;
+	}
+
+	if (m_fd != -1)
+	{
+		// trim the space that was never used
+		if (ftruncate(m_fd, static_cast<off_t>(m_used)) == -1)
+			g_stdErrLog << "EventLog: Failed to trim a segment\n";
+
+		close(m_fd);
+		m_fd = -1;
+	}
+
+	m_size = 0;
+	m_used = 0;
+}
+#endif
+
+EventLogReader::Status EventLogReader::Open(const std::string& path)
+{
+	m_data.clear();
+	m_offset = 0;
+	m_names.clear();
+	m_status = Status_OK;
+
+	// read the entire segment in one go
+	std::ifstream inFile(path, std::ios::binary);
+	if (inFile.good() == false)
+		return m_status = Status_NotFound;
+
+	m_data.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+
+	RecordReader header(std::string_view(m_data.data(), m_data.size()));
+	const std::string_view magic = header.ReadView(sizeof(g_eventLogMagic));
+	const uint32_t version = header.Read<uint32_t>();
+	const int64_t startTime = header.Read<int64_t>();
+
+	if (header.IsGood() == false ||
+		magic != std::string_view(g_eventLogMagic, sizeof(g_eventLogMagic)))
+		return m_status = Status_BadHeader;
+
+	if (version > g_eventLogVersion)
+		return m_status = Status_UnsupportedVersion;
+
+	m_startTime = Clock_t::time_point(std::chrono::duration_cast<Clock_t::duration>(std::chrono::microseconds(startTime)));
+	m_offset = g_eventLogHeaderSize;
+
+	return Status_OK;
+}
+
+EventLogReader::Clock_t::time_point EventLogReader::GetStartTime() const noexcept
+{
+	return m_startTime;
+}
+
+bool EventLogReader::Next(Record& recordOut)
+{
+	while (m_status == Status_OK &&
+		m_offset + g_eventLogRecordHeaderSize <= m_data.size())
+	{
+		RecordReader frame(std::string_view(m_data.data() + m_offset, m_data.size() - m_offset));
+		const uint32_t payloadSize = frame.Read<uint32_t>();
+
+		// the rest of a segment that was never trimmed
+		if (payloadSize == 0)
+			break;
+
+		const EventLogRecordType type = static_cast<EventLogRecordType>(frame.Read<uint8_t>());
+		const uint8_t flags = frame.Read<uint8_t>();
+		const uint16_t nameId = frame.Read<uint16_t>();
+		const int64_t time = frame.Read<int64_t>();
+		RecordReader payload(frame.ReadView(payloadSize));
+
+		if (frame.IsGood() == false ||
+			type >= EventLogRecordType_Count)
+		{
+			m_status = Status_Corrupt;
+			return false;
+		}
+
+		m_offset += g_eventLogRecordHeaderSize + payloadSize;
+
+		if (type == EventLogRecordType_Name)
+		{
+			if (nameId >= m_names.size())
+				m_names.resize(nameId + 1);
+
+			m_names[nameId] = payload.ReadView(payloadSize);
+			continue;
+		}
+
+		if (nameId >= m_names.size() ||
+			m_names[nameId].empty() == true)
+		{
+			m_status = Status_Corrupt;
+			return false;
+		}
+
+		recordOut.type = type;
+		recordOut.flags = flags;
+		recordOut.time = Clock_t::time_point(std::chrono::duration_cast<Clock_t::duration>(std::chrono::microseconds(time)));
+		recordOut.name = m_names[nameId];
+		recordOut.sequence = (type != EventLogRecordType_Event) ? static_cast<int32_t>(payload.ReadVarSInt()) : 0;
+
+		const uint64_t numWords = payload.ReadVarInt();
+		recordOut.words.clear();
+		for (uint64_t i = 0; i < numWords && payload.IsGood() == true; ++i)
+			recordOut.words.push_back(payload.ReadView(payload.ReadVarInt()));
+
+		if (payload.IsGood() == false)
+		{
+			m_status = Status_Corrupt;
+			return false;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+EventLogReader::Status EventLogReader::GetStatus() const noexcept
+{
+	return m_status;
+}
@@ -0,0 +1,288 @@
+#include <BetteRCon/Internal/FileWatcher.h>
+#include <BetteRCon/Internal/Log.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using BetteRCon::Internal::FileWatcher;
+
+FileWatcher::FileWatcher(Worker_t& worker)
+	: m_worker(worker), m_pollTimer(m_worker) {}
+
+FileWatcher::WatchId_t FileWatcher::Watch(const std::string& path, WatchCallback_t&& callback)
+{
+	const std::filesystem::path normalPath = std::filesystem::path(path).lexically_normal();
+	const std::string key = normalPath.string();
+
+	WatchedFileMap_t::iterator fileIt = m_files.find(key);
+	if (fileIt == m_files.end())
+	{
+		// take the current contents as the baseline
+		WatchedFile watchedFile;
+		watchedFile.path = normalPath;
+		watchedFile.lines = ReadLines(normalPath);
+		watchedFile.lastWriteTime = GetLastWriteTime(normalPath);
+
+		fileIt = m_files.emplace(key, std::move(watchedFile)).first;
+
+		// watch the directory rather than the file, because editors tend to replace files instead of writing them
+		const std::filesystem::path directory = normalPath.has_parent_path() ? normalPath.parent_path() : std::filesystem::path(".");
+		StartWatching(directory);
+	}
+
+	const WatchId_t id = m_nextId++;
+	fileIt->second.callbacks.emplace(id, std::move(callback));
+
+	return id;
+}
+
+void FileWatcher::Unwatch(const WatchId_t id)
+{
+	for (WatchedFileMap_t::iterator fileIt = m_files.begin(); fileIt != m_files.end(); ++fileIt)
+	{
+		if (fileIt->second.callbacks.erase(id) == 0)
+			continue;
+
+		// nobody is listening to the file anymore
+		if (fileIt->second.callbacks.empty() == true)
+			m_files.erase(fileIt);
+		return;
+	}
+}
+
+void FileWatcher::Clear()
+{
+	m_files.clear();
+	StopWatching();
+}
+
+FileWatcher::~FileWatcher()
+{
+	StopWatching();
+}
+
+std::vector<std::string> FileWatcher::ReadLines(const std::filesystem::path& path)
+{
+	std::vector<std::string> lines;
+
+	std::ifstream inFile(path);
+	if (inFile.good() == false)
+		return lines;
+
+	std::string line;
+	while (std::getline(inFile, line))
+	{
+		// files edited on windows
+		if (line.empty() == false &&
+			line.back() == '\r')
+			line.pop_back();
+
+		if (line.empty() == true)
+			continue;
+
+		lines.push_back(std::move(line));
+	}
+
+	// keep them sorted so that diffs are a linear merge
+	std::sort(lines.begin(), lines.end());
+
+	return lines;
+}
+
+std::filesystem::file_time_type FileWatcher::GetLastWriteTime(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(path, ec);
+
+	return (ec) ? std::filesystem::file_time_type::min() : lastWriteTime;
+}
+
+void FileWatcher::CheckFile(WatchedFile& watchedFile)
+{
+	std::vector<std::string> lines = ReadLines(watchedFile.path);
+	watchedFile.lastWriteTime = GetLastWriteTime(watchedFile.path);
+
+	FileDiff diff;
+	diff.path = watchedFile.path.string();
+	std::set_difference(lines.begin(), lines.end(), watchedFile.lines.begin(), watchedFile.lines.end(), std::back_inserter(diff.addedLines));
+	std::set_difference(watchedFile.lines.begin(), watchedFile.lines.end(), lines.begin(), lines.end(), std::back_inserter(diff.removedLines));
+
+	watchedFile.lines = std::move(lines);
+
+	// the file was touched but nothing changed
+	if (diff.addedLines.empty() == true &&
+		diff.removedLines.empty() == true)
+		return;
+
+	// copy the callbacks, because they are allowed to unwatch
+	std::vector<WatchCallback_t> callbacks;
+	for (const std::unordered_map<WatchId_t, WatchCallback_t>::value_type& callback : watchedFile.callbacks)
+		callbacks.push_back(callback.second);
+
+	for (const WatchCallback_t& callback : callbacks)
+		callback(diff);
+}
+
+void FileWatcher::StartWatching(const std::filesystem::path& directory)
+{
+#ifdef __linux__
+	if (m_polling == false)
+	{
+		if (m_inotifyFd == -1)
+		{
+			m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (m_inotifyFd != -1)
+			{
+				// hand the descriptor to asio so that notifications are delivered on the worker
+				m_pNotifyDescriptor = std::make_unique<asio::posix::stream_descriptor>(m_worker, m_inotifyFd);
+				m_notifyBuf.resize(4096);
+				m_pNotifyDescriptor->async_read_some(asio::buffer(m_notifyBuf),
+					std::bind(&FileWatcher::HandleNotification, this,
+						std::placeholders::_1, std::placeholders::_2));
+			}
+			else
+				BetteRCon::Internal::g_stdErrLog << "FileWatcher: inotify is unavailable, polling instead\n";
+		}
+
+		if (m_inotifyFd != -1)
+		{
+			// see if we already watch the directory
+			for (const std::unordered_map<int, std::filesystem::path>::value_type& watchedDirectory : m_directories)
+			{
+				if (watchedDirectory.second == directory)
+					return;
+			}
+
+			const int wd = inotify_add_watch(m_inotifyFd, directory.c_str(),
+				IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+			if (wd != -1)
+			{
+				m_directories.emplace(wd, directory);
+				return;
+			}
+
+			BetteRCon::Internal::g_stdErrLog << "FileWatcher: Failed to watch " << directory.string() << ", polling instead\n";
+		}
+	}
+#endif
+
+	// fall back to polling modification times
+	if (m_polling == true)
+		return;
+
+	m_polling = true;
+	m_pollTimer.expires_from_now(std::chrono::seconds(5));
+	m_pollTimer.async_wait(std::bind(&FileWatcher::HandlePollTimerExpire, this, std::placeholders::_1));
+}
+
+void FileWatcher::StopWatching()
+{
+	ErrorCode_t ignored;
+
+#ifdef __linux__
+	// closing the descriptor closes the inotify instance and cancels the read
+	if (m_pNotifyDescriptor != nullptr)
+	{
+		m_pNotifyDescriptor->close(ignored);
+		m_pNotifyDescriptor.reset();
+	}
+	m_inotifyFd = -1;
+	m_directories.clear();
+#endif
+
+	m_polling = false;
+	m_pollTimer.cancel(ignored);
+}
+
+void FileWatcher::HandleNotification(const ErrorCode_t& ec, const size_t bytes_transferred)
+{
+#ifdef __linux__
+	// the operation was likely cancelled
+	if (ec)
+		return;
+
+	// collect the files first, because callbacks are allowed to unwatch
+	std::vector<std::string> changedFiles;
+	bool overflowed = false;
+
+	size_t offset = 0;
+	while (offset + sizeof(inotify_event) <= bytes_transferred)
+	{
+		const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(&m_notifyBuf[offset]);
+		offset += sizeof(inotify_event) + pEvent->len;
+
+		if ((pEvent->mask & IN_Q_OVERFLOW) != 0)
+			overflowed = true;
+
+		if (pEvent->len == 0)
+			continue;
+
+		const std::unordered_map<int, std::filesystem::path>::const_iterator directoryIt = m_directories.find(pEvent->wd);
+		if (directoryIt == m_directories.end())
+			continue;
+
+		const std::string key = (directoryIt->second / pEvent->name).lexically_normal().string();
+		if (m_files.find(key) != m_files.end() &&
+			std::find(changedFiles.begin(), changedFiles.end(), key) == changedFiles.end())
+			changedFiles.push_back(key);
+	}
+
+	// we missed events, so check everything
+	if (overflowed == true)
+	{
+		changedFiles.clear();
+		for (const WatchedFileMap_t::value_type& watchedFile : m_files)
+			changedFiles.push_back(watchedFile.first);
+	}
+
+	for (const std::string& key : changedFiles)
+	{
+		const WatchedFileMap_t::iterator fileIt = m_files.find(key);
+		if (fileIt != m_files.end())
+			CheckFile(fileIt->second);
+	}
+
+	// wait for more notifications, if we weren't stopped by a callback
+	if (m_pNotifyDescriptor == nullptr)
+		return;
+
+	m_pNotifyDescriptor->async_read_some(asio::buffer(m_notifyBuf),
+		std::bind(&FileWatcher::HandleNotification, this,
+			std::placeholders::_1, std::placeholders::_2));
+#endif
+}
+
+void FileWatcher::HandlePollTimerExpire(const ErrorCode_t& ec)
+{
+	// the operation was likely cancelled. stop the loop
+	if (ec || m_polling == false)
+		return;
+
+	// collect the files first, because callbacks are allowed to unwatch
+	std::vector<std::string> changedFiles;
+	for (const WatchedFileMap_t::value_type& watchedFile : m_files)
+	{
+		if (GetLastWriteTime(watchedFile.second.path) != watchedFile.second.lastWriteTime)
+			changedFiles.push_back(watchedFile.first);
+	}
+
+	for (const std::string& key : changedFiles)
+	{
+		const WatchedFileMap_t::iterator fileIt = m_files.find(key);
+		if (fileIt != m_files.end())
+			CheckFile(fileIt->second);
+	}
+
+	if (m_polling == false)
+		return;
+
+	// reset the timer and wait again
+	m_pollTimer.expires_from_now(std::chrono::seconds(5));
+	m_pollTimer.async_wait(std::bind(&FileWatcher::HandlePollTimerExpire, this, std::placeholders::_1));
+}
@@ -0,0 +1,69 @@
+#include <BetteRCon/Internal/HandlerWatchdog.h>
+
+#include <algorithm>
+
+using BetteRCon::Internal::HandlerWatchdog;
+
+void HandlerWatchdog::Start(const std::chrono::nanoseconds budget, StallCallback_t&& stallCallback)
+{
+	Stop();
+
+	m_budgetTicks = CycleClock::ToTicks(budget);
+	// checking every quarter of the budget reports a call before it is a quarter over
+	m_period = std::max<std::chrono::nanoseconds>(budget / 4, std::chrono::milliseconds(1));
+	m_stallCallback = std::move(stallCallback);
+	m_reportedSequence = 0;
+	m_stopping = false;
+
+	m_thread = std::thread(&HandlerWatchdog::Watch, this);
+}
+
+void HandlerWatchdog::Stop()
+{
+	if (m_thread.joinable() == false)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_stopCondition.notify_one();
+
+	m_thread.join();
+}
+
+HandlerWatchdog::~HandlerWatchdog()
+{
+	Stop();
+}
+
+void HandlerWatchdog::Watch()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_stopCondition.wait_for(lock, m_period, [this]() { return m_stopping == true; }) == false)
+	{
+		uint64_t sequence;
+		const void* pContext;
+		uint64_t start;
+		do
+		{
+			sequence = m_sequence.load(std::memory_order_acquire);
+			pContext = m_pContext.load(std::memory_order_relaxed);
+			start = m_start.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((sequence & 1) != 0 ||
+			sequence != m_sequence.load(std::memory_order_relaxed));
+
+		// not in a call, or already reported
+		if (pContext == nullptr ||
+			sequence == m_reportedSequence)
+			continue;
+
+		const uint64_t elapsed = CycleClock::Now() - start;
+		if (elapsed <= m_budgetTicks)
+			continue;
+
+		m_reportedSequence = sequence;
+		m_stallCallback(pContext, CycleClock::ToDuration(elapsed));
+	}
+}
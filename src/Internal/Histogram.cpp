@@ -0,0 +1,143 @@
+#include <BetteRCon/Internal/Histogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+using BetteRCon::Internal::Histogram;
+
+namespace
+{
+	// the position of the highest set bit, counted from 1. 0 for 0
+	uint32_t GetBitWidth(uint64_t value) noexcept
+	{
+		uint32_t width = 0;
+		for (uint32_t shift = 32; shift != 0; shift /= 2)
+		{
+			if (value >= (uint64_t(1) << shift))
+			{
+				value >>= shift;
+				width += shift;
+			}
+		}
+
+		return width + static_cast<uint32_t>(value);
+	}
+}
+
+Histogram::Histogram(const uint64_t highestValue)
+	: m_highestValue(std::max<uint64_t>(highestValue, s_subBucketCount)), m_totalCount(0), m_min(0), m_max(0), m_sum(0.0)
+{
+	// the first bucket holds every sub-bucket, and each after it only the upper half, with twice the width
+	m_counts.resize(GetIndex(m_highestValue) + 1);
+}
+
+void Histogram::Record(const uint64_t value) noexcept
+{
+	Record(value, 1);
+}
+
+void Histogram::Record(const uint64_t value, const uint64_t count) noexcept
+{
+	if (count == 0)
+		return;
+
+	const uint64_t clampedValue = std::min(value, m_highestValue);
+
+	m_counts[GetIndex(clampedValue)] += count;
+
+	if (m_totalCount == 0 ||
+		clampedValue < m_min)
+		m_min = clampedValue;
+	if (clampedValue > m_max)
+		m_max = clampedValue;
+
+	m_totalCount += count;
+	m_sum += static_cast<double>(clampedValue) * count;
+}
+
+void Histogram::Add(const Histogram& other) noexcept
+{
+	if (other.m_totalCount == 0)
+		return;
+
+	const size_t numCounts = std::min(m_counts.size(), other.m_counts.size());
+	for (size_t i = 0; i < numCounts; ++i)
+		m_counts[i] += other.m_counts[i];
+
+	if (m_totalCount == 0 ||
+		other.m_min < m_min)
+		m_min = other.m_min;
+	m_max = std::max(m_max, other.m_max);
+
+	m_totalCount += other.m_totalCount;
+	m_sum += other.m_sum;
+}
+
+void Histogram::Reset() noexcept
+{
+	std::fill(m_counts.begin(), m_counts.end(), 0);
+	m_totalCount = 0;
+	m_min = 0;
+	m_max = 0;
+	m_sum = 0.0;
+}
+
+uint64_t Histogram::GetCount() const noexcept
+{
+	return m_totalCount;
+}
+
+uint64_t Histogram::GetMin() const noexcept
+{
+	return m_min;
+}
+
+uint64_t Histogram::GetMax() const noexcept
+{
+	return m_max;
+}
+
+double Histogram::GetMean() const noexcept
+{
+	return (m_totalCount == 0) ? 0.0 : m_sum / m_totalCount;
+}
+
+uint64_t Histogram::GetValueAtPercentile(const double percentile) const noexcept
+{
+	if (m_totalCount == 0)
+		return 0;
+
+	// the rank of the value we want, counted from 1
+	const double clampedPercentile = std::min(std::max(percentile, 0.0), 100.0);
+	const uint64_t targetCount = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(clampedPercentile / 100.0 * m_totalCount)), 1);
+
+	uint64_t countSoFar = 0;
+	for (size_t i = 0; i < m_counts.size(); ++i)
+	{
+		countSoFar += m_counts[i];
+		if (countSoFar >= targetCount)
+			return std::min(std::max(GetHighestEquivalentValue(i), m_min), m_max);
+	}
+
+	return m_max;
+}
+
+size_t Histogram::GetIndex(const uint64_t value) const noexcept
+{
+	// values below the sub-bucket count are exact, and every power of two above them is another bucket
+	const uint32_t bucketIndex = GetBitWidth(value | (s_subBucketCount - 1)) - s_subBucketBits;
+	const uint64_t subBucketIndex = value >> bucketIndex;
+
+	return (static_cast<size_t>(bucketIndex) << (s_subBucketBits - 1)) + static_cast<size_t>(subBucketIndex);
+}
+
+uint64_t Histogram::GetHighestEquivalentValue(const size_t index) const noexcept
+{
+	if (index < s_subBucketCount)
+		return index;
+
+	const size_t bucketIndex = (index >> (s_subBucketBits - 1)) - 1;
+	const uint64_t subBucketIndex = (index & (s_subBucketHalfCount - 1)) + s_subBucketHalfCount;
+
+	return ((subBucketIndex + 1) << bucketIndex) - 1;
+}
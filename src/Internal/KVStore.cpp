@@ -0,0 +1,509 @@
+#include <BetteRCon/Internal/KVStore.h>
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/Serialization.h>
+
+#include <algorithm>
+#include <filesystem>
+
+using BetteRCon::Internal::KVStore;
+
+namespace
+{
+	constexpr char s_storeMagic[4] = { 'B', 'R', 'K', 'V' };
+	constexpr uint32_t s_storeVersion = 1;
+	constexpr size_t s_storeHeaderSize = sizeof(s_storeMagic) + sizeof(uint32_t);
+	// length and checksum around each record's payload
+	constexpr size_t s_recordOverhead = sizeof(uint32_t) * 2;
+	// anything larger is a corrupt length rather than a real record
+	constexpr uint32_t s_maxRecordSize = 16 * 1024 * 1024;
+	// don't bother compacting small stores
+	constexpr uint64_t s_minCompactionBytes = 1024 * 1024;
+	// stands in for an expiry of never
+	constexpr int64_t s_noExpiry = INT64_MAX;
+
+	int64_t ToExpirySeconds(const KVStore::Clock_t::time_point expiry)
+	{
+		if (expiry == KVStore::Clock_t::time_point::max())
+			return s_noExpiry;
+
+		return std::chrono::duration_cast<std::chrono::seconds>(expiry.time_since_epoch()).count();
+	}
+
+	int64_t NowSeconds()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(KVStore::Clock_t::now().time_since_epoch()).count();
+	}
+}
+
+KVStore::KVStore(const size_t cachePages)
+	: m_cachePages(std::max<size_t>(cachePages, 1)) {}
+
+bool KVStore::Open(const std::string& path)
+{
+	Close();
+
+	// create the file if it doesn't exist
+	{
+		std::ofstream createFile(path, std::ios::binary | std::ios::app);
+		if (createFile.good() == false)
+			return false;
+	}
+
+	std::ifstream inFile(path, std::ios::binary);
+	if (inFile.good() == false)
+		return false;
+
+	// check the header. an empty file is a new store
+	char header[s_storeHeaderSize];
+	inFile.read(header, sizeof(header));
+	const std::streamsize headerRead = inFile.gcount();
+
+	if (headerRead != 0 &&
+		(headerRead != static_cast<std::streamsize>(sizeof(header)) ||
+		memcmp(header, s_storeMagic, sizeof(s_storeMagic)) != 0))
+	{
+		BetteRCon::Internal::g_stdErrLog << "KVStore: " << path << " is not a key-value store\n";
+		return false;
+	}
+
+	// replay the log to build the index
+	uint64_t offset = (headerRead != 0) ? s_storeHeaderSize : 0;
+	while (headerRead != 0)
+	{
+		char sizeBytes[sizeof(uint32_t)];
+		inFile.read(sizeBytes, sizeof(sizeBytes));
+		if (inFile.gcount() != static_cast<std::streamsize>(sizeof(sizeBytes)))
+			break;
+
+		const uint32_t payloadSize = RecordReader(std::string_view(sizeBytes, sizeof(sizeBytes))).Read<uint32_t>();
+		if (payloadSize > s_maxRecordSize)
+			break;
+
+		m_recordBuf.resize(payloadSize + sizeof(uint32_t));
+		inFile.read(m_recordBuf.data(), m_recordBuf.size());
+		if (inFile.gcount() != static_cast<std::streamsize>(m_recordBuf.size()))
+			break;
+
+		const uint32_t recordCrc = RecordReader(std::string_view(&m_recordBuf[payloadSize], sizeof(uint32_t))).Read<uint32_t>();
+		if (recordCrc != Crc32(m_recordBuf.data(), payloadSize))
+			break;
+
+		RecordReader payload(std::string_view(m_recordBuf.data(), payloadSize));
+		const uint8_t type = payload.Read<uint8_t>();
+		const int64_t expirySeconds = payload.Read<int64_t>();
+		const std::string_view key = payload.ReadString();
+		if (payload.IsGood() == false)
+			break;
+
+		const uint32_t recordSize = static_cast<uint32_t>(payloadSize + s_recordOverhead);
+
+		// the key's previous record is dead either way
+		const Index_t::iterator indexIt = m_index.find(key);
+		if (indexIt != m_index.end())
+			m_deadBytes += indexIt->second.size;
+
+		if (type == RecordType_Put)
+		{
+			const IndexEntry entry{ offset, recordSize, expirySeconds };
+			if (indexIt != m_index.end())
+				indexIt->second = entry;
+			else
+				m_index.emplace(std::string(key), entry);
+		}
+		else
+		{
+			if (indexIt != m_index.end())
+				m_index.erase(indexIt);
+			m_deadBytes += recordSize;
+		}
+
+		offset += recordSize;
+	}
+
+	inFile.close();
+
+	// drop whatever is after the last good record, so that new records aren't appended after garbage
+	std::error_code ec;
+	const uint64_t fileSize = std::filesystem::file_size(path, ec);
+	if (!ec && fileSize > offset)
+	{
+		BetteRCon::Internal::g_stdErrLog << "KVStore: Discarding " << (fileSize - offset) << " bytes after the last good record in " << path << '\n';
+		std::filesystem::resize_file(path, offset, ec);
+		if (ec)
+		{
+			m_index.clear();
+			m_deadBytes = 0;
+			return false;
+		}
+	}
+
+	m_file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+	if (m_file.good() == false)
+	{
+		m_index.clear();
+		m_deadBytes = 0;
+		return false;
+	}
+
+	m_path = path;
+	m_fileSize = offset;
+
+	// write the header for a new store
+	if (m_fileSize == 0)
+	{
+		RecordWriter newHeader;
+		for (const char c : s_storeMagic)
+			newHeader.Write(c);
+		newHeader.Write(s_storeVersion);
+
+		m_file.seekp(0);
+		m_file.write(newHeader.GetData().data(), newHeader.GetData().size());
+		m_file.flush();
+		m_fileSize = s_storeHeaderSize;
+	}
+
+	return m_file.good();
+}
+
+void KVStore::Close()
+{
+	if (m_file.is_open() == true)
+		m_file.close();
+	m_file.clear();
+
+	m_path.clear();
+	m_fileSize = 0;
+	m_index.clear();
+	m_deadBytes = 0;
+	m_pages.clear();
+	m_pageMap.clear();
+}
+
+bool KVStore::IsOpen() const noexcept
+{
+	return m_file.is_open();
+}
+
+bool KVStore::Put(const std::string_view key, const std::string_view value, const Clock_t::time_point expiry)
+{
+	if (IsOpen() == false)
+		return false;
+
+	IndexEntry entry;
+	if (AppendRecord(RecordType_Put, key, value, ToExpirySeconds(expiry), entry) == false)
+		return false;
+
+	// replace the old record
+	const Index_t::iterator indexIt = m_index.find(key);
+	if (indexIt != m_index.end())
+	{
+		m_deadBytes += indexIt->second.size;
+		indexIt->second = entry;
+	}
+	else
+		m_index.emplace(std::string(key), entry);
+
+	MaybeCompact();
+
+	return true;
+}
+
+std::optional<std::string> KVStore::Get(const std::string_view key)
+{
+	const Index_t::const_iterator indexIt = m_index.find(key);
+	if (indexIt == m_index.end() ||
+		IsExpired(indexIt->second, NowSeconds()) == true)
+		return std::nullopt;
+
+	std::string value;
+	if (ReadValue(indexIt->second, value) == false)
+		return std::nullopt;
+
+	return value;
+}
+
+bool KVStore::Erase(const std::string_view key)
+{
+	const Index_t::iterator indexIt = m_index.find(key);
+	if (indexIt == m_index.end())
+		return false;
+
+	// record the erase so that it survives a restart
+	IndexEntry entry;
+	if (AppendRecord(RecordType_Erase, key, {}, 0, entry) == false)
+		return false;
+
+	m_deadBytes += indexIt->second.size + entry.size;
+	m_index.erase(indexIt);
+
+	MaybeCompact();
+
+	return true;
+}
+
+void KVStore::Scan(const std::string_view begin, const std::string_view end, const ScanCallback_t& scanCallback)
+{
+	const int64_t nowSeconds = NowSeconds();
+
+	std::string value;
+	for (Index_t::const_iterator indexIt = m_index.lower_bound(begin); indexIt != m_index.end(); ++indexIt)
+	{
+		if (end.empty() == false &&
+			indexIt->first >= end)
+			break;
+
+		if (IsExpired(indexIt->second, nowSeconds) == true ||
+			ReadValue(indexIt->second, value) == false)
+			continue;
+
+		if (scanCallback(indexIt->first, value) == false)
+			break;
+	}
+}
+
+bool KVStore::Compact()
+{
+	if (IsOpen() == false)
+		return false;
+
+	const std::string compactPath = m_path + ".compact";
+	std::ofstream outFile(compactPath, std::ios::binary | std::ios::trunc);
+	if (outFile.good() == false)
+		return false;
+
+	RecordWriter newHeader;
+	for (const char c : s_storeMagic)
+		newHeader.Write(c);
+	newHeader.Write(s_storeVersion);
+	outFile.write(newHeader.GetData().data(), newHeader.GetData().size());
+
+	// copy the live records in key order, which also makes scans read the file sequentially
+	const int64_t nowSeconds = NowSeconds();
+	Index_t newIndex;
+	uint64_t newFileSize = s_storeHeaderSize;
+	std::vector<char> record;
+	for (const Index_t::value_type& indexPair : m_index)
+	{
+		if (IsExpired(indexPair.second, nowSeconds) == true)
+			continue;
+
+		if (ReadRecord(indexPair.second, record) == false)
+		{
+			outFile.close();
+			std::error_code ignored;
+			std::filesystem::remove(compactPath, ignored);
+			return false;
+		}
+
+		outFile.write(record.data(), record.size());
+		newIndex.emplace_hint(newIndex.end(), indexPair.first, IndexEntry{ newFileSize, indexPair.second.size, indexPair.second.expirySeconds });
+		newFileSize += indexPair.second.size;
+	}
+
+	outFile.close();
+	if (outFile.fail() == true)
+	{
+		std::error_code ignored;
+		std::filesystem::remove(compactPath, ignored);
+		return false;
+	}
+
+	// swap the compacted file in
+	m_file.close();
+
+	std::error_code ec;
+	std::filesystem::rename(compactPath, m_path, ec);
+
+	m_file.clear();
+	m_file.open(m_path, std::ios::binary | std::ios::in | std::ios::out);
+	m_pages.clear();
+	m_pageMap.clear();
+
+	if (ec)
+	{
+		// we still have the old file
+		std::filesystem::remove(compactPath, ec);
+		return false;
+	}
+
+	m_index.swap(newIndex);
+	m_fileSize = newFileSize;
+	m_deadBytes = 0;
+
+	return m_file.good();
+}
+
+size_t KVStore::Size() const noexcept
+{
+	return m_index.size();
+}
+
+KVStore::~KVStore()
+{
+	Close();
+}
+
+bool KVStore::IsExpired(const IndexEntry& entry, const int64_t nowSeconds) noexcept
+{
+	return entry.expirySeconds != s_noExpiry &&
+		entry.expirySeconds <= nowSeconds;
+}
+
+bool KVStore::AppendRecord(const RecordType type, const std::string_view key, const std::string_view value, const int64_t expirySeconds, IndexEntry& entryOut)
+{
+	RecordWriter payload;
+	payload.Write(type);
+	payload.Write(expirySeconds);
+	payload.WriteString(key);
+	payload.WriteString(value);
+
+	// frame it so that the whole record goes out in one write
+	const std::string_view payloadData = payload.GetData();
+	RecordWriter record;
+	record.Write(static_cast<uint32_t>(payloadData.size()));
+	const std::string_view sizeData = record.GetData();
+
+	std::string recordData;
+	recordData.reserve(payloadData.size() + s_recordOverhead);
+	recordData.append(sizeData.data(), sizeData.size());
+	recordData.append(payloadData.data(), payloadData.size());
+
+	record.Clear();
+	record.Write(Crc32(payloadData.data(), payloadData.size()));
+	recordData.append(record.GetData().data(), record.GetData().size());
+
+	m_file.seekp(m_fileSize);
+	m_file.write(recordData.data(), recordData.size());
+	m_file.flush();
+
+	if (m_file.good() == false)
+	{
+		// a partial record is discarded the next time the store is opened
+		m_file.clear();
+		return false;
+	}
+
+	InvalidatePages(m_fileSize, recordData.size());
+
+	entryOut = IndexEntry{ m_fileSize, static_cast<uint32_t>(recordData.size()), expirySeconds };
+	m_fileSize += recordData.size();
+
+	return true;
+}
+
+bool KVStore::ReadRecord(const IndexEntry& entry, std::vector<char>& recordOut)
+{
+	recordOut.resize(entry.size);
+
+	// copy the record out of the cached pages it spans
+	uint64_t offset = entry.offset;
+	size_t copied = 0;
+	while (copied < entry.size)
+	{
+		const std::vector<char>& page = GetPage(offset / s_pageSize);
+		const size_t pageOffset = offset % s_pageSize;
+		if (pageOffset >= page.size())
+			return false;
+
+		const size_t toCopy = std::min(page.size() - pageOffset, entry.size - copied);
+		memcpy(&recordOut[copied], &page[pageOffset], toCopy);
+
+		copied += toCopy;
+		offset += toCopy;
+	}
+
+	return true;
+}
+
+bool KVStore::ReadValue(const IndexEntry& entry, std::string& valueOut)
+{
+	if (ReadRecord(entry, m_recordBuf) == false ||
+		m_recordBuf.size() < s_recordOverhead)
+		return false;
+
+	// check the record is intact
+	const size_t payloadSize = m_recordBuf.size() - s_recordOverhead;
+	const char* pPayload = m_recordBuf.data() + sizeof(uint32_t);
+	const uint32_t recordCrc = RecordReader(std::string_view(pPayload + payloadSize, sizeof(uint32_t))).Read<uint32_t>();
+	if (recordCrc != Crc32(pPayload, payloadSize))
+	{
+		BetteRCon::Internal::g_stdErrLog << "KVStore: Checksum mismatch at offset " << entry.offset << '\n';
+		return false;
+	}
+
+	RecordReader payload(std::string_view(pPayload, payloadSize));
+	payload.Read<uint8_t>();
+	payload.Read<int64_t>();
+	payload.ReadString();
+	const std::string_view value = payload.ReadString();
+	if (payload.IsGood() == false)
+		return false;
+
+	valueOut.assign(value.data(), value.size());
+
+	return true;
+}
+
+const std::vector<char>& KVStore::GetPage(const uint64_t pageNumber)
+{
+	// see if it is cached
+	const std::unordered_map<uint64_t, PageList_t::iterator>::iterator pageIt = m_pageMap.find(pageNumber);
+	if (pageIt != m_pageMap.end())
+	{
+		m_pages.splice(m_pages.begin(), m_pages, pageIt->second);
+		return pageIt->second->data;
+	}
+
+	// evict the least recently used page, reusing its buffer
+	Page page{ pageNumber, {} };
+	if (m_pages.size() >= m_cachePages)
+	{
+		m_pageMap.erase(m_pages.back().pageNumber);
+		page.data = std::move(m_pages.back().data);
+		m_pages.pop_back();
+	}
+
+	// read it from the file. the last page may be partial
+	const uint64_t pageOffset = pageNumber * s_pageSize;
+	const size_t pageSize = (pageOffset < m_fileSize) ? static_cast<size_t>(std::min<uint64_t>(s_pageSize, m_fileSize - pageOffset)) : 0;
+
+	page.data.resize(pageSize);
+	if (pageSize != 0)
+	{
+		m_file.seekg(pageOffset);
+		m_file.read(page.data.data(), pageSize);
+		if (m_file.gcount() != static_cast<std::streamsize>(pageSize))
+			page.data.resize(static_cast<size_t>(std::max<std::streamsize>(m_file.gcount(), 0)));
+		m_file.clear();
+	}
+
+	m_pages.push_front(std::move(page));
+	m_pageMap.emplace(pageNumber, m_pages.begin());
+
+	return m_pages.front().data;
+}
+
+void KVStore::InvalidatePages(const uint64_t offset, const size_t size)
+{
+	const uint64_t lastPage = (offset + size - 1) / s_pageSize;
+	for (uint64_t pageNumber = offset / s_pageSize; pageNumber <= lastPage; ++pageNumber)
+	{
+		const std::unordered_map<uint64_t, PageList_t::iterator>::iterator pageIt = m_pageMap.find(pageNumber);
+		if (pageIt == m_pageMap.end())
+			continue;
+
+		m_pages.erase(pageIt->second);
+		m_pageMap.erase(pageIt);
+	}
+}
+
+void KVStore::MaybeCompact()
+{
+	// compact once most of the file is dead
+	if (m_deadBytes < s_minCompactionBytes ||
+		m_deadBytes * 2 < m_fileSize)
+		return;
+
+	if (Compact() == false)
+		BetteRCon::Internal::g_stdErrLog << "KVStore: Failed to compact " << m_path << '\n';
+}
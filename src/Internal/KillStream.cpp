@@ -0,0 +1,266 @@
+#include <BetteRCon/Internal/KillStream.h>
+
+#include <algorithm>
+
+using BetteRCon::Internal::KillStream;
+
+KillStream::KillStream(const size_t numBuckets, const Clock_t::duration bucketDuration)
+	: m_numBuckets(std::max<size_t>(numBuckets, 1)), m_bucketDuration(std::max<Clock_t::duration>(bucketDuration, Clock_t::duration(1))) {}
+
+void KillStream::AddKill(const std::string& killerName, const std::string& victimName, const std::string_view weapon, const bool headshot, const Clock_t::time_point now)
+{
+	if (victimName.empty() == false)
+	{
+		Bucket& victimBucket = GetBucket(GetPlayerWindow(victimName, now), now);
+		if (victimBucket.deaths != UINT16_MAX)
+			++victimBucket.deaths;
+	}
+
+	// they suicided
+	if (killerName.empty() == true ||
+		killerName == victimName)
+		return;
+
+	const uint32_t weaponId = GetWeaponId(weapon);
+
+	PlayerWindow& killerWindow = GetPlayerWindow(killerName, now);
+	Bucket& killerBucket = GetBucket(killerWindow, now);
+	if (killerBucket.kills != UINT16_MAX)
+	{
+		++killerBucket.kills;
+		killerBucket.headshots += headshot;
+
+		// players only use a few weapons in a bucket, so a list beats a map
+		std::vector<std::pair<uint32_t, uint16_t>>::iterator weaponIt = std::find_if(killerBucket.weapons.begin(), killerBucket.weapons.end(),
+			[weaponId](const std::pair<uint32_t, uint16_t>& weaponKills) { return weaponKills.first == weaponId; });
+		if (weaponIt != killerBucket.weapons.end())
+			++weaponIt->second;
+		else
+			killerBucket.weapons.emplace_back(weaponId, 1);
+	}
+
+	// only kills push a player's stats up
+	if (m_subscriptions.empty() == false)
+		CheckThresholds(killerName, killerWindow, now);
+}
+
+bool KillStream::GetStats(const std::string_view playerName, const Clock_t::time_point now, Stats& statsOut) const
+{
+	const PlayerWindowMap_t::const_iterator playerWindowIt = m_playerWindows.find(std::string(playerName));
+	if (playerWindowIt == m_playerWindows.end())
+	{
+		statsOut = Stats{};
+		return false;
+	}
+
+	CalculateStats(playerWindowIt->second, now, statsOut);
+	return statsOut.kills != 0 || statsOut.deaths != 0;
+}
+
+void KillStream::RemovePlayer(const std::string& playerName)
+{
+	m_playerWindows.erase(playerName);
+
+	for (SubscriptionMap_t::value_type& subscription : m_subscriptions)
+		subscription.second.crossed.erase(playerName);
+}
+
+void KillStream::Prune(const Clock_t::time_point now)
+{
+	const int64_t oldestBucket = GetBucketNumber(now) - static_cast<int64_t>(m_numBuckets) + 1;
+
+	for (PlayerWindowMap_t::iterator playerWindowIt = m_playerWindows.begin(); playerWindowIt != m_playerWindows.end();)
+	{
+		const std::vector<Bucket>& buckets = playerWindowIt->second.buckets;
+		const bool active = std::any_of(buckets.begin(), buckets.end(), [oldestBucket](const Bucket& bucket) { return bucket.number >= oldestBucket; });
+		if (active == true)
+		{
+			++playerWindowIt;
+			continue;
+		}
+
+		for (SubscriptionMap_t::value_type& subscription : m_subscriptions)
+			subscription.second.crossed.erase(playerWindowIt->first);
+
+		playerWindowIt = m_playerWindows.erase(playerWindowIt);
+	}
+}
+
+KillStream::SubscriptionId_t KillStream::Subscribe(const Threshold& threshold, ThresholdCallback_t&& thresholdCallback)
+{
+	const SubscriptionId_t subscriptionId = m_nextSubscriptionId++;
+
+	Subscription& subscription = m_subscriptions[subscriptionId];
+	subscription.threshold = threshold;
+	subscription.weaponId = (threshold.metric == Metric_WeaponKills) ? GetWeaponId(threshold.weapon) : UINT32_MAX;
+	subscription.thresholdCallback = std::move(thresholdCallback);
+
+	return subscriptionId;
+}
+
+void KillStream::Unsubscribe(const SubscriptionId_t subscriptionId)
+{
+	m_subscriptions.erase(subscriptionId);
+}
+
+void KillStream::Clear()
+{
+	m_playerWindows.clear();
+	m_weaponIds.clear();
+	m_weaponNames.clear();
+	m_subscriptions.clear();
+}
+
+int64_t KillStream::GetBucketNumber(const Clock_t::time_point now) const noexcept
+{
+	return now.time_since_epoch() / m_bucketDuration;
+}
+
+KillStream::PlayerWindow& KillStream::GetPlayerWindow(const std::string& playerName, const Clock_t::time_point now)
+{
+	const std::pair<PlayerWindowMap_t::iterator, bool> result = m_playerWindows.try_emplace(playerName);
+
+	PlayerWindow& playerWindow = result.first->second;
+	if (result.second == true)
+	{
+		playerWindow.buckets.resize(m_numBuckets);
+		playerWindow.firstSeen = now;
+	}
+
+	return playerWindow;
+}
+
+KillStream::Bucket& KillStream::GetBucket(PlayerWindow& playerWindow, const Clock_t::time_point now)
+{
+	const int64_t bucketNumber = GetBucketNumber(now);
+
+	Bucket& bucket = playerWindow.buckets[static_cast<size_t>(bucketNumber) % m_numBuckets];
+	if (bucket.number != bucketNumber)
+	{
+		// the bucket last held a slice of time that has left the window. keep the weapon list's storage
+		bucket.number = bucketNumber;
+		bucket.kills = 0;
+		bucket.deaths = 0;
+		bucket.headshots = 0;
+		bucket.weapons.clear();
+	}
+
+	return bucket;
+}
+
+void KillStream::CalculateStats(const PlayerWindow& playerWindow, const Clock_t::time_point now, Stats& statsOut) const
+{
+	const int64_t newestBucket = GetBucketNumber(now);
+	const int64_t oldestBucket = newestBucket - static_cast<int64_t>(m_numBuckets) + 1;
+
+	statsOut.kills = 0;
+	statsOut.deaths = 0;
+	statsOut.headshots = 0;
+	statsOut.weapons.clear();
+
+	m_weaponKills.resize(m_weaponNames.size());
+	m_windowWeapons.clear();
+
+	for (const Bucket& bucket : playerWindow.buckets)
+	{
+		if (bucket.number < oldestBucket ||
+			bucket.number > newestBucket)
+			continue;
+
+		statsOut.kills += bucket.kills;
+		statsOut.deaths += bucket.deaths;
+		statsOut.headshots += bucket.headshots;
+
+		for (const std::pair<uint32_t, uint16_t>& weaponKills : bucket.weapons)
+		{
+			if (m_weaponKills[weaponKills.first] == 0)
+				m_windowWeapons.push_back(weaponKills.first);
+
+			m_weaponKills[weaponKills.first] += weaponKills.second;
+		}
+	}
+
+	// gather the totals, and leave the scratch counts at zero for next time
+	for (const uint32_t weaponId : m_windowWeapons)
+	{
+		statsOut.weapons.push_back(WeaponKills{ *m_weaponNames[weaponId], m_weaponKills[weaponId] });
+		m_weaponKills[weaponId] = 0;
+	}
+
+	std::sort(statsOut.weapons.begin(), statsOut.weapons.end(), [](const WeaponKills& first, const WeaponKills& second)
+	{
+		return first.kills > second.kills;
+	});
+
+	// a player who joined partway through the window has had less time to get kills
+	const Clock_t::duration window = m_bucketDuration * static_cast<int64_t>(m_numBuckets);
+	const Clock_t::duration timeSeen = std::min(now - playerWindow.firstSeen, window);
+	const float minutesSeen = std::max(std::chrono::duration<float, std::ratio<60>>(timeSeen).count(), 1.f);
+
+	statsOut.killsPerMinute = statsOut.kills / minutesSeen;
+	statsOut.headshotRatio = (statsOut.kills != 0) ? static_cast<float>(statsOut.headshots) / statsOut.kills : 0.f;
+}
+
+float KillStream::GetMetric(const Subscription& subscription, const Stats& stats) const
+{
+	switch (subscription.threshold.metric)
+	{
+	case Metric_KillsPerMinute:
+		return stats.killsPerMinute;
+	case Metric_HeadshotRatio:
+		return stats.headshotRatio;
+	case Metric_WeaponKills:
+	{
+		const std::string_view weapon = *m_weaponNames[subscription.weaponId];
+		const std::vector<WeaponKills>::const_iterator weaponIt = std::find_if(stats.weapons.begin(), stats.weapons.end(),
+			[weapon](const WeaponKills& weaponKills) { return weaponKills.weapon == weapon; });
+		return (weaponIt != stats.weapons.end()) ? static_cast<float>(weaponIt->kills) : 0.f;
+	}
+	default:
+		return 0.f;
+	}
+}
+
+void KillStream::CheckThresholds(const std::string& playerName, const PlayerWindow& playerWindow, const Clock_t::time_point now)
+{
+	CalculateStats(playerWindow, now, m_stats);
+
+	// find every crossing first, because callbacks may subscribe or unsubscribe
+	m_crossedSubscriptions.clear();
+	for (SubscriptionMap_t::value_type& subscription : m_subscriptions)
+	{
+		const bool above = m_stats.kills >= subscription.second.threshold.minKills &&
+			GetMetric(subscription.second, m_stats) >= subscription.second.threshold.value;
+
+		if (above == false)
+			subscription.second.crossed.erase(playerName);
+		else if (subscription.second.crossed.insert(playerName).second == true)
+			m_crossedSubscriptions.push_back(subscription.first);
+	}
+
+	if (m_crossedSubscriptions.empty() == true)
+		return;
+
+	// the stats are copied in case a callback adds a kill
+	const Stats stats = m_stats;
+	const std::vector<SubscriptionId_t> crossedSubscriptions = m_crossedSubscriptions;
+	for (const SubscriptionId_t subscriptionId : crossedSubscriptions)
+	{
+		const SubscriptionMap_t::const_iterator subscriptionIt = m_subscriptions.find(subscriptionId);
+		if (subscriptionIt == m_subscriptions.end())
+			continue;
+
+		// copy the callback, so that it survives unsubscribing itself
+		const ThresholdCallback_t thresholdCallback = subscriptionIt->second.thresholdCallback;
+		thresholdCallback(playerName, stats);
+	}
+}
+
+uint32_t KillStream::GetWeaponId(const std::string_view weapon)
+{
+	const std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> result = m_weaponIds.emplace(std::string(weapon), static_cast<uint32_t>(m_weaponNames.size()));
+	if (result.second == true)
+		m_weaponNames.push_back(&result.first->first);
+
+	return result.first->second;
+}
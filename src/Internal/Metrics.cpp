@@ -0,0 +1,254 @@
+#include <BetteRCon/Internal/Metrics.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string_view>
+
+using BetteRCon::Internal::MetricCounter;
+using BetteRCon::Internal::MetricGauge;
+using BetteRCon::Internal::MetricHistogram;
+using BetteRCon::Internal::MetricRegistry;
+
+namespace
+{
+	constexpr std::string_view s_metricTypeStr[] = { "counter", "gauge", "histogram" };
+
+	void AppendSeconds(std::string& out, const std::chrono::nanoseconds duration)
+	{
+		char buf[32];
+		const int length = std::snprintf(buf, sizeof(buf), "%.9g", std::chrono::duration<double>(duration).count());
+		out.append(buf, static_cast<size_t>(std::max(length, 0)));
+	}
+
+	// help only escapes backslashes and newlines, and label values quotes too
+	void AppendEscaped(std::string& out, const std::string& text, const bool escapeQuotes)
+	{
+		for (const char c : text)
+		{
+			if (c == '\\')
+				out.append("\\\\");
+			else if (c == '\n')
+				out.append("\\n");
+			else if (c == '"' &&
+				escapeQuotes == true)
+				out.append("\\\"");
+			else
+				out.push_back(c);
+		}
+	}
+
+	// adds a label to rendered labels, for the le of histogram buckets
+	void AppendWithLabel(std::string& out, const std::string& labels, const std::string_view label)
+	{
+		if (labels.empty() == true)
+		{
+			out.push_back('{');
+			out.append(label);
+			out.push_back('}');
+			return;
+		}
+
+		out.append(labels, 0, labels.size() - 1);
+		out.push_back(',');
+		out.append(label);
+		out.push_back('}');
+	}
+}
+
+uint64_t MetricCounter::GetValue() const noexcept
+{
+	uint64_t value = 0;
+	for (const Shard& shard : m_shards)
+		value += shard.value.load(std::memory_order_relaxed);
+
+	return value;
+}
+
+MetricHistogram::MetricHistogram(const Bounds_t& bounds)
+	: m_bounds(bounds)
+{
+	for (Shard& shard : m_shards)
+	{
+		shard.counts = std::make_unique<std::atomic<uint64_t>[]>(m_bounds.size() + 1);
+		for (size_t i = 0; i < m_bounds.size() + 1; ++i)
+			shard.counts[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void MetricHistogram::Observe(const std::chrono::nanoseconds duration) noexcept
+{
+	// the first bucket whose bound is at least the duration, or the one past the last
+	const size_t bucket = static_cast<size_t>(std::lower_bound(m_bounds.begin(), m_bounds.end(), duration) - m_bounds.begin());
+
+	Shard& shard = m_shards[GetMetricShard()];
+	shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+	shard.sum.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+const MetricHistogram::Bounds_t& MetricHistogram::GetBounds() const noexcept
+{
+	return m_bounds;
+}
+
+void MetricHistogram::GetSnapshot(Snapshot& snapshotOut) const
+{
+	snapshotOut.counts.assign(m_bounds.size() + 1, 0);
+	snapshotOut.sum = std::chrono::nanoseconds::zero();
+
+	for (const Shard& shard : m_shards)
+	{
+		for (size_t i = 0; i < snapshotOut.counts.size(); ++i)
+			snapshotOut.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+
+		snapshotOut.sum += std::chrono::nanoseconds(shard.sum.load(std::memory_order_relaxed));
+	}
+}
+
+const MetricHistogram::Bounds_t& MetricHistogram::GetDefaultBounds()
+{
+	static const Bounds_t s_defaultBounds = []()
+	{
+		Bounds_t bounds;
+		for (int64_t decade = 1000; decade <= 1000000000; decade *= 10)
+		{
+			bounds.emplace_back(decade);
+			bounds.emplace_back(decade * 5 / 2);
+			bounds.emplace_back(decade * 5);
+		}
+		bounds.emplace_back(10000000000);
+
+		return bounds;
+	}();
+
+	return s_defaultBounds;
+}
+
+MetricCounter* MetricRegistry::GetCounter(const std::string& name, const std::string& help, const Labels_t& labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Family* pFamily = GetFamily(name, help, MetricType_Counter);
+	if (pFamily == nullptr)
+		return nullptr;
+
+	std::unique_ptr<MetricCounter>& pCounter = pFamily->counters[RenderLabels(labels)];
+	if (pCounter == nullptr)
+		pCounter = std::make_unique<MetricCounter>();
+
+	return pCounter.get();
+}
+
+MetricGauge* MetricRegistry::GetGauge(const std::string& name, const std::string& help, const Labels_t& labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Family* pFamily = GetFamily(name, help, MetricType_Gauge);
+	if (pFamily == nullptr)
+		return nullptr;
+
+	std::unique_ptr<MetricGauge>& pGauge = pFamily->gauges[RenderLabels(labels)];
+	if (pGauge == nullptr)
+		pGauge = std::make_unique<MetricGauge>();
+
+	return pGauge.get();
+}
+
+MetricHistogram* MetricRegistry::GetHistogram(const std::string& name, const std::string& help, const Labels_t& labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Family* pFamily = GetFamily(name, help, MetricType_Histogram);
+	if (pFamily == nullptr)
+		return nullptr;
+
+	std::unique_ptr<MetricHistogram>& pHistogram = pFamily->histograms[RenderLabels(labels)];
+	if (pHistogram == nullptr)
+		pHistogram = std::make_unique<MetricHistogram>(MetricHistogram::GetDefaultBounds());
+
+	return pHistogram.get();
+}
+
+void MetricRegistry::WriteText(std::string& out) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	MetricHistogram::Snapshot snapshot;
+	for (const std::pair<const std::string, Family>& family : m_families)
+	{
+		const std::string& name = family.first;
+
+		out.append("# HELP ").append(name).push_back(' ');
+		AppendEscaped(out, family.second.help, false);
+		out.append("\n# TYPE ").append(name).push_back(' ');
+		out.append(s_metricTypeStr[family.second.type]).push_back('\n');
+
+		for (const std::pair<const std::string, std::unique_ptr<MetricCounter>>& counter : family.second.counters)
+			out.append(name).append(counter.first).append(" ").append(std::to_string(counter.second->GetValue())).push_back('\n');
+
+		for (const std::pair<const std::string, std::unique_ptr<MetricGauge>>& gauge : family.second.gauges)
+			out.append(name).append(gauge.first).append(" ").append(std::to_string(gauge.second->GetValue())).push_back('\n');
+
+		for (const std::pair<const std::string, std::unique_ptr<MetricHistogram>>& histogram : family.second.histograms)
+		{
+			histogram.second->GetSnapshot(snapshot);
+			const MetricHistogram::Bounds_t& bounds = histogram.second->GetBounds();
+
+			// buckets count everything up to their bound, and the count is the last of them, so that they agree
+			uint64_t cumulativeCount = 0;
+			std::string le;
+			for (size_t i = 0; i < snapshot.counts.size(); ++i)
+			{
+				cumulativeCount += snapshot.counts[i];
+
+				le = "le=\"";
+				if (i < bounds.size())
+					AppendSeconds(le, bounds[i]);
+				else
+					le.append("+Inf");
+				le.push_back('"');
+
+				out.append(name).append("_bucket");
+				AppendWithLabel(out, histogram.first, le);
+				out.append(" ").append(std::to_string(cumulativeCount)).push_back('\n');
+			}
+
+			out.append(name).append("_sum").append(histogram.first).push_back(' ');
+			AppendSeconds(out, snapshot.sum);
+			out.push_back('\n');
+			out.append(name).append("_count").append(histogram.first).append(" ").append(std::to_string(cumulativeCount)).push_back('\n');
+		}
+	}
+}
+
+MetricRegistry::Family* MetricRegistry::GetFamily(const std::string& name, const std::string& help, const MetricType type)
+{
+	const std::map<std::string, Family>::iterator familyIt = m_families.find(name);
+	if (familyIt != m_families.end())
+		return (familyIt->second.type == type) ? &familyIt->second : nullptr;
+
+	Family& family = m_families[name];
+	family.help = help;
+	family.type = type;
+
+	return &family;
+}
+
+std::string MetricRegistry::RenderLabels(const Labels_t& labels)
+{
+	if (labels.empty() == true)
+		return std::string();
+
+	std::string rendered = "{";
+	for (const std::pair<std::string, std::string>& label : labels)
+	{
+		if (rendered.size() != 1)
+			rendered.push_back(',');
+
+		rendered.append(label.first).append("=\"");
+		AppendEscaped(rendered, label.second, true);
+		rendered.push_back('"');
+	}
+	rendered.push_back('}');
+
+	return rendered;
+}
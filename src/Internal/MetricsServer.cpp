@@ -0,0 +1,176 @@
+#include <BetteRCon/Internal/MetricsServer.h>
+
+#include <string_view>
+
+using BetteRCon::Internal::MetricsServer;
+
+MetricsServer::MetricsServer(const MetricRegistry& registry)
+	: m_registry(registry), m_acceptor(m_worker), m_socket(m_worker), m_timeoutTimer(m_worker) {}
+
+MetricsServer::ErrorCode_t MetricsServer::Start(const uint16_t port)
+{
+	Stop();
+
+	// only this host can scrape it
+	const Endpoint_t endpoint(asio::ip::address_v4::loopback(), port);
+
+	ErrorCode_t ec;
+	m_acceptor.open(endpoint.protocol(), ec);
+	if (ec)
+		return ec;
+
+	m_acceptor.set_option(Acceptor_t::reuse_address(true), ec);
+	m_acceptor.bind(endpoint, ec);
+	if (ec)
+	{
+		Stop();
+		return ec;
+	}
+
+	m_acceptor.listen(asio::socket_base::max_listen_connections, ec);
+	if (ec)
+	{
+		Stop();
+		return ec;
+	}
+
+	AcceptClient();
+
+	m_worker.restart();
+	m_thread = std::thread([this]() { m_worker.run(); });
+
+	return ec;
+}
+
+uint16_t MetricsServer::GetPort() const noexcept
+{
+	ErrorCode_t ignored;
+	return (m_acceptor.is_open() == true) ? m_acceptor.local_endpoint(ignored).port() : 0;
+}
+
+void MetricsServer::Stop()
+{
+	if (m_thread.joinable() == true)
+	{
+		m_worker.stop();
+		m_thread.join();
+	}
+
+	ErrorCode_t ignored;
+	m_acceptor.close(ignored);
+	m_socket.close(ignored);
+	m_timeoutTimer.cancel(ignored);
+}
+
+MetricsServer::~MetricsServer()
+{
+	Stop();
+}
+
+void MetricsServer::AcceptClient()
+{
+	m_acceptor.async_accept(m_socket, std::bind(&MetricsServer::HandleAccept, this, std::placeholders::_1));
+}
+
+void MetricsServer::CloseClient()
+{
+	ErrorCode_t ignored;
+	m_socket.shutdown(Socket_t::shutdown_both, ignored);
+	m_socket.close(ignored);
+	m_timeoutTimer.cancel(ignored);
+
+	// a timeout that already fired is for the old client
+	++m_clientId;
+
+	// wait for the next client
+	AcceptClient();
+}
+
+void MetricsServer::HandleAccept(const ErrorCode_t& ec)
+{
+	if (ec)
+	{
+		// the acceptor was closed
+		if (ec == asio::error::operation_aborted)
+			return;
+
+		return AcceptClient();
+	}
+
+	m_request.clear();
+
+	m_timeoutTimer.expires_after(s_requestTimeout);
+	m_timeoutTimer.async_wait(std::bind(&MetricsServer::HandleTimeout, this, std::placeholders::_1, m_clientId));
+
+	asio::async_read_until(m_socket, asio::dynamic_buffer(m_request, s_maxRequestSize), "\r\n\r\n",
+		std::bind(&MetricsServer::HandleRead, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+void MetricsServer::HandleRead(const ErrorCode_t& ec, const size_t bytes_transferred)
+{
+	if (ec)
+	{
+		if (ec != asio::error::operation_aborted)
+			CloseClient();
+		return;
+	}
+
+	// only the request line matters. the path is the second word, up to any query
+	const std::string_view request(m_request.data(), bytes_transferred);
+	const std::string_view requestLine = request.substr(0, request.find("\r\n"));
+	const size_t pathStart = requestLine.find(' ');
+	const size_t pathEnd = requestLine.find_first_of(" ?", pathStart + 1);
+	const std::string_view method = requestLine.substr(0, pathStart);
+	const std::string_view path = (pathStart != std::string_view::npos) ? requestLine.substr(pathStart + 1, pathEnd - pathStart - 1) : std::string_view();
+
+	std::string body;
+	std::string_view status;
+	std::string_view contentType = "text/plain; charset=utf-8";
+	if (method != "GET" &&
+		method != "HEAD")
+	{
+		status = "405 Method Not Allowed";
+		body = "Only GET is supported\n";
+	}
+	else if (path != "/metrics")
+	{
+		status = "404 Not Found";
+		body = "Metrics are at /metrics\n";
+	}
+	else
+	{
+		status = "200 OK";
+		contentType = "text/plain; version=0.0.4; charset=utf-8";
+		m_registry.WriteText(body);
+	}
+
+	m_response.clear();
+	m_response.append("HTTP/1.1 ").append(status).append("\r\n");
+	m_response.append("Content-Type: ").append(contentType).append("\r\n");
+	m_response.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+	m_response.append("Connection: close\r\n\r\n");
+	if (method != "HEAD")
+		m_response.append(body);
+
+	asio::async_write(m_socket, asio::buffer(m_response),
+		std::bind(&MetricsServer::HandleWrite, this, std::placeholders::_1, std::placeholders::_2));
+}
+
+void MetricsServer::HandleWrite(const ErrorCode_t& ec, const size_t bytes_transferred)
+{
+	if (ec == asio::error::operation_aborted)
+		return;
+
+	CloseClient();
+}
+
+void MetricsServer::HandleTimeout(const ErrorCode_t& ec, const uint32_t clientId)
+{
+	// the request finished in time
+	if (ec == asio::error::operation_aborted ||
+		clientId != m_clientId)
+		return;
+
+	// the read or write is aborted, and leaves accepting the next client to us
+	CloseClient();
+}
@@ -0,0 +1,547 @@
+#include <BetteRCon/Internal/MockServer.h>
+#include <MD5.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+using BetteRCon::Internal::MockServer;
+using BetteRCon::Internal::Packet;
+
+namespace
+{
+	// the simulation runs this often, and catches up on everything that was due
+	constexpr std::chrono::milliseconds s_tickInterval(10);
+
+	constexpr const char* s_weapons[] = { "M416", "AK-12", "SCAR-H", "M98B", "U_Glock18", "Knife", "U_M320_HE", "Roadkill" };
+	constexpr const char* s_chatMessages[] = { "gg", "lol", "nice shot", "who is camping B", "rush C", "!rules", "!help", "anyone want to squad up?" };
+
+	std::string ToHex(const uint64_t value, const size_t digits)
+	{
+		static constexpr char s_hexDigits[] = "0123456789ABCDEF";
+
+		std::string hex(digits, '0');
+		for (size_t i = 0; i < digits && i < 16; ++i)
+			hex[digits - i - 1] = s_hexDigits[(value >> (i * 4)) & 0xf];
+
+		return hex;
+	}
+}
+
+MockServer::MockServer(Worker_t& worker, const Settings& settings)
+	: m_worker(worker), m_endpoint(worker), m_tickTimer(worker), m_settings(settings), m_random(settings.seed)
+{
+	// the players are there from the start, so their join events never happen
+	const uint32_t players = std::min(m_settings.players, m_settings.maxPlayers);
+	for (uint32_t i = 0; i < players; ++i)
+		m_players.push_back(MakePlayer());
+
+	m_teamTickets[0] = m_teamTickets[1] = static_cast<int32_t>(m_settings.tickets);
+}
+
+MockServer::ErrorCode_t MockServer::Listen(const Endpoint_t& endpoint)
+{
+	return m_endpoint.Listen(endpoint, std::bind(&MockServer::HandleAccept, this),
+		std::bind(&MockServer::HandlePacket, this, std::placeholders::_1),
+		std::bind(&MockServer::HandleDisconnect, this));
+}
+
+MockServer::Endpoint_t MockServer::GetLocalEndpoint() const
+{
+	return m_endpoint.GetLocalEndpoint();
+}
+
+void MockServer::Close()
+{
+	ErrorCode_t ignored;
+	m_tickTimer.cancel(ignored);
+
+	m_endpoint.Close();
+	HandleDisconnect();
+}
+
+void MockServer::SetResponse(const std::string& command, const Words_t& response)
+{
+	m_responses[command] = response;
+}
+
+void MockServer::ScheduleEvent(const Clock_t::duration offset, const Words_t& event)
+{
+	const ScheduledEvent scheduledEvent{ offset, event };
+
+	// keep them in order, with events at the same time in the order they were added
+	const std::vector<ScheduledEvent>::iterator insertIt = std::upper_bound(m_scheduledEvents.begin(), m_scheduledEvents.end(), scheduledEvent,
+		[](const ScheduledEvent& a, const ScheduledEvent& b) { return a.offset < b.offset; });
+
+	m_scheduledEvents.insert(insertIt, scheduledEvent);
+}
+
+void MockServer::SendEvent(const Words_t& event)
+{
+	if (m_eventsEnabled == false ||
+		m_endpoint.IsConnected() == false)
+		return;
+
+	m_sequence = (m_sequence + 1) & 0x3FFFFFFF;
+	if (m_eventAckCallback)
+		m_unacknowledgedEvents.emplace_back(m_sequence, Clock_t::now());
+
+	m_endpoint.SendPacket(Packet(event, m_sequence));
+
+	++m_stats.events;
+}
+
+void MockServer::SetRates(const double joinsPerMinute, const double leavesPerMinute, const double killsPerMinute, const double chatsPerMinute)
+{
+	m_settings.joinsPerMinute = joinsPerMinute;
+	m_settings.leavesPerMinute = leavesPerMinute;
+	m_settings.killsPerMinute = killsPerMinute;
+	m_settings.chatsPerMinute = chatsPerMinute;
+
+	if (m_eventsEnabled == false)
+		return;
+
+	// the new rates start now, rather than after events that were due at the old ones
+	const Clock_t::time_point now = Clock_t::now();
+	m_nextJoin = GetNextTime(now, m_settings.joinsPerMinute);
+	m_nextLeave = GetNextTime(now, m_settings.leavesPerMinute);
+	m_nextKill = GetNextTime(now, m_settings.killsPerMinute);
+	m_nextChat = GetNextTime(now, m_settings.chatsPerMinute);
+}
+
+void MockServer::EndRound()
+{
+	EndRound((m_teamTickets[0] >= m_teamTickets[1]) ? 1 : 2);
+}
+
+void MockServer::SetEventAckCallback(EventAckCallback_t&& ackCallback)
+{
+	m_eventAckCallback = std::move(ackCallback);
+	m_unacknowledgedEvents.clear();
+}
+
+const MockServer::Stats& MockServer::GetStats() const noexcept
+{
+	return m_stats;
+}
+
+void MockServer::HandleAccept()
+{
+	m_salt = ToHex(m_random(), 8) + ToHex(m_random(), 8) + ToHex(m_random(), 8) + ToHex(m_random(), 8);
+	m_loggedIn = false;
+	m_eventsEnabled = false;
+	m_nextScheduledEvent = 0;
+
+	m_startTime = m_roundStart = Clock_t::now();
+}
+
+void MockServer::HandlePacket(const Packet& packet)
+{
+	// the client's replies to events
+	if (packet.IsResponse() == true)
+	{
+		++m_stats.acknowledgedEvents;
+
+		while (m_unacknowledgedEvents.empty() == false)
+		{
+			const std::pair<int32_t, Clock_t::time_point> unacknowledgedEvent = m_unacknowledgedEvents.front();
+
+			// an answer to an event sent before the callback was set, which isn't in the queue
+			if (((packet.GetSequence() - unacknowledgedEvent.first) & 0x3FFFFFFF) >= 0x20000000)
+				break;
+
+			m_unacknowledgedEvents.pop_front();
+
+			if (unacknowledgedEvent.first == packet.GetSequence())
+			{
+				m_eventAckCallback(Clock_t::now() - unacknowledgedEvent.second);
+				break;
+			}
+		}
+
+		return;
+	}
+
+	++m_stats.commands;
+
+	// the client has to see the response before anything the command causes
+	const Words_t response = HandleCommand(packet.GetWords());
+	m_endpoint.SendPacket(Packet(response, packet.GetSequence(), true));
+
+	if (packet.GetWords().empty() == false &&
+		packet.GetWords().front() == "punkBuster.pb_sv_command" &&
+		response.front() == "OK")
+		SendPlayerList();
+}
+
+void MockServer::HandleDisconnect()
+{
+	m_loggedIn = false;
+	m_eventsEnabled = false;
+	m_unacknowledgedEvents.clear();
+
+	ErrorCode_t ignored;
+	m_tickTimer.cancel(ignored);
+}
+
+void MockServer::HandleTick(const ErrorCode_t& ec)
+{
+	if (ec ||
+		m_eventsEnabled == false)
+		return;
+
+	const Clock_t::time_point now = Clock_t::now();
+
+	while (m_nextScheduledEvent < m_scheduledEvents.size() &&
+		m_eventsEnabledTime + m_scheduledEvents[m_nextScheduledEvent].offset <= now)
+		SendEvent(m_scheduledEvents[m_nextScheduledEvent++].words);
+
+	// each kind of event catches up separately, so a high rate can send many in one tick
+	while (m_nextJoin <= now)
+	{
+		Join();
+		m_nextJoin = GetNextTime(m_nextJoin, m_settings.joinsPerMinute);
+	}
+
+	while (m_nextLeave <= now)
+	{
+		Leave();
+		m_nextLeave = GetNextTime(m_nextLeave, m_settings.leavesPerMinute);
+	}
+
+	while (m_nextKill <= now)
+	{
+		Kill();
+		m_nextKill = GetNextTime(m_nextKill, m_settings.killsPerMinute);
+	}
+
+	while (m_nextChat <= now)
+	{
+		Chat();
+		m_nextChat = GetNextTime(m_nextChat, m_settings.chatsPerMinute);
+	}
+
+	m_tickTimer.expires_at(now + s_tickInterval);
+	m_tickTimer.async_wait(std::bind(&MockServer::HandleTick, this, std::placeholders::_1));
+}
+
+MockServer::Words_t MockServer::HandleCommand(const Words_t& command)
+{
+	if (command.empty() == true)
+		return { "InvalidArguments" };
+
+	const std::string& commandName = command.front();
+
+	// scripted responses win over everything
+	const std::unordered_map<std::string, Words_t>::const_iterator responseIt = m_responses.find(commandName);
+	if (responseIt != m_responses.end())
+		return responseIt->second;
+
+	if (commandName == "login.hashed")
+	{
+		if (m_settings.password.empty() == true)
+			return { "PasswordNotSet" };
+
+		// the first step asks for the salt
+		if (command.size() == 1)
+			return { "OK", m_salt };
+
+		std::string salt;
+		for (size_t i = 0; i + 1 < m_salt.size(); i += 2)
+			salt.push_back(static_cast<char>(std::stoi(m_salt.substr(i, 2), nullptr, 16)));
+
+		std::string expectedHash = MD5(salt + m_settings.password).hexdigest();
+		std::string hash = command[1];
+		std::transform(expectedHash.begin(), expectedHash.end(), expectedHash.begin(), [](const char c) { return std::tolower(c); });
+		std::transform(hash.begin(), hash.end(), hash.begin(), [](const char c) { return std::tolower(c); });
+
+		if (hash != expectedHash)
+			return { "InvalidPasswordHash" };
+
+		m_loggedIn = true;
+		return { "OK" };
+	}
+
+	if (commandName == "login.plainText")
+	{
+		if (command.size() != 2)
+			return { "InvalidArguments" };
+
+		if (command[1] != m_settings.password)
+			return { "InvalidPassword" };
+
+		m_loggedIn = true;
+		return { "OK" };
+	}
+
+	if (commandName == "version")
+		return { "OK", "BF4", "179665" };
+
+	if (commandName == "serverInfo")
+		return GetServerInfo();
+
+	// everything else needs a login
+	if (m_loggedIn == false)
+		return { "LogInRequired" };
+
+	if (commandName == "admin.eventsEnabled")
+	{
+		if (command.size() != 2)
+			return { "InvalidArguments" };
+
+		const bool eventsEnabled = (command[1] == "true");
+		if (eventsEnabled == true &&
+			m_eventsEnabled == false)
+		{
+			m_eventsEnabled = true;
+			m_eventsEnabledTime = Clock_t::now();
+			m_nextScheduledEvent = 0;
+
+			m_nextJoin = GetNextTime(m_eventsEnabledTime, m_settings.joinsPerMinute);
+			m_nextLeave = GetNextTime(m_eventsEnabledTime, m_settings.leavesPerMinute);
+			m_nextKill = GetNextTime(m_eventsEnabledTime, m_settings.killsPerMinute);
+			m_nextChat = GetNextTime(m_eventsEnabledTime, m_settings.chatsPerMinute);
+
+			m_tickTimer.expires_after(s_tickInterval);
+			m_tickTimer.async_wait(std::bind(&MockServer::HandleTick, this, std::placeholders::_1));
+		}
+
+		m_eventsEnabled = eventsEnabled;
+		return { "OK" };
+	}
+
+	if (commandName == "admin.listPlayers")
+	{
+		Words_t response{ "OK" };
+		AppendPlayers(response);
+		return response;
+	}
+
+	if (commandName == "admin.movePlayer")
+	{
+		if (command.size() != 5)
+			return { "InvalidArguments" };
+
+		const std::vector<Player>::iterator playerIt = std::find_if(m_players.begin(), m_players.end(), [&command](const Player& player) { return player.name == command[1]; });
+		if (playerIt == m_players.end())
+			return { "InvalidPlayerName" };
+
+		int32_t teamId, squadId;
+		try
+		{
+			teamId = std::stoi(command[2]);
+			squadId = std::stoi(command[3]);
+		}
+		catch (const std::exception&)
+		{
+			return { "InvalidArguments" };
+		}
+
+		if (teamId < 1 || teamId > 2)
+			return { "InvalidTeamId" };
+
+		if (squadId < 0 || squadId > 32)
+			return { "InvalidSquadId" };
+
+		const bool teamChanged = (playerIt->teamId != teamId);
+		playerIt->teamId = static_cast<uint8_t>(teamId);
+		playerIt->squadId = static_cast<uint8_t>(squadId);
+
+		// the game announces the move after the response
+		const Words_t moveEvent{ (teamChanged == true) ? "player.onTeamChange" : "player.onSquadChange", playerIt->name, command[2], command[3] };
+		asio::post(m_worker, [this, moveEvent] { SendEvent(moveEvent); });
+
+		return { "OK" };
+	}
+
+	if (commandName == "admin.kickPlayer")
+	{
+		if (command.size() < 2)
+			return { "InvalidArguments" };
+
+		const std::vector<Player>::iterator playerIt = std::find_if(m_players.begin(), m_players.end(), [&command](const Player& player) { return player.name == command[1]; });
+		if (playerIt == m_players.end())
+			return { "PlayerNotFound" };
+
+		const Words_t leaveEvent{ "player.onLeave", playerIt->name };
+		m_players.erase(playerIt);
+		asio::post(m_worker, [this, leaveEvent] { SendEvent(leaveEvent); });
+
+		return { "OK" };
+	}
+
+	if (commandName == "admin.say" ||
+		commandName == "admin.yell" ||
+		commandName == "admin.killPlayer" ||
+		commandName == "punkBuster.pb_sv_command")
+		return (command.size() >= 2) ? Words_t{ "OK" } : Words_t{ "InvalidArguments" };
+
+	++m_stats.unknownCommands;
+	return { "UnknownCommand" };
+}
+
+MockServer::Words_t MockServer::GetServerInfo() const
+{
+	const int64_t upTime = std::chrono::duration_cast<std::chrono::seconds>(Clock_t::now() - m_startTime).count();
+	const int64_t roundTime = std::chrono::duration_cast<std::chrono::seconds>(Clock_t::now() - m_roundStart).count();
+
+	return { "OK", m_settings.serverName, std::to_string(m_players.size()), std::to_string(m_settings.maxPlayers),
+		m_settings.gameMode, m_settings.map, std::to_string(m_roundsPlayed), "2",
+		"2", std::to_string(m_teamTickets[0]), std::to_string(m_teamTickets[1]), "0",
+		"", "true", "true", "false", std::to_string(upTime), std::to_string(roundTime),
+		"127.0.0.1:25200", "v1.905 | A1390 C2.351", "false", "NAm", "i3d-ams", "US",
+		std::to_string(m_players.size()), "IN_GAME" };
+}
+
+void MockServer::AppendPlayers(Words_t& wordsOut) const
+{
+	wordsOut.insert(wordsOut.end(), { "10", "name", "guid", "teamId", "squadId", "kills", "deaths", "score", "rank", "ping", "type" });
+	wordsOut.push_back(std::to_string(m_players.size()));
+
+	for (const Player& player : m_players)
+	{
+		wordsOut.insert(wordsOut.end(), { player.name, player.guid, std::to_string(player.teamId), std::to_string(player.squadId),
+			std::to_string(player.kills), std::to_string(player.deaths), std::to_string(player.score), std::to_string(player.slot % 140),
+			std::to_string(player.ping), "0" });
+	}
+}
+
+void MockServer::SendPlayerList()
+{
+	SendEvent({ "punkBuster.onMessage", "PunkBuster Server: Player List: [Slot #] [GUID] [Address] [Status] [Power] [Auth Rate] [Recent SS] [O/S] [Name]\n" });
+
+	char line[256];
+	for (const Player& player : m_players)
+	{
+		snprintf(line, sizeof(line), "PunkBuster Server: %u  %s(-) %s:%u OK   1 5.0 0 (W) \"%s\"\n",
+			player.slot, player.pbGuid.c_str(), player.ip.c_str(), player.port, player.name.c_str());
+		SendEvent({ "punkBuster.onMessage", line });
+	}
+
+	snprintf(line, sizeof(line), "PunkBuster Server: End of Player List (%zu Players)\n", m_players.size());
+	SendEvent({ "punkBuster.onMessage", line });
+}
+
+MockServer::Player MockServer::MakePlayer()
+{
+	Player player;
+	player.name = "MockPlayer" + std::to_string(m_nextPlayerId++);
+	player.guid = "EA_" + ToHex(m_random(), 8) + ToHex(m_random(), 8) + ToHex(m_random(), 8) + ToHex(m_random(), 8);
+	player.pbGuid = ToHex(m_random(), 8) + ToHex(m_random(), 8) + ToHex(m_random(), 8) + ToHex(m_random(), 8);
+	player.ip = "10." + std::to_string(m_random() % 256) + '.' + std::to_string(m_random() % 256) + '.' + std::to_string(1 + m_random() % 254);
+	player.port = static_cast<uint16_t>(1024 + m_random() % 60000);
+	player.ping = static_cast<uint16_t>(10 + m_random() % 150);
+	player.slot = m_nextSlot++;
+	if (m_nextSlot > m_settings.maxPlayers)
+		m_nextSlot = 1;
+
+	// the smaller team gets them
+	const size_t team1Players = std::count_if(m_players.begin(), m_players.end(), [](const Player& other) { return other.teamId == 1; });
+	player.teamId = (team1Players * 2 <= m_players.size()) ? 1 : 2;
+	player.squadId = static_cast<uint8_t>(1 + m_random() % 8);
+
+	return player;
+}
+
+void MockServer::Join()
+{
+	if (m_players.size() >= m_settings.maxPlayers)
+		return;
+
+	m_players.push_back(MakePlayer());
+	const Player& player = m_players.back();
+
+	char pbLine[256];
+	snprintf(pbLine, sizeof(pbLine), "PunkBuster Server: New Connection (slot #%u) %s:%u [?] \"%s\" (seq %u)\n",
+		player.slot, player.ip.c_str(), player.port, player.name.c_str(), player.slot);
+
+	// the order a real join comes in
+	SendEvent({ "player.onJoin", player.name, player.guid });
+	SendEvent({ "player.onAuthenticated", player.name });
+	SendEvent({ "punkBuster.onMessage", pbLine });
+	SendEvent({ "player.onTeamChange", player.name, std::to_string(player.teamId), std::to_string(player.squadId) });
+	SendEvent({ "player.onSpawn", player.name, std::to_string(player.teamId) });
+}
+
+void MockServer::Leave()
+{
+	if (m_players.empty() == true)
+		return;
+
+	const size_t index = m_random() % m_players.size();
+	const Player player = std::move(m_players[index]);
+	m_players.erase(m_players.begin() + index);
+
+	// the game sends the player's final stats with it
+	SendEvent({ "player.onLeave", player.name, "10", "name", "guid", "teamId", "squadId", "kills", "deaths", "score", "rank", "ping", "type", "1",
+		player.name, player.guid, std::to_string(player.teamId), std::to_string(player.squadId), std::to_string(player.kills),
+		std::to_string(player.deaths), std::to_string(player.score), std::to_string(player.slot % 140), std::to_string(player.ping), "0" });
+}
+
+void MockServer::Kill()
+{
+	if (m_players.size() < 2)
+		return;
+
+	const size_t killerIndex = m_random() % m_players.size();
+	size_t victimIndex = m_random() % (m_players.size() - 1);
+	if (victimIndex >= killerIndex)
+		++victimIndex;
+
+	Player& killer = m_players[killerIndex];
+	Player& victim = m_players[victimIndex];
+
+	// team kills count the same, which keeps it simple
+	++killer.kills;
+	killer.score += 100;
+	++victim.deaths;
+
+	const bool headshot = (m_random() % 4 == 0);
+	SendEvent({ "player.onKill", killer.name, victim.name, s_weapons[m_random() % std::size(s_weapons)], (headshot == true) ? "true" : "false" });
+	SendEvent({ "player.onSpawn", victim.name, std::to_string(victim.teamId) });
+
+	int32_t& tickets = m_teamTickets[(victim.teamId == 2) ? 1 : 0];
+	if (--tickets <= 0)
+		EndRound((victim.teamId == 2) ? 1 : 2);
+}
+
+void MockServer::Chat()
+{
+	if (m_players.empty() == true)
+		return;
+
+	const Player& player = m_players[m_random() % m_players.size()];
+	SendEvent({ "player.onChat", player.name, s_chatMessages[m_random() % std::size(s_chatMessages)], "all" });
+}
+
+void MockServer::EndRound(const uint8_t winner)
+{
+	Words_t roundOverPlayers{ "server.onRoundOverPlayers" };
+	AppendPlayers(roundOverPlayers);
+
+	SendEvent({ "server.onRoundOver", std::to_string(winner) });
+	SendEvent(roundOverPlayers);
+	SendEvent({ "server.onRoundOverTeamScores", "2", std::to_string(std::max(m_teamTickets[0], 0)), std::to_string(std::max(m_teamTickets[1], 0)), "0" });
+
+	// the next round starts straight away
+	for (Player& player : m_players)
+	{
+		player.kills = 0;
+		player.deaths = 0;
+		player.score = 0;
+	}
+
+	m_teamTickets[0] = m_teamTickets[1] = static_cast<int32_t>(m_settings.tickets);
+	m_roundStart = Clock_t::now();
+	++m_roundsPlayed;
+}
+
+MockServer::Clock_t::time_point MockServer::GetNextTime(const Clock_t::time_point from, const double perMinute)
+{
+	if (perMinute <= 0.0)
+		return Clock_t::time_point::max();
+
+	// the time between events in a poisson process is exponential
+	std::exponential_distribution<double> interval(perMinute / 60.0);
+	return from + std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double>(interval(m_random)));
+}
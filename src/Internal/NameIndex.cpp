@@ -0,0 +1,314 @@
+#include <BetteRCon/Internal/NameIndex.h>
+
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include <tuple>
+
+using BetteRCon::Internal::NameIndex;
+
+void NameIndex::Insert(const std::string& name)
+{
+	// make sure they are not already indexed
+	if (name.empty() == true ||
+		m_ids.find(name) != m_ids.end())
+		return;
+
+	// grab a free id
+	Id_t id;
+	if (m_freeIds.empty() == false)
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<Id_t>(m_names.size());
+		m_names.emplace_back();
+	}
+
+	NameEntry& entry = m_names[id];
+	entry.name = name;
+	entry.lowerName = Lower(name);
+	m_ids.emplace(name, id);
+
+	// walk down the trie, creating nodes as we go. nodes are referenced by index because allocating may move them
+	uint32_t node = 0;
+	++m_nodes[node].subtreeCount;
+	for (const char c : entry.lowerName)
+	{
+		std::vector<std::pair<char, uint32_t>>& children = m_nodes[node].children;
+		std::vector<std::pair<char, uint32_t>>::iterator childIt = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t{ 0 }));
+
+		uint32_t child;
+		if (childIt == children.end() || childIt->first != c)
+		{
+			const size_t childOffset = childIt - children.begin();
+			child = AllocateNode();
+			m_nodes[node].children.emplace(m_nodes[node].children.begin() + childOffset, c, child);
+		}
+		else
+			child = childIt->second;
+
+		node = child;
+		++m_nodes[node].subtreeCount;
+	}
+	m_nodes[node].ids.push_back(id);
+
+	// add the trigram postings
+	std::vector<Trigram_t> trigrams;
+	GetTrigrams(entry.lowerName, trigrams);
+	entry.trigramCount = static_cast<uint32_t>(trigrams.size());
+
+	for (const Trigram_t trigram : trigrams)
+		m_trigramPostings[trigram].push_back(id);
+}
+
+void NameIndex::Erase(const std::string& name)
+{
+	const std::unordered_map<std::string, Id_t>::iterator idIt = m_ids.find(name);
+	if (idIt == m_ids.end())
+		return;
+
+	const Id_t id = idIt->second;
+	m_ids.erase(idIt);
+
+	NameEntry& entry = m_names[id];
+
+	// walk down the trie, remembering the path so that we can prune it
+	std::vector<uint32_t> path{ 0 };
+	for (const char c : entry.lowerName)
+	{
+		const std::vector<std::pair<char, uint32_t>>& children = m_nodes[path.back()].children;
+		const std::vector<std::pair<char, uint32_t>>::const_iterator childIt = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t{ 0 }));
+
+		// shouldn't happen
+		if (childIt == children.end() || childIt->first != c)
+			return;
+
+		path.push_back(childIt->second);
+	}
+
+	std::vector<Id_t>& terminalIds = m_nodes[path.back()].ids;
+	terminalIds.erase(std::remove(terminalIds.begin(), terminalIds.end(), id), terminalIds.end());
+
+	for (const uint32_t node : path)
+		--m_nodes[node].subtreeCount;
+
+	// find the first node on the path that no longer leads anywhere. everything below it is only on our path
+	for (size_t i = 1; i < path.size(); ++i)
+	{
+		if (m_nodes[path[i]].subtreeCount != 0)
+			continue;
+
+		std::vector<std::pair<char, uint32_t>>& parentChildren = m_nodes[path[i - 1]].children;
+		parentChildren.erase(std::find_if(parentChildren.begin(), parentChildren.end(),
+			[&path, i](const std::pair<char, uint32_t>& child) { return child.second == path[i]; }));
+
+		for (size_t j = i; j < path.size(); ++j)
+		{
+			m_nodes[path[j]] = TrieNode{};
+			m_freeNodes.push_back(path[j]);
+		}
+		break;
+	}
+
+	// remove the trigram postings
+	std::vector<Trigram_t> trigrams;
+	GetTrigrams(entry.lowerName, trigrams);
+
+	for (const Trigram_t trigram : trigrams)
+	{
+		const std::unordered_map<Trigram_t, std::vector<Id_t>>::iterator postingIt = m_trigramPostings.find(trigram);
+		if (postingIt == m_trigramPostings.end())
+			continue;
+
+		std::vector<Id_t>& postings = postingIt->second;
+		const std::vector<Id_t>::iterator it = std::find(postings.begin(), postings.end(), id);
+		if (it != postings.end())
+		{
+			// order doesn't matter, swap and pop
+			*it = postings.back();
+			postings.pop_back();
+		}
+
+		if (postings.empty() == true)
+			m_trigramPostings.erase(postingIt);
+	}
+
+	// free the id
+	entry = NameEntry{};
+	m_freeIds.push_back(id);
+}
+
+void NameIndex::Clear()
+{
+	m_nodes.assign(1, TrieNode{});
+	m_freeNodes.clear();
+	m_names.clear();
+	m_freeIds.clear();
+	m_ids.clear();
+	m_trigramPostings.clear();
+}
+
+size_t NameIndex::Size() const noexcept
+{
+	return m_ids.size();
+}
+
+std::vector<std::string> NameIndex::Find(std::string_view query, const size_t limit) const
+{
+	std::vector<std::string> results;
+	if (limit == 0 || query.empty() == true)
+		return results;
+
+	const std::string lowerQuery = Lower(query);
+	std::vector<bool> seen(m_names.size());
+
+	const auto addResult = [this, &results, &seen](const Id_t id)
+	{
+		if (seen[id] == true)
+			return;
+
+		seen[id] = true;
+		results.push_back(m_names[id].name);
+	};
+
+	// exact and prefix matches. a breadth-first walk yields the shortest names first, so we can stop at the limit
+	const uint32_t prefixNode = FindNode(lowerQuery);
+	if (prefixNode != s_invalidId)
+	{
+		// exact matches, preferring the same case
+		for (const Id_t id : m_nodes[prefixNode].ids)
+		{
+			if (m_names[id].name == query)
+				addResult(id);
+		}
+		for (const Id_t id : m_nodes[prefixNode].ids)
+			addResult(id);
+
+		std::queue<uint32_t> nodeQueue;
+		for (const std::pair<char, uint32_t>& child : m_nodes[prefixNode].children)
+			nodeQueue.push(child.second);
+
+		while (nodeQueue.empty() == false &&
+			results.size() < limit)
+		{
+			const TrieNode& node = m_nodes[nodeQueue.front()];
+			nodeQueue.pop();
+
+			for (const Id_t id : node.ids)
+				addResult(id);
+
+			for (const std::pair<char, uint32_t>& child : node.children)
+				nodeQueue.push(child.second);
+		}
+	}
+
+	if (results.size() >= limit)
+	{
+		results.resize(limit);
+		return results;
+	}
+
+	// substring and similarity matches. count the trigrams each name shares with the query
+	std::vector<Trigram_t> queryTrigrams;
+	GetTrigrams(lowerQuery, queryTrigrams);
+
+	std::unordered_map<Id_t, uint32_t> sharedTrigrams;
+	for (const Trigram_t trigram : queryTrigrams)
+	{
+		const std::unordered_map<Trigram_t, std::vector<Id_t>>::const_iterator postingIt = m_trigramPostings.find(trigram);
+		if (postingIt == m_trigramPostings.end())
+			continue;
+
+		for (const Id_t id : postingIt->second)
+		{
+			if (seen[id] == false)
+				++sharedTrigrams[id];
+		}
+	}
+
+	// rank substring matches first, then by jaccard similarity of the trigram sets
+	using Candidate_t = std::tuple<bool, float, Id_t>;
+	std::vector<Candidate_t> candidates;
+	candidates.reserve(sharedTrigrams.size());
+	for (const std::unordered_map<Id_t, uint32_t>::value_type& shared : sharedTrigrams)
+	{
+		const NameEntry& entry = m_names[shared.first];
+		const bool isSubstring = entry.lowerName.find(lowerQuery) != std::string::npos;
+		const float similarity = static_cast<float>(shared.second) / (queryTrigrams.size() + entry.trigramCount - shared.second);
+		candidates.emplace_back(isSubstring, similarity, shared.first);
+	}
+
+	const size_t numCandidates = std::min(limit - results.size(), candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + numCandidates, candidates.end(),
+		[](const Candidate_t& left, const Candidate_t& right)
+	{
+		if (std::get<0>(left) != std::get<0>(right))
+			return std::get<0>(left) == true;
+		if (std::get<1>(left) != std::get<1>(right))
+			return std::get<1>(left) > std::get<1>(right);
+		return std::get<2>(left) < std::get<2>(right);
+	});
+
+	for (size_t i = 0; i < numCandidates; ++i)
+		addResult(std::get<2>(candidates[i]));
+
+	return results;
+}
+
+std::string NameIndex::Lower(std::string_view str)
+{
+	std::string lowerStr;
+	lowerStr.reserve(str.size());
+	std::transform(str.begin(), str.end(), std::back_inserter(lowerStr), [](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	return lowerStr;
+}
+
+void NameIndex::GetTrigrams(const std::string& lowerStr, std::vector<Trigram_t>& trigramsOut)
+{
+	// pad the string so that short names and word boundaries still produce trigrams
+	const std::string padded = "  " + lowerStr + ' ';
+
+	trigramsOut.clear();
+	for (size_t i = 0; i + 3 <= padded.size(); ++i)
+	{
+		trigramsOut.push_back(static_cast<Trigram_t>(static_cast<unsigned char>(padded[i])) << 16 |
+			static_cast<Trigram_t>(static_cast<unsigned char>(padded[i + 1])) << 8 |
+			static_cast<Trigram_t>(static_cast<unsigned char>(padded[i + 2])));
+	}
+
+	// a name only posts to each trigram once
+	std::sort(trigramsOut.begin(), trigramsOut.end());
+	trigramsOut.erase(std::unique(trigramsOut.begin(), trigramsOut.end()), trigramsOut.end());
+}
+
+uint32_t NameIndex::FindNode(const std::string& lowerStr) const
+{
+	uint32_t node = 0;
+	for (const char c : lowerStr)
+	{
+		const std::vector<std::pair<char, uint32_t>>& children = m_nodes[node].children;
+		const std::vector<std::pair<char, uint32_t>>::const_iterator childIt = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t{ 0 }));
+		if (childIt == children.end() || childIt->first != c)
+			return s_invalidId;
+
+		node = childIt->second;
+	}
+
+	return node;
+}
+
+uint32_t NameIndex::AllocateNode()
+{
+	if (m_freeNodes.empty() == false)
+	{
+		const uint32_t node = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		return node;
+	}
+
+	m_nodes.emplace_back();
+	return static_cast<uint32_t>(m_nodes.size() - 1);
+}
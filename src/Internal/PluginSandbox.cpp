@@ -0,0 +1,541 @@
+#include <BetteRCon/Internal/PluginSandbox.h>
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using BetteRCon::Internal::PluginSandbox;
+using BetteRCon::Internal::SandboxChannel;
+
+PluginSandbox::PluginSandbox(Worker_t& worker, MetricRegistry& metrics, CommandCallback_t&& commandCallback)
+	: m_worker(worker), m_metrics(metrics), m_commandCallback(std::move(commandCallback)) {}
+
+std::string PluginSandbox::GetDefaultHostPath()
+{
+#ifdef _WIN32
+	char modulePath[MAX_PATH];
+	const DWORD length = GetModuleFileNameA(nullptr, modulePath, MAX_PATH);
+
+	return (std::filesystem::path(std::string(modulePath, length)).parent_path() / "BetteRConPluginHost.exe").string();
+#else
+	std::error_code ec;
+	const std::filesystem::path programPath = std::filesystem::read_symlink("/proc/self/exe", ec);
+	if (ec)
+		return "bettercon-pluginhost";
+
+	return (programPath.parent_path() / "bettercon-pluginhost").string();
+#endif
+}
+
+void PluginSandbox::Start(const std::string& hostPath, const std::string& pluginPath, LoadCallback_t&& loadCallback)
+{
+	m_hostPath = hostPath;
+	m_pluginPath = pluginPath;
+
+	std::string failReason;
+	if (std::filesystem::exists(m_hostPath) == false)
+		failReason = "Plugin host not found at " + m_hostPath;
+	else if (m_channel.Create(SandboxChannel::s_defaultCapacity) == false)
+		failReason = "Failed to create the channel to the plugin host";
+
+	if (failReason.empty() == false)
+	{
+		asio::post(m_worker, [pWeakThis = weak_from_this(), loadCallback{ std::move(loadCallback) }, failReason]()
+		{
+			if (pWeakThis.expired() == false)
+				loadCallback(false, failReason);
+		});
+		return;
+	}
+
+	// until the plugin says its name
+	m_logTag = pluginPath;
+	m_warnLog.SetTag(m_logTag);
+
+	m_supervisor = std::thread(&PluginSandbox::Run, this, std::move(loadCallback));
+}
+
+const std::string& PluginSandbox::GetPluginName() const noexcept
+{
+	return m_pluginName;
+}
+
+const std::string& PluginSandbox::GetPluginVersion() const noexcept
+{
+	return m_pluginVersion;
+}
+
+const std::string& PluginSandbox::GetPluginAuthor() const noexcept
+{
+	return m_pluginAuthor;
+}
+
+void PluginSandbox::Enable()
+{
+	if (m_stopped == true)
+		return;
+
+	m_enabled = true;
+	SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_Enable, 0, {}, m_sendBuffer);
+}
+
+void PluginSandbox::Disable()
+{
+	if (m_stopped == true)
+		return;
+
+	m_enabled = false;
+	SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_Disable, 0, {}, m_sendBuffer);
+}
+
+bool PluginSandbox::IsEnabled() const noexcept
+{
+	return m_enabled == true;
+}
+
+void PluginSandbox::PostEvent(const std::vector<std::string>& eventArgs)
+{
+	if (m_stopped == true)
+		return;
+
+	if (SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_Event, 0, eventArgs, m_sendBuffer) == false)
+		m_pDroppedEvents->Increment();
+}
+
+void PluginSandbox::PostResponse(const uint32_t generation, const uint32_t sequence, const ErrorCode_t& ec, const std::vector<std::string>& response)
+{
+	// the host that sent it is gone
+	if (m_stopped == true ||
+		generation != m_generation.load(std::memory_order_acquire))
+		return;
+
+	if (ec)
+		SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_CommandFailed, sequence, { std::to_string(ec.value()) }, m_sendBuffer);
+	else
+		SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_Response, sequence, response, m_sendBuffer);
+}
+
+void PluginSandbox::PostServerInfo(const std::vector<std::string>& serverInfo)
+{
+	// there is nothing to send until the server has been polled
+	if (m_stopped == true ||
+		serverInfo.empty() == true)
+		return;
+
+	m_serverInfo = serverInfo;
+	SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_ServerInfo, 0, m_serverInfo, m_sendBuffer);
+}
+
+void PluginSandbox::PostPlayerList(const std::vector<std::string>& playerList)
+{
+	if (m_stopped == true ||
+		playerList.empty() == true)
+		return;
+
+	m_playerList = playerList;
+	SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_PlayerList, 0, m_playerList, m_sendBuffer);
+}
+
+void PluginSandbox::Stop(StoppedCallback_t&& stoppedCallback)
+{
+	if (m_stopped == true)
+		return;
+
+	m_stopped = true;
+
+	// a sandbox that never started has nothing to wait for
+	if (m_supervisor.joinable() == false)
+	{
+		if (stoppedCallback != nullptr)
+			PostStopped(std::move(stoppedCallback));
+		return;
+	}
+
+	// the host unloads the plugin and exits, and the supervisor waits for it
+	SandboxChannel::Send(m_channel.GetToHost(), SandboxChannel::MessageType_Shutdown, 0, {}, m_sendBuffer);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_stoppedCallback = std::move(stoppedCallback);
+	}
+	m_stopCondition.notify_one();
+}
+
+PluginSandbox::~PluginSandbox()
+{
+	Stop();
+
+	if (m_supervisor.joinable() == true)
+		m_supervisor.join();
+
+	m_channel.Close();
+}
+
+void PluginSandbox::Run(const LoadCallback_t loadCallback)
+{
+	std::string failReason;
+	const bool loaded = Spawn(failReason);
+	if (loaded == true)
+	{
+		m_logTag = m_pluginName;
+		m_warnLog.SetTag(m_logTag);
+
+		const MetricRegistry::Labels_t labels{ { "plugin", m_pluginName } };
+		m_pRestarts = m_metrics.GetCounter("bettercon_sandbox_restarts_total", "Times an isolated plugin's host was started again after it crashed or hung", labels);
+		m_pDroppedEvents = m_metrics.GetCounter("bettercon_sandbox_dropped_events_total", "Events that an isolated plugin's host was too far behind to take", labels);
+	}
+
+	// the plugin's details and counters are set before the worker hears about it
+	asio::post(m_worker, [pWeakThis = weak_from_this(), loadCallback, loaded, failReason]()
+	{
+		if (pWeakThis.expired() == false)
+			loadCallback(loaded, failReason);
+	});
+
+	if (loaded == true)
+		Supervise();
+
+	WaitForExit();
+
+	// a host that failed to load is already gone, but it is only stopped once the worker says so
+	StoppedCallback_t stoppedCallback;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stopCondition.wait(lock, [this]() { return m_stopping == true; });
+		stoppedCallback = std::move(m_stoppedCallback);
+	}
+
+	if (stoppedCallback != nullptr)
+		PostStopped(std::move(stoppedCallback));
+}
+
+void PluginSandbox::PostStopped(StoppedCallback_t&& stoppedCallback)
+{
+	asio::post(m_worker, [pWeakThis = weak_from_this(), stoppedCallback{ std::move(stoppedCallback) }]()
+	{
+		if (pWeakThis.expired() == false)
+			stoppedCallback();
+	});
+}
+
+void PluginSandbox::WaitForExit()
+{
+	// give it a chance to unload the plugin
+	std::string how;
+	const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + s_shutdownTimeout;
+	while (HasExited(how) == false)
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			m_warnLog << "Plugin host didn't exit in time, killing it\n";
+			Kill();
+			break;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+bool PluginSandbox::Spawn(std::string& failReasonOut)
+{
+	const std::string handle = m_channel.GetHandle();
+
+#ifdef _WIN32
+	std::string commandLine = "\"" + m_hostPath + "\" " + handle + " \"" + m_pluginPath + "\"";
+
+	STARTUPINFOA startupInfo{};
+	startupInfo.cb = sizeof(startupInfo);
+	PROCESS_INFORMATION processInfo{};
+
+	// the host inherits the channel's handle
+	if (CreateProcessA(m_hostPath.c_str(), commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startupInfo, &processInfo) == FALSE)
+	{
+		failReasonOut = "Failed to start the plugin host: " + std::to_string(GetLastError());
+		return false;
+	}
+
+	CloseHandle(processInfo.hThread);
+	m_hProcess = processInfo.hProcess;
+#else
+	// everything the child needs is made before forking, since only a few calls are safe between fork and exec
+	const int channelFd = std::stoi(handle);
+	std::vector<std::string> args{ m_hostPath, handle, m_pluginPath };
+	std::vector<char*> argv;
+	for (std::string& arg : args)
+		argv.push_back(arg.data());
+	argv.push_back(nullptr);
+
+	const pid_t processId = fork();
+	if (processId == -1)
+	{
+		failReasonOut = "Failed to start the plugin host: " + std::to_string(errno);
+		return false;
+	}
+
+	if (processId == 0)
+	{
+		// the host keeps the channel across exec. It watches for us going down itself, since a parent death signal
+		// would come when the thread that started it exits, which the supervisor does on every restart
+		fcntl(channelFd, F_SETFD, 0);
+
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+
+	m_processId = processId;
+#endif
+
+	return WaitForHello(failReasonOut);
+}
+
+bool PluginSandbox::WaitForHello(std::string& failReasonOut)
+{
+	SharedRing& toServer = m_channel.GetToServer();
+
+	const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + s_loadTimeout;
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		toServer.Wait(std::chrono::milliseconds(100));
+
+		while (SandboxChannel::Receive(toServer, m_message, m_receiveBuffer) == true)
+		{
+			if (m_message.type == SandboxChannel::MessageType_Hello &&
+				m_message.words.size() == 3)
+			{
+				// the worker reads these, so a restarted host's are left alone
+				if (m_pluginName.empty() == true)
+				{
+					m_pluginName = m_message.words[0];
+					m_pluginVersion = m_message.words[1];
+					m_pluginAuthor = m_message.words[2];
+				}
+
+				return true;
+			}
+
+			if (m_message.type == SandboxChannel::MessageType_LoadFailed &&
+				m_message.words.size() == 1)
+			{
+				failReasonOut = m_message.words[0];
+				Kill();
+				return false;
+			}
+
+			// the plugin can send commands while it is being created
+			if (m_message.type == SandboxChannel::MessageType_Command)
+			{
+				asio::post(m_worker, [pWeakThis = weak_from_this(), generation = m_generation.load(), sequence = m_message.sequence, command = m_message.words]()
+				{
+					if (const std::shared_ptr<PluginSandbox> pThis = pWeakThis.lock())
+						pThis->m_commandCallback(pThis, generation, sequence, command);
+				});
+			}
+		}
+
+		if (toServer.IsCorrupt() == true)
+		{
+			failReasonOut = "Plugin host corrupted its channel while loading the plugin";
+			Kill();
+			return false;
+		}
+
+		std::string how;
+		if (HasExited(how) == true)
+		{
+			failReasonOut = "Plugin host " + how + " while loading the plugin";
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_stopping == true)
+			break;
+	}
+
+	failReasonOut = "Plugin host didn't load the plugin in time";
+	Kill();
+	return false;
+}
+
+bool PluginSandbox::HasExited(std::string& howOut)
+{
+#ifdef _WIN32
+	if (m_hProcess == nullptr)
+		return true;
+
+	if (WaitForSingleObject(m_hProcess, 0) != WAIT_OBJECT_0)
+		return false;
+
+	DWORD exitCode = 0;
+	GetExitCodeProcess(m_hProcess, &exitCode);
+	howOut = "exited with code " + std::to_string(exitCode);
+
+	CloseHandle(m_hProcess);
+	m_hProcess = nullptr;
+#else
+	if (m_processId == -1)
+		return true;
+
+	int status = 0;
+	if (waitpid(m_processId, &status, WNOHANG) != m_processId)
+		return false;
+
+	if (WIFSIGNALED(status))
+		howOut = "was killed by signal " + std::to_string(WTERMSIG(status));
+	else
+		howOut = "exited with code " + std::to_string(WEXITSTATUS(status));
+
+	m_processId = -1;
+#endif
+
+	return true;
+}
+
+void PluginSandbox::Kill()
+{
+#ifdef _WIN32
+	if (m_hProcess == nullptr)
+		return;
+
+	TerminateProcess(m_hProcess, 1);
+	WaitForSingleObject(m_hProcess, INFINITE);
+	CloseHandle(m_hProcess);
+	m_hProcess = nullptr;
+#else
+	if (m_processId == -1)
+		return;
+
+	kill(m_processId, SIGKILL);
+	waitpid(m_processId, nullptr, 0);
+	m_processId = -1;
+#endif
+}
+
+void PluginSandbox::HandleHostMessages()
+{
+	while (SandboxChannel::Receive(m_channel.GetToServer(), m_message, m_receiveBuffer) == true)
+	{
+		if (m_message.type != SandboxChannel::MessageType_Command)
+			continue;
+
+		asio::post(m_worker, [pWeakThis = weak_from_this(), generation = m_generation.load(), sequence = m_message.sequence, command = m_message.words]()
+		{
+			if (const std::shared_ptr<PluginSandbox> pThis = pWeakThis.lock())
+				pThis->m_commandCallback(pThis, generation, sequence, command);
+		});
+	}
+}
+
+void PluginSandbox::Supervise()
+{
+	SharedRing& toHost = m_channel.GetToHost();
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration restartDelay = s_minRestartDelay;
+
+	uint64_t lastReadPosition = toHost.GetReadPosition();
+	std::chrono::steady_clock::time_point lastReadTime = startTime;
+
+	while (true)
+	{
+		m_channel.GetToServer().Wait(std::chrono::milliseconds(100));
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopping == true)
+				return;
+		}
+
+		HandleHostMessages();
+
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		// the host is only stuck if it has something to read
+		const uint64_t readPosition = toHost.GetReadPosition();
+		if (readPosition != lastReadPosition ||
+			toHost.IsEmpty() == true)
+		{
+			lastReadPosition = readPosition;
+			lastReadTime = now;
+		}
+
+		// a host that scribbled over the channel is treated as dead, since nothing more it sends can be trusted
+		std::string how;
+		if (m_channel.GetToServer().IsCorrupt() == true)
+		{
+			how = "corrupted its channel";
+			Kill();
+		}
+		else if (HasExited(how) == false)
+		{
+			if (now - lastReadTime < s_hangTimeout)
+				continue;
+
+			how = "stopped reading events for " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now - lastReadTime).count()) + " seconds";
+			Kill();
+		}
+
+		// anything it sent before it went down is still passed on, but the responses are dropped
+		HandleHostMessages();
+		m_generation.fetch_add(1, std::memory_order_acq_rel);
+		m_pRestarts->Increment();
+
+		// a host that keeps going down is started less and less often, until it stays up for a while
+		if (now - startTime >= s_maxRestartDelay)
+			restartDelay = s_minRestartDelay;
+
+		m_warnLog << "Plugin host " << how << ", starting it again in " << std::chrono::duration_cast<std::chrono::seconds>(restartDelay).count() << " seconds\n";
+
+		std::string failReason;
+		while (true)
+		{
+			if (WaitToRestart(restartDelay) == false)
+				return;
+
+			// the events that were waiting were for the host that went down, and nothing it wrote is kept
+			toHost.Reset();
+			m_channel.GetToServer().Clear();
+
+			if (Spawn(failReason) == true)
+				break;
+
+			restartDelay = std::min<std::chrono::steady_clock::duration>(restartDelay * 2, s_maxRestartDelay);
+			m_warnLog << "Failed to start the plugin host again: " << failReason << ", trying again in " << std::chrono::duration_cast<std::chrono::seconds>(restartDelay).count() << " seconds\n";
+		}
+
+		m_warnLog << "Plugin host started again\n";
+		restartDelay = std::min<std::chrono::steady_clock::duration>(restartDelay * 2, s_maxRestartDelay);
+
+		startTime = std::chrono::steady_clock::now();
+		lastReadPosition = toHost.GetReadPosition();
+		lastReadTime = startTime;
+
+		// the worker is the only one that writes to the host. The new host needs the server and its players before it can take events
+		asio::post(m_worker, [pWeakThis = weak_from_this()]()
+		{
+			const std::shared_ptr<PluginSandbox> pThis = pWeakThis.lock();
+			if (pThis == nullptr)
+				return;
+
+			pThis->PostServerInfo(pThis->m_serverInfo);
+			pThis->PostPlayerList(pThis->m_playerList);
+
+			if (pThis->m_enabled == true)
+				pThis->Enable();
+		});
+	}
+}
+
+bool PluginSandbox::WaitToRestart(const std::chrono::steady_clock::duration delay)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_stopCondition.wait_for(lock, delay, [this]() { return m_stopping == true; }) == false;
+}
@@ -0,0 +1,47 @@
+#include <BetteRCon/Internal/RateLimiter.h>
+
+#include <algorithm>
+#include <utility>
+
+using BetteRCon::Internal::RateLimiter;
+
+RateLimiter::Clock_t::duration RateLimiter::GetWait(const std::string& key, const Limit& limit, const Clock_t::time_point now) const
+{
+	if (limit.interval == Clock_t::duration::zero())
+		return Clock_t::duration::zero();
+
+	const std::unordered_map<std::string, Clock_t::time_point>::const_iterator bucketIt = m_buckets.find(key);
+	if (bucketIt == m_buckets.end())
+		return Clock_t::duration::zero();
+
+	// taking a token pushes the time it is full back by an interval, and it can only be pushed back a burst ahead of now
+	const Clock_t::time_point full = std::max(bucketIt->second, now) + limit.interval;
+	const Clock_t::time_point latestFull = now + limit.interval * static_cast<int64_t>(std::max<uint32_t>(limit.burst, 1));
+
+	return (full > latestFull) ? full - latestFull : Clock_t::duration::zero();
+}
+
+void RateLimiter::Take(const std::string& key, const Limit& limit, const Clock_t::time_point now)
+{
+	if (limit.interval == Clock_t::duration::zero())
+		return;
+
+	const std::pair<std::unordered_map<std::string, Clock_t::time_point>::iterator, bool> result = m_buckets.try_emplace(key, now);
+	result.first->second = std::max(result.first->second, now) + limit.interval;
+}
+
+void RateLimiter::Prune(const Clock_t::time_point now)
+{
+	for (std::unordered_map<std::string, Clock_t::time_point>::iterator bucketIt = m_buckets.begin(); bucketIt != m_buckets.end();)
+	{
+		if (bucketIt->second <= now)
+			bucketIt = m_buckets.erase(bucketIt);
+		else
+			++bucketIt;
+	}
+}
+
+void RateLimiter::Clear()
+{
+	m_buckets.clear();
+}
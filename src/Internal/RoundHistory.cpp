@@ -0,0 +1,702 @@
+#include <BetteRCon/Internal/RoundHistory.h>
+#include <BetteRCon/Internal/Log.h>
+#include <BetteRCon/Internal/Serialization.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+using BetteRCon::Internal::RoundHistory;
+
+namespace
+{
+	constexpr uint32_t s_roundHistoryTag = BetteRCon::Internal::MakeSchemaTag("RHST");
+	constexpr uint32_t s_roundHistoryVersion = 1;
+}
+
+bool RoundHistory::Open(const std::string& directory, const std::chrono::hours retention, const bool readOnly)
+{
+	Close();
+
+	// the writer creates the directory when it first opens the history
+	std::error_code ec;
+	if (readOnly == false)
+	{
+		std::filesystem::create_directories(directory, ec);
+		if (std::filesystem::is_directory(directory, ec) == false)
+			return false;
+	}
+
+	m_directory = directory;
+	m_retentionSeconds = std::chrono::duration_cast<std::chrono::seconds>(retention).count();
+	m_readOnly = readOnly;
+
+	for (const int64_t number : GetPartitionNumbers(m_directory))
+	{
+		Partition partition;
+		partition.number = number;
+		partition.path = GetPartitionPath(m_directory, number);
+
+		if (LoadPartition(partition) == true)
+			m_partitions.push_back(std::move(partition));
+	}
+
+	m_open = true;
+
+	DropExpiredPartitions(ToSeconds(Clock_t::now()));
+
+	return true;
+}
+
+bool RoundHistory::Refresh()
+{
+	if (m_open == false)
+		return false;
+
+	const std::vector<int64_t> partitionNumbers = GetPartitionNumbers(m_directory);
+
+	// the writer deleted them once they were out of retention
+	m_partitions.erase(std::remove_if(m_partitions.begin(), m_partitions.end(), [&partitionNumbers](const Partition& partition)
+	{
+		return std::binary_search(partitionNumbers.begin(), partitionNumbers.end(), partition.number) == false;
+	}), m_partitions.end());
+
+	for (const int64_t number : partitionNumbers)
+	{
+		Partitions_t::iterator partitionIt = std::lower_bound(m_partitions.begin(), m_partitions.end(), number, [](const Partition& partition, const int64_t number)
+		{
+			return partition.number < number;
+		});
+
+		if (partitionIt == m_partitions.end() ||
+			partitionIt->number != number)
+		{
+			Partition partition;
+			partition.number = number;
+			partition.path = GetPartitionPath(m_directory, number);
+
+			partitionIt = m_partitions.insert(partitionIt, std::move(partition));
+		}
+
+		LoadNewRounds(*partitionIt);
+	}
+
+	DropExpiredPartitions(ToSeconds(Clock_t::now()));
+
+	return true;
+}
+
+void RoundHistory::Close()
+{
+	m_open = false;
+	m_readOnly = false;
+	m_directory.clear();
+	m_partitions.clear();
+	m_nameIds.clear();
+	m_names.clear();
+	m_totals.clear();
+}
+
+bool RoundHistory::IsOpen() const noexcept
+{
+	return m_open;
+}
+
+bool RoundHistory::AppendRound(const Round& round)
+{
+	if (m_open == false ||
+		m_readOnly == true)
+		return false;
+
+	// the clock may have gone backwards, but rounds stay in order
+	int64_t endSeconds = ToSeconds(round.end);
+	if (m_partitions.empty() == false &&
+		m_partitions.back().roundEnds.empty() == false)
+		endSeconds = std::max(endSeconds, m_partitions.back().roundEnds.back());
+
+	DropExpiredPartitions(endSeconds);
+	Partition& partition = GetPartition(endSeconds);
+
+	RecordWriter record;
+	EncodeRound(round, endSeconds, partition, record);
+
+	DatabaseWriter writer;
+	if (writer.Append(partition.path, s_roundHistoryTag, s_roundHistoryVersion) == false ||
+		writer.WriteRecord(record) == false ||
+		writer.Commit() == false)
+		return false;
+
+	// the record is exactly what a load would see, so apply it the same way
+	RecordReader reader(record.GetData());
+	return DecodeRound(reader, partition);
+}
+
+bool RoundHistory::GetPlayerTotals(const std::string_view name, const Clock_t::time_point since, PlayerTotals& totalsOut) const
+{
+	totalsOut = PlayerTotals{};
+
+	const uint32_t nameId = FindNameId(name);
+	if (nameId == UINT32_MAX)
+		return false;
+
+	totalsOut.name = *m_names[nameId];
+
+	const int64_t sinceSeconds = ToSeconds(since);
+	for (const Partition& partition : m_partitions)
+	{
+		// skip weeks that ended before the range, or that they didn't play in
+		if ((partition.number + 1) * s_partitionSeconds <= sinceSeconds)
+			continue;
+
+		const std::unordered_map<uint32_t, uint32_t>::const_iterator localIdIt = partition.globalToLocal.find(nameId);
+		if (localIdIt == partition.globalToLocal.end())
+			continue;
+
+		const uint32_t localId = localIdIt->second;
+		for (size_t round = FindFirstRound(partition, sinceSeconds); round < partition.roundEnds.size(); ++round)
+		{
+			// rows are sorted by player within a round
+			const std::vector<uint32_t>::const_iterator roundBegin = partition.playerIds.begin() + partition.roundFirstRows[round];
+			const std::vector<uint32_t>::const_iterator roundEnd = partition.playerIds.begin() + GetRoundEndRow(partition, round);
+			const std::vector<uint32_t>::const_iterator rowIt = std::lower_bound(roundBegin, roundEnd, localId);
+			if (rowIt == roundEnd ||
+				*rowIt != localId)
+				continue;
+
+			const size_t row = rowIt - partition.playerIds.begin();
+			++totalsOut.rounds;
+			totalsOut.wins += partition.teamIds[row] == partition.roundWinners[round];
+			totalsOut.kills += partition.kills[row];
+			totalsOut.deaths += partition.deaths[row];
+			totalsOut.score += partition.scores[row];
+			totalsOut.secondsPlayed += partition.secondsPlayed[row];
+		}
+	}
+
+	return totalsOut.rounds != 0;
+}
+
+void RoundHistory::GetPlayerRounds(const std::string_view name, const Clock_t::time_point since, std::vector<PlayerRoundEntry>& roundsOut) const
+{
+	roundsOut.clear();
+
+	const uint32_t nameId = FindNameId(name);
+	if (nameId == UINT32_MAX)
+		return;
+
+	const int64_t sinceSeconds = ToSeconds(since);
+	for (const Partition& partition : m_partitions)
+	{
+		if ((partition.number + 1) * s_partitionSeconds <= sinceSeconds)
+			continue;
+
+		const std::unordered_map<uint32_t, uint32_t>::const_iterator localIdIt = partition.globalToLocal.find(nameId);
+		if (localIdIt == partition.globalToLocal.end())
+			continue;
+
+		const uint32_t localId = localIdIt->second;
+		for (size_t round = FindFirstRound(partition, sinceSeconds); round < partition.roundEnds.size(); ++round)
+		{
+			const std::vector<uint32_t>::const_iterator roundBegin = partition.playerIds.begin() + partition.roundFirstRows[round];
+			const std::vector<uint32_t>::const_iterator roundEnd = partition.playerIds.begin() + GetRoundEndRow(partition, round);
+			const std::vector<uint32_t>::const_iterator rowIt = std::lower_bound(roundBegin, roundEnd, localId);
+			if (rowIt == roundEnd ||
+				*rowIt != localId)
+				continue;
+
+			const size_t row = rowIt - partition.playerIds.begin();
+
+			PlayerRoundEntry entry;
+			entry.end = Clock_t::time_point(std::chrono::seconds(partition.roundEnds[round]));
+			entry.teamId = partition.teamIds[row];
+			entry.won = partition.teamIds[row] == partition.roundWinners[round];
+			entry.kills = partition.kills[row];
+			entry.deaths = partition.deaths[row];
+			entry.score = partition.scores[row];
+			entry.secondsPlayed = partition.secondsPlayed[row];
+
+			roundsOut.push_back(entry);
+		}
+	}
+}
+
+RoundHistory::PlayerTotals RoundHistory::GetServerTotals(const Clock_t::time_point since) const
+{
+	PlayerTotals totals;
+
+	const int64_t sinceSeconds = ToSeconds(since);
+	for (const Partition& partition : m_partitions)
+	{
+		if ((partition.number + 1) * s_partitionSeconds <= sinceSeconds)
+			continue;
+
+		const size_t firstRound = FindFirstRound(partition, sinceSeconds);
+		if (firstRound == partition.roundEnds.size())
+			continue;
+
+		// every row from the first round on is in range, so the columns can be summed straight through
+		const size_t firstRow = partition.roundFirstRows[firstRound];
+		const size_t numRows = partition.playerIds.size();
+
+		uint64_t kills = 0;
+		uint64_t deaths = 0;
+		uint64_t score = 0;
+		uint64_t secondsPlayed = 0;
+		for (size_t row = firstRow; row < numRows; ++row)
+			kills += partition.kills[row];
+		for (size_t row = firstRow; row < numRows; ++row)
+			deaths += partition.deaths[row];
+		for (size_t row = firstRow; row < numRows; ++row)
+			score += partition.scores[row];
+		for (size_t row = firstRow; row < numRows; ++row)
+			secondsPlayed += partition.secondsPlayed[row];
+
+		for (size_t round = firstRound; round < partition.roundEnds.size(); ++round)
+		{
+			const uint8_t winner = partition.roundWinners[round];
+			const size_t roundEndRow = GetRoundEndRow(partition, round);
+			for (size_t row = partition.roundFirstRows[round]; row < roundEndRow; ++row)
+				totals.wins += partition.teamIds[row] == winner;
+		}
+
+		totals.rounds += static_cast<uint32_t>(numRows - firstRow);
+		totals.kills += static_cast<uint32_t>(kills);
+		totals.deaths += static_cast<uint32_t>(deaths);
+		totals.score += score;
+		totals.secondsPlayed += secondsPlayed;
+	}
+
+	return totals;
+}
+
+void RoundHistory::GetTopPlayers(const Metric metric, const Clock_t::time_point since, const uint32_t minRounds, const size_t limit, std::vector<PlayerTotals>& topOut) const
+{
+	topOut.clear();
+
+	AccumulateTotals(since);
+
+	for (size_t nameId = 0; nameId < m_totals.size(); ++nameId)
+	{
+		if (m_totals[nameId].rounds == 0 ||
+			m_totals[nameId].rounds < minRounds)
+			continue;
+
+		topOut.push_back(m_totals[nameId]);
+		topOut.back().name = *m_names[nameId];
+	}
+
+	const auto getMetric = [metric](const PlayerTotals& totals)
+	{
+		switch (metric)
+		{
+		case Metric_KDR:
+			return totals.GetKDR();
+		case Metric_KPM:
+			return totals.GetKPM();
+		case Metric_SPM:
+			return totals.GetSPM();
+		case Metric_WinRate:
+			return totals.GetWinRate();
+		default:
+			return 0.f;
+		}
+	};
+
+	const size_t numTop = std::min(limit, topOut.size());
+	std::partial_sort(topOut.begin(), topOut.begin() + numTop, topOut.end(), [&getMetric](const PlayerTotals& first, const PlayerTotals& second)
+	{
+		return getMetric(first) > getMetric(second);
+	});
+
+	topOut.resize(numTop);
+}
+
+int64_t RoundHistory::ToSeconds(const Clock_t::time_point timePoint) noexcept
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(timePoint.time_since_epoch()).count();
+}
+
+int64_t RoundHistory::GetPartitionNumber(const int64_t seconds) noexcept
+{
+	return std::max<int64_t>(seconds, 0) / s_partitionSeconds;
+}
+
+std::string RoundHistory::GetPartitionPath(const std::string& directory, const int64_t number)
+{
+	return (std::filesystem::path(directory) / (std::to_string(number) + ".brdb")).string();
+}
+
+std::vector<int64_t> RoundHistory::GetPartitionNumbers(const std::string& directory)
+{
+	// every week is a file named after its number
+	std::vector<int64_t> partitionNumbers;
+
+	std::error_code ec;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, ec))
+	{
+		if (entry.path().extension() != ".brdb")
+			continue;
+
+		const std::string stem = entry.path().stem().string();
+		if (stem.empty() == true ||
+			std::all_of(stem.begin(), stem.end(), [](const char c) { return c >= '0' && c <= '9'; }) == false)
+			continue;
+
+		partitionNumbers.push_back(std::stoll(stem));
+	}
+
+	std::sort(partitionNumbers.begin(), partitionNumbers.end());
+
+	return partitionNumbers;
+}
+
+bool RoundHistory::LoadPartition(Partition& partition)
+{
+	// the writer repairs the files, and may be in the middle of appending to one
+	if (m_readOnly == true)
+	{
+		LoadNewRounds(partition);
+		return true;
+	}
+
+	DatabaseReader reader;
+	const DatabaseReader::Status status = reader.Open(partition.path, s_roundHistoryTag, s_roundHistoryVersion);
+	if (status != DatabaseReader::Status_OK)
+	{
+		// don't append to something we can't read. move it aside and start the week over
+		BetteRCon::Internal::g_stdErrLog << "Failed to open round history " << partition.path << ": " << DatabaseReader::s_StatusStr[status] << '\n';
+
+		std::error_code ec;
+		std::filesystem::rename(partition.path, partition.path + ".bad", ec);
+		return ec.value() == 0;
+	}
+
+	std::vector<std::string_view> payloads;
+
+	RecordReader record;
+	bool good = true;
+	while (reader.Next(record) == true)
+	{
+		// keep the payload in case the rest of the file has to be rewritten
+		RecordReader payloadReader = record;
+		const std::string_view payload = payloadReader.ReadView(payloadReader.GetRemaining());
+
+		if (DecodeRound(record, partition) == false)
+		{
+			good = false;
+			break;
+		}
+
+		payloads.push_back(payload);
+	}
+
+	if (good == true &&
+		reader.GetStatus() == DatabaseReader::Status_OK)
+		return true;
+
+	// a round was cut off or is corrupt. rewrite the file with the rounds before it, so new rounds aren't appended after garbage
+	BetteRCon::Internal::g_stdErrLog << "Round history " << partition.path << " is damaged, keeping the first " << payloads.size() << " rounds\n";
+
+	DatabaseWriter writer;
+	if (writer.Create(partition.path, s_roundHistoryTag, s_roundHistoryVersion) == false)
+		return false;
+
+	RecordWriter rewritten;
+	for (const std::string_view payload : payloads)
+	{
+		rewritten.Clear();
+		rewritten.WriteView(payload);
+
+		if (writer.WriteRecord(rewritten) == false)
+			return false;
+	}
+
+	return writer.Commit();
+}
+
+void RoundHistory::LoadNewRounds(Partition& partition)
+{
+	DatabaseReader reader;
+	if (reader.Open(partition.path, s_roundHistoryTag, s_roundHistoryVersion) != DatabaseReader::Status_OK)
+		return;
+
+	// the records are never changed once they are written, so the ones that are loaded are skipped
+	RecordReader record;
+	size_t loadedRounds = 0;
+	while (loadedRounds < partition.roundEnds.size() &&
+		reader.Next(record) == true)
+		++loadedRounds;
+
+	// the writer found the week damaged and rewrote it with fewer rounds, so it is loaded again from the start
+	if (loadedRounds < partition.roundEnds.size())
+	{
+		Partition reloaded;
+		reloaded.number = partition.number;
+		reloaded.path = std::move(partition.path);
+		partition = std::move(reloaded);
+
+		if (reader.Open(partition.path, s_roundHistoryTag, s_roundHistoryVersion) != DatabaseReader::Status_OK)
+			return;
+	}
+
+	// a record that is cut off is still being written, and is picked up next time
+	while (reader.Next(record) == true)
+	{
+		if (DecodeRound(record, partition) == false)
+			break;
+	}
+}
+
+/*
+ *	A round record is:
+ *
+ *		varsint end - previous end in the week | varint duration | u8 winner | string map | string game mode
+ *		varint new names | string name...
+ *		varint rows | varint player id delta... | u8 team id... | varint kills... | varint deaths... | varint score... | varint seconds played...
+ */
+bool RoundHistory::DecodeRound(RecordReader& record, Partition& partition)
+{
+	const int64_t previousEnd = (partition.roundEnds.empty() == false) ? partition.roundEnds.back() : partition.number * s_partitionSeconds;
+	const int64_t end = previousEnd + record.ReadVarSInt();
+	const uint32_t duration = static_cast<uint32_t>(record.ReadVarInt());
+	const uint8_t winner = record.Read<uint8_t>();
+	const std::string_view map = record.ReadString();
+	const std::string_view gameMode = record.ReadString();
+
+	const uint64_t numNewNames = record.ReadVarInt();
+	const uint64_t firstNewName = partition.localToGlobal.size();
+	if (record.IsGood() == false ||
+		numNewNames > record.GetRemaining())
+		return false;
+
+	std::vector<std::string_view> newNames(static_cast<size_t>(numNewNames));
+	for (std::string_view& newName : newNames)
+		newName = record.ReadString();
+
+	const uint64_t numRows = record.ReadVarInt();
+	if (record.IsGood() == false ||
+		numRows > record.GetRemaining())
+		return false;
+
+	const size_t firstRow = partition.playerIds.size();
+	const size_t endRow = firstRow + static_cast<size_t>(numRows);
+
+	// decode into the columns, then check that the whole record was good before keeping anything
+	partition.playerIds.resize(endRow);
+	partition.teamIds.resize(endRow);
+	partition.kills.resize(endRow);
+	partition.deaths.resize(endRow);
+	partition.scores.resize(endRow);
+	partition.secondsPlayed.resize(endRow);
+
+	uint64_t playerId = 0;
+	bool idsValid = true;
+	for (size_t row = firstRow; row < endRow; ++row)
+	{
+		playerId += record.ReadVarInt();
+		idsValid = idsValid && playerId < firstNewName + numNewNames;
+		partition.playerIds[row] = static_cast<uint32_t>(playerId);
+	}
+	for (size_t row = firstRow; row < endRow; ++row)
+		partition.teamIds[row] = record.Read<uint8_t>();
+	for (size_t row = firstRow; row < endRow; ++row)
+		partition.kills[row] = static_cast<uint32_t>(record.ReadVarInt());
+	for (size_t row = firstRow; row < endRow; ++row)
+		partition.deaths[row] = static_cast<uint32_t>(record.ReadVarInt());
+	for (size_t row = firstRow; row < endRow; ++row)
+		partition.scores[row] = static_cast<uint32_t>(record.ReadVarInt());
+	for (size_t row = firstRow; row < endRow; ++row)
+		partition.secondsPlayed[row] = static_cast<uint32_t>(record.ReadVarInt());
+
+	if (record.IsGood() == false ||
+		idsValid == false)
+	{
+		partition.playerIds.resize(firstRow);
+		partition.teamIds.resize(firstRow);
+		partition.kills.resize(firstRow);
+		partition.deaths.resize(firstRow);
+		partition.scores.resize(firstRow);
+		partition.secondsPlayed.resize(firstRow);
+		return false;
+	}
+
+	for (const std::string_view newName : newNames)
+	{
+		const uint32_t nameId = GetNameId(newName);
+		partition.globalToLocal.emplace(nameId, static_cast<uint32_t>(partition.localToGlobal.size()));
+		partition.localToGlobal.push_back(nameId);
+	}
+
+	partition.roundEnds.push_back(end);
+	partition.roundDurations.push_back(duration);
+	partition.roundWinners.push_back(winner);
+	partition.roundMaps.emplace_back(map);
+	partition.roundGameModes.emplace_back(gameMode);
+	partition.roundFirstRows.push_back(static_cast<uint32_t>(firstRow));
+
+	return true;
+}
+
+void RoundHistory::EncodeRound(const Round& round, const int64_t endSeconds, const Partition& partition, RecordWriter& recordOut) const
+{
+	const int64_t previousEnd = (partition.roundEnds.empty() == false) ? partition.roundEnds.back() : partition.number * s_partitionSeconds;
+
+	// number the players the way the partition will, with names it hasn't seen yet after the ones it has
+	std::vector<std::string_view> newNames;
+	std::vector<std::pair<uint32_t, const PlayerRound*>> rows;
+	rows.reserve(round.players.size());
+
+	for (const PlayerRound& player : round.players)
+	{
+		uint32_t localId = UINT32_MAX;
+
+		const uint32_t nameId = FindNameId(player.name);
+		const std::unordered_map<uint32_t, uint32_t>::const_iterator localIdIt = partition.globalToLocal.find(nameId);
+		if (nameId != UINT32_MAX &&
+			localIdIt != partition.globalToLocal.end())
+			localId = localIdIt->second;
+		else
+		{
+			const std::vector<std::string_view>::const_iterator newNameIt = std::find(newNames.begin(), newNames.end(), player.name);
+			localId = static_cast<uint32_t>(partition.localToGlobal.size() + (newNameIt - newNames.begin()));
+			if (newNameIt == newNames.end())
+				newNames.push_back(player.name);
+		}
+
+		rows.emplace_back(localId, &player);
+	}
+
+	// sorted ids delta-encode to a byte each. a player can only be in a round once
+	std::sort(rows.begin(), rows.end(), [](const std::pair<uint32_t, const PlayerRound*>& first, const std::pair<uint32_t, const PlayerRound*>& second)
+	{
+		return first.first < second.first;
+	});
+	rows.erase(std::unique(rows.begin(), rows.end(), [](const std::pair<uint32_t, const PlayerRound*>& first, const std::pair<uint32_t, const PlayerRound*>& second)
+	{
+		return first.first == second.first;
+	}), rows.end());
+
+	recordOut.Clear();
+	recordOut.WriteVarSInt(endSeconds - previousEnd);
+	recordOut.WriteVarInt(round.durationSeconds);
+	recordOut.Write(round.winningTeam);
+	recordOut.WriteString(round.map);
+	recordOut.WriteString(round.gameMode);
+
+	recordOut.WriteVarInt(newNames.size());
+	for (const std::string_view newName : newNames)
+		recordOut.WriteString(newName);
+
+	recordOut.WriteVarInt(rows.size());
+
+	uint32_t previousId = 0;
+	for (const std::pair<uint32_t, const PlayerRound*>& row : rows)
+	{
+		recordOut.WriteVarInt(row.first - previousId);
+		previousId = row.first;
+	}
+	for (const std::pair<uint32_t, const PlayerRound*>& row : rows)
+		recordOut.Write(row.second->teamId);
+	for (const std::pair<uint32_t, const PlayerRound*>& row : rows)
+		recordOut.WriteVarInt(row.second->kills);
+	for (const std::pair<uint32_t, const PlayerRound*>& row : rows)
+		recordOut.WriteVarInt(row.second->deaths);
+	for (const std::pair<uint32_t, const PlayerRound*>& row : rows)
+		recordOut.WriteVarInt(row.second->score);
+	for (const std::pair<uint32_t, const PlayerRound*>& row : rows)
+		recordOut.WriteVarInt(row.second->secondsPlayed);
+}
+
+RoundHistory::Partition& RoundHistory::GetPartition(const int64_t seconds)
+{
+	const int64_t number = GetPartitionNumber(seconds);
+	if (m_partitions.empty() == false &&
+		m_partitions.back().number >= number)
+		return m_partitions.back();
+
+	Partition partition;
+	partition.number = number;
+	partition.path = GetPartitionPath(m_directory, number);
+
+	m_partitions.push_back(std::move(partition));
+	return m_partitions.back();
+}
+
+void RoundHistory::DropExpiredPartitions(const int64_t nowSeconds)
+{
+	if (m_retentionSeconds == 0)
+		return;
+
+	// never drop the week we are in
+	const int64_t currentNumber = GetPartitionNumber(nowSeconds);
+
+	Partitions_t::iterator partitionIt = m_partitions.begin();
+	while (partitionIt != m_partitions.end() &&
+		partitionIt->number < currentNumber &&
+		(partitionIt->number + 1) * s_partitionSeconds <= nowSeconds - m_retentionSeconds)
+	{
+		if (m_readOnly == false)
+		{
+			std::error_code ec;
+			std::filesystem::remove(partitionIt->path, ec);
+		}
+
+		++partitionIt;
+	}
+
+	m_partitions.erase(m_partitions.begin(), partitionIt);
+}
+
+uint32_t RoundHistory::GetNameId(const std::string_view name)
+{
+	const std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> result = m_nameIds.emplace(std::string(name), static_cast<uint32_t>(m_names.size()));
+	if (result.second == true)
+		m_names.push_back(&result.first->first);
+
+	return result.first->second;
+}
+
+uint32_t RoundHistory::FindNameId(const std::string_view name) const
+{
+	const std::unordered_map<std::string, uint32_t>::const_iterator nameIt = m_nameIds.find(std::string(name));
+	return (nameIt != m_nameIds.end()) ? nameIt->second : UINT32_MAX;
+}
+
+size_t RoundHistory::FindFirstRound(const Partition& partition, const int64_t since) noexcept
+{
+	return std::lower_bound(partition.roundEnds.begin(), partition.roundEnds.end(), since) - partition.roundEnds.begin();
+}
+
+size_t RoundHistory::GetRoundEndRow(const Partition& partition, const size_t round) noexcept
+{
+	return (round + 1 < partition.roundFirstRows.size()) ? partition.roundFirstRows[round + 1] : partition.playerIds.size();
+}
+
+void RoundHistory::AccumulateTotals(const Clock_t::time_point since) const
+{
+	m_totals.assign(m_names.size(), PlayerTotals{});
+
+	const int64_t sinceSeconds = ToSeconds(since);
+	for (const Partition& partition : m_partitions)
+	{
+		if ((partition.number + 1) * s_partitionSeconds <= sinceSeconds)
+			continue;
+
+		const size_t firstRound = FindFirstRound(partition, sinceSeconds);
+		for (size_t round = firstRound; round < partition.roundEnds.size(); ++round)
+		{
+			const uint8_t winner = partition.roundWinners[round];
+			const size_t roundEndRow = GetRoundEndRow(partition, round);
+			for (size_t row = partition.roundFirstRows[round]; row < roundEndRow; ++row)
+			{
+				PlayerTotals& totals = m_totals[partition.localToGlobal[partition.playerIds[row]]];
+				++totals.rounds;
+				totals.wins += partition.teamIds[row] == winner;
+				totals.kills += partition.kills[row];
+				totals.deaths += partition.deaths[row];
+				totals.score += partition.scores[row];
+				totals.secondsPlayed += partition.secondsPlayed[row];
+			}
+		}
+	}
+}
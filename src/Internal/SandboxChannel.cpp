@@ -0,0 +1,289 @@
+#include <BetteRCon/Internal/SandboxChannel.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using BetteRCon::Internal::SandboxChannel;
+using BetteRCon::Internal::SharedRing;
+
+namespace
+{
+	void WriteVarint(uint64_t value, std::vector<char>& bufferOut)
+	{
+		while (value >= 0x80)
+		{
+			bufferOut.push_back(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		bufferOut.push_back(static_cast<char>(value));
+	}
+
+	bool ReadVarint(const std::vector<char>& buffer, size_t& offset, uint64_t& valueOut)
+	{
+		valueOut = 0;
+		for (uint32_t shift = 0; shift < 64; shift += 7)
+		{
+			if (offset == buffer.size())
+				return false;
+
+			const uint8_t byte = static_cast<uint8_t>(buffer[offset++]);
+			valueOut |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+
+		return false;
+	}
+}
+
+bool SandboxChannel::Create(const uint32_t capacity)
+{
+	Close();
+
+	const size_t size = sizeof(Header) + 2 * SharedRing::GetMemorySize(capacity);
+
+#ifdef _WIN32
+	// the handle is inherited by the host
+	SECURITY_ATTRIBUTES securityAttributes{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	m_hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, &securityAttributes, PAGE_READWRITE,
+		static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+	if (m_hMapping == nullptr)
+		return false;
+#else
+	// the memory has no name, so the host inherits the descriptor instead. it is closed on exec until the host is started
+	m_fd = memfd_create("bettercon-sandbox", MFD_CLOEXEC);
+	if (m_fd == -1)
+		return false;
+
+	if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+	{
+		Close();
+		return false;
+	}
+#endif
+
+	if (Map(size) == false)
+	{
+		Close();
+		return false;
+	}
+
+	Header* pHeader = new (m_pMemory) Header;
+	pHeader->magic = s_magic;
+	pHeader->capacity = capacity;
+#ifdef _WIN32
+	pHeader->serverProcessId = GetCurrentProcessId();
+#else
+	pHeader->serverProcessId = static_cast<uint64_t>(getpid());
+#endif
+
+	char* pRings = static_cast<char*>(m_pMemory) + sizeof(Header);
+	SharedRing::Initialize(pRings, capacity);
+	SharedRing::Initialize(pRings + SharedRing::GetMemorySize(capacity), capacity);
+
+	m_toHost.Attach(pRings, capacity);
+	m_toServer.Attach(pRings + SharedRing::GetMemorySize(capacity), capacity);
+
+	return true;
+}
+
+bool SandboxChannel::Open(const std::string& handle)
+{
+	Close();
+
+	char* pEnd = nullptr;
+	const unsigned long long handleValue = std::strtoull(handle.c_str(), &pEnd, 10);
+	if (handle.empty() == true ||
+		*pEnd != '\0')
+		return false;
+
+	size_t size = 0;
+#ifdef _WIN32
+	m_hMapping = reinterpret_cast<void*>(static_cast<uintptr_t>(handleValue));
+#else
+	m_fd = static_cast<int>(handleValue);
+
+	struct stat fileStat;
+	if (fstat(m_fd, &fileStat) != 0)
+	{
+		m_fd = -1;
+		return false;
+	}
+
+	size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+	// a size of 0 maps all of it on Windows
+	if (Map(size) == false)
+	{
+		Close();
+		return false;
+	}
+
+	const Header* pHeader = static_cast<const Header*>(m_pMemory);
+	if (pHeader->magic != s_magic)
+	{
+		Close();
+		return false;
+	}
+
+	const uint32_t capacity = pHeader->capacity;
+	char* pRings = static_cast<char*>(m_pMemory) + sizeof(Header);
+	m_toHost.Attach(pRings, capacity);
+	m_toServer.Attach(pRings + SharedRing::GetMemorySize(capacity), capacity);
+
+	return true;
+}
+
+void SandboxChannel::Close()
+{
+	m_toHost.Detach();
+	m_toServer.Detach();
+
+#ifdef _WIN32
+	if (m_pMemory != nullptr)
+		UnmapViewOfFile(m_pMemory);
+
+	if (m_hMapping != nullptr)
+		CloseHandle(m_hMapping);
+	m_hMapping = nullptr;
+#else
+	if (m_pMemory != nullptr)
+		munmap(m_pMemory, m_size);
+
+	if (m_fd != -1)
+		close(m_fd);
+	m_fd = -1;
+#endif
+
+	m_pMemory = nullptr;
+	m_size = 0;
+}
+
+bool SandboxChannel::IsOpen() const noexcept
+{
+	return m_pMemory != nullptr;
+}
+
+std::string SandboxChannel::GetHandle() const
+{
+#ifdef _WIN32
+	return std::to_string(reinterpret_cast<uintptr_t>(m_hMapping));
+#else
+	return std::to_string(m_fd);
+#endif
+}
+
+uint64_t SandboxChannel::GetServerProcessId() const noexcept
+{
+	return static_cast<const Header*>(m_pMemory)->serverProcessId;
+}
+
+SharedRing& SandboxChannel::GetToHost() noexcept
+{
+	return m_toHost;
+}
+
+SharedRing& SandboxChannel::GetToServer() noexcept
+{
+	return m_toServer;
+}
+
+bool SandboxChannel::Send(SharedRing& ring, const MessageType type, const uint32_t sequence, const std::vector<std::string>& words, std::vector<char>& buffer)
+{
+	Encode(type, sequence, words, buffer);
+
+	return ring.TryWrite(buffer.data(), static_cast<uint32_t>(buffer.size()));
+}
+
+bool SandboxChannel::Receive(SharedRing& ring, Message& messageOut, std::vector<char>& buffer)
+{
+	if (ring.TryRead(buffer) == false)
+		return false;
+
+	if (Decode(buffer, messageOut) == false)
+		messageOut.type = MessageType_Count;
+
+	return true;
+}
+
+void SandboxChannel::Encode(const MessageType type, const uint32_t sequence, const std::vector<std::string>& words, std::vector<char>& bufferOut)
+{
+	bufferOut.clear();
+	bufferOut.push_back(static_cast<char>(type));
+	WriteVarint(sequence, bufferOut);
+	WriteVarint(words.size(), bufferOut);
+
+	for (const std::string& word : words)
+	{
+		WriteVarint(word.size(), bufferOut);
+		bufferOut.insert(bufferOut.end(), word.begin(), word.end());
+	}
+}
+
+bool SandboxChannel::Decode(const std::vector<char>& buffer, Message& messageOut)
+{
+	if (buffer.empty() == true ||
+		static_cast<uint8_t>(buffer[0]) >= MessageType_Count)
+		return false;
+
+	messageOut.type = static_cast<MessageType>(buffer[0]);
+
+	size_t offset = 1;
+	uint64_t sequence;
+	uint64_t wordCount;
+	if (ReadVarint(buffer, offset, sequence) == false ||
+		ReadVarint(buffer, offset, wordCount) == false ||
+		wordCount > buffer.size() - offset)
+		return false;
+
+	messageOut.sequence = static_cast<uint32_t>(sequence);
+
+	// assigning into the words that are already there keeps their storage
+	messageOut.words.resize(static_cast<size_t>(wordCount));
+	for (std::string& word : messageOut.words)
+	{
+		uint64_t wordSize;
+		if (ReadVarint(buffer, offset, wordSize) == false ||
+			wordSize > buffer.size() - offset)
+			return false;
+
+		word.assign(buffer.data() + offset, static_cast<size_t>(wordSize));
+		offset += static_cast<size_t>(wordSize);
+	}
+
+	return offset == buffer.size();
+}
+
+SandboxChannel::~SandboxChannel()
+{
+	Close();
+}
+
+bool SandboxChannel::Map(const size_t size)
+{
+#ifdef _WIN32
+	m_pMemory = MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (m_pMemory == nullptr)
+		return false;
+#else
+	void* pMemory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (pMemory == MAP_FAILED)
+		return false;
+
+	m_pMemory = pMemory;
+#endif
+	m_size = size;
+
+	return true;
+}
@@ -0,0 +1,232 @@
+#include <BetteRCon/Internal/ServerEndpoint.h>
+
+#include <cstring>
+#include <optional>
+
+using BetteRCon::Internal::Packet;
+using BetteRCon::Internal::ServerEndpoint;
+
+ServerEndpoint::ServerEndpoint(Worker_t& worker)
+	: m_worker(worker), m_acceptor(m_worker), m_socket(m_worker), m_connected(false) {}
+
+ServerEndpoint::ErrorCode_t ServerEndpoint::Listen(const Endpoint_t& endpoint, AcceptCallback_t&& acceptCallback,
+	PacketCallback_t&& packetCallback, DisconnectCallback_t&& disconnectCallback)
+{
+	Close();
+
+	ErrorCode_t ec;
+	m_acceptor.open(endpoint.protocol(), ec);
+	if (ec)
+		return ec;
+
+	m_acceptor.set_option(Acceptor_t::reuse_address(true), ec);
+	m_acceptor.bind(endpoint, ec);
+	if (ec)
+	{
+		Close();
+		return ec;
+	}
+
+	m_acceptor.listen(asio::socket_base::max_listen_connections, ec);
+	if (ec)
+	{
+		Close();
+		return ec;
+	}
+
+	m_acceptCallback = std::move(acceptCallback);
+	m_packetCallback = std::move(packetCallback);
+	m_disconnectCallback = std::move(disconnectCallback);
+
+	AcceptClient();
+
+	return ec;
+}
+
+ServerEndpoint::Endpoint_t ServerEndpoint::GetLocalEndpoint() const
+{
+	ErrorCode_t ignored;
+	return m_acceptor.local_endpoint(ignored);
+}
+
+bool ServerEndpoint::IsConnected() const noexcept
+{
+	return m_connected == true;
+}
+
+void ServerEndpoint::SendPacket(const Packet& packet)
+{
+	if (IsConnected() == false)
+		return;
+
+	std::vector<char> sendBuf;
+	packet.Serialize(sendBuf);
+
+	m_sendQueue.push(std::move(sendBuf));
+
+	// ours is the only one. otherwise, a callback will handle sending our data
+	if (m_sendQueue.size() == 1)
+		SendUnsentBuffers();
+}
+
+void ServerEndpoint::Disconnect()
+{
+	if (IsConnected() == false)
+		return;
+
+	// forget the callback for this client, and put it back for the next one
+	DisconnectCallback_t disconnectCallback = std::move(m_disconnectCallback);
+	m_disconnectCallback = [](const ErrorCode_t&) {};
+	CloseClient(ErrorCode_t{});
+	m_disconnectCallback = std::move(disconnectCallback);
+}
+
+void ServerEndpoint::Close()
+{
+	ErrorCode_t ignored;
+	m_acceptor.close(ignored);
+
+	Disconnect();
+}
+
+ServerEndpoint::~ServerEndpoint()
+{
+	Close();
+}
+
+void ServerEndpoint::AcceptClient()
+{
+	if (m_acceptor.is_open() == false)
+		return;
+
+	m_acceptor.async_accept(m_socket, std::bind(&ServerEndpoint::HandleAccept, this, std::placeholders::_1));
+}
+
+void ServerEndpoint::CloseClient(const ErrorCode_t& ec)
+{
+	ErrorCode_t ignored;
+	m_socket.shutdown(Socket_t::shutdown_both, ignored);
+	m_socket.close(ignored);
+
+	m_connected = false;
+	m_sendQueue = {};
+
+	// handlers that finish after this are for the old client
+	++m_clientId;
+
+	m_disconnectCallback(ec);
+
+	// wait for the next client
+	AcceptClient();
+}
+
+void ServerEndpoint::HandleAccept(const ErrorCode_t& ec)
+{
+	if (ec)
+	{
+		// keep listening through errors with a single client, like it running out of descriptors
+		if (ec != asio::error::operation_aborted)
+			AcceptClient();
+		return;
+	}
+
+	m_connected = true;
+
+	ErrorCode_t ignored;
+	m_socket.set_option(Proto_t::no_delay(true), ignored);
+
+	ReadHeader();
+
+	m_acceptCallback();
+}
+
+void ServerEndpoint::HandleReadHeader(const ErrorCode_t& ec, const size_t)
+{
+	if (ec)
+	{
+		if (ec != asio::error::operation_aborted)
+			CloseClient(ec);
+		return;
+	}
+
+	int32_t packetSize;
+	memcpy(&packetSize, &m_incomingBuf[sizeof(int32_t)], sizeof(packetSize));
+
+	// the header, the word count, and at most 16KB
+	if (packetSize < static_cast<int32_t>(sizeof(int32_t) * 3) ||
+		packetSize > 16384)
+		return CloseClient(asio::error::make_error_code(asio::error::invalid_argument));
+
+	m_incomingBuf.resize(packetSize);
+
+	asio::async_read(m_socket, asio::buffer(m_incomingBuf.data() + sizeof(int32_t) * 2, packetSize - sizeof(int32_t) * 2),
+		[this, clientId = m_clientId](const ErrorCode_t& ec, const size_t bytes_transferred)
+		{
+			if (clientId == m_clientId)
+				HandleReadBody(ec, bytes_transferred);
+		});
+}
+
+void ServerEndpoint::HandleReadBody(const ErrorCode_t& ec, const size_t)
+{
+	if (ec)
+	{
+		if (ec != asio::error::operation_aborted)
+			CloseClient(ec);
+		return;
+	}
+
+	std::optional<Packet> receivedPacket;
+	try
+	{
+		receivedPacket.emplace(m_incomingBuf);
+	}
+	catch (const Packet::ErrorCode_t&)
+	{
+		return CloseClient(asio::error::make_error_code(asio::error::invalid_argument));
+	}
+
+	ReadHeader();
+
+	m_packetCallback(*receivedPacket);
+}
+
+void ServerEndpoint::HandleWrite(const ErrorCode_t& ec, const size_t)
+{
+	if (ec)
+	{
+		if (ec != asio::error::operation_aborted)
+			CloseClient(ec);
+		return;
+	}
+
+	// pop the buffer, we don't need it any more
+	m_sendQueue.pop();
+
+	// send more packets if there are some lined up
+	if (m_sendQueue.empty() == false)
+		SendUnsentBuffers();
+}
+
+void ServerEndpoint::ReadHeader()
+{
+	// read the first 8 bytes, which include the size of the packet
+	m_incomingBuf.resize(sizeof(int32_t) * 2);
+
+	asio::async_read(m_socket, asio::buffer(m_incomingBuf),
+		[this, clientId = m_clientId](const ErrorCode_t& ec, const size_t bytes_transferred)
+		{
+			if (clientId == m_clientId)
+				HandleReadHeader(ec, bytes_transferred);
+		});
+}
+
+void ServerEndpoint::SendUnsentBuffers()
+{
+	asio::async_write(m_socket, asio::buffer(m_sendQueue.front()),
+		[this, clientId = m_clientId](const ErrorCode_t& ec, const size_t bytes_transferred)
+		{
+			if (clientId == m_clientId)
+				HandleWrite(ec, bytes_transferred);
+		});
+}
@@ -0,0 +1,86 @@
+#include <BetteRCon/Internal/SessionCapture.h>
+
+#include <filesystem>
+
+using BetteRCon::Internal::SessionCapture;
+using BetteRCon::Internal::SessionCaptureReader;
+
+bool SessionCapture::Open(const std::string& path)
+{
+	Close();
+
+	// appending rather than creating, so that a crash doesn't throw the capture away
+	std::error_code ignored;
+	std::filesystem::remove(path, ignored);
+
+	m_open = m_writer.Append(path, g_sessionCaptureTag, g_sessionCaptureVersion);
+
+	return m_open;
+}
+
+void SessionCapture::Close()
+{
+	if (m_open == false)
+		return;
+
+	m_writer.Commit();
+	m_open = false;
+}
+
+bool SessionCapture::IsOpen() const noexcept
+{
+	return m_open == true;
+}
+
+void SessionCapture::Write(const SessionFrameType type, const std::string_view data, const Clock_t::time_point time)
+{
+	if (m_open == false)
+		return;
+
+	m_record.Clear();
+	m_record.Write(static_cast<uint8_t>(type));
+	m_record.Write(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count()));
+	m_record.WriteView(data);
+
+	m_writer.WriteRecord(m_record);
+}
+
+SessionCaptureReader::Status SessionCaptureReader::Open(const std::string& path)
+{
+	m_status = m_reader.Open(path, g_sessionCaptureTag, g_sessionCaptureVersion);
+	return m_status;
+}
+
+bool SessionCaptureReader::Next(Frame& frameOut)
+{
+	if (m_status != DatabaseReader::Status_OK)
+		return false;
+
+	RecordReader record;
+	if (m_reader.Next(record) == false)
+	{
+		m_status = m_reader.GetStatus();
+		return false;
+	}
+
+	const SessionFrameType type = static_cast<SessionFrameType>(record.Read<uint8_t>());
+	const int64_t time = record.Read<int64_t>();
+
+	if (record.IsGood() == false ||
+		type >= SessionFrameType_Count)
+	{
+		m_status = DatabaseReader::Status_Corrupt;
+		return false;
+	}
+
+	frameOut.type = type;
+	frameOut.time = Clock_t::time_point(std::chrono::duration_cast<Clock_t::duration>(std::chrono::microseconds(time)));
+	frameOut.data = record.ReadView(record.GetRemaining());
+
+	return true;
+}
+
+SessionCaptureReader::Status SessionCaptureReader::GetStatus() const noexcept
+{
+	return m_status;
+}
@@ -0,0 +1,188 @@
+#include <BetteRCon/Internal/SharedRing.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using BetteRCon::Internal::SharedRing;
+
+size_t SharedRing::GetMemorySize(const uint32_t capacity) noexcept
+{
+	return sizeof(Header) + capacity;
+}
+
+void SharedRing::Initialize(void* pMemory, const uint32_t capacity) noexcept
+{
+	Header* pHeader = new (pMemory) Header;
+	pHeader->writePosition.store(0, std::memory_order_relaxed);
+	pHeader->readPosition.store(0, std::memory_order_relaxed);
+	pHeader->doorbell.store(0, std::memory_order_relaxed);
+	pHeader->sleepers.store(0, std::memory_order_relaxed);
+
+	std::memset(static_cast<char*>(pMemory) + sizeof(Header), 0, capacity);
+}
+
+void SharedRing::Attach(void* pMemory, const uint32_t capacity) noexcept
+{
+	m_pHeader = static_cast<Header*>(pMemory);
+	m_pData = static_cast<char*>(pMemory) + sizeof(Header);
+	m_capacity = capacity;
+	m_corrupt = false;
+}
+
+void SharedRing::Detach() noexcept
+{
+	m_pHeader = nullptr;
+	m_pData = nullptr;
+	m_capacity = 0;
+	m_corrupt = false;
+}
+
+bool SharedRing::TryWrite(const char* pData, const uint32_t size) noexcept
+{
+	const uint64_t writePosition = m_pHeader->writePosition.load(std::memory_order_relaxed);
+	const uint64_t readPosition = m_pHeader->readPosition.load(std::memory_order_acquire);
+
+	// the reader may have scribbled over its position, in which case the ring stays full until it is cleared
+	const uint64_t used = writePosition - readPosition;
+	const uint64_t recordSize = sizeof(size) + size;
+	if (used > m_capacity ||
+		recordSize > m_capacity - used)
+		return false;
+
+	CopyIn(writePosition, reinterpret_cast<const char*>(&size), sizeof(size));
+	CopyIn(writePosition + sizeof(size), pData, size);
+
+	// the reader announces that it is going to sleep before it checks the position one last time, so either it sees
+	// the record, or we see it asleep
+	m_pHeader->writePosition.store(writePosition + recordSize, std::memory_order_seq_cst);
+	if (m_pHeader->sleepers.load(std::memory_order_seq_cst) == 0)
+		return true;
+
+	m_pHeader->doorbell.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_pHeader->doorbell), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+
+	return true;
+}
+
+bool SharedRing::TryRead(std::vector<char>& recordOut)
+{
+	if (m_corrupt == true)
+		return false;
+
+	const uint64_t readPosition = m_pHeader->readPosition.load(std::memory_order_relaxed);
+	const uint64_t writePosition = m_pHeader->writePosition.load(std::memory_order_acquire);
+	if (readPosition == writePosition)
+		return false;
+
+	// the writer may be another process that scribbled over the ring as it went down, so neither its position nor the
+	// record's size is trusted until it is known to fit in what could have been written
+	const uint64_t used = writePosition - readPosition;
+	if (used < sizeof(uint32_t) ||
+		used > m_capacity)
+	{
+		m_corrupt = true;
+		return false;
+	}
+
+	uint32_t size;
+	CopyOut(readPosition, reinterpret_cast<char*>(&size), sizeof(size));
+
+	if (size > used - sizeof(size))
+	{
+		m_corrupt = true;
+		return false;
+	}
+
+	recordOut.resize(size);
+	CopyOut(readPosition + sizeof(size), recordOut.data(), size);
+
+	m_pHeader->readPosition.store(readPosition + sizeof(size) + size, std::memory_order_release);
+
+	return true;
+}
+
+void SharedRing::Wait(const std::chrono::milliseconds timeout) noexcept
+{
+	// a corrupt ring is never empty, so there is nothing to wait for
+	if (IsEmpty() == false ||
+		m_corrupt == true)
+		return;
+
+#ifdef __linux__
+	const uint32_t doorbell = m_pHeader->doorbell.load(std::memory_order_acquire);
+	m_pHeader->sleepers.fetch_add(1, std::memory_order_seq_cst);
+
+	if (IsEmpty() == true)
+	{
+		const std::chrono::seconds seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+		const timespec relativeTimeout{ static_cast<time_t>(seconds.count()), static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds).count()) };
+
+		// returns straight away if the doorbell already rang
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_pHeader->doorbell), FUTEX_WAIT, doorbell, &relativeTimeout, nullptr, 0);
+	}
+
+	m_pHeader->sleepers.fetch_sub(1, std::memory_order_seq_cst);
+#else
+	// there is no futex to sleep on between processes, so check back often
+	std::this_thread::sleep_for(std::min<std::chrono::milliseconds>(timeout, std::chrono::milliseconds(1)));
+#endif
+}
+
+void SharedRing::Reset() noexcept
+{
+	m_pHeader->readPosition.store(m_pHeader->writePosition.load(std::memory_order_acquire), std::memory_order_release);
+	// otherwise the writer would ring for it forever
+	m_pHeader->sleepers.store(0, std::memory_order_relaxed);
+}
+
+void SharedRing::Clear() noexcept
+{
+	Initialize(m_pHeader, m_capacity);
+	m_corrupt = false;
+}
+
+bool SharedRing::IsCorrupt() const noexcept
+{
+	return m_corrupt == true;
+}
+
+bool SharedRing::IsEmpty() const noexcept
+{
+	return m_pHeader->readPosition.load(std::memory_order_seq_cst) == m_pHeader->writePosition.load(std::memory_order_seq_cst);
+}
+
+uint64_t SharedRing::GetReadPosition() const noexcept
+{
+	return m_pHeader->readPosition.load(std::memory_order_acquire);
+}
+
+void SharedRing::CopyIn(const uint64_t position, const char* pData, const uint32_t size) noexcept
+{
+	// the capacity is a power of 2, so the offset wraps with a mask
+	const uint32_t offset = static_cast<uint32_t>(position & (m_capacity - 1));
+	const uint32_t firstPart = std::min(size, m_capacity - offset);
+
+	std::memcpy(m_pData + offset, pData, firstPart);
+	std::memcpy(m_pData, pData + firstPart, size - firstPart);
+}
+
+void SharedRing::CopyOut(const uint64_t position, char* pData, const uint32_t size) const noexcept
+{
+	const uint32_t offset = static_cast<uint32_t>(position & (m_capacity - 1));
+	const uint32_t firstPart = std::min(size, m_capacity - offset);
+
+	std::memcpy(pData, m_pData + offset, firstPart);
+	std::memcpy(pData + firstPart, m_pData, size - firstPart);
+}
@@ -0,0 +1,154 @@
+#include <BetteRCon/Internal/TicketForecaster.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using BetteRCon::Internal::TicketForecaster;
+
+void TicketForecaster::Reset()
+{
+	m_first = 0;
+	m_numSamples = 0;
+	m_numTeams = 0;
+	m_forecast = Forecast{};
+}
+
+void TicketForecaster::AddSample(const int32_t roundSeconds, const std::vector<int32_t>& teamScores, const int32_t goalScore)
+{
+	const size_t numTeams = std::min(teamScores.size(), s_maxTeams);
+
+	// a new round started, or the teams changed
+	if (m_numSamples != 0 &&
+		(roundSeconds < GetSample(0).roundSeconds || numTeams != m_numTeams))
+		Reset();
+
+	// the round clock isn't running, so there is nothing new to learn
+	if (m_numSamples != 0 &&
+		roundSeconds == GetSample(0).roundSeconds)
+		return;
+
+	m_numTeams = numTeams;
+
+	// overwrite the oldest sample once we are full
+	Sample* pSample;
+	if (m_numSamples < s_maxSamples)
+		pSample = &m_samples[(m_first + m_numSamples++) % s_maxSamples];
+	else
+	{
+		pSample = &m_samples[m_first];
+		m_first = (m_first + 1) % s_maxSamples;
+	}
+
+	pSample->roundSeconds = roundSeconds;
+	std::copy(teamScores.begin(), teamScores.begin() + numTeams, pSample->scores.begin());
+
+	UpdateForecast(goalScore);
+}
+
+const TicketForecaster::Forecast& TicketForecaster::GetForecast() const noexcept
+{
+	return m_forecast;
+}
+
+const TicketForecaster::Sample& TicketForecaster::GetSample(const size_t age) const noexcept
+{
+	// age 0 is the latest sample
+	return m_samples[(m_first + m_numSamples - 1 - age) % s_maxSamples];
+}
+
+float TicketForecaster::EstimateRate(const size_t team) const
+{
+	if (m_numSamples < 2)
+		return 0.f;
+
+	const int32_t latestSeconds = GetSample(0).roundSeconds;
+
+	// weighted means first, then the weighted least squares slope around them
+	double totalWeight = 0.0;
+	double meanTime = 0.0;
+	double meanScore = 0.0;
+	for (size_t age = 0; age < m_numSamples; ++age)
+	{
+		const Sample& sample = GetSample(age);
+		const double weight = std::exp((sample.roundSeconds - latestSeconds) / s_rateTimeConstant);
+
+		totalWeight += weight;
+		meanTime += weight * sample.roundSeconds;
+		meanScore += weight * sample.scores[team];
+	}
+
+	meanTime /= totalWeight;
+	meanScore /= totalWeight;
+
+	double covariance = 0.0;
+	double variance = 0.0;
+	for (size_t age = 0; age < m_numSamples; ++age)
+	{
+		const Sample& sample = GetSample(age);
+		const double weight = std::exp((sample.roundSeconds - latestSeconds) / s_rateTimeConstant);
+		const double timeOffset = sample.roundSeconds - meanTime;
+
+		covariance += weight * timeOffset * (sample.scores[team] - meanScore);
+		variance += weight * timeOffset * timeOffset;
+	}
+
+	if (variance <= 0.0)
+		return 0.f;
+
+	return static_cast<float>(covariance / variance * 60.0);
+}
+
+void TicketForecaster::UpdateForecast(const int32_t goalScore)
+{
+	const Sample& latest = GetSample(0);
+
+	m_forecast.countsUp = goalScore > 0;
+	m_forecast.samples = m_numSamples;
+	m_forecast.teams.resize(m_numTeams);
+
+	// find when each team would end the round at its current rate
+	float secondsRemaining = std::numeric_limits<float>::infinity();
+	for (size_t team = 0; team < m_numTeams; ++team)
+	{
+		TeamForecast& teamForecast = m_forecast.teams[team];
+		teamForecast.score = latest.scores[team];
+		teamForecast.ratePerMinute = EstimateRate(team);
+
+		const float ratePerSecond = teamForecast.ratePerMinute / 60.f;
+
+		float secondsToEnd = std::numeric_limits<float>::infinity();
+		if (m_forecast.countsUp == true && ratePerSecond > 0.f)
+			secondsToEnd = std::max(goalScore - teamForecast.score, 0) / ratePerSecond;
+		else if (m_forecast.countsUp == false && ratePerSecond < 0.f)
+			secondsToEnd = std::max(teamForecast.score, 0) / -ratePerSecond;
+
+		secondsRemaining = std::min(secondsRemaining, secondsToEnd);
+	}
+
+	m_forecast.secondsRemaining = (std::isinf(secondsRemaining) == true) ? -1.f : secondsRemaining;
+
+	// play the rates forward to the end of the round, or just take the scores if it isn't ending
+	const float secondsAhead = std::max(m_forecast.secondsRemaining, 0.f);
+	int32_t bestScore = 0;
+	m_forecast.predictedWinner = 0;
+	for (size_t team = 0; team < m_numTeams; ++team)
+	{
+		TeamForecast& teamForecast = m_forecast.teams[team];
+
+		const float predictedScore = teamForecast.score + teamForecast.ratePerMinute / 60.f * secondsAhead;
+		teamForecast.predictedScore = static_cast<int32_t>(std::lround(m_forecast.countsUp == true ? std::min(predictedScore, static_cast<float>(goalScore)) : std::max(predictedScore, 0.f)));
+
+		// the higher score wins either way. ties have no winner
+		if (m_forecast.predictedWinner == 0 || teamForecast.predictedScore > bestScore)
+		{
+			m_forecast.predictedWinner = static_cast<uint8_t>(team + 1);
+			bestScore = teamForecast.predictedScore;
+		}
+		else if (teamForecast.predictedScore == bestScore)
+			m_forecast.predictedWinner = UINT8_MAX;
+	}
+
+	if (m_forecast.predictedWinner == UINT8_MAX)
+		m_forecast.predictedWinner = 0;
+}
@@ -2,7 +2,12 @@
 #include <BetteRCon/Server.h>
 #include <MD5.h>
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
+#include <fstream>
+#include <map>
+#include <tuple>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -25,10 +30,28 @@ using BetteRCon::Server;
 Server::Server(Worker_t& worker) 
 	: m_gotServerInfo(false), m_gotServerPlayers(false),
 	m_initializedServer(false), m_lastSequence(false),
-	m_worker(worker), m_connection(m_worker),
-	m_serverInfoTimer(m_worker), m_playerInfoTimer(m_worker), 
-	m_punkbusterPlayerListTimer(m_worker)
+	m_metricsServer(m_metrics), m_worker(worker), m_connection(m_worker, m_metrics),
+	m_serverInfoTimer(m_worker), m_isolatePlugins(false), m_isPluginHost(false), m_playerInfoTimer(m_worker), 
+	m_punkbusterPlayerListTimer(m_worker), m_fileWatcher(m_worker),
+	m_roundWinner(0)
 {
+	// plugins get the queue from us
+	Internal::StartLogQueue();
+
+	m_pConnects = m_metrics.GetCounter("bettercon_connects_total", "Connections made to the server");
+	m_pReconnects = m_metrics.GetCounter("bettercon_reconnects_total", "Connections made to the server after an earlier one ended");
+	m_pDisconnects = m_metrics.GetCounter("bettercon_disconnects_total", "Connections to the server that ended");
+	m_pConnected = m_metrics.GetGauge("bettercon_connected", "Whether the server is connected");
+
+	// the time from sending each poll to its response
+	static const std::string s_pollName = "bettercon_poll_seconds";
+	static const std::string s_pollHelp = "Round trip of the commands that poll the server";
+	m_pServerInfoPollSeconds = m_metrics.GetHistogram(s_pollName, s_pollHelp, { { "command", "serverInfo" } });
+	m_pPlayerListPollSeconds = m_metrics.GetHistogram(s_pollName, s_pollHelp, { { "command", "admin.listPlayers" } });
+	m_pPunkbusterPlayerListPollSeconds = m_metrics.GetHistogram(s_pollName, s_pollHelp, { { "command", "punkBuster.pb_sv_command" } });
+
+	SetHandlerBudget(std::chrono::milliseconds(250), SlowHandlerAction_Log);
+
 	// initialize all serverInfo stuff to 0
 	m_serverInfo.m_playerCount = 0;
 	m_serverInfo.m_maxPlayerCount = 0;
@@ -48,11 +71,32 @@ Server::Server(Worker_t& worker)
 void Server::AsyncConnect(const Endpoint_t& endpoint, ConnectCallback_t&& connectCallback,
 	DisconnectCallback_t&& disconnectCallback) noexcept
 {
+	m_logTag = endpoint.address().to_string() + ':' + std::to_string(endpoint.port());
+	m_warnLog.SetTag(m_logTag);
+	m_errLog.SetTag(m_logTag);
+
 	// try to connect to the server
-	m_connection.AsyncConnect(endpoint, std::move(connectCallback), 
+	m_connection.AsyncConnect(endpoint, 
+		[this, connectCallback = std::move(connectCallback)](const ErrorCode_t& ec)
+	{
+		if (!ec)
+		{
+			if (m_pConnects->GetValue() != 0)
+				m_pReconnects->Increment();
+			m_pConnects->Increment();
+			m_pConnected->Set(1);
+		}
+
+		connectCallback(ec);
+	},
 		[this, disconnectCallback = std::move(disconnectCallback)](const ErrorCode_t& ec) 
 	{
+		m_pDisconnects->Increment();
+		m_pConnected->Set(0);
+
 		ErrorCode_t ignored;
+		// while the plugins that are waiting on them are still loaded
+		FailMoveBatches();
 		ClearContainers();
 		// kill timers
 		m_serverInfoTimer.cancel(ignored);
@@ -105,11 +149,95 @@ bool Server::IsConnected() const noexcept
 	return m_connection.IsConnected() == true;
 }
 
+BetteRCon::Internal::LogQueue* Server::GetLogQueue() const noexcept
+{
+	return Internal::g_pLogQueue.load(std::memory_order_acquire);
+}
+
+bool Server::StartEventLog(const std::string& directory)
+{
+	return m_eventLog.Open(directory);
+}
+
+void Server::StopEventLog()
+{
+	m_eventLog.Close();
+}
+
+bool Server::StartCapture(const std::string& path)
+{
+	return m_connection.StartCapture(path);
+}
+
+void Server::StopCapture()
+{
+	m_connection.StopCapture();
+}
+
+const BetteRCon::Internal::MetricRegistry& Server::GetMetrics() const noexcept
+{
+	return m_metrics;
+}
+
+bool Server::StartMetricsServer(const uint16_t port)
+{
+	const ErrorCode_t ec = m_metricsServer.Start(port);
+	if (ec)
+	{
+		m_errLog << "Failed to start the metrics server on port " << port << ": " << ec.message() << '\n';
+		return false;
+	}
+
+	return true;
+}
+
+uint16_t Server::GetMetricsPort() const noexcept
+{
+	return m_metricsServer.GetPort();
+}
+
+void Server::StopMetricsServer()
+{
+	m_metricsServer.Stop();
+}
+
+void Server::SetHandlerBudget(const std::chrono::milliseconds budget, const SlowHandlerAction action)
+{
+	// the watchdog reads the budget for its log lines
+	m_handlerWatchdog.Stop();
+
+	m_handlerBudget = budget;
+	m_slowHandlerAction = action;
+
+	if (budget == std::chrono::milliseconds::zero())
+	{
+		m_handlerBudgetTicks = 0;
+		return;
+	}
+
+	m_handlerBudgetTicks = Internal::CycleClock::ToTicks(budget);
+	m_handlerWatchdog.Start(budget, [this](const void* pContext, const std::chrono::nanoseconds elapsed)
+		{
+			HandleStalledHandler(*static_cast<const HandlerStats*>(pContext), elapsed);
+		});
+}
+
+void Server::SetPluginIsolation(const bool isolate, const std::string& hostPath)
+{
+	m_isolatePlugins = isolate;
+	m_pluginHostPath = (hostPath.empty() == true) ? Internal::PluginSandbox::GetDefaultHostPath() : hostPath;
+}
+
 const Server::ServerInfo& Server::GetServerInfo() const noexcept
 {
 	return m_serverInfo;
 }
 
+const Server::TicketForecast_t& Server::GetTicketForecast() const noexcept
+{
+	return m_ticketForecaster.GetForecast();
+}
+
 const Server::PlayerMap_t& Server::GetPlayers() const noexcept
 {
 	return m_players;
@@ -144,15 +272,96 @@ const Server::PlayerMap_t& Server::GetSquad(const uint8_t teamId, const uint8_t
 	return squadIt->second;
 }
 
+std::vector<std::shared_ptr<Server::PlayerInfo>> Server::FindPlayers(const std::string_view query, const size_t limit) const
+{
+	std::vector<std::shared_ptr<PlayerInfo>> players;
+
+	// the index gives us ranked names, resolve them to players
+	for (const std::string& name : m_playerNameIndex.Find(query, limit))
+	{
+		const PlayerMap_t::const_iterator playerIt = m_players.find(name);
+		if (playerIt != m_players.end())
+			players.push_back(playerIt->second);
+	}
+
+	return players;
+}
+
+Server::BalancePlan Server::PlanTeamBalance(const std::vector<MoveRequest_t>& requests, const PlayerStrengthCallback_t& strengthCallback, const BalanceOptions_t& options)
+{
+	m_balanceSolver.Clear();
+	m_balancePlayers.clear();
+	m_balancePlayerIndices.clear();
+
+	// every playing team is a candidate, even if it is empty
+	const size_t numTeams = m_serverInfo.m_scores.m_teamScores.size();
+	for (size_t teamId = 1; teamId <= numTeams; ++teamId)
+		m_balanceSolver.AddTeam(static_cast<uint8_t>(teamId));
+
+	for (const PlayerMap_t::value_type& player : m_players)
+	{
+		const std::shared_ptr<PlayerInfo>& pPlayer = player.second;
+
+		// commanders don't take up player slots, and neither they nor spectators are moved
+		if (pPlayer->teamId == 0 ||
+			pPlayer->type != PlayerInfo::TYPE_Player)
+			continue;
+
+		m_balancePlayerIndices.emplace(pPlayer.get(), m_balanceSolver.AddPlayer(Internal::BalanceSolver::Player{ pPlayer->teamId, pPlayer->squadId, strengthCallback(*pPlayer) }));
+		m_balancePlayers.push_back(pPlayer);
+	}
+
+	for (const MoveRequest_t& request : requests)
+	{
+		const std::unordered_map<const PlayerInfo*, size_t>::const_iterator indexIt = m_balancePlayerIndices.find(request.first.get());
+		if (indexIt != m_balancePlayerIndices.end() &&
+			request.second != 0)
+			m_balanceSolver.RequestMove(indexIt->second, request.second);
+	}
+
+	// teams can't be bigger than the server allows
+	BalanceOptions_t solverOptions = options;
+	if (numTeams != 0 &&
+		m_serverInfo.m_maxPlayerCount > 0)
+		solverOptions.maxTeamSize = std::min(solverOptions.maxTeamSize, static_cast<uint32_t>(m_serverInfo.m_maxPlayerCount / numTeams));
+
+	m_balanceSolver.Solve(solverOptions, m_balancePlan);
+
+	BalancePlan plan{ {}, m_balancePlan.strengthRatioBefore, m_balancePlan.strengthRatioAfter, m_balancePlan.balanced };
+	plan.moves.reserve(m_balancePlan.moves.size());
+	for (const Internal::BalanceSolver::Move& move : m_balancePlan.moves)
+		plan.moves.push_back(BalanceMove{ m_balancePlayers[move.playerIndex], move.teamId, move.squadId, move.requested });
+
+	return plan;
+}
+
 void Server::SendCommand(const std::vector<std::string>& command, RecvCallback_t&& recvCallback)
 {
 	// create our packet
-	Packet_t packet(command, m_lastSequence++);
+	const int32_t sequence = m_lastSequence++;
+	Packet_t packet(command, sequence);
+
+	// the response is logged under the command's name, so only keep it if it will be logged
+	std::string commandName;
+	if (m_eventLog.IsOpen() == true &&
+		command.empty() == false)
+	{
+		m_eventLog.LogCommand(sequence, command, Internal::EventLog::Clock_t::now());
+		commandName = command.front();
+	}
 
 	// send the packet
-	m_connection.SendPacket(packet, [recvCallback{ std::move(recvCallback) }]
+	m_connection.SendPacket(packet, [this, sequence, commandName{ std::move(commandName) }, recvCallback{ std::move(recvCallback) }]
 		(const Connection_t::ErrorCode_t& ec, const std::optional<Packet_t>& packet)
 		{
+			if (commandName.empty() == false)
+			{
+				if (ec)
+					m_eventLog.LogResponse(sequence, commandName, { ec.message() }, true, Internal::EventLog::Clock_t::now());
+				else
+					m_eventLog.LogResponse(sequence, commandName, packet->GetWords(), false, Internal::EventLog::Clock_t::now());
+			}
+
 			// make sure we don't have an error
 			if (ec)
 				return recvCallback(ec, std::vector<std::string>{});
@@ -162,6 +371,16 @@ void Server::SendCommand(const std::vector<std::string>& command, RecvCallback_t
 		});
 }
 
+void Server::GetCommandTimings(std::vector<CommandTiming_t>& timingsOut) const
+{
+	m_connection.GetCommandTimings(timingsOut);
+}
+
+void Server::GetPendingCommands(std::vector<PendingCommand_t>& pendingOut) const
+{
+	m_connection.GetPendingCommands(pendingOut);
+}
+
 void Server::RegisterCallback(const std::string& eventName, EventCallback_t&& eventCallback)
 {
 	RegisterPrePluginCallback(eventName, std::move(eventCallback));
@@ -184,10 +403,20 @@ bool Server::EnablePlugin(const std::string& pluginName)
 	const PluginMap_t::const_iterator pluginIt = m_plugins.find(pluginName);
 
 	if (pluginIt == m_plugins.end())
-		return false;
+	{
+		const decltype(m_sandboxes)::const_iterator sandboxIt = m_sandboxes.find(pluginName);
+		if (sandboxIt == m_sandboxes.end())
+			return false;
+
+		sandboxIt->second->Enable();
+		return true;
+	}
 
 	pluginIt->second.pPlugin->Enable();
 
+	// pick up any commands it registered since the last build
+	BuildCommandRouter();
+
 	return true;
 }
 
@@ -196,7 +425,14 @@ bool Server::DisablePlugin(const std::string& pluginName)
 	const PluginMap_t::const_iterator pluginIt = m_plugins.find(pluginName);
 
 	if (pluginIt == m_plugins.end())
-		return false;
+	{
+		const decltype(m_sandboxes)::const_iterator sandboxIt = m_sandboxes.find(pluginName);
+		if (sandboxIt == m_sandboxes.end())
+			return false;
+
+		sandboxIt->second->Disable();
+		return true;
+	}
 
 	pluginIt->second.pPlugin->Disable();
 
@@ -222,18 +458,255 @@ void Server::ScheduleAction(TimedAction_t&& timedAction, const size_t millisecon
 	ScheduleAction(std::move(timedAction), std::chrono::milliseconds(millisecondsFromNow));
 }
 
+Server::FileWatchId_t Server::WatchFile(const std::string& path, FileWatchCallback_t&& watchCallback)
+{
+	return m_fileWatcher.Watch(path, std::move(watchCallback));
+}
+
+void Server::UnwatchFile(const FileWatchId_t watchId)
+{
+	m_fileWatcher.Unwatch(watchId);
+}
+
+bool Server::StorePut(const std::string_view storeNamespace, const std::string_view key, const std::string_view value, const std::chrono::seconds ttl)
+{
+	if (OpenStore() == false)
+		return false;
+
+	const Internal::KVStore::Clock_t::time_point expiry = (ttl.count() != 0) ? Internal::KVStore::Clock_t::now() + ttl : Internal::KVStore::Clock_t::time_point::max();
+	return m_store.Put(std::string(storeNamespace) + '\0' + std::string(key), value, expiry);
+}
+
+std::optional<std::string> Server::StoreGet(const std::string_view storeNamespace, const std::string_view key)
+{
+	if (OpenStore() == false)
+		return std::nullopt;
+
+	return m_store.Get(std::string(storeNamespace) + '\0' + std::string(key));
+}
+
+bool Server::StoreErase(const std::string_view storeNamespace, const std::string_view key)
+{
+	if (OpenStore() == false)
+		return false;
+
+	return m_store.Erase(std::string(storeNamespace) + '\0' + std::string(key));
+}
+
+void Server::StoreScan(const std::string_view storeNamespace, const std::string_view begin, const std::string_view end, const StoreScanCallback_t& scanCallback)
+{
+	if (OpenStore() == false)
+		return;
+
+	// keys are prefixed by the namespace and a null, so the namespace ends right before the same prefix with a 1
+	const std::string prefix = std::string(storeNamespace) + '\0';
+	const std::string scanBegin = prefix + std::string(begin);
+	const std::string scanEnd = (end.empty() == true) ? std::string(storeNamespace) + '\1' : prefix + std::string(end);
+
+	m_store.Scan(scanBegin, scanEnd, [&prefix, &scanCallback](const std::string_view key, const std::string_view value)
+	{
+		return scanCallback(key.substr(prefix.size()), value);
+	});
+}
+
+bool Server::GetKillStats(const std::string_view playerName, KillStats_t& statsOut) const
+{
+	return m_killStream.GetStats(playerName, Internal::KillStream::Clock_t::now(), statsOut);
+}
+
+Server::KillThresholdId_t Server::SubscribeKillThreshold(const KillThreshold_t& threshold, KillThresholdCallback_t&& thresholdCallback)
+{
+	return m_killStream.Subscribe(threshold, std::move(thresholdCallback));
+}
+
+void Server::UnsubscribeKillThreshold(const KillThresholdId_t thresholdId)
+{
+	m_killStream.Unsubscribe(thresholdId);
+}
+
+bool Server::GetPlayerHistory(const std::string_view playerName, const std::chrono::system_clock::time_point since, PlayerHistory_t& historyOut)
+{
+	if (OpenRoundHistory() == false)
+	{
+		historyOut = PlayerHistory_t{};
+		return false;
+	}
+
+	return m_roundHistory.GetPlayerTotals(playerName, since, historyOut);
+}
+
+std::vector<Server::PlayerHistoryRound_t> Server::GetPlayerHistoryRounds(const std::string_view playerName, const std::chrono::system_clock::time_point since)
+{
+	std::vector<PlayerHistoryRound_t> rounds;
+	if (OpenRoundHistory() == true)
+		m_roundHistory.GetPlayerRounds(playerName, since, rounds);
+
+	return rounds;
+}
+
+Server::PlayerHistory_t Server::GetServerHistory(const std::chrono::system_clock::time_point since)
+{
+	if (OpenRoundHistory() == false)
+		return PlayerHistory_t{};
+
+	return m_roundHistory.GetServerTotals(since);
+}
+
+std::vector<Server::PlayerHistory_t> Server::GetTopPlayers(const HistoryMetric_t metric, const std::chrono::system_clock::time_point since, const uint32_t minRounds, const size_t limit)
+{
+	std::vector<PlayerHistory_t> topPlayers;
+	if (OpenRoundHistory() == true)
+		m_roundHistory.GetTopPlayers(metric, since, minRounds, limit, topPlayers);
+
+	return topPlayers;
+}
+
+bool Server::OpenRoundHistory()
+{
+	if (m_roundHistory.IsOpen() == true)
+		return true;
+
+	if (m_roundHistory.Open("plugins/history", s_roundHistoryRetention, m_isPluginHost) == false)
+	{
+		m_errLog << "Failed to open the round history\n";
+		return false;
+	}
+
+	return true;
+}
+
+void Server::RecordRound()
+{
+	if (OpenRoundHistory() == false)
+		return;
+
+	const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+	const uint32_t roundSeconds = static_cast<uint32_t>(std::max(m_serverInfo.m_roundTime, 0));
+
+	Internal::RoundHistory::Round round;
+	round.end = now;
+	round.map = m_serverInfo.m_map;
+	round.gameMode = m_serverInfo.m_gameMode;
+	round.durationSeconds = roundSeconds;
+	round.winningTeam = m_roundWinner;
+
+	for (const PlayerMap_t::value_type& player : m_players)
+	{
+		const PlayerInfo& playerInfo = *player.second;
+
+		// only players on a playing team took part
+		if (playerInfo.teamId == 0 ||
+			playerInfo.type != PlayerInfo::TYPE_Player)
+			continue;
+
+		// players who stayed from an earlier round were here for all of it
+		const int64_t secondsSinceFirstSeen = std::chrono::duration_cast<std::chrono::seconds>(now - playerInfo.firstSeen).count();
+		const uint32_t secondsPlayed = static_cast<uint32_t>(std::clamp<int64_t>(secondsSinceFirstSeen, 0, roundSeconds));
+
+		round.players.push_back(Internal::RoundHistory::PlayerRound{ playerInfo.name, playerInfo.teamId, playerInfo.kills, playerInfo.deaths, playerInfo.score, secondsPlayed });
+	}
+
+	if (m_roundHistory.AppendRound(round) == false)
+		m_errLog << "Failed to record the round\n";
+
+	m_roundWinner = 0;
+}
+
+bool Server::OpenStore()
+{
+	if (m_store.IsOpen() == true)
+		return true;
+
+	if (m_store.Open("plugins/BetteRCon.kv") == false)
+	{
+		m_errLog << "Failed to open the key-value store\n";
+		return false;
+	}
+
+	return true;
+}
+
 void Server::MovePlayer(const uint8_t teamId, const uint8_t squadId, const std::shared_ptr<PlayerInfo>& pPlayer)
 {
-	const uint8_t oldTeamId = pPlayer->teamId;
-	const uint8_t oldSquadId = pPlayer->squadId;
+	MoveBatch({ BatchMove{ pPlayer, teamId, squadId } }, nullptr);
+}
+
+void Server::MoveBatch(const std::vector<BatchMove>& moves, MoveBatchCallback_t&& moveBatchCallback)
+{
+	const std::shared_ptr<MoveBatchState> pBatch = std::make_shared<MoveBatchState>();
+	pBatch->moveBatchCallback = std::move(moveBatchCallback);
+
+	// if a player is moved more than once, the last move wins
+	std::unordered_map<const PlayerInfo*, size_t> moveIndices;
+	for (const BatchMove& move : moves)
+	{
+		if (move.pPlayer == nullptr)
+			continue;
+
+		const std::unordered_map<const PlayerInfo*, size_t>::const_iterator moveIndexIt = moveIndices.find(move.pPlayer.get());
+		if (moveIndexIt != moveIndices.end())
+		{
+			pBatch->results[moveIndexIt->second] = BatchMoveResult{ move.pPlayer, move.teamId, move.squadId, "" };
+			continue;
+		}
+
+		moveIndices.emplace(move.pPlayer.get(), pBatch->results.size());
+		pBatch->results.push_back(BatchMoveResult{ move.pPlayer, move.teamId, move.squadId, "" });
+	}
+
+	// make sure they can actually be moved
+	for (BatchMoveResult& result : pBatch->results)
+	{
+		const PlayerMap_t::const_iterator playerIt = m_players.find(result.pPlayer->name);
+		if (playerIt == m_players.end() ||
+			playerIt->second != result.pPlayer)
+			result.error = "PlayerNotFound";
+		else if (result.teamId == 0)
+			result.error = "InvalidTeamId";
+		else if (result.squadId == UINT8_MAX &&
+			result.teamId == result.pPlayer->teamId)
+			// they are already on the team
+			result.squadId = result.pPlayer->squadId;
+	}
+
+	PlanBatchSquads(pBatch->results);
+
+	// assume they all work, and move everybody in the team map first
+	pBatch->oldSquads.reserve(pBatch->results.size());
+	pBatch->sent.reserve(pBatch->results.size());
+	pBatch->answered.resize(pBatch->results.size(), false);
+	for (const BatchMoveResult& result : pBatch->results)
+	{
+		const std::shared_ptr<PlayerInfo>& pPlayer = result.pPlayer;
+		pBatch->oldSquads.emplace_back(pPlayer->teamId, pPlayer->squadId);
+
+		const bool send = result.error.empty() == true &&
+			(pPlayer->teamId != result.teamId || pPlayer->squadId != result.squadId);
+		pBatch->sent.push_back(send);
+
+		if (send == false)
+			continue;
 
-	// assume it worked, remove them from their old team/squad and add them to the new one
-	RemovePlayerFromSquad(pPlayer, oldTeamId, oldSquadId);
-	AddPlayerToSquad(pPlayer, teamId, squadId);
+		RemovePlayerFromSquad(pPlayer, pPlayer->teamId, pPlayer->squadId);
+		AddPlayerToSquad(pPlayer, result.teamId, result.squadId);
+	}
 
-	// send the command
-	SendCommand({ "admin.movePlayer", pPlayer->name, std::to_string(teamId), std::to_string(squadId), "true" },
-		std::bind(&Server::HandleMovePlayer, this, oldTeamId, oldSquadId, pPlayer, std::placeholders::_1, std::placeholders::_2));
+	pBatch->pendingMoves = std::count(pBatch->sent.begin(), pBatch->sent.end(), true);
+	if (pBatch->pendingMoves == 0)
+		return FinishMoveBatch(pBatch);
+
+	m_moveBatches.push_back(pBatch);
+
+	// send the commands without waiting for each other
+	for (size_t i = 0; i < pBatch->results.size(); ++i)
+	{
+		if (pBatch->sent[i] == false)
+			continue;
+
+		const BatchMoveResult& result = pBatch->results[i];
+		SendCommand({ "admin.movePlayer", result.pPlayer->name, std::to_string(result.teamId), std::to_string(result.squadId), "true" },
+			std::bind(&Server::HandleBatchMovePlayer, this, pBatch, i, std::placeholders::_1, std::placeholders::_2));
+	}
 }
 
 Server::~Server()
@@ -249,6 +722,22 @@ void Server::ClearContainers()
 	m_gotServerInfo = false;
 	m_gotServerPlayers = false;
 
+	// the score history is for this server's round
+	m_ticketForecaster.Reset();
+
+	// the subscribers are about to be unloaded
+	m_killStream.Clear();
+
+	// and so are the command handlers
+	m_commandRouter.Clear();
+	m_commandRoutes.clear();
+
+	// the filter and command limits are loaded again on the next login
+	m_chatFilter.Clear();
+	m_chatFilterPatterns.clear();
+	m_commandLimiter.Clear();
+	m_cooldownRepliedPlayers.clear();
+
 	// disable plugins
 	PluginMap_t::iterator pluginIt = m_plugins.begin();
 	while (pluginIt != m_plugins.end())
@@ -270,10 +759,24 @@ void Server::ClearContainers()
 		pluginIt = m_plugins.erase(pluginIt);
 	}
 
+	// the hosts unload their plugins when they are stopped, and exit in the background
+	for (decltype(m_sandboxes)::value_type& sandbox : m_sandboxes)
+	{
+		StopSandbox(sandbox.second);
+		m_pluginCallback(sandbox.first, false, true, "");
+	}
+	m_sandboxes.clear();
+
+	// the ones still loading never said they were loaded
+	for (const std::shared_ptr<Internal::PluginSandbox>& pSandbox : m_loadingSandboxes)
+		StopSandbox(pSandbox);
+	m_loadingSandboxes.clear();
+
 	// clear the players and handlers
 	m_prePluginEventCallbacks.clear();
 	m_postPluginEventCallbacks.clear();
 	m_players.clear();
+	m_playerNameIndex.Clear();
 	m_teams.clear();
 	ErrorCode_t ignored;
 	for (decltype(m_scheduledTimers)::iterator it = m_scheduledTimers.begin(); it != m_scheduledTimers.end();)
@@ -281,6 +784,7 @@ void Server::ClearContainers()
 		(*it)->cancel(ignored);
 		it = m_scheduledTimers.erase(it);
 	}
+	m_fileWatcher.Clear();
 }
 
 void Server::SendResponse(const std::vector<std::string>& response, const int32_t sequence)
@@ -296,24 +800,44 @@ void Server::HandleEvent(const ErrorCode_t& ec, const std::optional<Packet_t>& e
 {
 	if (ec)
 	{
-		BetteRCon::Internal::g_stdErrLog << "ErrorCode on HandleEvent: " << ec.message() << '\n';
+		m_errLog << "ErrorCode on HandleEvent: " << ec.message() << '\n';
 		return;
 	}
 
-	auto callHandlers = [&event = std::as_const(event)](const EventCallbackMap_t& eventHandlerMap)
+	DispatchEvent(event->GetWords());
+
+	// isolated plugins get the server's events, and fire the bettercon events for themselves
+	for (decltype(m_sandboxes)::value_type& sandbox : m_sandboxes)
+		sandbox.second->PostEvent(event->GetWords());
+
+	// send back the OK response
+	SendResponse({ "OK" }, event->GetSequence());
+}
+
+void Server::DispatchEvent(const std::vector<std::string>& eventArgs)
+{
+	if (m_eventLog.IsOpen() == true)
+		m_eventLog.LogEvent(eventArgs, Internal::EventLog::Clock_t::now());
+
+	std::unordered_map<std::string, Internal::MetricCounter*>::const_iterator eventCounterIt = m_eventCounters.find(eventArgs.front());
+	if (eventCounterIt == m_eventCounters.end())
+		eventCounterIt = m_eventCounters.emplace(eventArgs.front(), m_metrics.GetCounter("bettercon_events_total", "Events dispatched, by name", { { "event", eventArgs.front() } })).first;
+	eventCounterIt->second->Increment();
+
+	auto callHandlers = [&eventArgs](const EventCallbackMap_t& eventHandlerMap)
 	{
 		// call each event handler
-		const std::pair<const EventCallbackMap_t::const_iterator, const EventCallbackMap_t::const_iterator> eventRange = eventHandlerMap.equal_range(event->GetWords().front());
+		const std::pair<const EventCallbackMap_t::const_iterator, const EventCallbackMap_t::const_iterator> eventRange = eventHandlerMap.equal_range(eventArgs.front());
 
 		for (EventCallbackMap_t::const_iterator it = eventRange.first; it != eventRange.second; ++it)
-			it->second(event->GetWords());
+			it->second(eventArgs);
 	};
 
 	// call prePlugin handlers before plugin handlers are called
 	callHandlers(m_prePluginEventCallbacks);
 
 	// call each plugin's event handler
-	for (const PluginMap_t::value_type& plugin : m_plugins)
+	for (PluginMap_t::value_type& plugin : m_plugins)
 	{
 		// make sure the plugin is enabled
 		if (plugin.second.pPlugin->IsEnabled() == false)
@@ -322,20 +846,25 @@ void Server::HandleEvent(const ErrorCode_t& ec, const std::optional<Packet_t>& e
 		const Plugin::EventHandlerMap_t& handlers = plugin.second.pPlugin->GetEventHandlers();
 
 		// call their handler
-		const Plugin::EventHandlerMap_t::const_iterator handlerIt = handlers.find(event->GetWords().front());
+		const Plugin::EventHandlerMap_t::const_iterator handlerIt = handlers.find(eventArgs.front());
 
 		if (handlerIt != handlers.end())
-			handlerIt->second(event->GetWords());
+		{
+			HandlerStats*& pStats = plugin.second.eventHandlerStats[&handlerIt->second];
+			if (pStats == nullptr)
+				pStats = GetHandlerStats(plugin.first, eventArgs.front(), false);
+
+			const Internal::HandlerWatchdog::Call call = m_handlerWatchdog.Enter(pStats);
+			handlerIt->second(eventArgs);
+			FinishPluginHandler(*pStats, plugin.second.pPlugin, m_handlerWatchdog.Leave(call));
+		}
 	}
 
 	// call postPlugin handlers after plugin handlers are called
 	callHandlers(m_postPluginEventCallbacks);
 
 	// call the main event handler
-	m_eventCallback(event->GetWords());
-
-	// send back the OK response
-	SendResponse({ "OK" }, event->GetSequence());
+	m_eventCallback(eventArgs);
 }
 
 void Server::HandleLoginRecvHash(const ErrorCode_t& ec, const std::vector<std::string>& response, const std::string& password, const LoginCallback_t& loginCallback)
@@ -429,7 +958,8 @@ void Server::HandleLoginRecvResponse(const ErrorCode_t& ec, const std::vector<st
 
 void Server::FireEvent(const std::vector<std::string>& eventArgs)
 {
-	HandleEvent(ErrorCode_t{}, std::make_optional<Packet_t>(eventArgs, 0));
+	// our own events didn't come from the server, so it isn't answered
+	DispatchEvent(eventArgs);
 }
 
 void Server::HandlePlayerInfo(const std::vector<std::string>& playerInfo)
@@ -437,7 +967,7 @@ void Server::HandlePlayerInfo(const std::vector<std::string>& playerInfo)
 	if (playerInfo.size() < 13)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "PlayerInfo was too small size: " << playerInfo.size() << '\n';
+		m_errLog << "PlayerInfo was too small size: " << playerInfo.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -445,7 +975,7 @@ void Server::HandlePlayerInfo(const std::vector<std::string>& playerInfo)
 	if (playerInfo[1] != "10")
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "PlayerInfo did not have 10 members: " << playerInfo[1] << '\n';
+		m_errLog << "PlayerInfo did not have 10 members: " << playerInfo[1] << '\n';
 		Disconnect();
 		return;
 	}
@@ -473,6 +1003,7 @@ void Server::HandlePlayerInfo(const std::vector<std::string>& playerInfo)
 			{
 				pPlayer = m_players.emplace(playerName, std::make_shared<PlayerInfo>()).first->second;
 				pPlayer->firstSeen = std::chrono::system_clock::now();
+				m_playerNameIndex.Insert(playerName);
 				firstTime = true;
 			}
 			else
@@ -502,24 +1033,35 @@ void Server::HandlePlayerInfo(const std::vector<std::string>& playerInfo)
 	}
 	catch (const std::exception& e)
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Malformed playerInfo\n";
+		m_errLog << "ERROR: Malformed playerInfo\n";
 		Disconnect();
 		return;
 	}
 
-	for (PlayerMap_t::iterator playerIt = m_players.begin(); playerIt != m_players.end(); ++playerIt)
+	for (PlayerMap_t::iterator playerIt = m_players.begin(); playerIt != m_players.end();)
 	{
 		// if we didn't see them in the list, remove them
 		if (playerIt->second->seenThisCheck == false)
 		{
-			BetteRCon::Internal::g_stdErrLog << "ERROR: Player " << playerIt->second->name << " has disappeared\n";
+			m_errLog << "ERROR: Player " << playerIt->second->name << " has disappeared\n";
 
 			// delete the player
 			RemovePlayerFromSquad(playerIt->second, playerIt->second->teamId, playerIt->second->squadId);
-			m_players.erase(playerIt);
+			m_playerNameIndex.Erase(playerIt->first);
+			m_killStream.RemovePlayer(playerIt->first);
+			m_cooldownRepliedPlayers.erase(playerIt->first);
+			playerIt = m_players.erase(playerIt);
 		}
+		else
+			++playerIt;
 	}
 
+	// forget anybody whose kills and deaths have all left the window, including kills of players we never knew
+	m_killStream.Prune(Internal::KillStream::Clock_t::now());
+
+	// and any command buckets that have filled back up
+	m_commandLimiter.Prune(Internal::RateLimiter::Clock_t::now());
+
 	// fire a playerInfo event
 	FireEvent({ "bettercon.playerInfo" });
 
@@ -552,7 +1094,7 @@ void Server::HandleOnAuthenticated(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() != 2)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnAuthenticated did not have 2 members: " << eventArgs.size() << '\n';
+		m_errLog << "OnAuthenticated did not have 2 members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -567,97 +1109,343 @@ void Server::HandleOnAuthenticated(const std::vector<std::string>& eventArgs)
 		ErrorCode_t ec;
 		playerTimerIt->second.second.cancel(ec);
 		m_players.emplace(playerName, playerTimerIt->second.first);
+		m_playerNameIndex.Insert(playerName);
 		AddPlayerToSquad(playerTimerIt->second.first, 0, 0);
 
-		m_playerTimers.erase(playerTimerIt);
-		return;
-	}
+		m_playerTimers.erase(playerTimerIt);
+		return;
+	}
+
+	// make a new player
+	const std::shared_ptr<PlayerInfo>& pPlayer = m_players.emplace(playerName, std::make_shared<PlayerInfo>()).first->second;
+
+	pPlayer->name = playerName;
+	pPlayer->firstSeen = std::chrono::system_clock::now();
+	m_playerNameIndex.Insert(playerName);
+
+	AddPlayerToSquad(pPlayer, 0, 0);
+}
+
+void Server::HandleOnChat(const std::vector<std::string>& eventArgs)
+{
+	if (eventArgs.size() < 4)
+	{
+		// the server is not ok, disconnect
+		m_errLog << "OnChat did not have at least 4 members: " << eventArgs.size() << '\n';
+		Disconnect();
+		return;
+	}
+
+	const std::string& playerName = eventArgs[1];
+	const std::string& chatMessage = eventArgs[2];
+
+	// make sure it isn't an empty chat message
+	if (chatMessage.empty() == true)
+		return;
+
+	// see if the player exists
+	const PlayerMap_t::const_iterator playerIt = m_players.find(playerName);
+	if (playerIt == m_players.end())
+		return;
+
+	// tell plugins about anything the chat filter matched, before they see the message
+	if (m_chatFilter.Scan(chatMessage, m_chatViolations) == true)
+	{
+		std::vector<std::string> violationArgs{ "bettercon.chatViolation", playerName, chatMessage };
+		violationArgs.reserve(violationArgs.size() + 3 * m_chatViolations.size());
+
+		for (const Internal::ChatFilter::Violation& violation : m_chatViolations)
+		{
+			violationArgs.push_back(m_chatFilter.GetPattern(violation.pattern));
+			violationArgs.push_back(std::to_string(violation.offset));
+			violationArgs.push_back(std::to_string(violation.length));
+		}
+
+		FireEvent(violationArgs);
+	}
+
+	size_t offset = 0;
+	// remove the slash if there is one
+	if (chatMessage[0] == '/')
+		offset = 1;
+
+	char prefix = '\0';
+
+	// all commands begin with !
+	if (chatMessage[offset] == '!' ||
+		chatMessage[offset] == '@' ||
+		chatMessage[offset] == '#')
+	{
+		prefix = chatMessage[offset];
+		++offset;
+	}
+	else if (chatMessage[0] != '/')
+		return;
+
+	// the command comes right after the prefix
+	if (offset == chatMessage.size() ||
+		chatMessage[offset] == ' ')
+		return;
+
+	// split up their message without copying it, and see if anybody handles the command before doing anything else
+	if (Internal::CommandRouter::Tokenize(std::string_view(chatMessage).substr(offset), m_commandTokens) == 0)
+		return;
+
+	const Internal::CommandRouter::Routes_t* pRoutes = m_commandRouter.FindRoutes(m_commandTokens[0]);
+	if (pRoutes == nullptr)
+		return;
+
+	// a player can't make handlers do work or send responses faster than the limits allow
+	if (TakeCommandLimit(playerName, m_commandTokens[0]) == false)
+		return;
+
+	// handlers take strings. assigning into the reused strings doesn't allocate once they are big enough
+	m_commandArgs.resize(m_commandTokens.size());
+	for (size_t i = 0; i < m_commandTokens.size(); ++i)
+		m_commandArgs[i].assign(m_commandTokens[i].data(), m_commandTokens[i].size());
+
+	// call each plugin's command handler
+	for (const Internal::CommandRouter::Route_t route : *pRoutes)
+	{
+		const CommandRoute& commandRoute = m_commandRoutes[route];
+
+		// make sure the plugin is enabled
+		if (commandRoute.pPlugin->IsEnabled() == false)
+			continue;
+
+		const Internal::HandlerWatchdog::Call call = m_handlerWatchdog.Enter(commandRoute.pStats);
+		(*commandRoute.pCommandHandler)(playerIt->second, m_commandArgs, prefix);
+		FinishPluginHandler(*commandRoute.pStats, commandRoute.pPlugin, m_handlerWatchdog.Leave(call));
+	}
+}
+
+void Server::BuildCommandRouter()
+{
+	m_commandRouter.Clear();
+	m_commandRoutes.clear();
+
+	// routes are added in plugin order, so handlers are called in the same order as before
+	for (const PluginMap_t::value_type& plugin : m_plugins)
+	{
+		for (const Plugin::CommandHandlerMap_t::value_type& commandHandler : plugin.second.pPlugin->GetCommandHandlers())
+		{
+			m_commandRouter.AddRoute(commandHandler.first, static_cast<Internal::CommandRouter::Route_t>(m_commandRoutes.size()));
+			m_commandRoutes.push_back(CommandRoute{ plugin.second.pPlugin, &commandHandler.second, GetHandlerStats(plugin.first, commandHandler.first, true) });
+		}
+	}
+}
+
+Server::HandlerStats* Server::GetHandlerStats(const std::string_view pluginName, const std::string& handlerName, const bool command)
+{
+	const std::string description = ((command == true) ? "command " : "event ") + handlerName;
+
+	HandlerStats& stats = m_handlerStats[std::make_pair(std::string(pluginName), description)];
+	if (stats.pSeconds != nullptr)
+		return &stats;
+
+	stats.pluginName = pluginName;
+	stats.description = description;
+	if (command == true)
+		stats.pSeconds = m_metrics.GetHistogram("bettercon_plugin_command_handler_seconds", "Time spent in each plugin's command handlers, by command",
+			{ { "plugin", stats.pluginName }, { "command", handlerName } });
+	else
+		stats.pSeconds = m_metrics.GetHistogram("bettercon_plugin_event_handler_seconds", "Time spent in each plugin's event handlers, by event",
+			{ { "plugin", stats.pluginName }, { "event", handlerName } });
+	stats.pSlowCalls = m_metrics.GetCounter("bettercon_plugin_slow_handler_calls_total", "Plugin handler calls that ran past the budget",
+		{ { "plugin", stats.pluginName } });
+
+	return &stats;
+}
+
+void Server::FinishPluginHandler(HandlerStats& stats, Plugin* pPlugin, const uint64_t elapsedTicks)
+{
+	stats.pSeconds->Observe(Internal::CycleClock::ToDuration(elapsedTicks));
+
+	if (m_handlerBudgetTicks == 0 ||
+		elapsedTicks <= m_handlerBudgetTicks)
+		return;
+
+	stats.pSlowCalls->Increment();
+
+	const int64_t elapsedMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(Internal::CycleClock::ToDuration(elapsedTicks)).count();
+	m_warnLog << stats.pluginName << "'s " << stats.description << " handler took " << elapsedMilliseconds << "ms, over the budget of " << m_handlerBudget.count() << "ms\n";
+
+	// it can only be stopped between calls, so this is as soon as it can be disabled
+	if (m_slowHandlerAction == SlowHandlerAction_Disable &&
+		pPlugin->IsEnabled() == true)
+	{
+		pPlugin->Disable();
+		m_warnLog << "Disabled " << stats.pluginName << " for holding up the worker\n";
+	}
+}
+
+void Server::HandleStalledHandler(const HandlerStats& stats, const std::chrono::nanoseconds elapsed)
+{
+	// called from the watchdog's thread while the worker is still in the handler
+	const int64_t elapsedMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+	m_warnLog << stats.pluginName << "'s " << stats.description << " handler has held up the worker for " << elapsedMilliseconds << "ms, over the budget of " << m_handlerBudget.count() << "ms\n";
+}
+
+void Server::LoadChatFilter()
+{
+	std::ifstream inFile("plugins/ChatFilter.cfg");
+
+	std::string patternLine;
+	while (std::getline(inFile, patternLine))
+	{
+		// files edited on windows
+		if (patternLine.empty() == false &&
+			patternLine.back() == '\r')
+			patternLine.pop_back();
+
+		if (patternLine.empty() == false)
+			m_chatFilterPatterns.insert(std::move(patternLine));
+	}
+
+	CompileChatFilter();
+
+	// pick up patterns that are added or removed while we are running
+	m_fileWatcher.Watch("plugins/ChatFilter.cfg", std::bind(&Server::HandleChatFilterChanged, this, std::placeholders::_1));
+}
+
+void Server::HandleChatFilterChanged(const FileDiff_t& diff)
+{
+	for (const std::string& patternLine : diff.removedLines)
+		m_chatFilterPatterns.erase(patternLine);
+
+	m_chatFilterPatterns.insert(diff.addedLines.begin(), diff.addedLines.end());
 
-	// make a new player
-	const std::shared_ptr<PlayerInfo>& pPlayer = m_players.emplace(playerName, std::make_shared<PlayerInfo>()).first->second;
+	CompileChatFilter();
+}
 
-	pPlayer->name = playerName;
-	pPlayer->firstSeen = std::chrono::system_clock::now();
+void Server::CompileChatFilter()
+{
+	// the automaton is rebuilt from scratch, which is cheap next to how rarely the list changes
+	const size_t numPatterns = m_chatFilter.Compile(std::vector<std::string>(m_chatFilterPatterns.begin(), m_chatFilterPatterns.end()));
+	if (numPatterns != m_chatFilterPatterns.size())
+		m_errLog << "The chat filter has " << m_chatFilterPatterns.size() - numPatterns << " patterns without letters or digits, which never match\n";
+}
 
-	AddPlayerToSquad(pPlayer, 0, 0);
+void Server::LoadCommandLimits()
+{
+	ReadCommandLimits();
+
+	// the file is small, so it is read again whenever it changes
+	m_fileWatcher.Watch("plugins/CommandLimits.cfg", [this](const FileDiff_t&) { ReadCommandLimits(); });
 }
 
-void Server::HandleOnChat(const std::vector<std::string>& eventArgs)
+void Server::ReadCommandLimits()
 {
-	if (eventArgs.size() < 4)
+	m_playerCommandLimit = s_defaultPlayerCommandLimit;
+	m_commandLimit = s_defaultCommandLimit;
+	m_commandLimits.clear();
+	m_cooldownReply = s_defaultCooldownReply;
+
+	std::ifstream inFile("plugins/CommandLimits.cfg");
+
+	std::string limitLine;
+	while (std::getline(inFile, limitLine))
 	{
-		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnChat did not have at least 4 members: " << eventArgs.size() << '\n';
-		Disconnect();
-		return;
-	}
+		// files edited on windows
+		if (limitLine.empty() == false &&
+			limitLine.back() == '\r')
+			limitLine.pop_back();
 
-	const std::string& playerName = eventArgs[1];
-	const std::string& chatMessage = eventArgs[2];
+		if (limitLine.empty() == true)
+			continue;
 
-	// make sure it isn't an empty chat message
-	if (chatMessage.empty() == true)
-		return;
+		const size_t comma = limitLine.find(',');
+		if (comma == std::string::npos)
+		{
+			m_errLog << "Failed to find comma for command limit " << limitLine << '\n';
+			continue;
+		}
 
-	// see if the player exists
-	const PlayerMap_t::const_iterator playerIt = m_players.find(playerName);
-	if (playerIt == m_players.end())
-		return;
+		std::string commandName = limitLine.substr(0, comma);
+		std::transform(commandName.begin(), commandName.end(), commandName.begin(), [](const char c) { return std::tolower(c); });
 
-	size_t offset = 0;
-	// remove the slash if there is one
-	if (chatMessage[0] == '/')
-		offset = 1;
+		// the reply can have commas in it
+		if (commandName == "[reply]")
+		{
+			m_cooldownReply = limitLine.substr(comma + 1);
+			continue;
+		}
 
-	char prefix = '\0';
+		CommandLimit_t limit;
+		try
+		{
+			const size_t secondComma = limitLine.find(',', comma + 1);
+			if (secondComma == std::string::npos)
+				throw std::invalid_argument("missing seconds");
+
+			const int32_t burst = std::stoi(limitLine.substr(comma + 1, secondComma - comma - 1));
+			const float seconds = std::stof(limitLine.substr(secondComma + 1));
+			if (burst < 1 ||
+				seconds < 0.f)
+				throw std::out_of_range("negative limit");
+
+			limit.burst = static_cast<uint32_t>(burst);
+			limit.interval = std::chrono::duration_cast<Internal::RateLimiter::Clock_t::duration>(std::chrono::duration<float>(seconds));
+		}
+		catch (const std::exception&)
+		{
+			m_errLog << "Invalid command limit " << limitLine << '\n';
+			continue;
+		}
 
-	// all commands begin with !
-	if (chatMessage[offset] == '!' ||
-		chatMessage[offset] == '@' ||
-		chatMessage[offset] == '#')
-	{
-		prefix = chatMessage[offset];
-		++offset;
+		if (commandName == "[player]")
+			m_playerCommandLimit = limit;
+		else if (commandName == "[command]")
+			m_commandLimit = limit;
+		else
+			m_commandLimits.insert_or_assign(std::move(commandName), limit);
 	}
-	else if (chatMessage[0] != '/')
-		return;
+}
 
-	// split up their message by spaces
-	std::vector<std::string> commandArgs;
-	size_t space = chatMessage.find(' ', offset);
-	if (space == std::string::npos)
-	{
-		commandArgs.emplace_back(chatMessage.substr(offset));
-	}
-	else
+bool Server::TakeCommandLimit(const std::string& playerName, const std::string_view commandName)
+{
+	const Internal::RateLimiter::Clock_t::time_point now = Internal::RateLimiter::Clock_t::now();
+
+	// commands are limited regardless of case
+	m_commandLimitName.clear();
+	std::transform(commandName.begin(), commandName.end(), std::back_inserter(m_commandLimitName), [](const char c) { return std::tolower(c); });
+
+	const CommandLimitMap_t::const_iterator commandLimitIt = m_commandLimits.find(m_commandLimitName);
+	const CommandLimit_t& commandLimit = (commandLimitIt != m_commandLimits.end()) ? commandLimitIt->second : m_commandLimit;
+
+	// the player's bucket is their name, and each of their commands' buckets is their name and the command
+	m_commandLimitKey.assign(playerName);
+	m_commandLimitKey.push_back('\0');
+	m_commandLimitKey.append(m_commandLimitName);
+
+	// only take from either bucket if both have a token
+	const Internal::RateLimiter::Clock_t::duration wait = std::max(m_commandLimiter.GetWait(playerName, m_playerCommandLimit, now),
+		m_commandLimiter.GetWait(m_commandLimitKey, commandLimit, now));
+	if (wait == Internal::RateLimiter::Clock_t::duration::zero())
 	{
-		do
-		{
-			commandArgs.emplace_back(chatMessage.substr(offset, space - offset));
-			offset = space + 1;
-		} while ((space = chatMessage.find(' ', offset)) != std::string::npos);
-		commandArgs.emplace_back(chatMessage.substr(offset));
+		m_commandLimiter.Take(playerName, m_playerCommandLimit, now);
+		m_commandLimiter.Take(m_commandLimitKey, commandLimit, now);
+		m_cooldownRepliedPlayers.erase(playerName);
+		return true;
 	}
 
-	// store the lowercase command
-	std::string lowerCommand;
-	std::transform(commandArgs[0].begin(), commandArgs[0].end(), std::back_inserter(lowerCommand), [](const char c) { return std::tolower(c); });
+	// tell them once, rather than answering spam with more messages
+	if (m_cooldownReply.empty() == true ||
+		m_cooldownRepliedPlayers.insert(playerName).second == false)
+		return false;
 
-	// call each plugin's command handler
-	for (const PluginMap_t::value_type& plugin : m_plugins)
+	const auto replace = [](std::string& message, const std::string_view from, const std::string_view to)
 	{
-		// make sure the plugin is enabled
-		if (plugin.second.pPlugin->IsEnabled() == false)
-			continue;
-
-		const Plugin::CommandHandlerMap_t& commandHandlers = plugin.second.pPlugin->GetCommandHandlers();
+		for (size_t offset = message.find(from); offset != std::string::npos; offset = message.find(from, offset + to.size()))
+			message.replace(offset, from.size(), to);
+	};
 
-		// call their handler
-		const std::pair<const Plugin::CommandHandlerMap_t::const_iterator, const Plugin::CommandHandlerMap_t::const_iterator> commandRange = commandHandlers.equal_range(lowerCommand);
+	std::string reply = m_cooldownReply;
+	replace(reply, "{command}", m_commandLimitName);
+	replace(reply, "{seconds}", std::to_string(std::chrono::ceil<std::chrono::seconds>(wait).count()));
 
-		for (Plugin::CommandHandlerMap_t::const_iterator it = commandRange.first; it != commandRange.second; ++it)
-			it->second(playerIt->second, commandArgs, prefix);
-	}
+	SendCommand({ "admin.say", reply, "player", playerName }, [](const ErrorCode_t&, const std::vector<std::string>&) {});
+	return false;
 }
 
 void Server::HandleOnJoin(const std::vector<std::string>& eventArgs)
@@ -666,7 +1454,7 @@ void Server::HandleOnJoin(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() != 3)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnJoin did not have 3 members: " << eventArgs.size() << '\n';
+		m_errLog << "OnJoin did not have 3 members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -700,7 +1488,7 @@ void Server::HandleOnKill(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() != 5)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnKill did not have 5 members: " << eventArgs.size() << '\n';
+		m_errLog << "OnKill did not have 5 members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -708,10 +1496,13 @@ void Server::HandleOnKill(const std::vector<std::string>& eventArgs)
 	const std::string& killerName = eventArgs[1];
 	const std::string& victimName = eventArgs[2];
 
+	// the stream keeps the weapon and headshot, which the player map has no place for
+	m_killStream.AddKill(killerName, victimName, eventArgs[3], eventArgs[4] == "true", Internal::KillStream::Clock_t::now());
+
 	const PlayerMap_t::const_iterator victimIt = m_players.find(victimName);
 	if (victimIt == m_players.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Victim " << killerName << " not found in player map\n";
+		m_errLog << "ERROR: Victim " << killerName << " not found in player map\n";
 		return;
 	}
 
@@ -729,7 +1520,7 @@ void Server::HandleOnKill(const std::vector<std::string>& eventArgs)
 	const PlayerMap_t::const_iterator killerIt = m_players.find(killerName);
 	if (killerIt == m_players.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Killer " << killerName << " not found in player map\n";
+		m_errLog << "ERROR: Killer " << killerName << " not found in player map\n";
 		return;
 	}
 
@@ -743,7 +1534,7 @@ void Server::HandleOnLeave(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() < 2)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnLeave did not have at least members: " << eventArgs.size() << '\n';
+		m_errLog << "OnLeave did not have at least members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -753,7 +1544,7 @@ void Server::HandleOnLeave(const std::vector<std::string>& eventArgs)
 	const PlayerMap_t::const_iterator playerIt = m_players.find(playerName);
 	if (playerIt == m_players.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Player " << playerName << " left but was not found in the internal player map\n";
+		m_errLog << "ERROR: Player " << playerName << " left but was not found in the internal player map\n";
 		return;
 	}
 
@@ -763,7 +1554,10 @@ void Server::HandleOnLeave(const std::vector<std::string>& eventArgs)
 	// erase them from the team map
 	RemovePlayerFromSquad(playerIt->second, teamId, squadId);
 
-	// remove them from the player map
+	// remove them from the player map, the name index, the kill stream and the cooldown replies
+	m_playerNameIndex.Erase(playerName);
+	m_killStream.RemovePlayer(playerName);
+	m_cooldownRepliedPlayers.erase(playerName);
 	m_players.erase(playerIt);
 }
 
@@ -772,7 +1566,7 @@ void Server::HandleOnSpawn(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() < 2)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnSpawn did not have at least 2 members: " << eventArgs.size() << '\n';
+		m_errLog << "OnSpawn did not have at least 2 members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -783,7 +1577,7 @@ void Server::HandleOnSpawn(const std::vector<std::string>& eventArgs)
 	const PlayerMap_t::iterator playerIt = m_players.find(playerName);
 	if (playerIt == m_players.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Player " << playerName << " spawned but is not stored!\n";
+		m_errLog << "ERROR: Player " << playerName << " spawned but is not stored!\n";
 		return;
 	}
 
@@ -802,7 +1596,7 @@ void Server::HandleOnTeamChange(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() != 4)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnTeamChange did not have 4 members: " << eventArgs.size() << '\n';
+		m_errLog << "OnTeamChange did not have 4 members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -832,9 +1626,30 @@ void Server::HandleOnTeamChange(const std::vector<std::string>& eventArgs)
 	AddPlayerToSquad(pPlayer, newTeamId, newSquadId);
 }
 
+void Server::HandleOnRoundOver(const std::vector<std::string>& eventArgs)
+{
+	if (eventArgs.size() != 2)
+	{
+		// the server is not ok, disconnect
+		m_errLog << "OnRoundOver did not have 2 members: " << eventArgs.size() << '\n';
+		Disconnect();
+		return;
+	}
+
+	// the players and their final stats come next, in server.onRoundOverPlayers
+	m_roundWinner = static_cast<uint8_t>(std::stoi(eventArgs[1]));
+}
+
 void Server::HandleOnRoundEnd(const std::vector<std::string>& eventArgs)
 {
 	HandlePlayerInfo(eventArgs);
+
+	// the players now have their final stats. The server process recorded the round before it sent the event on to a plugin host
+	if (IsConnected() == true)
+		RecordRound();
+	else if (m_isPluginHost == true &&
+		m_roundHistory.IsOpen() == true)
+		m_roundHistory.Refresh();
 }
 
 void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
@@ -842,7 +1657,7 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 	if (eventArgs.size() != 2)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "OnLeave did not have 2 members: " << eventArgs.size() << '\n';
+		m_errLog << "OnLeave did not have 2 members: " << eventArgs.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -854,14 +1669,17 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 	// see if we should expect a playerList
 	if (pbMessage.find("Player List:") != std::string::npos)
 	{
-		// reset the timer and wait again
-		ErrorCode_t ec;
-		m_punkbusterPlayerListTimer.cancel_one(ec);
+		// reset the timer and wait again. A plugin host leaves the polling to the server process
+		if (m_isPluginHost == false)
+		{
+			ErrorCode_t ec;
+			m_punkbusterPlayerListTimer.cancel_one(ec);
 
-		m_punkbusterPlayerListTimer.expires_from_now(std::chrono::seconds(30));
-		m_punkbusterPlayerListTimer.async_wait(std::bind(
-			&Server::HandlePunkbusterPlayerListTimerExpire,
-			this, std::placeholders::_1));
+			m_punkbusterPlayerListTimer.expires_from_now(std::chrono::seconds(30));
+			m_punkbusterPlayerListTimer.async_wait(std::bind(
+				&Server::HandlePunkbusterPlayerListTimerExpire,
+				this, std::placeholders::_1));
+		}
 
 		s_expectPlayerList = true;
 	}
@@ -900,7 +1718,7 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 		const PlayerMap_t::const_iterator playerIt = m_players.find(name);
 		if (playerIt == m_players.end())
 		{
-			BetteRCon::Internal::g_stdErrLog << "ERROR: Punkbuster sent a new connection for a player that we don't have stored\n";
+			m_errLog << "ERROR: Punkbuster sent a new connection for a player that we don't have stored\n";
 			return;
 		}
 
@@ -915,7 +1733,7 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 	{
 		if (pbMessage.size() < sizeof("PunkBuster Server: ") - 1)
 		{
-			BetteRCon::Internal::g_stdErrLog << "ERROR: PB sent an empty message\n";
+			m_errLog << "ERROR: PB sent an empty message\n";
 			return;
 		}
 
@@ -944,7 +1762,7 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 			(OS == "(" && !(ss >> OS)) || // stupid case where OS is not (V) and is instead ( )
 			!(ss >> name))
 		{
-			BetteRCon::Internal::g_stdErrLog << "ERROR: Failed to parse PB player list message\n";
+			m_errLog << "ERROR: Failed to parse PB player list message\n";
 			return;
 		}
 
@@ -955,14 +1773,14 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 		const PlayerMap_t::const_iterator playerIt = m_players.find(name);
 		if (playerIt == m_players.end())
 		{
-			BetteRCon::Internal::g_stdErrLog << "ERROR: Punkbuster sent player info for a player who is not in the internal player map\n";
+			m_errLog << "ERROR: Punkbuster sent player info for a player who is not in the internal player map\n";
 			return;
 		}
 
 		const size_t ipColon = ipPort.find(':');
 		if (ipColon == std::string::npos)
 		{
-			BetteRCon::Internal::g_stdErrLog << "ERROR: Punkbuster sent an invalid IP-port\n";
+			m_errLog << "ERROR: Punkbuster sent an invalid IP-port\n";
 			return;
 		}
 
@@ -974,29 +1792,204 @@ void Server::HandlePunkbusterMessage(const std::vector<std::string>& eventArgs)
 	}
 }
 
-void Server::HandleMovePlayer(const uint8_t oldTeamId, const uint8_t oldSquadId, const std::shared_ptr<PlayerInfo>& pPlayer, const ErrorCode_t& ec, const std::vector<std::string>& response)
+void Server::PlanBatchSquads(std::vector<BatchMoveResult>& moves) const
 {
-	// connection should be closed automatically
-	if (ec)
+	using SquadSizes_t = std::array<size_t, Internal::BalanceSolver::s_maxSquadId + 1>;
+
+	// count the squads of every team that players are moving to
+	std::unordered_map<uint8_t, SquadSizes_t> teamSquadSizes;
+	for (const BatchMoveResult& move : moves)
+	{
+		if (move.error.empty() == false ||
+			teamSquadSizes.find(move.teamId) != teamSquadSizes.end())
+			continue;
+
+		SquadSizes_t& squadSizes = teamSquadSizes.emplace(move.teamId, SquadSizes_t{}).first->second;
+
+		const TeamMap_t::const_iterator teamIt = m_teams.find(move.teamId);
+		if (teamIt == m_teams.end())
+			continue;
+
+		for (const SquadMap_t::value_type& squad : teamIt->second.squads)
+		{
+			if (squad.first < squadSizes.size())
+				squadSizes[squad.first] = squad.second.size();
+		}
+	}
+
+	// players who are moving out leave room behind
+	for (const BatchMoveResult& move : moves)
+	{
+		if (move.error.empty() == false)
+			continue;
+
+		const std::unordered_map<uint8_t, SquadSizes_t>::iterator squadSizesIt = teamSquadSizes.find(move.pPlayer->teamId);
+		if (squadSizesIt != teamSquadSizes.end() &&
+			move.pPlayer->squadId < squadSizesIt->second.size() &&
+			squadSizesIt->second[move.pPlayer->squadId] > 0)
+			--squadSizesIt->second[move.pPlayer->squadId];
+	}
+
+	// moves to a specific squad take their spots first
+	for (const BatchMoveResult& move : moves)
+	{
+		if (move.error.empty() == false ||
+			move.squadId == UINT8_MAX)
+			continue;
+
+		SquadSizes_t& squadSizes = teamSquadSizes[move.teamId];
+		if (move.squadId < squadSizes.size())
+			++squadSizes[move.squadId];
+	}
+
+	// the rest are grouped by the team they are going to and the squad they are coming from, so that friends stay together
+	std::map<std::tuple<uint8_t, uint8_t, uint8_t, size_t>, std::vector<size_t>> groups;
+	for (size_t i = 0; i < moves.size(); ++i)
+	{
+		const BatchMoveResult& move = moves[i];
+		if (move.error.empty() == false ||
+			move.squadId != UINT8_MAX)
+			continue;
+
+		// players without a squad go on their own
+		const std::shared_ptr<PlayerInfo>& pPlayer = move.pPlayer;
+		groups[std::make_tuple(move.teamId, pPlayer->teamId, pPlayer->squadId, (pPlayer->squadId == 0) ? i : 0)].push_back(i);
+	}
+
+	std::vector<std::vector<size_t>*> sortedGroups;
+	sortedGroups.reserve(groups.size());
+	for (std::pair<const std::tuple<uint8_t, uint8_t, uint8_t, size_t>, std::vector<size_t>>& group : groups)
+		sortedGroups.push_back(&group.second);
+
+	// place the biggest groups first, while there is the most room
+	std::stable_sort(sortedGroups.begin(), sortedGroups.end(), [](const std::vector<size_t>* pFirst, const std::vector<size_t>* pSecond) { return pFirst->size() > pSecond->size(); });
+
+	// finds the fullest squad with room for the group, or an empty squad. returns 0 if there is none
+	const auto findSquad = [](const SquadSizes_t& squadSizes, const size_t groupSize)
+	{
+		uint8_t bestSquadId = 0;
+		for (uint8_t squadId = 1; squadId < squadSizes.size(); ++squadId)
+		{
+			if (squadSizes[squadId] + groupSize > s_maxSquadSize)
+				continue;
+
+			if (bestSquadId == 0 ||
+				squadSizes[squadId] > squadSizes[bestSquadId])
+				bestSquadId = squadId;
+		}
+
+		return bestSquadId;
+	};
+
+	for (std::vector<size_t>* pGroup : sortedGroups)
+	{
+		SquadSizes_t& squadSizes = teamSquadSizes[moves[pGroup->front()].teamId];
+
+		const uint8_t squadId = findSquad(squadSizes, pGroup->size());
+		if (squadId != 0 ||
+			pGroup->size() == 1)
+		{
+			for (const size_t moveIndex : *pGroup)
+				moves[moveIndex].squadId = squadId;
+
+			squadSizes[squadId] += pGroup->size();
+			continue;
+		}
+
+		// the group doesn't fit anywhere together, so split them up
+		for (const size_t moveIndex : *pGroup)
+		{
+			const uint8_t singleSquadId = findSquad(squadSizes, 1);
+			moves[moveIndex].squadId = singleSquadId;
+			++squadSizes[singleSquadId];
+		}
+	}
+}
+
+void Server::HandleBatchMovePlayer(const std::shared_ptr<MoveBatchState>& pBatch, const size_t moveIndex, const ErrorCode_t& ec, const std::vector<std::string>& response)
+{
+	// the batch was finished when we disconnected
+	if (pBatch->answered[moveIndex] == true)
 		return;
 
-	if (response.size() != 1)
+	pBatch->answered[moveIndex] = true;
+	BatchMoveResult& result = pBatch->results[moveIndex];
+
+	if (ec)
 	{
-		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "ERROR: MovePlayer sent an invalid response of size " << response.size() << '\n';
+		// connection should be closed automatically
+		result.error = ec.message();
+	}
+	else if (response.size() != 1)
+	{
+		// the server is not ok, disconnect. The disconnect is posted, so the batch still finishes with the move failed
+		m_errLog << "ERROR: MovePlayer sent an invalid response of size " << response.size() << '\n';
+		result.error = "InvalidResponse";
 		Disconnect();
-		return;
+	}
+	else if (response[0] != "OK")
+	{
+		m_errLog << "ERROR: Failed to move player " << result.pPlayer->name << ": " << response[0] << '\n';
+		result.error = response[0];
 	}
 
-	if (response[0] != "OK")
+	if (--pBatch->pendingMoves == 0)
+		FinishMoveBatch(pBatch);
+}
+
+void Server::FailMoveBatches()
+{
+	// the connection drops the callbacks of the commands it was still waiting on, so their moves are failed here
+	const std::vector<std::shared_ptr<MoveBatchState>> moveBatches = std::move(m_moveBatches);
+	m_moveBatches.clear();
+
+	for (const std::shared_ptr<MoveBatchState>& pBatch : moveBatches)
+	{
+		for (size_t i = 0; i < pBatch->results.size(); ++i)
+		{
+			if (pBatch->sent[i] == false ||
+				pBatch->answered[i] == true)
+				continue;
+
+			pBatch->answered[i] = true;
+			pBatch->results[i].error = "Disconnected";
+		}
+
+		pBatch->pendingMoves = 0;
+		FinishMoveBatch(pBatch);
+	}
+}
+
+void Server::FinishMoveBatch(const std::shared_ptr<MoveBatchState>& pBatch)
+{
+	const std::vector<std::shared_ptr<MoveBatchState>>::iterator batchIt = std::find(m_moveBatches.begin(), m_moveBatches.end(), pBatch);
+	if (batchIt != m_moveBatches.end())
+		m_moveBatches.erase(batchIt);
+
+	// undo the failed moves in reverse, so every player ends up where they started
+	for (size_t i = pBatch->results.size(); i-- > 0;)
 	{
-		// the move failed. move them back to their old team
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Failed to move player " << pPlayer->name << ": " << response[0] << '\n';
+		const BatchMoveResult& result = pBatch->results[i];
+		if (pBatch->sent[i] == false ||
+			result.error.empty() == true)
+			continue;
+
+		const std::shared_ptr<PlayerInfo>& pPlayer = result.pPlayer;
+
+		// they left, or the server already told us where they are
+		const PlayerMap_t::const_iterator playerIt = m_players.find(pPlayer->name);
+		if (playerIt == m_players.end() ||
+			playerIt->second != pPlayer ||
+			pPlayer->teamId != result.teamId ||
+			pPlayer->squadId != result.squadId)
+			continue;
 
-		// adjust their team and squad internally
 		RemovePlayerFromSquad(pPlayer, pPlayer->teamId, pPlayer->squadId);
-		AddPlayerToSquad(pPlayer, oldTeamId, oldSquadId);
+		AddPlayerToSquad(pPlayer, pBatch->oldSquads[i].first, pBatch->oldSquads[i].second);
 	}
+
+	if (pBatch->moveBatchCallback != nullptr)
+		pBatch->moveBatchCallback(pBatch->results);
 }
 
 void Server::AddPlayerToSquad(const std::shared_ptr<PlayerInfo>& pPlayer, const uint8_t teamId, const uint8_t squadId)
@@ -1030,21 +2023,21 @@ void Server::RemovePlayerFromSquad(const std::shared_ptr<PlayerInfo>& pPlayer, c
 	const TeamMap_t::iterator teamIt = m_teams.find(teamId);
 	if (teamIt == m_teams.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Player " << pPlayer->name << " changed squads/teams but had an invalid team\n";
+		m_errLog << "ERROR: Player " << pPlayer->name << " changed squads/teams but had an invalid team\n";
 		return;
 	}
 
 	const SquadMap_t::iterator squadIt = teamIt->second.squads.find(squadId);
 	if (squadIt == teamIt->second.squads.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Player " << pPlayer->name << " changed squads/teams but had an invalid squad\n";
+		m_errLog << "ERROR: Player " << pPlayer->name << " changed squads/teams but had an invalid squad\n";
 		return;
 	}
 
 	const PlayerMap_t::iterator playerIt = squadIt->second.find(pPlayer->name);
 	if (playerIt == squadIt->second.end())
 	{
-		BetteRCon::Internal::g_stdErrLog << "ERROR: Player " << pPlayer->name << " changed squads/teams but was not found in the internal team map\n";
+		m_errLog << "ERROR: Player " << pPlayer->name << " changed squads/teams but was not found in the internal team map\n";
 		return;
 	}
 
@@ -1087,54 +2080,128 @@ void Server::LoadPlugins()
 		if (pathStr.substr(pathStr.size() - sizeof(".plugin") + 1) != ".plugin")
 			continue;
 
-		const auto hPlugin = BLoadLibrary(file.path().string().c_str());
+		if (m_isolatePlugins == true)
+			LoadSandbox(pathStr);
+		else
+			LoadPlugin(pathStr);
+	}
+
+	BuildCommandRouter();
 
-		if (hPlugin == nullptr)
-		{
+	// isolated plugins finish loading in the background
+	if (m_loadingSandboxes.empty() == true)
+		m_finishedLoadingPluginsCallback();
+}
+
+bool Server::LoadPlugin(const std::string& path)
+{
+	const auto hPlugin = BLoadLibrary(path.c_str());
+
+	if (hPlugin == nullptr)
+	{
 #ifdef _WIN32
-			m_pluginCallback(pathStr, true, false, "Failed to open file: " + std::to_string(GetLastError()));
+		m_pluginCallback(path, true, false, "Failed to open file: " + std::to_string(GetLastError()));
 #elif __linux__
-			m_pluginCallback(pathStr, true, false, "Failed to open file: " + std::string(dlerror()));
+		m_pluginCallback(path, true, false, "Failed to open file: " + std::string(dlerror()));
 #endif
-			continue;
-		}
+		return false;
+	}
 
-		const PluginFactory_t fnPluginFactory = reinterpret_cast<PluginFactory_t>(BFindFunction(hPlugin, "CreatePlugin"));
+	const PluginFactory_t fnPluginFactory = reinterpret_cast<PluginFactory_t>(BFindFunction(hPlugin, "CreatePlugin"));
 
-		if (fnPluginFactory == nullptr)
-		{
-			m_pluginCallback(pathStr, true, false, "Failed to find CreatePlugin");
-			continue;
-		}
+	if (fnPluginFactory == nullptr)
+	{
+		m_pluginCallback(path, true, false, "Failed to find CreatePlugin");
+		return false;
+	}
+
+	const PluginDestructor_t fnPluginDestructor = reinterpret_cast<PluginDestructor_t>(BFindFunction(hPlugin, "DestroyPlugin"));
 
-		const PluginDestructor_t fnPluginDestructor = reinterpret_cast<PluginDestructor_t>(BFindFunction(hPlugin, "DestroyPlugin"));
+	if (fnPluginDestructor == nullptr)
+	{
+		m_pluginCallback(path, true, false, "Failed to find DestroyPlugin");
+		return false;
+	}
+
+	// we have a valid plugin. create an instance
+	Plugin* pPlugin = fnPluginFactory(this);
+
+	if (pPlugin == nullptr)
+	{
+		m_pluginCallback(path, true, false, "CreatePlugin returned nullptr");
+		return false;
+	}
 
-		if (fnPluginDestructor == nullptr)
+	// add the plugin to the map
+	m_plugins.emplace(pPlugin->GetPluginName(), PluginInfo{ hPlugin, pPlugin, fnPluginDestructor });
+
+	// call the callback
+	m_pluginCallback(pPlugin->GetPluginName().data(), true, true, "");
+
+	return true;
+}
+
+void Server::LoadSandbox(const std::string& path)
+{
+	// the host's commands are sent like any other, and the responses go back to the host that sent them, if it is still running
+	const std::shared_ptr<Internal::PluginSandbox> pSandbox = std::make_shared<Internal::PluginSandbox>(m_worker, m_metrics,
+		[this](const std::shared_ptr<Internal::PluginSandbox>& pSandbox, const uint32_t generation, const uint32_t sequence, const std::vector<std::string>& command)
 		{
-			m_pluginCallback(pathStr, true, false, "Failed to find DestroyPlugin");
-			continue;
-		}
+			SendCommand(command, [pWeakSandbox = std::weak_ptr<Internal::PluginSandbox>(pSandbox), generation, sequence](const ErrorCode_t& ec, const std::vector<std::string>& response)
+				{
+					if (const std::shared_ptr<Internal::PluginSandbox> pSandbox = pWeakSandbox.lock())
+						pSandbox->PostResponse(generation, sequence, ec, response);
+				});
+		});
+
+	m_loadingSandboxes.push_back(pSandbox);
+
+	pSandbox->Start(m_pluginHostPath, path, [this, pRawSandbox = pSandbox.get(), path](const bool success, const std::string& failReason)
+	{
+		// a sandbox that was stopped while it was loading is ignored
+		const std::vector<std::shared_ptr<Internal::PluginSandbox>>::iterator loadingIt = std::find_if(m_loadingSandboxes.begin(), m_loadingSandboxes.end(),
+			[pRawSandbox](const std::shared_ptr<Internal::PluginSandbox>& pSandbox) { return pSandbox.get() == pRawSandbox; });
+		if (loadingIt == m_loadingSandboxes.end())
+			return;
 
-		// we have a valid plugin. create an instance
-		Plugin* pPlugin = fnPluginFactory(this);
+		const std::shared_ptr<Internal::PluginSandbox> pSandbox = std::move(*loadingIt);
+		m_loadingSandboxes.erase(loadingIt);
 
-		if (pPlugin == nullptr)
+		if (success == false)
 		{
-			m_pluginCallback(pathStr, true, false, "CreatePlugin returned nullptr");
-			continue;
+			StopSandbox(pSandbox);
+			m_pluginCallback(path, true, false, failReason);
+		}
+		else
+		{
+			// the host can't take events until it knows the server and its players
+			pSandbox->PostServerInfo(m_serverInfoResponse);
+			pSandbox->PostPlayerList(m_playerListResponse);
+
+			m_sandboxes.emplace(pSandbox->GetPluginName(), pSandbox);
+			m_pluginCallback(pSandbox->GetPluginName(), true, true, "");
 		}
 
-		// add the plugin to the map
-		m_plugins.emplace(pPlugin->GetPluginName(), PluginInfo{ hPlugin, pPlugin, fnPluginDestructor });
+		if (m_loadingSandboxes.empty() == true)
+			m_finishedLoadingPluginsCallback();
+	});
+}
 
-		// call the callback
-		m_pluginCallback(pPlugin->GetPluginName().data(), true, true, "");
-	}
+void Server::StopSandbox(const std::shared_ptr<Internal::PluginSandbox>& pSandbox)
+{
+	// kept until its host has exited, so that destroying it doesn't wait
+	m_stoppingSandboxes.push_back(pSandbox);
 
-	m_finishedLoadingPluginsCallback();
+	pSandbox->Stop([this, pRawSandbox = pSandbox.get()]()
+	{
+		const std::vector<std::shared_ptr<Internal::PluginSandbox>>::iterator stoppingIt = std::find_if(m_stoppingSandboxes.begin(), m_stoppingSandboxes.end(),
+			[pRawSandbox](const std::shared_ptr<Internal::PluginSandbox>& pSandbox) { return pSandbox.get() == pRawSandbox; });
+		if (stoppingIt != m_stoppingSandboxes.end())
+			m_stoppingSandboxes.erase(stoppingIt);
+	});
 }
 
-void Server::InitializeServer()
+void Server::RegisterServerHandlers()
 {
 	// register the event callbacks
 	RegisterPrePluginCallback("player.onAuthenticated",
@@ -1161,12 +2228,23 @@ void Server::InitializeServer()
 	RegisterPrePluginCallback("player.onTeamChange",
 		std::bind(&Server::HandleOnTeamChange,
 			this, std::placeholders::_1));
+	RegisterPrePluginCallback("server.onRoundOver",
+		std::bind(&Server::HandleOnRoundOver,
+			this, std::placeholders::_1));
 	RegisterPrePluginCallback("server.onRoundOverPlayers",
 		std::bind(&Server::HandleOnRoundEnd,
 			this, std::placeholders::_1));
 	RegisterPrePluginCallback("punkBuster.onMessage",
 		std::bind(&Server::HandlePunkbusterMessage,
 			this, std::placeholders::_1));
+}
+
+void Server::InitializeServer()
+{
+	RegisterServerHandlers();
+
+	LoadChatFilter();
+	LoadCommandLimits();
 
 	LoadPlugins();
 }
@@ -1181,7 +2259,7 @@ void Server::HandleServerInfo(const ErrorCode_t& ec, const std::vector<std::stri
 		serverInfo.size() != 26)
 	{
 		// disconnect, the server is not OK
-		BetteRCon::Internal::g_stdErrLog << "ServerInfo size invalid: " << serverInfo.size() << '\n';
+		m_errLog << "ServerInfo size invalid: " << serverInfo.size() << '\n';
 		Disconnect();
 		return;
 	}
@@ -1189,7 +2267,7 @@ void Server::HandleServerInfo(const ErrorCode_t& ec, const std::vector<std::stri
 	if (serverInfo[0] != "OK")
 	{
 		// disconnect, the server is not OK
-		BetteRCon::Internal::g_stdErrLog << "ServerInfo response not OK: " << serverInfo[0] << '\n';
+		m_errLog << "ServerInfo response not OK: " << serverInfo[0] << '\n';
 		Disconnect();
 		return;
 	}
@@ -1238,14 +2316,41 @@ void Server::HandleServerInfo(const ErrorCode_t& ec, const std::vector<std::stri
 	catch (const std::exception& e)
 	{
 		// they sent bad serverInfo. disconnect
-		BetteRCon::Internal::g_stdErrLog << "Error parsing serverInfo: " << e.what() << '\n';
+		m_errLog << "Error parsing serverInfo: " << e.what() << '\n';
 		Disconnect();
 		return;
 	}
 
+	// isolated plugins are sent the response instead of polling for it themselves
+	if (m_isolatePlugins == true)
+	{
+		m_serverInfoResponse = serverInfo;
+		for (decltype(m_sandboxes)::value_type& sandbox : m_sandboxes)
+			sandbox.second->PostServerInfo(serverInfo);
+	}
+
 	// fire a serverInfo event
 	FireEvent({ "bettercon.serverInfo" });
 
+	// update the forecast with the new scores. the words are the predicted winner, the seconds remaining,
+	// the number of teams, then the score, score per minute and predicted score of each team
+	m_ticketForecaster.AddSample(m_serverInfo.m_roundTime, m_serverInfo.m_scores.m_teamScores, m_serverInfo.m_scores.m_goalScore);
+
+	const TicketForecast_t& forecast = m_ticketForecaster.GetForecast();
+	if (forecast.teams.empty() == false)
+	{
+		std::vector<std::string> forecastArgs{ "bettercon.ticketForecast", std::to_string(forecast.predictedWinner),
+			std::to_string(static_cast<int32_t>(forecast.secondsRemaining)), std::to_string(forecast.teams.size()) };
+		for (const Internal::TicketForecaster::TeamForecast& teamForecast : forecast.teams)
+		{
+			forecastArgs.push_back(std::to_string(teamForecast.score));
+			forecastArgs.push_back(std::to_string(teamForecast.ratePerMinute));
+			forecastArgs.push_back(std::to_string(teamForecast.predictedScore));
+		}
+
+		FireEvent(forecastArgs);
+	}
+
 	// call the serverInfo callback
 	m_serverInfoCallback(m_serverInfo);
 
@@ -1257,6 +2362,10 @@ void Server::HandleServerInfo(const ErrorCode_t& ec, const std::vector<std::stri
 		m_initializedServer = true;
 	}
 
+	// a plugin host waits for the server process to send it the next one
+	if (m_isPluginHost == true)
+		return;
+
 	// reset the timer and wait again
 	m_serverInfoTimer.expires_from_now(std::chrono::seconds(15));
 	m_serverInfoTimer.async_wait(std::bind(
@@ -1270,9 +2379,14 @@ void Server::HandleServerInfoTimerExpire(const ErrorCode_t& ec)
 	if (ec)
 		return;
 
-	SendCommand({ "serverInfo" }, std::bind(
-		&Server::HandleServerInfo, this,
-		std::placeholders::_1, std::placeholders::_2));
+	const std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+	SendCommand({ "serverInfo" }, [this, sent](const ErrorCode_t& ec, const std::vector<std::string>& serverInfo)
+		{
+			if (!ec)
+				m_pServerInfoPollSeconds->Observe(std::chrono::steady_clock::now() - sent);
+
+			HandleServerInfo(ec, serverInfo);
+		});
 }
 
 void Server::HandlePlayerList(const ErrorCode_t& ec, const std::vector<std::string>& playerInfo)
@@ -1282,7 +2396,8 @@ void Server::HandlePlayerList(const ErrorCode_t& ec, const std::vector<std::stri
 		return;
 
 	// see if punkbuster is looking for player info yet
-	if (m_punkbusterPlayerListTimer.expiry() < std::chrono::steady_clock::now())
+	if (m_isPluginHost == false &&
+		m_punkbusterPlayerListTimer.expiry() < std::chrono::steady_clock::now())
 	{
 		// start the punkbuster playerList loop
 		m_punkbusterPlayerListTimer.async_wait(std::bind(
@@ -1293,20 +2408,27 @@ void Server::HandlePlayerList(const ErrorCode_t& ec, const std::vector<std::stri
 	if (playerInfo.size() < 1)
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "PlayerInfo sent empty response\n";
+		m_errLog << "PlayerInfo sent empty response\n";
 		Disconnect();
 		return;
 	}
 	else if (playerInfo[0] != "OK")
 	{
 		// the server is not ok, disconnect
-		BetteRCon::Internal::g_stdErrLog << "PlayerInfo sent not OK response: " << playerInfo[0] << '\n';
+		m_errLog << "PlayerInfo sent not OK response: " << playerInfo[0] << '\n';
 		Disconnect();
 		return;
 	}
 
 	HandlePlayerInfo(playerInfo);
 
+	if (m_isolatePlugins == true)
+	{
+		m_playerListResponse = playerInfo;
+		for (decltype(m_sandboxes)::value_type& sandbox : m_sandboxes)
+			sandbox.second->PostPlayerList(playerInfo);
+	}
+
 	m_gotServerPlayers = true;
 	if (m_initializedServer == false &&
 		m_gotServerInfo == true)
@@ -1315,6 +2437,10 @@ void Server::HandlePlayerList(const ErrorCode_t& ec, const std::vector<std::stri
 		m_initializedServer = true;
 	}
 
+	// likewise for the players
+	if (m_isPluginHost == true)
+		return;
+
 	// reset the timer and wait again
 	m_playerInfoTimer.expires_from_now(std::chrono::seconds(15));
 	m_playerInfoTimer.async_wait(std::bind(
@@ -1328,9 +2454,14 @@ void Server::HandlePlayerListTimerExpire(const ErrorCode_t& ec)
 	if (ec)
 		return;
 	
-	SendCommand({ "admin.listPlayers", "all" }, std::bind(
-		&Server::HandlePlayerList, this,
-		std::placeholders::_1, std::placeholders::_2));
+	const std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+	SendCommand({ "admin.listPlayers", "all" }, [this, sent](const ErrorCode_t& ec, const std::vector<std::string>& playerList)
+		{
+			if (!ec)
+				m_pPlayerListPollSeconds->Observe(std::chrono::steady_clock::now() - sent);
+
+			HandlePlayerList(ec, playerList);
+		});
 }
 
 void Server::HandlePunkbusterPlayerList(const ErrorCode_t& ec, const std::vector<std::string>& response)
@@ -1341,7 +2472,7 @@ void Server::HandlePunkbusterPlayerList(const ErrorCode_t& ec, const std::vector
 	if (response.size() < 1)
 	{
 		// disconnect, the server is not OK
-		BetteRCon::Internal::g_stdErrLog << "Punkbuster PlayerList response empty\n";
+		m_errLog << "Punkbuster PlayerList response empty\n";
 		Disconnect();
 		return;
 
@@ -1350,7 +2481,7 @@ void Server::HandlePunkbusterPlayerList(const ErrorCode_t& ec, const std::vector
 	if (response[0] != "OK")
 	{
 		// disconnect, the server is not OK
-		BetteRCon::Internal::g_stdErrLog << "Punkbuster PlayerList sent not OK response: " << response[0] << '\n';
+		m_errLog << "Punkbuster PlayerList sent not OK response: " << response[0] << '\n';
 		Disconnect();
 		return;
 	}
@@ -1362,7 +2493,12 @@ void Server::HandlePunkbusterPlayerListTimerExpire(const ErrorCode_t& ec)
 	if (ec)
 		return;
 
-	SendCommand({ "punkBuster.pb_sv_command", "pb_sv_plist" }, 
-		std::bind(&Server::HandlePunkbusterPlayerList, this,
-			std::placeholders::_1, std::placeholders::_2));
+	const std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+	SendCommand({ "punkBuster.pb_sv_command", "pb_sv_plist" }, [this, sent](const ErrorCode_t& ec, const std::vector<std::string>& response)
+		{
+			if (!ec)
+				m_pPunkbusterPlayerListPollSeconds->Observe(std::chrono::steady_clock::now() - sent);
+
+			HandlePunkbusterPlayerList(ec, response);
+		});
 }
\ No newline at end of file
@@ -1,9 +1,15 @@
 #include <BetteRCon/Plugin.h>
+#include <BetteRCon/Internal/Serialization.h>
 
 // STL
+#include <bitset>
 #include <chrono>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <queue>
 #include <streambuf>
 #include <string>
 #include <unordered_map>
@@ -25,6 +31,54 @@ private:
 		std::chrono::system_clock::time_point expiry;
 	};
 
+	// Bloom filter over VIP GUIDs. Most players are not VIPs, so this answers the common case without touching the map
+	class GUIDBloomFilter
+	{
+	public:
+		void Add(const std::string& guid)
+		{
+			const size_t hash = std::hash<std::string>{}(guid);
+			for (size_t i = 0; i < s_numHashes; ++i)
+				m_bits.set(GetBit(hash, i));
+		}
+
+		bool MightContain(const std::string& guid) const
+		{
+			const size_t hash = std::hash<std::string>{}(guid);
+			for (size_t i = 0; i < s_numHashes; ++i)
+			{
+				if (m_bits.test(GetBit(hash, i)) == false)
+					return false;
+			}
+			return true;
+		}
+
+		void Clear() { m_bits.reset(); }
+	private:
+		static constexpr size_t s_numBits = 1 << 14;
+		static constexpr size_t s_numHashes = 4;
+
+		// double hashing, deriving each probe from the two halves of one hash
+		static size_t GetBit(const size_t hash, const size_t i)
+		{
+			const uint32_t h1 = static_cast<uint32_t>(hash);
+			const uint32_t h2 = static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32) | 1;
+			return (h1 + i * h2) % s_numBits;
+		}
+
+		std::bitset<s_numBits> m_bits;
+	};
+
+	enum VIPRecordType : uint8_t
+	{
+		VIPRecordType_Set,
+		VIPRecordType_Remove
+	};
+
+	// the VIP database is a journal of records
+	static constexpr uint32_t s_vipDatabaseTag = BetteRCon::Internal::MakeSchemaTag("VIPS");
+	static constexpr uint32_t s_vipDatabaseVersion = 1;
+
 	using Hours_t = std::chrono::hours;
 	using Days_t = std::chrono::duration<int, std::ratio_multiply<std::ratio<24>, Hours_t::period>>;
 	using Weeks_t = std::chrono::duration<int, std::ratio_multiply<std::ratio<7>, Days_t::period>>;
@@ -36,10 +90,22 @@ private:
 	using ServerInfo_t = BetteRCon::Server::ServerInfo;
 	using Team_t = BetteRCon::Server::Team;
 	using VIPMap_t = std::unordered_map<std::string, VIP>;
+	using ExpiryEntry_t = std::pair<std::chrono::system_clock::time_point, std::string>;
+	using ExpiryHeap_t = std::priority_queue<ExpiryEntry_t, std::vector<ExpiryEntry_t>, std::greater<ExpiryEntry_t>>;
 
 	PendingVIPMap_t m_pendingVIPs;
 	// may have some duplicates
 	VIPMap_t m_VIPs;
+	GUIDBloomFilter m_vipFilter;
+
+	// min-heap of VIP expiries. entries are not removed when a VIP is extended, so they are checked against m_VIPs when popped
+	ExpiryHeap_t m_expiryHeap;
+	// the expiry the timer is currently scheduled for, and a generation to invalidate superseded timers
+	std::chrono::system_clock::time_point m_scheduledExpiry = std::chrono::system_clock::time_point::max();
+	uint32_t m_expiryTimerGeneration = 0;
+
+	// number of records in the journal, used to decide when to compact it
+	size_t m_journalRecords = 0;
 
 	std::chrono::system_clock::duration ParseDuration(const std::string& durationStr)
 	{
@@ -95,47 +161,32 @@ private:
 				return;
 			}
 
-			// split the name and duration up, and add it to our admin maps
-			std::string name = pendingVIPLine.substr(0, comma);
-			std::string duration = pendingVIPLine.substr(comma + 1);
+			// split the name and duration up, and add it to our pending map
+			m_pendingVIPs.emplace(pendingVIPLine.substr(0, comma), pendingVIPLine.substr(comma + 1));
+		}
 
-			// check to see if the player is in-game already
-			const PlayerMap_t players = GetPlayers();
+		inFile.close();
 
-			const PlayerMap_t::const_iterator playerIt = players.find(name);
-			if (playerIt != players.end())
-			{
-				const std::shared_ptr<PlayerInfo_t> pPlayer = playerIt->second;
+		// resolve the pending VIPs that are in-game in one pass against the player table
+		const size_t numPendingVIPs = m_pendingVIPs.size();
+		const PlayerMap_t& players = GetPlayers();
 
-				// the player is in-game. first see if they are already a VIP
-				const VIPMap_t::iterator vipIt = m_VIPs.find(pPlayer->GUID);
-				if (vipIt != m_VIPs.end())
-				{
-					// they are a VIP already. update their duration
-					VIP& VIP = vipIt->second;
-					VIP.expiry += ParseDuration(duration);
-					
-					// make sure it is not expired
-					if (std::chrono::system_clock::now() >= VIP.expiry)
-					{
-						// remove them
-						m_VIPs.erase(vipIt);
-						continue;
-					}
-				}
-				m_VIPs.emplace(pPlayer->GUID, VIP{ pPlayer->name, pPlayer->GUID, std::chrono::system_clock::now() + ParseDuration(duration) });
+		for (PendingVIPMap_t::iterator pendingVIPIt = m_pendingVIPs.begin(); pendingVIPIt != m_pendingVIPs.end();)
+		{
+			const PlayerMap_t::const_iterator playerIt = players.find(pendingVIPIt->first);
+			if (playerIt == players.end())
+			{
+				++pendingVIPIt;
 				continue;
 			}
 
-			// create a new pending VIP with the duration
-			m_pendingVIPs.emplace(std::move(name), duration);
+			AddVIP(playerIt->second->name, playerIt->second->GUID, ParseDuration(pendingVIPIt->second));
+			pendingVIPIt = m_pendingVIPs.erase(pendingVIPIt);
 		}
 
-		inFile.close();
-
-		// write the database to show changes
-		WritePendingVIPDatabase();
-		WriteVIPDatabase();
+		// write the pending database to show changes
+		if (m_pendingVIPs.size() != numPendingVIPs)
+			WritePendingVIPDatabase();
 	}
 	void WritePendingVIPDatabase() 
 	{
@@ -151,118 +202,265 @@ private:
 		outFile.close();
 	}
 
-	void ReadVIPDatabase() 
+	static void SerializeVIPRecord(BetteRCon::Internal::RecordWriter& record, const VIPRecordType type, const VIP& VIP)
 	{
-		// open the input file
-		std::ifstream inFile("plugins/VIPs.cfg", std::ios::binary);
-		if (inFile.good() == false)
-			return;
+		record.Clear();
+		record.Write(type);
+		record.WriteString(VIP.name);
+		record.WriteString(VIP.eaguid);
+		record.WriteTimePoint(VIP.expiry);
+	}
 
-		// read the file into a vector
-		std::vector<char> dbData(std::istreambuf_iterator<char>(inFile), {});
+	void ApplyVIPRecord(const uint8_t type, VIP&& VIP)
+	{
+		if (type == VIPRecordType_Set)
+			m_VIPs.insert_or_assign(VIP.eaguid, std::move(VIP));
+		else if (type == VIPRecordType_Remove)
+			m_VIPs.erase(VIP.eaguid);
+	}
 
-		// empty DB
-		if (dbData.size() == 0)
-			return;
+	void ReadLegacyVIPDatabase(BetteRCon::Internal::RecordReader reader)
+	{
+		// older databases are a count of VIPs, with one-byte string lengths
+		const uint32_t dbSize = reader.Read<uint32_t>();
+		for (uint32_t i = 0; i < dbSize && reader.IsGood() == true; ++i)
+		{
+			VIP VIP;
+			VIP.name = reader.ReadView(reader.Read<uint8_t>());
+			VIP.eaguid = reader.ReadView(reader.Read<uint8_t>());
+			VIP.expiry = reader.ReadTimePoint();
+
+			if (reader.IsGood() == true)
+				ApplyVIPRecord(VIPRecordType_Set, std::move(VIP));
+		}
 
-		const uint32_t dbSize = *reinterpret_cast<uint32_t*>(&dbData[0]);
+		if (reader.IsGood() == false)
+			BetteRCon::Internal::g_stdErrLog << "[VIPManager] Invalid VIP DB, ignoring the rest\n";
+	}
+
+	// returns false if the database exists but can't be read, in which case the plugin is disabled without writing anything
+	bool ReadVIPDatabase() 
+	{
+		BetteRCon::Internal::DatabaseReader dbReader;
+		const BetteRCon::Internal::DatabaseReader::Status status = dbReader.Open("plugins/VIPs.cfg", s_vipDatabaseTag, s_vipDatabaseVersion);
+		if (status == BetteRCon::Internal::DatabaseReader::Status_NotFound)
+			return true;
 
-		size_t offset = sizeof(uint32_t);
-		for (size_t i = 0; i < dbSize; ++i)
+		m_VIPs.clear();
+
+		if (status == BetteRCon::Internal::DatabaseReader::Status_BadHeader)
+		{
+			// this is a database from before the shared format, read it the old way
+			ReadLegacyVIPDatabase(dbReader.GetRawReader());
+		}
+		else if (status == BetteRCon::Internal::DatabaseReader::Status_OK)
 		{
-			// naive bounds checking
-			if (offset >= dbData.size())
+			// replay the journal
+			BetteRCon::Internal::RecordReader record;
+			while (dbReader.Next(record) == true)
 			{
-				BetteRCon::Internal::g_stdErrLog << "[VIPManager] Invalid VIP DB\n";
-				return;
+				const uint8_t type = record.Read<uint8_t>();
+
+				VIP VIP;
+				VIP.name = record.ReadString();
+				VIP.eaguid = record.ReadString();
+				VIP.expiry = record.ReadTimePoint();
+
+				if (record.IsGood() == false)
+				{
+					BetteRCon::Internal::g_stdErrLog << "[VIPManager] Malformed VIP DB record\n";
+					continue;
+				}
+
+				ApplyVIPRecord(type, std::move(VIP));
 			}
 
-			// read the name
-			const uint8_t nameLen = *reinterpret_cast<uint8_t*>(&dbData[offset]);
-			++offset;
+			// a torn write at the end of the journal. everything before it is still good
+			if (dbReader.GetStatus() != BetteRCon::Internal::DatabaseReader::Status_OK)
+				BetteRCon::Internal::g_stdErrLog << "[VIPManager] Stopped replaying VIP DB: " << BetteRCon::Internal::DatabaseReader::s_StatusStr[dbReader.GetStatus()] << '\n';
+		}
+		else
+		{
+			// don't compact over a database we can't read
+			BetteRCon::Internal::g_stdErrLog << "[VIPManager] Failed to open VIP DB: " << BetteRCon::Internal::DatabaseReader::s_StatusStr[status] << '\n';
+			Plugin::Disable();
+			return false;
+		}
 
-			std::string name(&dbData[offset], nameLen);
-			offset += nameLen;
+		// drop anybody who expired while we were not running
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+		for (VIPMap_t::iterator vipIt = m_VIPs.begin(); vipIt != m_VIPs.end();)
+		{
+			if (now >= vipIt->second.expiry)
+				vipIt = m_VIPs.erase(vipIt);
+			else
+				++vipIt;
+		}
 
-			// read the guid
-			const uint8_t guidLen = *reinterpret_cast<uint8_t*>(&dbData[offset]);
-			++offset;
+		RebuildVIPIndex();
 
-			std::string guid(&dbData[offset], guidLen);
-			offset += guidLen;
+		// compact the journal to reflect changes
+		WriteVIPDatabase();
 
-			// read the time point
-			std::chrono::system_clock::time_point tp = std::chrono::system_clock::from_time_t(*reinterpret_cast<time_t*>(&dbData[offset]));
-			offset += sizeof(time_t);
+		return true;
+	}
+	void WriteVIPDatabase() 
+	{
+		BetteRCon::Internal::DatabaseWriter dbWriter;
+		if (dbWriter.Create("plugins/VIPs.cfg", s_vipDatabaseTag, s_vipDatabaseVersion) == false)
+		{
+			BetteRCon::Internal::g_stdErrLog << "[VIPManager] Failed to open VIP DB for writing\n";
+			return;
+		}
 
-			// make sure they are not expired
-			if (std::chrono::system_clock::now() >= tp)
-				continue;
+		// stream one record per VIP
+		BetteRCon::Internal::RecordWriter record;
+		for (const VIPMap_t::value_type& vipPair : m_VIPs)
+		{
+			SerializeVIPRecord(record, VIPRecordType_Set, vipPair.second);
+			dbWriter.WriteRecord(record);
+		}
 
-			m_VIPs.emplace(guid, VIP{ std::move(name), guid, tp });
+		if (dbWriter.Commit() == false)
+		{
+			BetteRCon::Internal::g_stdErrLog << "[VIPManager] Failed to write VIP DB\n";
+			return;
 		}
-		
-		inFile.close();
 
-		// write the new database to reflect changes
-		WriteVIPDatabase();
+		m_journalRecords = m_VIPs.size();
 	}
-	void WriteVIPDatabase() 
+	void AppendVIPRecord(const VIPRecordType type, const VIP& VIP)
 	{
-		// open the output file
-		std::ofstream outFile("plugins/VIPs.cfg", std::ios::binary);
-		if (outFile.good() == false)
+		// compact instead if the journal is mostly dead records
+		if (m_journalRecords + 1 > m_VIPs.size() * 2 + 64)
+		{
+			WriteVIPDatabase();
+			return;
+		}
+
+		BetteRCon::Internal::DatabaseWriter dbWriter;
+		if (dbWriter.Append("plugins/VIPs.cfg", s_vipDatabaseTag, s_vipDatabaseVersion) == false)
 			return;
 
-		// write the number of VIPs
-		std::vector<char> dbData(sizeof(uint32_t));
+		BetteRCon::Internal::RecordWriter record;
+		SerializeVIPRecord(record, type, VIP);
 
-		*reinterpret_cast<uint32_t*>(&dbData[0]) = m_VIPs.size();
+		if (dbWriter.WriteRecord(record) == true &&
+			dbWriter.Commit() == true)
+			++m_journalRecords;
+	}
+
+	void RebuildVIPIndex()
+	{
+		// rebuild the bloom filter, since it can't remove entries
+		m_vipFilter.Clear();
+		m_expiryHeap = ExpiryHeap_t();
 
 		for (const VIPMap_t::value_type& vipPair : m_VIPs)
 		{
-			const VIP& VIP = vipPair.second;
-			const std::string& name = VIP.name;
+			m_vipFilter.Add(vipPair.first);
+			m_expiryHeap.emplace(vipPair.second.expiry, vipPair.first);
+		}
+
+		ScheduleExpiryTimer();
+	}
+
+	void AddVIP(const std::string& name, const std::string& guid, const std::chrono::system_clock::duration& duration)
+	{
+		// existing VIPs have their duration extended
+		VIPMap_t::iterator vipIt = m_VIPs.find(guid);
+		if (vipIt != m_VIPs.end())
+			vipIt->second.expiry += duration;
+		else
+			vipIt = m_VIPs.emplace(guid, VIP{ name, guid, std::chrono::system_clock::now() + duration }).first;
+
+		VIP& VIP = vipIt->second;
+
+		// make sure it is not expired
+		if (std::chrono::system_clock::now() >= VIP.expiry)
+		{
+			RemoveVIP(vipIt);
+			return;
+		}
+
+		m_vipFilter.Add(guid);
+		m_expiryHeap.emplace(VIP.expiry, guid);
+		AppendVIPRecord(VIPRecordType_Set, VIP);
+
+		ScheduleExpiryTimer();
+	}
+
+	void RemoveVIP(const VIPMap_t::iterator vipIt)
+	{
+		// erase them first, in case appending compacts the journal
+		const VIP VIP = std::move(vipIt->second);
+		m_VIPs.erase(vipIt);
+		AppendVIPRecord(VIPRecordType_Remove, VIP);
 
-			// write the name's length
-			dbData.push_back(name.size() % 0xff);
+		// the heap entry goes stale and is skipped, and the bloom filter is allowed false positives
+	}
 
-			// write the string
-			dbData.insert(dbData.end(), name.begin(), name.end());
+	void ExpireVIPs()
+	{
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
 
-			const std::string& guid = VIP.eaguid;
-			// write the guid's length
-			dbData.push_back(guid.size() % 0xff);
+		while (m_expiryHeap.empty() == false &&
+			m_expiryHeap.top().first <= now)
+		{
+			const ExpiryEntry_t expiryEntry = m_expiryHeap.top();
+			m_expiryHeap.pop();
 
-			// write the guid
-			dbData.insert(dbData.end(), guid.begin(), guid.end());
+			// make sure the entry is not stale from an extension or removal
+			const VIPMap_t::iterator vipIt = m_VIPs.find(expiryEntry.second);
+			if (vipIt == m_VIPs.end() ||
+				vipIt->second.expiry != expiryEntry.first)
+				continue;
 
-			// write the expiry time
-			dbData.resize(dbData.size() + sizeof(time_t));
-			*reinterpret_cast<time_t*>(&dbData[dbData.size() - sizeof(time_t)]) = std::chrono::system_clock::to_time_t(VIP.expiry);
+			BetteRCon::Internal::g_stdOutLog << "[VIPManager] VIP status for " << vipIt->second.name << " expired\n";
+			RemoveVIP(vipIt);
 		}
 
-		outFile.write(dbData.data(), dbData.size());
-		outFile.close();
+		ScheduleExpiryTimer();
+	}
+
+	void ScheduleExpiryTimer()
+	{
+		if (m_expiryHeap.empty() == true)
+			return;
+
+		// the timer already fires early enough
+		const std::chrono::system_clock::time_point nextExpiry = m_expiryHeap.top().first;
+		if (nextExpiry >= m_scheduledExpiry)
+			return;
+
+		m_scheduledExpiry = nextExpiry;
+
+		const uint32_t generation = ++m_expiryTimerGeneration;
+		const std::chrono::milliseconds timeUntilExpiry = std::chrono::duration_cast<std::chrono::milliseconds>(nextExpiry - std::chrono::system_clock::now());
+
+		ScheduleAction([this, generation]
+		{
+			// a sooner expiry replaced this timer
+			if (generation != m_expiryTimerGeneration)
+				return;
+
+			m_scheduledExpiry = std::chrono::system_clock::time_point::max();
+			ExpireVIPs();
+		}, static_cast<size_t>(std::max<int64_t>(timeUntilExpiry.count(), 0)) + 1);
 	}
 
 	bool IsVIP(const std::shared_ptr<PlayerInfo_t>& pPlayer)
 	{
-		// first see if they are in the GUID db
-		const VIPMap_t::iterator vipIt = m_VIPs.find(pPlayer->GUID);
-		if (vipIt == m_VIPs.end())
+		// most players are not VIPs
+		if (m_vipFilter.MightContain(pPlayer->GUID) == false)
 			return false;
 
-		// see if their VIP status expired
-		if (std::chrono::system_clock::now() >= vipIt->second.expiry)
-		{
-			// remove them
-			m_VIPs.erase(vipIt);
-			WriteVIPDatabase();
+		const VIPMap_t::const_iterator vipIt = m_VIPs.find(pPlayer->GUID);
+		if (vipIt == m_VIPs.end())
 			return false;
-		}
 
-		return true;
+		// the expiry timer removes them, but it may not have fired yet
+		return std::chrono::system_clock::now() < vipIt->second.expiry;
 	}
 
 	void HandleKillMe(const std::shared_ptr<PlayerInfo_t>& pPlayer, const std::vector<std::string>& args, const char prefix)
@@ -302,25 +500,23 @@ private:
 			return;
 		}
 
-		// see if the enemy team has room
+		// see if the enemy team has room. VIPs are allowed to stack, so only the size of the team matters
 		const uint8_t newTeamId = (pPlayer->teamId % 2) + 1;
-		const Team_t& newTeam = GetTeam(newTeamId);
-
-		const ServerInfo_t& serverInfo = GetServerInfo();
-		const std::vector<int32_t>& teamScores = serverInfo.m_scores.m_teamScores;
 
-		const uint32_t maxTeamSize = (teamScores.size() != 0) ? serverInfo.m_maxPlayerCount / teamScores.size() : 0;
+		BetteRCon::Server::BalanceOptions_t options;
+		options.maxStrengthRatio = std::numeric_limits<float>::infinity();
+		options.maxTeamSizeDifference = UINT32_MAX;
+		options.maxBalanceMoves = 0;
 
-		const uint32_t teamSize = newTeam.playerCount - newTeam.commanderCount;
-
-		if (teamSize >= maxTeamSize)
+		const BetteRCon::Server::BalancePlan plan = PlanTeamBalance({ { pPlayer, newTeamId } }, [](const PlayerInfo_t&) { return 1.f; }, options);
+		if (plan.moves.empty() == true)
 		{
 			SendChatMessage("The enemy team is full!", pPlayer);
 			return;
 		}
 
 		// switch the player
-		MovePlayer(newTeamId, UINT8_MAX, pPlayer);
+		MovePlayer(newTeamId, plan.moves.front().squadId, pPlayer);
 		SendChatMessage("Get used to your new comrades.", pPlayer);
 	}
 
@@ -329,20 +525,62 @@ private:
 		if (eventArgs.size() != 3)
 			return;
 
-		// check to see if they are in the VIP db
-		const VIPMap_t::iterator vipIt = m_VIPs.find(eventArgs[2]);
-		if (vipIt == m_VIPs.end())
+		// expiry is handled by the expiry timer. see if they are a pending VIP we can resolve now that we have their GUID
+		const PendingVIPMap_t::iterator pendingVIPIt = m_pendingVIPs.find(eventArgs[1]);
+		if (pendingVIPIt == m_pendingVIPs.end())
 			return;
 
-		// check to see if their VIP status has expired
-		if (std::chrono::system_clock::now() >= vipIt->second.expiry)
-			m_VIPs.erase(vipIt);
+		AddVIP(eventArgs[1], eventArgs[2], ParseDuration(pendingVIPIt->second));
+		m_pendingVIPs.erase(pendingVIPIt);
+
+		WritePendingVIPDatabase();
 	}
 
-	void HandleOnLevelLoaded(const std::vector<std::string>&)
+	void HandlePendingVIPDatabaseChanged(const BetteRCon::Server::FileDiff_t& diff)
 	{
-		// load the pending VIP database to see if new VIPs have been added
-		ReadPendingVIPDatabase();
+		// pending VIPs that were resolved or deleted by hand. our own writes also land here, so this must be idempotent
+		for (const std::string& pendingVIPLine : diff.removedLines)
+		{
+			const size_t comma = pendingVIPLine.find(',');
+			if (comma == std::string::npos)
+				continue;
+
+			const PendingVIPMap_t::iterator pendingVIPIt = m_pendingVIPs.find(pendingVIPLine.substr(0, comma));
+			if (pendingVIPIt != m_pendingVIPs.end() &&
+				pendingVIPIt->second == pendingVIPLine.substr(comma + 1))
+				m_pendingVIPs.erase(pendingVIPIt);
+		}
+
+		// new pending VIPs. resolve the ones that are in-game right away
+		bool resolvedAny = false;
+		const PlayerMap_t& players = GetPlayers();
+		for (const std::string& pendingVIPLine : diff.addedLines)
+		{
+			const size_t comma = pendingVIPLine.find(',');
+			if (comma == std::string::npos)
+			{
+				BetteRCon::Internal::g_stdErrLog << "[VIPManager] Failed to find comma for pending VIP " << pendingVIPLine << '\n';
+				continue;
+			}
+
+			std::string name = pendingVIPLine.substr(0, comma);
+			std::string duration = pendingVIPLine.substr(comma + 1);
+
+			const PlayerMap_t::const_iterator playerIt = players.find(name);
+			if (playerIt == players.end())
+			{
+				m_pendingVIPs.insert_or_assign(std::move(name), std::move(duration));
+				continue;
+			}
+
+			AddVIP(playerIt->second->name, playerIt->second->GUID, ParseDuration(duration));
+			m_pendingVIPs.erase(name);
+			resolvedAny = true;
+		}
+
+		// write the pending database to show changes
+		if (resolvedAny == true)
+			WritePendingVIPDatabase();
 	}
 public:
 	VIPManager(BetteRCon::Server* pServer)
@@ -354,16 +592,41 @@ public:
 
 		// register event handlers
 		RegisterHandler("player.onJoin", std::bind(&VIPManager::HandleOnJoin, this, std::placeholders::_1));
-		RegisterHandler("server.onLevelLoaded", std::bind(&VIPManager::HandleOnLevelLoaded, this, std::placeholders::_1));
+
+		// pick up pending VIPs that are added while we are running
+		WatchFile("plugins/PendingVIPs.cfg", std::bind(&VIPManager::HandlePendingVIPDatabaseChanged, this, std::placeholders::_1));
 	}
 
 	virtual std::string_view GetPluginAuthor() const { return "MrElectrify"; }
 	virtual std::string_view GetPluginName() const { return "VIPManager"; }
-	virtual std::string_view GetPluginVersion() const { return "v1.0.1"; }
+	virtual std::string_view GetPluginVersion() const { return "v1.2.0"; }
+
+	virtual void Enable() 
+	{ 
+		Plugin::Enable(); 
+
+		// the pending VIPs are left alone too if the database couldn't be read
+		if (ReadVIPDatabase() == false)
+			return;
+
+		ReadPendingVIPDatabase(); 
+	}
+
+	virtual void Disable() 
+	{ 
+		// a plugin that disabled itself because it couldn't read the database has nothing of its own to write
+		if (IsEnabled() == false)
+			return;
 
-	virtual void Enable() { Plugin::Enable(); ReadVIPDatabase(); ReadPendingVIPDatabase(); }
+		Plugin::Disable(); 
 
-	virtual void Disable() { Plugin::Disable(); WriteVIPDatabase(); WritePendingVIPDatabase(); }
+		// invalidate the expiry timer
+		++m_expiryTimerGeneration;
+		m_scheduledExpiry = std::chrono::system_clock::time_point::max();
+
+		WriteVIPDatabase(); 
+		WritePendingVIPDatabase(); 
+	}
 
 	virtual ~VIPManager() {}
 };